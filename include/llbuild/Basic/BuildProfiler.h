@@ -0,0 +1,155 @@
+//===- BuildProfiler.h ------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLBUILD_BASIC_BUILDPROFILER_H
+#define LLBUILD_BASIC_BUILDPROFILER_H
+
+#include "llbuild/Basic/Compiler.h"
+#include "llbuild/Basic/LLVM.h"
+
+#include "llvm/ADT/StringRef.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace llvm {
+class raw_fd_ostream;
+}
+
+namespace llbuild {
+namespace basic {
+
+struct ProcessResult;
+
+/// A profiler which records the execution of the commands in a build, and
+/// writes it as a Chrome trace event file (which can be viewed with Chrome's
+/// about:tracing, or with Perfetto).
+///
+/// Each command which runs is written as a single complete event on the track
+/// of the lane which executed it. The event arguments record the time the
+/// engine spent scanning the command, the time it waited for its inputs and
+/// for a free lane, and the resource usage of the processes it ran.
+///
+/// Commands are identified by an opaque pointer, which must remain unique while
+/// the command is active. Every notification is optional, and all methods are
+/// thread-safe and do nothing unless the profiler is open.
+class BuildProfiler {
+  struct CommandRecord {
+    /// The time the engine started scanning the command, if known.
+    uint64_t scanStartTime = ~uint64_t(0);
+
+    /// The time the engine determined the command needs to run, if known.
+    uint64_t preparingTime = ~uint64_t(0);
+
+    /// The time the command was added to the execution queue, if known.
+    uint64_t queuedTime = ~uint64_t(0);
+
+    /// The time the command started executing, if it has.
+    uint64_t startTime = ~uint64_t(0);
+
+    /// The name of the command, once started.
+    std::string name;
+
+    /// The lane executing the command, once started.
+    unsigned lane = 0;
+
+    /// The number of processes the command has run.
+    unsigned numProcesses = 0;
+
+    /// The total user and system time of the processes, in microseconds.
+    uint64_t utime = 0, stime = 0;
+
+    /// The largest maximum resident set size of the processes, in bytes.
+    uint64_t maxrss = 0;
+  };
+
+  /// The output stream, while open.
+  std::unique_ptr<llvm::raw_fd_ostream> os;
+
+  /// The time the profile was opened, to which event times are relative.
+  std::chrono::steady_clock::time_point epoch;
+
+  /// The lock protecting the records and the output stream.
+  std::mutex mutex;
+
+  /// The records of the active commands.
+  std::unordered_map<const void*, CommandRecord> records;
+
+  /// The lanes which have been named in the output.
+  std::unordered_set<unsigned> namedLanes;
+
+  /// Get the current time, in microseconds since the epoch.
+  uint64_t now() const;
+
+  /// Write the metadata event naming the given lane, if not already written.
+  void nameLane(unsigned lane);
+
+public:
+  BuildProfiler();
+  ~BuildProfiler();
+
+  BuildProfiler(const BuildProfiler&) LLBUILD_DELETED_FUNCTION;
+  void operator=(const BuildProfiler&) LLBUILD_DELETED_FUNCTION;
+
+  /// Open the profile output file, which may only be done once.
+  ///
+  /// \returns True on success.
+  bool open(StringRef path, std::string* error_out);
+
+  /// Finish and close the profile output file.
+  ///
+  /// \returns True on success.
+  bool close(std::string* error_out);
+
+  /// Check if the profile output is open.
+  bool isOpen() const { return bool(os); }
+
+  /// @name Command Notifications
+  /// @{
+
+  /// Called when the engine starts scanning a command, to determine whether it
+  /// needs to run.
+  void commandScanning(const void* command);
+
+  /// Called when the engine has determined a command needs to run, and starts
+  /// requesting its inputs.
+  void commandPreparing(const void* command);
+
+  /// Called when all of the inputs of a command are available, and its job is
+  /// added to the execution queue.
+  void commandQueued(const void* command);
+
+  /// Called when the job of a command starts executing on a lane.
+  void commandStarted(const void* command, StringRef name, unsigned lane);
+
+  /// Called when a process run by a command has finished.
+  void commandProcessFinished(const void* command, const ProcessResult& result);
+
+  /// Called when a command has finished, or the engine has determined it does
+  /// not need to run.
+  ///
+  /// The command is written to the profile if it was started, and may be
+  /// reported again afterwards for a subsequent build.
+  void commandFinished(const void* command);
+
+  /// @}
+};
+
+}
+}
+
+#endif
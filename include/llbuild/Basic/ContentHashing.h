@@ -0,0 +1,51 @@
+//===- ContentHashing.h -----------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Hash functions used to checksum file contents.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLBUILD_BASIC_CONTENTHASHING_H
+#define LLBUILD_BASIC_CONTENTHASHING_H
+
+#include "llbuild/Basic/LLVM.h"
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include <array>
+#include <cstdint>
+
+namespace llbuild {
+namespace basic {
+
+/// Compute the XXH64 hash of \arg data.
+uint64_t hashXXH64(ArrayRef<uint8_t> data, uint64_t seed = 0);
+
+/// The size of the blocks which \see hashXXH64Blocks() hashes independently.
+const uint64_t xxh64BlockSize = 4 * 1024 * 1024;
+
+/// Compute the XXH64 hash of \arg data, or, if it is larger than a single
+/// block, the XXH64 hash of the (little-endian) XXH64 hashes of its blocks,
+/// which are computed on up to \arg numThreads threads.
+uint64_t hashXXH64Blocks(ArrayRef<uint8_t> data, unsigned numThreads);
+
+/// Compute the (unkeyed, 32 byte) BLAKE3 hash of \arg data.
+///
+/// Large inputs are split into subtrees which are hashed on up to \arg
+/// numThreads threads; the result does not depend on the number of threads.
+std::array<uint8_t, 32> hashBLAKE3(ArrayRef<uint8_t> data,
+                                   unsigned numThreads);
+
+}
+}
+
+#endif
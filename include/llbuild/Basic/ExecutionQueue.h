@@ -18,6 +18,7 @@
 #include "llbuild/Basic/Subprocess.h"
 
 #include <cstdint>
+#include <string>
 
 namespace llbuild {
   namespace basic {
@@ -46,6 +47,23 @@ namespace llbuild {
     };
 
 
+    /// A named pool of resources, which limits the total weight of the jobs
+    /// using it that an execution queue runs concurrently (\see
+    /// QueueJob::setResourcePool()).
+    class ResourcePool {
+      std::string name;
+      unsigned depth;
+
+    public:
+      ResourcePool(StringRef name, unsigned depth)
+        : name(name), depth(depth) {}
+
+      StringRef getName() const { return name; }
+
+      /// The maximum total weight of the jobs running in the pool.
+      unsigned getDepth() const { return depth; }
+    };
+
     /// Opaque type which allows the queue implementation to maintain additional
     /// state and associate subsequent requests (e.g., \see executeProcess())
     /// with the dispatching job.
@@ -64,6 +82,19 @@ namespace llbuild {
       typedef std::function<void(QueueJobContext*)> work_fn_ty;
       work_fn_ty work;
 
+      /// The estimated duration, in seconds, of the longest chain of work
+      /// which depends on this job (including the job itself), or zero if
+      /// unknown.
+      double criticalPathEstimate = 0.0;
+
+      /// The estimated peak memory use, in bytes, of each process run by this
+      /// job, or zero if unknown.
+      uint64_t memoryEstimate = 0;
+
+      /// The resource pool the job runs in, if any, and its weight in the pool.
+      const ResourcePool* resourcePool = nullptr;
+      unsigned resourcePoolWeight = 1;
+
     public:
       /// Default constructor, for use as a sentinel.
       QueueJob() {}
@@ -74,6 +105,27 @@ namespace llbuild {
 
       JobDescriptor* getDescriptor() const { return desc; }
 
+      double getCriticalPathEstimate() const { return criticalPathEstimate; }
+      void setCriticalPathEstimate(double value) {
+        criticalPathEstimate = value;
+      }
+
+      uint64_t getMemoryEstimate() const { return memoryEstimate; }
+      void setMemoryEstimate(uint64_t value) { memoryEstimate = value; }
+
+      const ResourcePool* getResourcePool() const { return resourcePool; }
+      unsigned getResourcePoolWeight() const { return resourcePoolWeight; }
+
+      /// Set the resource pool the job runs in.
+      ///
+      /// While the pool is full, the queue holds the job without occupying a
+      /// lane. A job always runs if its pool is otherwise idle, even if its
+      /// weight exceeds the pool's depth. The pool must outlive the queue.
+      void setResourcePool(const ResourcePool* pool, unsigned weight = 1) {
+        resourcePool = pool;
+        resourcePoolWeight = weight;
+      }
+
       void execute(QueueJobContext* context) { work(context); }
     };
 
@@ -110,6 +162,14 @@ namespace llbuild {
       /// Cancel all jobs and subprocesses of this queue.
       virtual void cancelAllJobs() = 0;
 
+      /// Check whether the queue schedules jobs using their critical path
+      /// estimates, in which case clients should supply them.
+      virtual bool usesCriticalPathEstimates() const { return false; }
+
+      /// Check whether the queue admits processes using the memory estimates
+      /// of their jobs, in which case clients should supply them.
+      virtual bool usesMemoryEstimates() const { return false; }
+
 
       /// @name Execution Interfaces
       ///
@@ -222,14 +282,65 @@ namespace llbuild {
       NamePriority = 0,
 
       /// First in, first out
-      FIFO = 1
+      FIFO = 1,
+
+      /// Per-lane first in, first out queues, with idle lanes stealing jobs
+      /// from busy ones
+      WorkStealing = 2,
+
+      /// Priority queue based scheduling, dispatching the jobs with the
+      /// longest estimated critical path first (and otherwise by name)
+      CriticalPath = 3
+    };
+
+    /// Limits on the load of the system, above which an execution queue stops
+    /// starting new processes.
+    ///
+    /// While any limit is exceeded, processes are only started when no other
+    /// process from the queue is running, so the build always makes progress.
+    struct ExecutionQueueLoadLimits {
+      /// The maximum one minute load average, or zero for no limit.
+      double maxLoadAverage = 0.0;
+
+      /// The maximum percentage of time some tasks were stalled waiting for a
+      /// CPU, over the last ten seconds, or zero for no limit.
+      ///
+      /// This uses the Linux pressure stall information, and is ignored where
+      /// it is unavailable.
+      double maxCPUPressure = 0.0;
+
+      /// The maximum percentage of time some tasks were stalled waiting for
+      /// memory, over the last ten seconds, or zero for no limit.
+      ///
+      /// This uses the Linux pressure stall information, and is ignored where
+      /// it is unavailable.
+      double maxMemoryPressure = 0.0;
+
+      /// The maximum total of the memory estimates of the running processes,
+      /// in bytes, or zero for no limit.
+      ///
+      /// A process is only started if its job's memory estimate (\see
+      /// QueueJob::getMemoryEstimate()) fits within the budget remaining, and
+      /// processes without an estimate are always allowed to start.
+      uint64_t memoryBudget = 0;
+
+      /// Whether any limit is set.
+      bool hasLimits() const {
+        return maxLoadAverage > 0.0 || maxCPUPressure > 0.0 ||
+          maxMemoryPressure > 0.0 || memoryBudget != 0;
+      }
     };
 
     /// Create an execution queue that schedules jobs to individual lanes with a
     /// capped limit on the number of concurrent lanes.
+    ///
+    /// \param loadLimits The system load above which the queue should not start
+    /// new processes.
     ExecutionQueue* createLaneBasedExecutionQueue(
         ExecutionQueueDelegate& delegate, int numLanes, SchedulerAlgorithm alg,
-        QualityOfService qos, const char* const* environment);
+        QualityOfService qos, const char* const* environment,
+        const ExecutionQueueLoadLimits& loadLimits =
+          ExecutionQueueLoadLimits());
 
     /// Create an execution queue that executes all tasks serially on a single
     /// thread.
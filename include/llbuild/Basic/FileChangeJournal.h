@@ -0,0 +1,75 @@
+//===- FileChangeJournal.h --------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLBUILD_BASIC_FILECHANGEJOURNAL_H
+#define LLBUILD_BASIC_FILECHANGEJOURNAL_H
+
+#include "llbuild/Basic/Compiler.h"
+#include "llbuild/Basic/LLVM.h"
+
+#include "llvm/ADT/StringRef.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llbuild {
+namespace basic {
+
+/// A journal of the changes made to a set of watched paths, used to keep file
+/// information cached across builds and only re-read what has changed.
+///
+/// A path is watched by watching its parent directory, along with each of the
+/// directories above it, so that the replacement of any directory on the way
+/// to the path is noticed. A path which is a directory is also watched itself,
+/// so that changes to its entries are noticed.
+///
+/// Paths which are symbolic links, or which are reached through one, are not
+/// watched, since the changes to their targets would not be noticed.
+class FileChangeJournal {
+  // DO NOT COPY
+  FileChangeJournal(const FileChangeJournal&) LLBUILD_DELETED_FUNCTION;
+  void operator=(const FileChangeJournal&) LLBUILD_DELETED_FUNCTION;
+
+public:
+  FileChangeJournal() {}
+  virtual ~FileChangeJournal();
+
+  /// Start recording the changes made to the given path.
+  ///
+  /// This should be called before reading the information for the path, so
+  /// that no change made after the read is missed.
+  ///
+  /// \returns False if changes to the path cannot be recorded (for example,
+  /// because its directory does not exist yet), in which case no information
+  /// about the path should be retained.
+  virtual bool watch(StringRef path) = 0;
+
+  /// Retrieve the watched paths which have changed since the last call.
+  ///
+  /// \returns False if the journal lost track of the changes made, in which
+  /// case any watched path may have changed.
+  virtual bool takeChanges(std::vector<std::string>& paths_out) = 0;
+};
+
+/// Create a journal backed by the file change notifications of the host
+/// operating system.
+///
+/// \returns The journal, or null if the host is unsupported or the journal
+/// could not be created (with \arg error_out describing why).
+std::unique_ptr<FileChangeJournal>
+createFileChangeJournal(std::string* error_out);
+
+}
+}
+
+#endif
@@ -0,0 +1,111 @@
+//===- FileChecksumCache.h --------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLBUILD_BASIC_FILECHECKSUMCACHE_H
+#define LLBUILD_BASIC_FILECHECKSUMCACHE_H
+
+#include "llbuild/Basic/Compiler.h"
+#include "llbuild/Basic/FileInfo.h"
+#include "llbuild/Basic/LLVM.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace llbuild {
+namespace basic {
+
+/// A persistent cache of file checksums, which allows a file's contents to be
+/// hashed only when its metadata has changed.
+///
+/// Checksums are keyed by the device and inode of the file, and are only
+/// reused while its size and modification time are unchanged. A checksum is
+/// not recorded for a file which was modified within the last couple of
+/// seconds, since a further modification could then leave its modification
+/// time unchanged.
+///
+/// The cache is loaded when it is created, and is written back (atomically, so
+/// concurrent processes sharing it can at worst lose each other's entries) by
+/// \see save(). Only the entries used by this instance are written back, so
+/// the entries of files which are deleted, or no longer part of the build, are
+/// pruned rather than accumulating. All other methods are thread safe.
+class FileChecksumCache {
+  // DO NOT COPY
+  FileChecksumCache(const FileChecksumCache&) LLBUILD_DELETED_FUNCTION;
+  void operator=(const FileChecksumCache&) LLBUILD_DELETED_FUNCTION;
+
+  /// The path of the cache file.
+  std::string path;
+
+  /// The algorithm of the cached checksums.
+  FileChecksumAlgorithm algorithm;
+
+  /// The mutex protecting the entries.
+  std::mutex entriesMutex;
+
+  struct Entry {
+    /// The file information, including the checksum.
+    FileInfo info;
+
+    /// Whether the entry has been looked up or inserted.
+    bool isTouched = false;
+  };
+
+  /// The cached entries, by device and inode.
+  llvm::DenseMap<std::pair<uint64_t, uint64_t>, Entry> entries;
+
+  /// The number of entries which have been touched.
+  size_t numTouchedEntries = 0;
+
+  /// Whether the entries have changed since they were loaded or saved.
+  bool isDirty = false;
+
+  /// Mark an entry as used, so it is saved.
+  ///
+  /// The caller must hold \see entriesMutex.
+  void touch(Entry& entry) {
+    if (!entry.isTouched) {
+      entry.isTouched = true;
+      ++numTouchedEntries;
+    }
+  }
+
+public:
+  /// Create a cache stored at \arg path, which holds checksums computed using
+  /// \arg algorithm.
+  ///
+  /// A cache file which is missing, unreadable, or was written for a different
+  /// algorithm is treated as empty.
+  FileChecksumCache(StringRef path, FileChecksumAlgorithm algorithm);
+
+  /// Look up the checksum of the file described by \arg info.
+  ///
+  /// \returns True if a checksum was found.
+  bool lookup(const FileInfo& info, FileChecksum* checksum_out);
+
+  /// Record the checksum of the file described by \arg info.
+  void insert(const FileInfo& info, const FileChecksum& checksum);
+
+  /// Write the cache to disk, if it has changed, dropping the entries which
+  /// have not been touched.
+  ///
+  /// \returns True on success.
+  bool save(std::string* error_out);
+};
+
+}
+}
+
+#endif
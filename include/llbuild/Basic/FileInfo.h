@@ -27,6 +27,9 @@
 
 #include "BinaryCoding.h"
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
 #include <cstdint>
 #include <string>
 
@@ -66,9 +69,38 @@ struct FileTimestamp {
   }
 };
 
+/// The algorithms which can be used to checksum file contents.
+enum class FileChecksumAlgorithm : uint8_t {
+  /// The platform's cryptographic hash (SHA-256 on Darwin, and MD5 elsewhere),
+  /// which was the only algorithm before others were added.
+  Platform = 0,
+
+  /// XXH64, over fixed size blocks for large files. This is fast, but not
+  /// collision resistant, so it is only suitable for detecting changes.
+  XXH64 = 1,
+
+  /// BLAKE3, truncated to 31 bytes, which is suitable for content addressing.
+  BLAKE3 = 2,
+};
+
+/// Parse the name of a file checksum algorithm.
+///
+/// \returns True on success.
+bool parseFileChecksumAlgorithm(StringRef name,
+                                FileChecksumAlgorithm* algorithm_out);
+
 struct FileChecksum {
   uint8_t bytes[32] = {0};
 
+  /// The byte which records the algorithm of checksums computed by algorithms
+  /// other than \see FileChecksumAlgorithm::Platform, so that checksums from
+  /// different algorithms never compare equal.
+  static const unsigned algorithmByte = 31;
+
+  /// The algorithm used by default.
+  static const FileChecksumAlgorithm defaultAlgorithm =
+    FileChecksumAlgorithm::XXH64;
+
   bool operator==(const FileChecksum& rhs) const {
     return (memcmp(bytes, rhs.bytes, sizeof(bytes)) == 0);
   }
@@ -77,7 +109,9 @@ struct FileChecksum {
     return !(*this==rhs);
   }
 
-  static FileChecksum getChecksumForPath(const std::string& path);
+  static FileChecksum getChecksumForPath(
+      const std::string& path,
+      FileChecksumAlgorithm algorithm = defaultAlgorithm);
 };
 
 /// File information which is intended to be used as a proxy for when a file has
@@ -130,6 +164,18 @@ struct FileInfo {
   /// \returns The FileInfo for the given path, which will be missing if the
   /// path does not exist (or any error was encountered).
   static FileInfo getInfoForPath(const std::string& path, bool asLink = false);
+
+  /// Get the information for each of the given paths, as if by
+  /// \see getInfoForPath().
+  ///
+  /// The requests are issued concurrently in large batches (using io_uring
+  /// where supported, or a pool of threads otherwise), which is much faster
+  /// than a serial loop for many paths.
+  ///
+  /// \param infos_out The results, which must have one entry per path.
+  static void getInfoForPaths(ArrayRef<std::string> paths,
+                              MutableArrayRef<FileInfo> infos_out,
+                              bool asLink = false);
 };
 
 template<>
@@ -230,7 +276,6 @@ public:
   }
 
   void finalize() override {
-    llvm::MD5::MD5Result output;
     hasher.final(output);
   }
 
@@ -14,12 +14,17 @@
 #define LLBUILD_BASIC_FILESYSTEM_H
 
 #include "llbuild/Basic/Compiler.h"
+#include "llbuild/Basic/FileChangeJournal.h"
+#include "llbuild/Basic/FileChecksumCache.h"
 #include "llbuild/Basic/FileInfo.h"
 #include "llbuild/Basic/LLVM.h"
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/ErrorOr.h"
 
 #include <memory>
+#include <mutex>
 #ifndef _WIN32
 #include <unistd.h>
 #endif
@@ -90,14 +95,30 @@ public:
   /// path does not exist (or any error was encountered).
   virtual FileInfo getLinkInfo(const std::string& path) = 0;
 
+  /// Get the information for each of the given paths, as if by
+  /// \see getFileInfo().
+  ///
+  /// File systems may override this to retrieve the information for many paths
+  /// more efficiently than one at a time.
+  ///
+  /// \param infos_out The results, which must have one entry per path.
+  virtual void getFileInfos(ArrayRef<std::string> paths,
+                            MutableArrayRef<FileInfo> infos_out);
+
   /// Create a symbolic link
   ///
   /// \returns True on success (the symlink was created)
   virtual bool createSymlink(const std::string& src, const std::string& target) = 0;
+
+  /// Discard any file information cached for the given path, which may have
+  /// been modified by other means than this interface (for example, by a
+  /// subprocess).
+  virtual void invalidateFileInfo(const std::string& path) {}
 };
 
 /// Create a FileSystem instance suitable for accessing the local filesystem.
-std::unique_ptr<FileSystem> createLocalFileSystem();
+std::unique_ptr<FileSystem> createLocalFileSystem(
+    FileChecksumAlgorithm checksumAlgorithm = FileChecksum::defaultAlgorithm);
 
 
 /// Device/inode agnostic filesystem wrapper
@@ -161,9 +182,22 @@ public:
     return info;
   }
 
+  virtual void getFileInfos(ArrayRef<std::string> paths,
+                            MutableArrayRef<FileInfo> infos_out) override {
+    impl->getFileInfos(paths, infos_out);
+    for (auto& info: infos_out) {
+      info.device = 0;
+      info.inode = 0;
+    }
+  }
+
   virtual bool createSymlink(const std::string& src, const std::string& target) override {
     return impl->createSymlink(src, target);
   }
+
+  virtual void invalidateFileInfo(const std::string& path) override {
+    impl->invalidateFileInfo(path);
+  }
 };
 
 /// Checksum-only filesystem wrapper
@@ -171,6 +205,9 @@ class ChecksumOnlyFileSystem : public FileSystem {
 private:
   std::unique_ptr<FileSystem> impl;
 
+  /// The cache of checksums to consult before reading file contents, if any.
+  FileChecksumCache* checksumCache = nullptr;
+
 public:
   explicit ChecksumOnlyFileSystem(std::unique_ptr<FileSystem> fs)
     : impl(std::move(fs))
@@ -183,6 +220,11 @@ public:
 
   static std::unique_ptr<FileSystem> from(std::unique_ptr<FileSystem> fs);
 
+  /// Use the given cache to avoid re-reading unchanged files.
+  ///
+  /// The cache must outlive this file system.
+  void attachChecksumCache(FileChecksumCache* cache) { checksumCache = cache; }
+
 
   virtual bool
   createDirectory(const std::string& path) override {
@@ -205,19 +247,7 @@ public:
     return impl->getFileChecksum(path);
   }
 
-  virtual FileInfo getFileInfo(const std::string& path) override {
-    auto info = impl->getFileInfo(path);
-
-    info.device = 0;
-    info.inode = 0;
-    info.modTime = FileTimestamp();
-    info.modTime.seconds = 0;
-    info.modTime.nanoseconds = 0;
-
-    info.checksum = impl->getFileChecksum(path);
-
-    return info;
-  }
+  virtual FileInfo getFileInfo(const std::string& path) override;
 
   virtual FileInfo getLinkInfo(const std::string& path) override {
     auto info = impl->getLinkInfo(path);
@@ -246,6 +276,107 @@ public:
   virtual bool createSymlink(const std::string& src, const std::string& target) override {
     return impl->createSymlink(src, target);
   }
+
+  virtual void invalidateFileInfo(const std::string& path) override {
+    impl->invalidateFileInfo(path);
+  }
+};
+
+/// File system wrapper which caches file information for the duration of a
+/// build.
+///
+/// Each path is stat'ed at most once until its entry is invalidated, either by
+/// a modification made through this interface or by \see invalidateFileInfo()
+/// (which also invalidates the parent directories of the path). The cache may
+/// be used concurrently, and should be revalidated at the start of each build.
+///
+/// If a \see FileChangeJournal is attached, only the information about paths
+/// which the journal reports as changed is discarded when revalidating, so
+/// that information about unchanged paths can be reused across builds.
+class StatCachingFileSystem : public FileSystem {
+private:
+  std::unique_ptr<FileSystem> impl;
+
+  /// The journal of changes to the cached paths, if attached.
+  std::unique_ptr<FileChangeJournal> journal;
+
+  struct Shard {
+    std::mutex mutex;
+
+    /// The number of invalidations of the shard, used to avoid caching
+    /// information which was read concurrently with an invalidation.
+    uint64_t generation = 0;
+
+    llvm::StringMap<FileInfo> fileInfos;
+    llvm::StringMap<FileInfo> linkInfos;
+  };
+
+  static const unsigned NumShards = 16;
+
+  Shard shards[NumShards];
+
+  Shard& getShard(StringRef path);
+
+  FileInfo getCachedInfo(const std::string& path, bool asLink);
+
+public:
+  explicit StatCachingFileSystem(std::unique_ptr<FileSystem> fs)
+    : impl(std::move(fs))
+  {
+  }
+
+  StatCachingFileSystem(const FileSystem&) LLBUILD_DELETED_FUNCTION;
+  void operator=(const StatCachingFileSystem&) LLBUILD_DELETED_FUNCTION;
+  StatCachingFileSystem &operator=(StatCachingFileSystem&& rhs) LLBUILD_DELETED_FUNCTION;
+
+  /// Discard all cached file information.
+  void clear();
+
+  /// Attach a journal, which starts watching each path as it is cached.
+  ///
+  /// This discards all cached file information.
+  void attachJournal(std::unique_ptr<FileChangeJournal> journal);
+
+  /// Check whether a journal is attached.
+  bool hasJournal() const { return journal != nullptr; }
+
+  /// Discard the cached file information which may be out of date, which is
+  /// everything unless a journal is attached.
+  void revalidate();
+
+  virtual bool
+  createDirectory(const std::string& path) override;
+
+  virtual bool
+  createDirectories(const std::string& path) override;
+
+  virtual std::unique_ptr<llvm::MemoryBuffer>
+  getFileContents(const std::string& path) override;
+
+  virtual bool remove(const std::string& path) override;
+
+  virtual FileChecksum getFileChecksum(const std::string& path) override {
+    return impl->getFileChecksum(path);
+  }
+
+  virtual FileInfo getFileInfo(const std::string& path) override {
+    return getCachedInfo(path, /*asLink=*/false);
+  }
+
+  virtual FileInfo getLinkInfo(const std::string& path) override {
+    return getCachedInfo(path, /*asLink=*/true);
+  }
+
+  virtual void getFileInfos(ArrayRef<std::string> paths,
+                            MutableArrayRef<FileInfo> infos_out) override;
+
+  /// Populate the cache with the file information for the given paths,
+  /// retrieving the information for the paths which are not cached in bulk.
+  void prefetchFileInfo(ArrayRef<std::string> paths);
+
+  virtual bool createSymlink(const std::string& src, const std::string& target) override;
+
+  virtual void invalidateFileInfo(const std::string& path) override;
 };
 
 }
@@ -17,10 +17,14 @@
 
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/ConvertUTF.h"
 
 #include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -36,6 +40,47 @@ template <> struct hash<llvm::StringRef> {
 namespace llbuild {
 namespace basic {
 
+/// An immutable, precomputed environment, suitable for sharing as the base of
+/// many \see POSIXEnvironment instances (for example, the environment
+/// inherited by every subprocess of an execution queue).
+class POSIXEnvironmentBlock {
+  /// The assignments, in the same form as \see POSIXEnvironment uses.
+  std::vector<std::string> envStorage;
+
+  /// The index of the assignment for each key.
+  std::unordered_map<StringRef, unsigned> keyIndices;
+
+public:
+  /// Create a block from a null terminated list of "key=value" assignments.
+  ///
+  /// If a key is assigned more than once, the first assignment wins.
+  explicit POSIXEnvironmentBlock(const char* const* envp) {
+    std::unordered_set<StringRef> seenKeys;
+    for (const char* const* p = envp; *p != nullptr; ++p) {
+      if (!seenKeys.insert(StringRef(*p).split('=').first).second)
+        continue;
+      std::string assignment(*p);
+      assignment += '\0';
+      envStorage.emplace_back(std::move(assignment));
+    }
+
+    // Index the keys once the storage will no longer move.
+    for (unsigned i = 0, e = envStorage.size(); i != e; ++i)
+      keyIndices.emplace(StringRef(envStorage[i]).split('=').first, i);
+  }
+
+  POSIXEnvironmentBlock(const POSIXEnvironmentBlock&) = delete;
+  POSIXEnvironmentBlock& operator=(const POSIXEnvironmentBlock&) = delete;
+
+  const std::vector<std::string>& getEntries() const { return envStorage; }
+
+  /// Get the index of the assignment to the given key, or -1 if missing.
+  int getIndex(StringRef key) const {
+    auto it = keyIndices.find(key);
+    return it == keyIndices.end() ? -1 : int(it->second);
+  }
+};
+
 /// A helper class for constructing a POSIX-style environment.
 class POSIXEnvironment {
   /// The actual environment, this is only populated once frozen.
@@ -53,18 +98,74 @@ class POSIXEnvironment {
   /// The list of known keys in the environment.
   std::unordered_set<StringRef> keys{};
 
+  /// The base environment, whose assignments are included after those made
+  /// before it was set (and only for keys which those have not defined).
+  std::shared_ptr<const POSIXEnvironmentBlock> base;
+
+  /// The number of assignments made before the base environment was set.
+  size_t numEntriesBeforeBase = 0;
+
   /// Whether the environment pointer has been vended, and assignments can no
   /// longer be mutated.
   bool isFrozen = false;
 
+  /// Visit each of the entries of the final environment, in order.
+  template <typename Fn>
+  void forEachEntry(Fn fn) const {
+    if (!base) {
+      for (const auto& entry : envStorage)
+        fn(entry);
+      return;
+    }
+
+    // Find the base assignments shadowed by the ones made before it, which is
+    // cheap since the base environment is indexed and those are typically few.
+    llvm::SmallVector<int, 8> shadowed;
+    for (size_t i = 0; i != numEntriesBeforeBase; ++i) {
+      fn(envStorage[i]);
+      int index = base->getIndex(StringRef(envStorage[i]).split('=').first);
+      if (index >= 0)
+        shadowed.push_back(index);
+    }
+    std::sort(shadowed.begin(), shadowed.end());
+
+    const auto& baseEntries = base->getEntries();
+    auto nextShadowed = shadowed.begin();
+    for (int i = 0, e = int(baseEntries.size()); i != e; ++i) {
+      if (nextShadowed != shadowed.end() && *nextShadowed == i) {
+        ++nextShadowed;
+        continue;
+      }
+      fn(baseEntries[i]);
+    }
+
+    for (size_t i = numEntriesBeforeBase, e = envStorage.size(); i != e; ++i)
+      fn(envStorage[i]);
+  }
+
 public:
   POSIXEnvironment() {}
 
+  /// Inherit the given base environment.
+  ///
+  /// This is equivalent to adding each of the base assignments with
+  /// \see setIfMissing(), so they are shadowed by keys which are already
+  /// defined and take precedence over keys defined later, but they are not
+  /// copied into this environment. This may only be called once.
+  void setBase(std::shared_ptr<const POSIXEnvironmentBlock> block) {
+    assert(!isFrozen && !base);
+    base = std::move(block);
+    numEntriesBeforeBase = envStorage.size();
+  }
+
   /// Add a key to the environment, if missing.
   ///
-  /// If the key has already been defined, it will **NOT** be inserted.
+  /// If the key has already been defined, including by the base environment,
+  /// it will **NOT** be inserted.
   void setIfMissing(StringRef key, StringRef value) {
     assert(!isFrozen);
+    if (base && base->getIndex(key) >= 0)
+      return;
     if (keys.insert(key).second) {
       llvm::SmallString<256> assignment;
       assignment += key;
@@ -88,11 +189,11 @@ public:
     // On Windows, the environment must be a contiguous null-terminated block
     // of null-terminated strings followed by an additional null terminator
     env.clear();
-    for (const auto& entry : envStorage) {
+    forEachEntry([&](const std::string& entry) {
       llvm::SmallVector<llvm::UTF16, 20> wEntry;
       llvm::convertUTF8ToUTF16String(entry, wEntry);
       env.insert(env.end(), wEntry.begin(), wEntry.end());
-    }
+    });
     env.emplace_back(L'\0');
     auto envData = std::make_unique<wchar_t[]>(env.size());
     std::copy(env.begin(), env.end(), envData.get());
@@ -107,9 +208,11 @@ public:
 
     // Form the final environment.
     env.clear();
-    for (const auto& entry : envStorage) {
+    env.reserve(envStorage.size() +
+                (base ? base->getEntries().size() : 0) + 1);
+    forEachEntry([&](const std::string& entry) {
       env.emplace_back(entry.c_str());
-    }
+    });
     env.emplace_back(nullptr);
     return env.data();
   }
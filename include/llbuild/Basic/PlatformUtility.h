@@ -63,6 +63,16 @@ llbuild_rlim_t getOpenFileLimit();
 /// Returns: 0 on success, -1 on failure (check errno).
 int raiseOpenFileLimit(llbuild_rlim_t limit = 2048);
 
+/// Gets the system load average over the last minute.
+/// Returns: a negative value on failure.
+double getLoadAverage();
+
+/// Gets the percentage of time over the last ten seconds in which some tasks
+/// were stalled waiting for the given resource ("cpu", "memory" or "io"), from
+/// the Linux pressure stall information.
+/// Returns: a negative value on failure, or if unsupported.
+double getPressureStallPercentage(const char* resource);
+
 enum MATCH_RESULT { MATCH, NO_MATCH, MATCH_ERROR };
 // Test if a path or filename matches a wildcard pattern
 //
@@ -23,6 +23,7 @@
 #include <inttypes.h>
 #include <condition_variable>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 
@@ -247,6 +248,30 @@ namespace llbuild {
       bool controlEnabled = true;
     };
 
+    /// An event loop which services the output and exit notifications of
+    /// spawned processes on a single thread.
+    ///
+    /// Processes spawned with a reactor which release their execution lane
+    /// are handed off to the reactor, which reads the rest of their output and
+    /// completes them once they exit, without requiring a thread per process.
+    /// Until then, the spawning thread services the process as usual.
+    ///
+    /// The delegate callbacks for all handed off processes, including
+    /// \see ProcessDelegate::processHadOutput(), are made serially from the
+    /// reactor thread, so delegates must be safe to call from it and should
+    /// not block.
+    class ProcessReactor {
+    public:
+      virtual ~ProcessReactor();
+    };
+
+    /// Create a process reactor, or return null if one is not supported on
+    /// this platform.
+    ///
+    /// All processes spawned with the reactor must complete before it is
+    /// destroyed.
+    std::unique_ptr<ProcessReactor> createProcessReactor();
+
     /// Execute the given command line.
     ///
     /// This will launch and execute the given command line and wait for it to
@@ -275,6 +300,11 @@ namespace llbuild {
     /// its execution lane. Callers should put cleanup and notification work
     /// here.
     ///
+    /// \param reactor If non-null, the reactor to service the process with.
+    /// When the process releases its execution lane, the function passed to
+    /// \p releaseFn only needs to be called to wait for the process, since the
+    /// reactor completes it regardless.
+    ///
     //
     // FIXME: This interface will need to get more complicated, and provide the
     // command result and facilities for dealing with the output.
@@ -286,7 +316,8 @@ namespace llbuild {
                       POSIXEnvironment environment,
                       ProcessAttributes attributes,
                       ProcessReleaseFn&& releaseFn,
-                      ProcessCompletionFn&& completionFn);
+                      ProcessCompletionFn&& completionFn,
+                      ProcessReactor* reactor = nullptr);
 
     /// @}
 
@@ -0,0 +1,62 @@
+//===- WorkStealingPool.h ---------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLBUILD_BASIC_WORKSTEALINGPOOL_H
+#define LLBUILD_BASIC_WORKSTEALINGPOOL_H
+
+#include <functional>
+
+namespace llbuild {
+namespace basic {
+
+/// A pool of threads for executing short, independent operations.
+///
+/// Each thread has its own deque of operations. Operations added from a pool
+/// thread are pushed onto that thread's deque, and operations added from any
+/// other thread are distributed across the deques. Threads take their own work
+/// most recently added first, and when out of work steal the oldest operations
+/// from other threads.
+class WorkStealingPool {
+  void *impl;
+
+public:
+  /// Create a pool with the given number of threads, or one per hardware
+  /// thread if zero.
+  explicit WorkStealingPool(unsigned numThreads = 0);
+
+  /// Destroy the pool, after waiting for all operations to complete.
+  ~WorkStealingPool();
+
+  /// Get the number of threads in the pool.
+  unsigned getNumThreads() const;
+
+  /// Add an operation to the pool and return.
+  void async(std::function<void(void)> fn);
+
+  /// Run a single pending operation on the calling thread, if one is
+  /// available.
+  ///
+  /// This allows a thread which is waiting on the result of an operation to
+  /// help the pool make progress.
+  ///
+  /// \returns True if an operation was run.
+  bool runOne();
+
+  /// Wait for all added operations (including any they add) to complete,
+  /// running pending operations on the calling thread while waiting.
+  void waitForAll();
+};
+
+}
+}
+
+#endif
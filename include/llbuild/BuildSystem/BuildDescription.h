@@ -119,6 +119,8 @@ public:
   // FIXME: This is an inefficent map, the string is duplicated.
   typedef llvm::StringMap<std::unique_ptr<Tool>> tool_set;
 
+  typedef llvm::StringMap<std::unique_ptr<basic::ResourcePool>> pool_set;
+
 private:
   node_set nodes;
 
@@ -128,6 +130,8 @@ private:
   
   tool_set tools;
 
+  pool_set pools;
+
   /// The default target.
   std::string defaultTarget;
 
@@ -165,6 +169,12 @@ public:
   /// Get the set of all tools used by the file.
   const tool_set& getTools() const { return tools; }
 
+  /// Get the set of declared resource pools for the file.
+  pool_set& getPools() { return pools; }
+
+  /// Get the set of declared resource pools for the file.
+  const pool_set& getPools() const { return pools; }
+
   /// @}
   /// @name Construction Helpers.
   /// @{
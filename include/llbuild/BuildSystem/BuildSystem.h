@@ -14,8 +14,10 @@
 #define LLBUILD_BUILDSYSTEM_BUILDSYSTEM_H
 
 #include "llbuild/Basic/Compiler.h"
+#include "llbuild/Basic/FileInfo.h"
 #include "llbuild/Basic/LLVM.h"
 #include "llbuild/Basic/Subprocess.h"
+#include "llbuild/Core/BuildDB.h"
 #include "llbuild/Core/BuildEngine.h"
 
 #include "llvm/ADT/Optional.h"
@@ -28,6 +30,7 @@
 
 namespace llbuild {
 namespace basic {
+  class BuildProfiler;
   class ExecutionQueue;
   class FileSystem;
 }
@@ -259,6 +262,10 @@ public:
   /// Get the file system to use for access.
   basic::FileSystem& getFileSystem();
 
+  /// Get the profiler of the commands run by the build, which only records
+  /// once \see enableProfiling() has succeeded.
+  basic::BuildProfiler& getProfiler();
+
   /// @name Client API
   /// @{
 
@@ -275,11 +282,61 @@ public:
   /// \returns True on success.
   bool attachDB(StringRef path, std::string* error_out);
 
+  /// Attach (or create) the database of the given format at the given path.
+  ///
+  /// \param writeBatchSize If non-zero, rule results are written to the
+  /// database on a background thread, in batches of this size.
+  /// \param preload If true, all results are loaded from the database in a
+  /// single read when the first result is needed.
+  /// \returns True on success.
+  bool attachDB(StringRef path, core::BuildDBFormat format,
+                unsigned writeBatchSize, bool preload, std::string* error_out);
+
   /// Enable low-level engine tracing into the given output file.
   ///
   /// \returns True on success.
   bool enableTracing(StringRef path, std::string* error_out);
 
+  /// Enable low-level engine tracing into the given output file, in the given
+  /// format.
+  ///
+  /// \returns True on success.
+  bool enableTracing(StringRef path, core::BuildEngineTraceFormat format,
+                     std::string* error_out);
+
+  /// Enable writing a profile of the commands run by the build, as a Chrome
+  /// trace event file, into the given output file.
+  ///
+  /// \returns True on success.
+  bool enableProfiling(StringRef path, std::string* error_out);
+
+  /// Enable caching file information for the duration of each build, so each
+  /// path is only stat'ed once.
+  ///
+  /// Only the declared outputs of commands are invalidated as they run, so
+  /// this must only be enabled if commands do not modify other files during
+  /// the build, including by adding or removing the entries of directories
+  /// whose contents are inputs.
+  void enableFileInfoCache();
+
+  /// Enable keeping file information between builds, using a journal of the
+  /// changes made to files to decide which of it must be re-read.
+  ///
+  /// This only pays off when the build system is reused for several builds,
+  /// and implies \see enableFileInfoCache().
+  ///
+  /// \returns True on success.
+  bool enableFileChangeJournal(std::string* error_out);
+
+  /// Enable a persistent cache of file checksums stored at rg path, so that
+  /// when the build file requests checksum-only file information, only files
+  /// whose metadata has changed are re-read.
+  ///
+  /// \param algorithm The algorithm of the checksums computed by the file
+  /// system; a cache written for another algorithm is discarded.
+  void enableChecksumCache(StringRef path,
+                           basic::FileChecksumAlgorithm algorithm);
+
   /// Build the named target.
   ///
   /// A build description *must* have been loaded before calling this method.
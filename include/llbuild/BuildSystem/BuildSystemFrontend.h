@@ -14,6 +14,7 @@
 #define LLBUILD_BUILDSYSTEM_BUILDSYSTEMFRONTEND_H
 
 #include "llbuild/Basic/ExecutionQueue.h"
+#include "llbuild/Basic/FileInfo.h"
 #include "llbuild/Basic/LLVM.h"
 #include "llbuild/BuildSystem/BuildSystem.h"
 #include "llbuild/BuildSystem/BuildNode.h"
@@ -74,8 +75,12 @@ public:
   /// construct an appropriate underlying `BuildSystem` for use by subsequent
   /// build calls.
   ///
-  /// \returns True on success, or false if there were errors. If initialization
-  /// fails, the frontend is in an indeterminant state and should not be reused.
+  /// Once initialized, the build system (along with the engine's in-memory rule
+  /// state) stays resident and is reused by subsequent builds, unless the build
+  /// file or the database has changed on disk since it was last used, in which
+  /// case it is recreated from scratch.
+  ///
+  /// \returns True on success, or false if there were errors.
   bool initialize();
 
   /// Build the named target using the specified invocation parameters.
@@ -357,6 +362,28 @@ public:
   /// The path of the database file to use, if any.
   std::string dbPath = "build.db";
 
+  /// The format of the database file.
+  core::BuildDBFormat dbFormat = core::BuildDBFormat::SQLite;
+
+  /// If non-zero, write results to the database on a background thread, in
+  /// batches of this size.
+  unsigned dbWriteBatchSize = 0;
+
+  /// Whether to load all results from the database up front, rather than
+  /// querying it for each rule.
+  bool dbPreload = false;
+
+  /// Whether to cache file information for the duration of each build.
+  bool useFileInfoCache = false;
+
+  /// Whether to keep file information between builds, using a journal of file
+  /// changes to decide what to re-read.
+  bool useFileChangeJournal = false;
+
+  /// The algorithm to use to checksum file contents.
+  basic::FileChecksumAlgorithm checksumAlgorithm =
+    basic::FileChecksum::defaultAlgorithm;
+
   /// The path of a directory to change into before anything else, if any.
   std::string chdirPath = "";
 
@@ -366,11 +393,20 @@ public:
   /// The path of the build trace output file to use, if any.
   std::string traceFilePath = "";
 
+  /// The format of the build trace output file.
+  core::BuildEngineTraceFormat traceFormat = core::BuildEngineTraceFormat::JSON;
+
+  /// The path of the build profile output file to use, if any.
+  std::string profileFilePath = "";
+
   basic::SchedulerAlgorithm schedulerAlgorithm =
       basic::SchedulerAlgorithm::NamePriority;
 
   uint32_t schedulerLanes = 0;
 
+  /// The system load above which new commands are not started.
+  basic::ExecutionQueueLoadLimits loadLimits;
+
   /// The Quality of Service class to use. If not set the global default setting will be used.
   Optional<basic::QualityOfService> qos;
 
@@ -57,6 +57,11 @@ public:
   std::vector<BuildNode*> outputs;
   bool repairViaOwnershipAnalysis = false;
 
+  /// The resource pool the command runs in, if any, and its weight in the
+  /// pool.
+  const basic::ResourcePool* pool = nullptr;
+  unsigned poolWeight = 1;
+
   StringRef getName() const { return name; }
 
   /// @name Command Information
@@ -157,6 +162,10 @@ public:
   /// The command should execute outside the execution lanes.
   virtual bool isDetached() const { return false; }
 
+  /// The estimated peak memory use of the command's processes, in bytes, or
+  /// zero to estimate it from the command's prior runs.
+  virtual uint64_t getMemoryEstimate() const { return 0; }
+
   virtual void addOutput(BuildNode* node) final {
     outputs.push_back(node);
     node->getProducers().push_back(this);
@@ -62,6 +62,10 @@ class ExternalCommand : public Command {
   /// Whether to treat the command as always being out-of-date.
   bool alwaysOutOfDate = false;
 
+  /// The estimated peak memory use of the command's processes, in bytes, or
+  /// zero if unspecified.
+  uint64_t memoryEstimate = 0;
+
   /// If not None, the command should be skipped with the provided BuildValue.
   llvm::Optional<BuildValue> skipValue;
 
@@ -79,6 +83,9 @@ class ExternalCommand : public Command {
   /// because the outputs are newer than all of the inputs.
   bool canUpdateIfNewerWithResult(const BuildValue& result);
 
+  /// Get the total size of the file outputs described by a successful result.
+  uint64_t getOutputBytes(const BuildValue& result) const;
+
 protected:
   StringRef getDescription() const { return description; }
 
@@ -110,6 +117,8 @@ public:
 
   bool isExternalCommand() const override { return true; }
 
+  uint64_t getMemoryEstimate() const override { return memoryEstimate; }
+
   virtual void configureDescription(const ConfigureContext&,
                                     StringRef value) override;
   
@@ -23,11 +23,55 @@
 #include <string>
 
 namespace llbuild {
+namespace basic {
+class BinaryEncoder;
+}
+
 namespace core {
 
 struct Result;
 class Rule;
 
+/// Historical execution statistics for a rule, accumulated over the builds in
+/// which it was computed.
+///
+/// Statistics are only recorded for rules whose tasks perform work on the
+/// execution queue, or report statistics (\see TaskInterface::reportStatistics).
+struct RuleStatistics {
+  /// The number of times the rule has been computed.
+  uint64_t runCount = 0;
+
+  /// The exponentially weighted moving average of the time taken to compute
+  /// the rule, in seconds.
+  double weightedDuration = 0.0;
+
+  /// The peak resident set size of the processes run by the most recent
+  /// computation of the rule, in bytes.
+  uint64_t peakRSS = 0;
+
+  /// The number of bytes of output produced by the most recent computation of
+  /// the rule.
+  uint64_t outputBytes = 0;
+
+  /// The weight of the most recent duration in \see weightedDuration.
+  static constexpr double durationWeight = 0.25;
+
+  /// Update the statistics for a new computation of the rule.
+  void addRun(double duration, uint64_t peakRSS, uint64_t outputBytes);
+
+  /// Encode the statistics, for storage in a database.
+  ///
+  /// The encoding is a count of fields followed by the fields, so fields may be
+  /// added (at the end) without invalidating stored statistics.
+  void encode(basic::BinaryEncoder& coder) const;
+
+  /// Decode statistics encoded by \see encode(); any fields missing from the
+  /// encoding are left unchanged.
+  ///
+  /// \returns False if the data is not a valid encoding.
+  bool decode(StringRef data);
+};
+
 /// Delegate interface for use with the build database
 class BuildDBDelegate {
 public:
@@ -42,12 +86,16 @@ public:
   /// implementations may (and do) cache these values for future use.
   ///
   /// \param key [out] The key whose unique ID is being returned.
-  virtual const KeyID getKeyID(const KeyType& key) = 0;
+  virtual const KeyID getKeyID(StringRef key) = 0;
 
   /// Get the key corresponding to a key ID.
   ///
   /// This method must be thread safe, and must not fail.
   virtual KeyType getKeyForID(const KeyID key) = 0;
+
+  /// Report an error which could not be returned from the failing operation,
+  /// such as a failure to write results when a build completes.
+  virtual void error(const Twine& message) {}
 };
 
 
@@ -103,6 +151,32 @@ public:
   /// \param error_out [out] Error string if return value is false.
   virtual bool setRuleResult(KeyID keyID, const Rule& rule, const Result& result, std::string* error_out) = 0;
 
+  /// Look up the stored execution statistics for a rule.
+  ///
+  /// The default implementation stores no statistics.
+  ///
+  /// \param keyID The keyID for the rule.
+  /// \param statistics_out [out] The statistics, if found.
+  /// \param error_out [out] Error string if an error occurred.
+  /// \returns True if the database had stored statistics for the rule.
+  virtual bool lookupRuleStatistics(KeyID keyID,
+                                    RuleStatistics* statistics_out,
+                                    std::string* error_out) {
+    return false;
+  }
+
+  /// Update the stored execution statistics for a rule.
+  ///
+  /// The default implementation discards the statistics.
+  ///
+  /// \param keyID The keyID for the rule.
+  /// \param error_out [out] Error string if return value is false.
+  virtual bool setRuleStatistics(KeyID keyID,
+                                 const RuleStatistics& statistics,
+                                 std::string* error_out) {
+    return true;
+  }
+
   /// Called by the build engine to indicate that a build has started.
   ///
   /// The engine guarantees that all mutation operations (e.g., \see
@@ -115,6 +189,9 @@ public:
   /// Called by the build engine to indicate a build has finished, and results
   /// should be written.
   ///
+  /// Any failure to write the results is reported via \see
+  /// BuildDBDelegate::error().
+  ///
   /// The expected behavior of the database when \see buildStarted() is called,
   /// but \see buildComplete() is never called (e.g., due to a crash) is not
   /// prescribed. The database implementation may choose to put all
@@ -154,6 +231,55 @@ std::unique_ptr<BuildDB> createSQLiteBuildDB(StringRef path,
                                              bool recreateUnmatchedVersion,
                                              std::string* error_out);
 
+/// Create a BuildDB instance backed by a memory-mapped, append-only log file.
+///
+/// The log is indexed in memory when opened, results are read directly from
+/// the mapped file, and writes are appended in batches. The log is compacted
+/// when opened if it is dominated by superseded records. The version semantics
+/// match those of \see createSQLiteBuildDB().
+std::unique_ptr<BuildDB> createLogBuildDB(StringRef path,
+                                          uint32_t clientSchemaVersion,
+                                          bool recreateUnmatchedVersion,
+                                          std::string* error_out);
+
+/// The available storage formats for build databases.
+enum class BuildDBFormat {
+  /// An SQLite database.
+  SQLite,
+
+  /// A memory-mapped log file, see \see createLogBuildDB().
+  Log,
+};
+
+/// Parse a build database format name (`sqlite` or `log`).
+///
+/// \returns True on success.
+bool parseBuildDBFormat(StringRef name, BuildDBFormat* format_out);
+
+/// Create a BuildDB which performs rule result writes on a background thread.
+///
+/// Results are handed to the writer thread in batches of \p batchSize, and all
+/// other operations (including \see BuildDB::buildComplete()) wait for any
+/// outstanding writes to finish before being forwarded to \p db.
+///
+/// \param db The database to write to, or null (in which case null is
+/// returned).
+std::unique_ptr<BuildDB> createWriteBehindBuildDB(std::unique_ptr<BuildDB> db,
+                                                  unsigned batchSize);
+
+/// Create a BuildDB which loads every stored result from \p db in a single
+/// bulk read, on the first lookup, and serves all lookups from memory.
+///
+/// \param db The database to read from, or null (in which case null is
+/// returned).
+std::unique_ptr<BuildDB> createPreloadingBuildDB(std::unique_ptr<BuildDB> db);
+
+/// Create a BuildDB instance of the given format.
+std::unique_ptr<BuildDB> createBuildDB(BuildDBFormat format, StringRef path,
+                                       uint32_t clientSchemaVersion,
+                                       bool recreateUnmatchedVersion,
+                                       std::string* error_out);
+
 }
 }
 
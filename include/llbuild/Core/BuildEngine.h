@@ -52,6 +52,10 @@ public:
   const char* data() const { return key.data(); }
   const char* c_str() const { return key.c_str(); }
   size_t size() const { return key.size(); }
+
+  /// Implicit conversion to a reference to the key bytes, which allows keys to
+  /// be passed to the engine APIs without copying them.
+  operator llvm::StringRef() const { return key; }
 };
 
 typedef std::vector<uint8_t> ValueType;
@@ -80,12 +84,11 @@ struct Result {
   /// up-to-date.
   ///
   /// \invariant builtAt >= computedAt
-  //
-  // FIXME: Think about this representation more. The problem with storing this
-  // field here in this fashion is that every build will result in bringing all
-  // of the \see builtAt fields up to date. That is unfortunate from a
-  // persistence perspective, where it would be ideal if we didn't touch any
-  // disk state for null builds.
+  ///
+  /// The value stored in the database is a lower bound: the engine does not
+  /// rewrite a result only to advance builtAt, unless one of its inputs was
+  /// computed after the stored value. This keeps null builds from touching
+  /// disk state for results which are unchanged.
   Epoch builtAt = 0;
 
   /// The explicit dependencies required by the generation.
@@ -136,14 +139,14 @@ public:
   /// intentionally chosen to allow a pointer to be provided, but note that all
   /// input IDs greater than \see kMaximumInputID are reserved for internal use
   /// by the engine.
-  void request(const KeyType& key, uintptr_t inputID);
+  void request(StringRef key, uintptr_t inputID);
 
   /// Request a task as a dependency just for the current build iteration. Once
   /// the requesting task finishes, the dependency will be removed so that
   /// incremental builds won't consider it for invalidating the task.
   ///
   /// NOTE: This method behaves like `request` for the current build.
-  void requestSingleUse(const KeyType& key, uintptr_t inputID);
+  void requestSingleUse(StringRef key, uintptr_t inputID);
   
   /// Specify that the task must be built subsequent to the
   /// computation of \arg Key.
@@ -151,7 +154,7 @@ public:
   /// The value of the computation of \arg Key is not available to the task, and
   /// the only guarantee the engine provides is that if \arg Key is computed
   /// during a build, then task will not be computed until after it.
-  void mustFollow(const KeyType& key);
+  void mustFollow(StringRef key);
 
   /// Inform the engine of an input dependency that was discovered by the task
   /// during its execution, a la compiler generated dependency files.
@@ -173,7 +176,21 @@ public:
   /// It is legal to call this method from any thread, but the caller is
   /// responsible for ensuring that it is never called concurrently for the same
   /// task.
-  void discoveredDependency(const KeyType& key);
+  void discoveredDependency(StringRef key);
+
+  /// Report the resources used by the task, to be recorded in the rule's
+  /// statistics in the build database (\see RuleStatistics) when the task
+  /// completes, along with its duration.
+  ///
+  /// This may be called multiple times (e.g., once for each process the task
+  /// runs), the peak RSS is the largest reported, and the output bytes are
+  /// summed. Tasks which run work on the execution queue always have their
+  /// statistics recorded, even if they report none.
+  ///
+  /// It is legal to call this method from any thread prior to completing the
+  /// task, but the caller is responsible for ensuring that it is never called
+  /// concurrently for the same task.
+  void reportStatistics(uint64_t peakRSS, uint64_t outputBytes);
 
   /// Called by a task to indicate it has completed and to provide its value.
   ///
@@ -431,6 +448,41 @@ public:
   virtual void buildCancelled() = 0;
 };
 
+/// The available formats for build engine traces.
+enum class BuildEngineTraceFormat {
+  /// A JSON-like text format, with one line per event.
+  JSON,
+
+  /// A compact binary format, which is written on a background thread and can
+  /// be converted to other formats afterwards, see \see
+  /// convertBinaryBuildEngineTrace().
+  Binary,
+};
+
+/// Parse a build engine trace format name (`json` or `binary`).
+///
+/// \returns True on success.
+bool parseBuildEngineTraceFormat(StringRef name,
+                                 BuildEngineTraceFormat* format_out);
+
+/// The formats a binary build engine trace can be converted to.
+enum class BuildEngineTraceConversion {
+  /// The JSON-like text format written by \see BuildEngineTraceFormat::JSON.
+  JSON,
+
+  /// The Chrome trace event format, with an event for the execution of each
+  /// task.
+  Chrome,
+};
+
+/// Convert the contents of a binary build engine trace.
+///
+/// \returns True on success.
+bool convertBinaryBuildEngineTrace(StringRef data,
+                                   BuildEngineTraceConversion conversion,
+                                   llvm::raw_ostream& os,
+                                   std::string* error_out);
+
 /// A build engine supports fast, incremental, persistent, and parallel
 /// execution of computational graphs.
 ///
@@ -527,6 +579,30 @@ public:
   /// \returns True on success.
   bool enableTracing(const std::string& path, std::string* error_out);
 
+  /// Enable tracing into the given output file, in the given format.
+  ///
+  /// \returns True on success.
+  bool enableTracing(const std::string& path, BuildEngineTraceFormat format,
+                     std::string* error_out);
+
+  /// Enable parallel dependency scanning, using a pool of \arg numThreads
+  /// threads (or disable it, if zero).
+  ///
+  /// In this mode, when the engine begins scanning the inputs of a rule, it
+  /// immediately looks up the rules for all of its recorded dependencies, and
+  /// checks whether their results are still valid in parallel. Only these
+  /// checks are parallelized: scan requests, input requests and finished tasks
+  /// are still processed on the engine thread, which makes all other
+  /// callbacks. A check is repeated when its rule is scanned if any task has
+  /// completed since it was started, so the work of tasks is never missed.
+  ///
+  /// Clients must ensure \see Rule::isResultValid() is safe to call
+  /// concurrently with any other engine callback, and tolerates being called
+  /// for a rule which is not subsequently scanned, or more than once.
+  ///
+  /// This must not be called while a build is running.
+  void enableParallelScanning(unsigned numThreads);
+
   /// Dump the build state to a file in Graphviz DOT format.
   void dumpGraphToFile(const std::string &path);
 
@@ -80,6 +80,14 @@ public:
     return keys.size();
   }
 
+  /// Check whether two sets contain the same tuples, in the same order.
+  bool operator==(const DependencyKeyIDs& rhs) const {
+    return keys == rhs.keys && flags == rhs.flags;
+  }
+  bool operator!=(const DependencyKeyIDs& rhs) const {
+    return !(*this == rhs);
+  }
+
   /// Change the size of the set.
   void resize(size_t newSize) {
     keys.resize(newSize);
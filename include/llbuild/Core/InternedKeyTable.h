@@ -0,0 +1,106 @@
+//===- InternedKeyTable.h ---------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLBUILD_CORE_INTERNEDKEYTABLE_H
+#define LLBUILD_CORE_INTERNEDKEYTABLE_H
+
+#include "llbuild/Basic/LLVM.h"
+#include "llbuild/Core/KeyID.h"
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/DJB.h"
+
+#include <mutex>
+
+namespace llbuild {
+namespace core {
+
+/// A thread-safe table which interns keys, assigning each a stable \see KeyID
+/// and an associated value.
+///
+/// The bytes of each key are stored exactly once, in a bump allocated arena,
+/// and the KeyID for a key is the address of those bytes. This allows the key
+/// and value for a KeyID to be recovered without any lookup or locking.
+///
+/// The index from keys to KeyIDs is split into independently locked shards, so
+/// concurrent interning from many threads rarely contends.
+template <typename ValueTy, unsigned NumShards = 16>
+class InternedKeyTable {
+  static_assert((NumShards & (NumShards - 1)) == 0,
+                "number of shards must be a power of two");
+
+  typedef llvm::StringMapEntry<ValueTy> EntryTy;
+
+  struct Shard {
+    std::mutex mutex;
+    llvm::StringMap<ValueTy, llvm::BumpPtrAllocator> map;
+  };
+
+  Shard shards[NumShards];
+
+  Shard& getShard(StringRef key) {
+    // Use the high bits of the hash, since the low bits select the bucket
+    // within the shard.
+    uint32_t hash = llvm::djbHash(key, 0);
+    return shards[(hash >> 16) & (NumShards - 1)];
+  }
+
+  static EntryTy& getEntry(KeyID keyID) {
+    return EntryTy::GetStringMapEntryFromKeyData(
+        (const char*)(uintptr_t)keyID.value());
+  }
+
+public:
+  InternedKeyTable() {}
+  InternedKeyTable(const InternedKeyTable&) = delete;
+  InternedKeyTable& operator=(const InternedKeyTable&) = delete;
+
+  /// Get the unique ID for the given key, interning it if necessary.
+  ///
+  /// Newly interned keys have a default constructed value.
+  KeyID getKeyID(StringRef key) {
+    auto& shard = getShard(key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    return KeyID(shard.map.try_emplace(key).first->getKey().data());
+  }
+
+  /// Get the key for an ID previously returned by \see getKeyID().
+  ///
+  /// The returned reference is valid for the lifetime of the table.
+  static StringRef getKey(KeyID keyID) {
+    return getEntry(keyID).getKey();
+  }
+
+  /// Get the value for an ID previously returned by \see getKeyID().
+  ///
+  /// Access to the value is not synchronized by the table.
+  static ValueTy& getValue(KeyID keyID) {
+    return getEntry(keyID).getValue();
+  }
+
+  /// Get the number of interned keys.
+  size_t size() {
+    size_t result = 0;
+    for (auto& shard: shards) {
+      std::lock_guard<std::mutex> guard(shard.mutex);
+      result += shard.map.size();
+    }
+    return result;
+  }
+};
+
+}
+}
+
+#endif
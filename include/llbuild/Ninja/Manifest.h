@@ -177,10 +177,12 @@ private:
   std::string commandString;
   std::string description;
   std::string depsFile;
+  std::string msvcDepsPrefix;
   std::string rspFile;
   std::string rspFileContent;
 
   unsigned depsStyle: 2;
+  unsigned shouldRemoveDepsFile: 1;
   unsigned isGenerator: 1;
   unsigned shouldRestat: 1;
 
@@ -196,7 +198,7 @@ public:
       numExplicitInputs(numExplicitInputs),
       numImplicitInputs(numImplicitInputs),
       executionPool(nullptr), depsStyle(unsigned(DepsStyleKind::None)),
-      isGenerator(0), shouldRestat(0)
+      shouldRemoveDepsFile(0), isGenerator(0), shouldRestat(0)
   {
     assert(outputs.size() > 0);
     assert(numExplicitInputs + numImplicitInputs <= inputs.size());
@@ -284,6 +286,25 @@ public:
     depsFile = value;
   }
 
+  /// Check whether the dependency output file should be removed once its
+  /// dependencies have been recorded (in the build database), which is the
+  /// case when the GCC style is requested explicitly.
+  bool hasRemoveDepsFileFlag() const {
+    return shouldRemoveDepsFile;
+  }
+  void setRemoveDepsFileFlag(bool value) {
+    shouldRemoveDepsFile = value;
+  }
+
+  /// Get the prefix of the lines in the output of a command using MSVC style
+  /// implicit dependencies which name an included file.
+  const std::string& getMSVCDepsPrefix() const {
+    return msvcDepsPrefix;
+  }
+  void setMSVCDepsPrefix(StringRef value) {
+    msvcDepsPrefix = value;
+  }
+
   /// Get the response file to be used by this command.
   const std::string& getRspFile() const {
     return rspFile;
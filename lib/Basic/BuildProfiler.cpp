@@ -0,0 +1,198 @@
+//===-- BuildProfiler.cpp -------------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "llbuild/Basic/BuildProfiler.h"
+
+#include "llbuild/Basic/JSON.h"
+#include "llbuild/Basic/Subprocess.h"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llbuild;
+using namespace llbuild::basic;
+
+/// The lane reported for commands which do not execute on a lane.
+static const unsigned detachedLane = ~0U;
+
+static const uint64_t unknownTime = ~uint64_t(0);
+
+BuildProfiler::BuildProfiler() {}
+
+BuildProfiler::~BuildProfiler() {
+  std::string error;
+  close(&error);
+}
+
+uint64_t BuildProfiler::now() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - epoch).count();
+}
+
+bool BuildProfiler::open(StringRef path, std::string* error_out) {
+  assert(!os);
+
+  std::error_code ec;
+  auto stream = llvm::make_unique<llvm::raw_fd_ostream>(
+      path, ec, llvm::sys::fs::F_Text);
+  if (ec) {
+    *error_out = "unable to open '" + path.str() + "' (" + ec.message() + ")";
+    return false;
+  }
+
+  std::lock_guard<std::mutex> guard(mutex);
+  os = std::move(stream);
+  epoch = std::chrono::steady_clock::now();
+  *os << "{ \"traceEvents\": [\n"
+      << "{ \"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, "
+      << "\"args\": { \"name\": \"llbuild\" } }";
+  return true;
+}
+
+bool BuildProfiler::close(std::string* error_out) {
+  std::lock_guard<std::mutex> guard(mutex);
+  if (!os)
+    return true;
+
+  *os << "\n], \"displayTimeUnit\": \"ms\" }\n";
+  os->close();
+  bool hadError = os->has_error();
+  os->clear_error();
+  os.reset();
+  records.clear();
+  namedLanes.clear();
+
+  if (hadError) {
+    *error_out = "unable to write build profile";
+    return false;
+  }
+  return true;
+}
+
+void BuildProfiler::nameLane(unsigned lane) {
+  if (!namedLanes.insert(lane).second)
+    return;
+
+  *os << ",\n{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, "
+      << "\"tid\": " << lane << ", \"args\": { \"name\": \"";
+  if (lane == detachedLane)
+    *os << "detached";
+  else
+    *os << "lane " << lane;
+  *os << "\" } }";
+}
+
+void BuildProfiler::commandScanning(const void* command) {
+  if (!isOpen())
+    return;
+
+  auto time = now();
+  std::lock_guard<std::mutex> guard(mutex);
+  auto& record = records[command];
+  record = CommandRecord();
+  record.scanStartTime = time;
+}
+
+void BuildProfiler::commandPreparing(const void* command) {
+  if (!isOpen())
+    return;
+
+  auto time = now();
+  std::lock_guard<std::mutex> guard(mutex);
+  records[command].preparingTime = time;
+}
+
+void BuildProfiler::commandQueued(const void* command) {
+  if (!isOpen())
+    return;
+
+  auto time = now();
+  std::lock_guard<std::mutex> guard(mutex);
+  records[command].queuedTime = time;
+}
+
+void BuildProfiler::commandStarted(const void* command, StringRef name,
+                                   unsigned lane) {
+  if (!isOpen())
+    return;
+
+  auto time = now();
+  std::lock_guard<std::mutex> guard(mutex);
+  auto& record = records[command];
+  record.startTime = time;
+  record.name = name;
+  record.lane = lane;
+}
+
+void BuildProfiler::commandProcessFinished(const void* command,
+                                           const ProcessResult& result) {
+  if (!isOpen())
+    return;
+
+  std::lock_guard<std::mutex> guard(mutex);
+  auto it = records.find(command);
+  if (it == records.end())
+    return;
+
+  auto& record = it->second;
+  ++record.numProcesses;
+  record.utime += result.utime;
+  record.stime += result.stime;
+  record.maxrss = std::max(record.maxrss, result.maxrss);
+}
+
+void BuildProfiler::commandFinished(const void* command) {
+  if (!isOpen())
+    return;
+
+  auto time = now();
+  std::lock_guard<std::mutex> guard(mutex);
+  auto it = records.find(command);
+  if (it == records.end())
+    return;
+  CommandRecord record = std::move(it->second);
+  records.erase(it);
+
+  // Ignore commands which never ran.
+  if (record.startTime == unknownTime)
+    return;
+
+  nameLane(record.lane);
+  *os << ",\n{ \"name\": \"" << escapeForJSON(record.name)
+      << "\", \"cat\": \"command\", \"ph\": \"X\", \"pid\": 0, "
+      << "\"tid\": " << record.lane << ", \"ts\": " << record.startTime
+      << ", \"dur\": " << (time - record.startTime) << ", \"args\": { ";
+
+  // Report each of the intervals leading up to the command starting, for
+  // which both ends are known.
+  bool first = true;
+  auto writeArg = [&](StringRef name, uint64_t value) {
+    if (!first)
+      *os << ", ";
+    first = false;
+    *os << "\"" << name << "\": " << value;
+  };
+  if (record.scanStartTime != unknownTime &&
+      record.preparingTime != unknownTime)
+    writeArg("scan_us", record.preparingTime - record.scanStartTime);
+  if (record.preparingTime != unknownTime && record.queuedTime != unknownTime)
+    writeArg("input_wait_us", record.queuedTime - record.preparingTime);
+  if (record.queuedTime != unknownTime)
+    writeArg("queue_wait_us", record.startTime - record.queuedTime);
+  if (record.numProcesses != 0) {
+    writeArg("processes", record.numProcesses);
+    writeArg("utime_us", record.utime);
+    writeArg("stime_us", record.stime);
+    writeArg("maxrss_bytes", record.maxrss);
+  }
+  *os << " } }";
+}
@@ -0,0 +1,369 @@
+//===-- ContentHashing.cpp ------------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "llbuild/Basic/ContentHashing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using namespace llbuild;
+using namespace llbuild::basic;
+
+/// Call \arg fn for each index below \arg numItems, on up to \arg numThreads
+/// threads (including the calling thread).
+static void forEachInParallel(size_t numItems, unsigned numThreads,
+                              const std::function<void(size_t)>& fn) {
+  numThreads = std::max(1u, (unsigned)std::min<size_t>(numThreads, numItems));
+
+  std::atomic<size_t> nextItem{0};
+  auto work = [&]() {
+    while (true) {
+      size_t item = nextItem++;
+      if (item >= numItems)
+        return;
+      fn(item);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < numThreads; ++i)
+    threads.emplace_back(work);
+  work();
+  for (auto& thread: threads)
+    thread.join();
+}
+
+static inline uint32_t read32(const uint8_t* p) {
+  return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) |
+    (uint32_t(p[3]) << 24);
+}
+
+static inline uint64_t read64(const uint8_t* p) {
+  return uint64_t(read32(p)) | (uint64_t(read32(p + 4)) << 32);
+}
+
+#pragma mark - XXH64
+
+namespace {
+
+const uint64_t xxhPrime1 = 11400714785074694791ULL;
+const uint64_t xxhPrime2 = 14029467366897019727ULL;
+const uint64_t xxhPrime3 = 1609587929392839161ULL;
+const uint64_t xxhPrime4 = 9650029242287828579ULL;
+const uint64_t xxhPrime5 = 2870177450012600261ULL;
+
+inline uint64_t rotl64(uint64_t value, unsigned amount) {
+  return (value << amount) | (value >> (64 - amount));
+}
+
+inline uint64_t xxhRound(uint64_t acc, uint64_t input) {
+  acc += input * xxhPrime2;
+  acc = rotl64(acc, 31);
+  return acc * xxhPrime1;
+}
+
+inline uint64_t xxhMergeRound(uint64_t acc, uint64_t value) {
+  acc ^= xxhRound(0, value);
+  return acc * xxhPrime1 + xxhPrime4;
+}
+
+}
+
+uint64_t basic::hashXXH64(ArrayRef<uint8_t> data, uint64_t seed) {
+  const uint8_t* p = data.data();
+  const uint8_t* end = p + data.size();
+
+  uint64_t hash;
+  if (data.size() >= 32) {
+    uint64_t v1 = seed + xxhPrime1 + xxhPrime2;
+    uint64_t v2 = seed + xxhPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - xxhPrime1;
+    for (const uint8_t* limit = end - 32; p <= limit; p += 32) {
+      v1 = xxhRound(v1, read64(p));
+      v2 = xxhRound(v2, read64(p + 8));
+      v3 = xxhRound(v3, read64(p + 16));
+      v4 = xxhRound(v4, read64(p + 24));
+    }
+    hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+    hash = xxhMergeRound(hash, v1);
+    hash = xxhMergeRound(hash, v2);
+    hash = xxhMergeRound(hash, v3);
+    hash = xxhMergeRound(hash, v4);
+  } else {
+    hash = seed + xxhPrime5;
+  }
+  hash += data.size();
+
+  for (; p + 8 <= end; p += 8) {
+    hash ^= xxhRound(0, read64(p));
+    hash = rotl64(hash, 27) * xxhPrime1 + xxhPrime4;
+  }
+  if (p + 4 <= end) {
+    hash ^= uint64_t(read32(p)) * xxhPrime1;
+    hash = rotl64(hash, 23) * xxhPrime2 + xxhPrime3;
+    p += 4;
+  }
+  for (; p != end; ++p) {
+    hash ^= (*p) * xxhPrime5;
+    hash = rotl64(hash, 11) * xxhPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= xxhPrime2;
+  hash ^= hash >> 29;
+  hash *= xxhPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+uint64_t basic::hashXXH64Blocks(ArrayRef<uint8_t> data, unsigned numThreads) {
+  if (data.size() <= xxh64BlockSize)
+    return hashXXH64(data);
+
+  size_t numBlocks = (data.size() + xxh64BlockSize - 1) / xxh64BlockSize;
+  std::vector<uint8_t> blockHashes(numBlocks * 8);
+  forEachInParallel(numBlocks, numThreads, [&](size_t i) {
+    uint64_t hash = hashXXH64(data.slice(i * xxh64BlockSize).take_front(
+                                  xxh64BlockSize));
+    for (unsigned j = 0; j != 8; ++j)
+      blockHashes[i * 8 + j] = uint8_t(hash >> (8 * j));
+  });
+  return hashXXH64(blockHashes);
+}
+
+#pragma mark - BLAKE3
+
+// This follows the structure of the BLAKE3 reference implementation.
+
+namespace {
+
+const size_t blake3BlockLen = 64;
+const size_t blake3ChunkLen = 1024;
+
+const uint32_t blake3ChunkStart = 1 << 0;
+const uint32_t blake3ChunkEnd = 1 << 1;
+const uint32_t blake3Parent = 1 << 2;
+const uint32_t blake3Root = 1 << 3;
+
+const uint32_t blake3IV[8] = {
+  0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+  0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+
+const unsigned blake3MessagePermutation[16] = {
+  2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8,
+};
+
+inline uint32_t rotr32(uint32_t value, unsigned amount) {
+  return (value >> amount) | (value << (32 - amount));
+}
+
+inline void blake3G(uint32_t* state, unsigned a, unsigned b, unsigned c,
+                    unsigned d, uint32_t mx, uint32_t my) {
+  state[a] = state[a] + state[b] + mx;
+  state[d] = rotr32(state[d] ^ state[a], 16);
+  state[c] = state[c] + state[d];
+  state[b] = rotr32(state[b] ^ state[c], 12);
+  state[a] = state[a] + state[b] + my;
+  state[d] = rotr32(state[d] ^ state[a], 8);
+  state[c] = state[c] + state[d];
+  state[b] = rotr32(state[b] ^ state[c], 7);
+}
+
+void blake3Compress(const uint32_t cv[8], const uint32_t blockWords[16],
+                    uint64_t counter, uint32_t blockLen, uint32_t flags,
+                    uint32_t out[16]) {
+  uint32_t state[16] = {
+    cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+    blake3IV[0], blake3IV[1], blake3IV[2], blake3IV[3],
+    uint32_t(counter), uint32_t(counter >> 32), blockLen, flags,
+  };
+  uint32_t m[16];
+  memcpy(m, blockWords, sizeof(m));
+
+  for (unsigned round = 0; round != 7; ++round) {
+    // Mix the columns, then the diagonals.
+    blake3G(state, 0, 4, 8, 12, m[0], m[1]);
+    blake3G(state, 1, 5, 9, 13, m[2], m[3]);
+    blake3G(state, 2, 6, 10, 14, m[4], m[5]);
+    blake3G(state, 3, 7, 11, 15, m[6], m[7]);
+    blake3G(state, 0, 5, 10, 15, m[8], m[9]);
+    blake3G(state, 1, 6, 11, 12, m[10], m[11]);
+    blake3G(state, 2, 7, 8, 13, m[12], m[13]);
+    blake3G(state, 3, 4, 9, 14, m[14], m[15]);
+
+    uint32_t permuted[16];
+    for (unsigned i = 0; i != 16; ++i)
+      permuted[i] = m[blake3MessagePermutation[i]];
+    memcpy(m, permuted, sizeof(m));
+  }
+
+  for (unsigned i = 0; i != 8; ++i) {
+    out[i] = state[i] ^ state[i + 8];
+    out[i + 8] = state[i + 8] ^ cv[i];
+  }
+}
+
+/// The input to a final compression, which can produce either a chaining
+/// value or (with the root flag) the output of the hash.
+struct Blake3Output {
+  uint32_t inputCV[8];
+  uint32_t blockWords[16];
+  uint64_t counter;
+  uint32_t blockLen;
+  uint32_t flags;
+
+  void getChainingValue(uint32_t cv_out[8]) const {
+    uint32_t out[16];
+    blake3Compress(inputCV, blockWords, counter, blockLen, flags, out);
+    memcpy(cv_out, out, 8 * sizeof(uint32_t));
+  }
+
+  std::array<uint8_t, 32> getRootBytes() const {
+    uint32_t out[16];
+    blake3Compress(inputCV, blockWords, 0, blockLen, flags | blake3Root, out);
+    std::array<uint8_t, 32> result;
+    for (unsigned i = 0; i != 8; ++i) {
+      for (unsigned j = 0; j != 4; ++j)
+        result[i * 4 + j] = uint8_t(out[i] >> (8 * j));
+    }
+    return result;
+  }
+
+  static Blake3Output makeParent(const uint32_t left[8],
+                                 const uint32_t right[8]) {
+    Blake3Output output;
+    memcpy(output.inputCV, blake3IV, sizeof(output.inputCV));
+    memcpy(output.blockWords, left, 8 * sizeof(uint32_t));
+    memcpy(output.blockWords + 8, right, 8 * sizeof(uint32_t));
+    output.counter = 0;
+    output.blockLen = blake3BlockLen;
+    output.flags = blake3Parent;
+    return output;
+  }
+};
+
+void loadBlockWords(const uint8_t* block, size_t length,
+                    uint32_t words_out[16]) {
+  uint8_t padded[blake3BlockLen] = {0};
+  if (length)
+    memcpy(padded, block, length);
+  for (unsigned i = 0; i != 16; ++i)
+    words_out[i] = read32(padded + i * 4);
+}
+
+/// Compute the final output of the chunk at \arg chunk (of at most a chunk's
+/// length).
+Blake3Output hashChunk(ArrayRef<uint8_t> chunk, uint64_t chunkCounter) {
+  uint32_t cv[8];
+  memcpy(cv, blake3IV, sizeof(cv));
+
+  // Compress every block but the last, which may be partial (or empty).
+  size_t numBlocks = std::max<size_t>(
+      1, (chunk.size() + blake3BlockLen - 1) / blake3BlockLen);
+  uint32_t startFlag = blake3ChunkStart;
+  for (size_t i = 0; i + 1 < numBlocks; ++i) {
+    uint32_t words[16], out[16];
+    loadBlockWords(chunk.data() + i * blake3BlockLen, blake3BlockLen, words);
+    blake3Compress(cv, words, chunkCounter, blake3BlockLen, startFlag, out);
+    memcpy(cv, out, sizeof(cv));
+    startFlag = 0;
+  }
+
+  Blake3Output output;
+  memcpy(output.inputCV, cv, sizeof(cv));
+  size_t lastOffset = (numBlocks - 1) * blake3BlockLen;
+  size_t lastLen = chunk.size() - lastOffset;
+  loadBlockWords(chunk.data() + lastOffset, lastLen, output.blockWords);
+  output.counter = chunkCounter;
+  output.blockLen = uint32_t(lastLen);
+  output.flags = startFlag | blake3ChunkEnd;
+  return output;
+}
+
+/// Compute the final output of the subtree covering \arg data, starting at
+/// chunk \arg firstChunk.
+///
+/// The chunk chaining values are merged on a stack as in the reference
+/// implementation: after the Nth chunk, one merge happens for each trailing
+/// zero bit of N, and the last chunk is only merged when finalizing. The
+/// subtree must either be the rightmost one, or cover a power of two number of
+/// chunks, for its output to be part of the overall tree.
+Blake3Output hashSubtree(ArrayRef<uint8_t> data, uint64_t firstChunk) {
+  uint32_t stack[54][8];
+  unsigned stackLen = 0;
+
+  size_t numChunks = std::max<size_t>(
+      1, (data.size() + blake3ChunkLen - 1) / blake3ChunkLen);
+  for (size_t i = 0; i + 1 < numChunks; ++i) {
+    uint32_t cv[8];
+    hashChunk(data.slice(i * blake3ChunkLen, blake3ChunkLen),
+              firstChunk + i).getChainingValue(cv);
+    for (uint64_t total = i + 1; (total & 1) == 0; total >>= 1) {
+      --stackLen;
+      Blake3Output::makeParent(stack[stackLen], cv).getChainingValue(cv);
+    }
+    memcpy(stack[stackLen++], cv, sizeof(cv));
+  }
+
+  Blake3Output output = hashChunk(
+      data.slice((numChunks - 1) * blake3ChunkLen), firstChunk + numChunks - 1);
+  while (stackLen) {
+    uint32_t cv[8];
+    output.getChainingValue(cv);
+    output = Blake3Output::makeParent(stack[--stackLen], cv);
+  }
+  return output;
+}
+
+}
+
+std::array<uint8_t, 32> basic::hashBLAKE3(ArrayRef<uint8_t> data,
+                                          unsigned numThreads) {
+  // Hash in subtrees of a power of two number of chunks, which can be
+  // computed independently and then merged as if they were single chunks.
+  const size_t subtreeLen = 1024 * blake3ChunkLen;
+  if (numThreads <= 1 || data.size() <= 2 * subtreeLen)
+    return hashSubtree(data, 0).getRootBytes();
+
+  size_t numSubtrees = (data.size() + subtreeLen - 1) / subtreeLen;
+  std::vector<Blake3Output> outputs(numSubtrees);
+  forEachInParallel(numSubtrees, numThreads, [&](size_t i) {
+    outputs[i] = hashSubtree(data.slice(i * subtreeLen).take_front(subtreeLen),
+                             i * (subtreeLen / blake3ChunkLen));
+  });
+
+  uint32_t stack[54][8];
+  unsigned stackLen = 0;
+  for (size_t i = 0; i + 1 < numSubtrees; ++i) {
+    uint32_t cv[8];
+    outputs[i].getChainingValue(cv);
+    for (uint64_t total = i + 1; (total & 1) == 0; total >>= 1) {
+      --stackLen;
+      Blake3Output::makeParent(stack[stackLen], cv).getChainingValue(cv);
+    }
+    memcpy(stack[stackLen++], cv, sizeof(cv));
+  }
+
+  Blake3Output output = outputs.back();
+  while (stackLen) {
+    uint32_t cv[8];
+    output.getChainingValue(cv);
+    output = Blake3Output::makeParent(stack[--stackLen], cv);
+  }
+  return output.getRootBytes();
+}
@@ -0,0 +1,224 @@
+//===-- FileChangeJournal.cpp ---------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "llbuild/Basic/FileChangeJournal.h"
+
+#include "llvm/ADT/STLExtras.h"
+
+#if defined(__linux__)
+#include "llbuild/Basic/PlatformUtility.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Path.h"
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace llbuild;
+using namespace llbuild::basic;
+
+FileChangeJournal::~FileChangeJournal() {}
+
+#if defined(__linux__)
+
+namespace {
+
+/// A journal which watches directories with inotify.
+class InotifyFileChangeJournal : public FileChangeJournal {
+  /// The events which may change the information for a path.
+  ///
+  /// Symbolic links are not followed, so that watching a link to a directory
+  /// fails rather than watching a directory elsewhere.
+  static const uint32_t watchMask =
+    IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_DELETE_SELF |
+    IN_MODIFY | IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR |
+    IN_DONT_FOLLOW;
+
+  /// The events which replace an entry in a directory.
+  static const uint32_t replaceMask =
+    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+  /// The events after which a watch no longer reports changes to the contents
+  /// of the directory it was created for.
+  static const uint32_t lostMask =
+    IN_DELETE_SELF | IN_IGNORED | IN_MOVE_SELF | IN_UNMOUNT;
+
+  /// The inotify instance.
+  const int fd;
+
+  /// The mutex protecting the watch state.
+  std::mutex mutex;
+
+  /// The watch descriptor of each watched directory, by the name it was
+  /// watched under (the empty name being the working directory).
+  llvm::StringMap<int> watches;
+
+  /// The names of the directories each watch descriptor was created for.
+  ///
+  /// Several names may refer to the same directory, which share a watch.
+  llvm::DenseMap<int, std::vector<std::string>> watchedNames;
+
+  /// Whether changes may have been missed since the last call to \see
+  /// takeChanges().
+  bool lostTrack = false;
+
+  /// Watch the given directory.
+  ///
+  /// \returns False if the directory could not be watched, in which case
+  /// errno describes why.
+  bool watchDirectory(StringRef dir) {
+    if (watches.count(dir))
+      return true;
+
+    int wd = inotify_add_watch(fd, dir.empty() ? "." : dir.str().c_str(),
+                               watchMask);
+    if (wd < 0)
+      return false;
+    watches[dir] = wd;
+    watchedNames[wd].push_back(dir);
+    return true;
+  }
+
+  void forgetWatch(int wd) {
+    auto it = watchedNames.find(wd);
+    if (it == watchedNames.end())
+      return;
+    for (const auto& name: it->second)
+      watches.erase(name);
+    watchedNames.erase(it);
+  }
+
+public:
+  explicit InotifyFileChangeJournal(int fd) : fd(fd) {}
+
+  virtual ~InotifyFileChangeJournal() {
+    basic::sys::close(fd);
+  }
+
+  virtual bool watch(StringRef path) override {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    // The information for a directory changes when its entries do, which is
+    // not reported to its parent, so also watch the path itself in case it is
+    // a directory.
+    if (!path.empty() && !watchDirectory(path)) {
+      if (errno != ENOTDIR && errno != ENOENT)
+        return false;
+
+      // Changes to the target of a symbolic link are not reported to the
+      // directory of the link.
+      struct stat buf;
+      if (errno == ENOTDIR && ::lstat(path.str().c_str(), &buf) == 0 &&
+          S_ISLNK(buf.st_mode))
+        return false;
+    }
+
+    // Watching a parent directory which is a symbolic link fails (see
+    // \see watchMask), so paths reached through one are not watched.
+    StringRef dir = path;
+    do {
+      dir = llvm::sys::path::parent_path(dir);
+      if (!watchDirectory(dir))
+        return false;
+    } while (!dir.empty() && dir != llvm::sys::path::root_path(dir));
+    return true;
+  }
+
+  virtual bool takeChanges(std::vector<std::string>& paths_out) override {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    while (true) {
+      ssize_t n = ::read(fd, buffer, sizeof(buffer));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        break;
+
+      for (char* p = buffer; p < buffer + n;) {
+        auto* event = reinterpret_cast<struct inotify_event*>(p);
+        p += sizeof(struct inotify_event) + event->len;
+
+        if (event->mask & IN_Q_OVERFLOW) {
+          lostTrack = true;
+          continue;
+        }
+        if (event->mask & lostMask) {
+          lostTrack = true;
+          // A moved directory stays watched, but no longer under its names.
+          if (event->mask & IN_MOVE_SELF)
+            inotify_rm_watch(fd, event->wd);
+          if (event->mask & (IN_IGNORED | IN_MOVE_SELF))
+            forgetWatch(event->wd);
+          continue;
+        }
+
+        auto it = watchedNames.find(event->wd);
+        if (it == watchedNames.end())
+          continue;
+        for (const auto& dir: it->second) {
+          // An event without a name is about the directory itself.
+          if (event->len == 0) {
+            paths_out.push_back(dir);
+            continue;
+          }
+
+          SmallString<256> path(dir);
+          llvm::sys::path::append(path, event->name);
+
+          // If a watched directory was replaced, anything below it may have
+          // changed.
+          if ((event->mask & replaceMask) && watches.count(path))
+            lostTrack = true;
+          paths_out.push_back(path.str());
+        }
+      }
+    }
+
+    if (lostTrack) {
+      lostTrack = false;
+      return false;
+    }
+    return true;
+  }
+};
+
+}
+
+std::unique_ptr<FileChangeJournal>
+basic::createFileChangeJournal(std::string* error_out) {
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    *error_out = std::string("unable to initialize inotify: ") +
+      ::strerror(errno);
+    return nullptr;
+  }
+  return llvm::make_unique<InotifyFileChangeJournal>(fd);
+}
+
+#else
+
+std::unique_ptr<FileChangeJournal>
+basic::createFileChangeJournal(std::string* error_out) {
+  *error_out = "file change journals are not supported on this platform";
+  return nullptr;
+}
+
+#endif
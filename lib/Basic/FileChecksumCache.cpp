@@ -0,0 +1,173 @@
+//===-- FileChecksumCache.cpp ---------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "llbuild/Basic/FileChecksumCache.h"
+
+#include "llbuild/Basic/BinaryCoding.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+
+using namespace llbuild;
+using namespace llbuild::basic;
+
+namespace {
+
+/// The magic bytes which start a cache file.
+const char cacheMagic[] = "LLBCKSUM";
+
+/// The version of the cache file format.
+const uint32_t cacheVersion = 1;
+
+/// The size of the cache file header: the magic, the version, and the checksum
+/// algorithm.
+const size_t headerSize = sizeof(cacheMagic) - 1 + 4 + 1;
+
+/// The size of each entry, which is an encoded FileInfo.
+const size_t entrySize = 6 * 8 + sizeof(FileChecksum::bytes);
+
+/// The number of seconds a file must have gone unmodified for its checksum to
+/// be recorded, which covers file systems with coarse timestamps.
+const uint64_t minimumFileAge = 2;
+
+}
+
+FileChecksumCache::FileChecksumCache(StringRef path,
+                                     FileChecksumAlgorithm algorithm)
+    : path(path), algorithm(algorithm)
+{
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer)
+    return;
+
+  StringRef data = (*buffer)->getBuffer();
+  if (data.size() < headerSize || (data.size() - headerSize) % entrySize != 0)
+    return;
+
+  BinaryDecoder decoder(data);
+  StringRef magic;
+  uint32_t version;
+  uint8_t fileAlgorithm;
+  decoder.readBytes(sizeof(cacheMagic) - 1, magic);
+  decoder.read(version);
+  decoder.read(fileAlgorithm);
+  if (magic != cacheMagic || version != cacheVersion ||
+      fileAlgorithm != uint8_t(algorithm))
+    return;
+
+  size_t numEntries = (data.size() - headerSize) / entrySize;
+  entries.reserve(numEntries);
+  for (size_t i = 0; i != numEntries; ++i) {
+    FileInfo info;
+    decoder.read(info);
+    entries[{ info.device, info.inode }].info = info;
+  }
+  decoder.finish();
+}
+
+bool FileChecksumCache::lookup(const FileInfo& info,
+                               FileChecksum* checksum_out) {
+  std::lock_guard<std::mutex> guard(entriesMutex);
+  auto it = entries.find({ info.device, info.inode });
+  if (it == entries.end())
+    return false;
+
+  // Keep the entry even if it is out of date, since the file still exists
+  // and its checksum is about to be recorded again.
+  touch(it->second);
+  const FileInfo& entry = it->second.info;
+  if (entry.size != info.size || entry.modTime != info.modTime)
+    return false;
+
+  *checksum_out = entry.checksum;
+  return true;
+}
+
+void FileChecksumCache::insert(const FileInfo& info,
+                               const FileChecksum& checksum) {
+  if (info.isMissing() || info.isDirectory())
+    return;
+
+  // Don't record the checksum of a recently modified file, which could be
+  // modified again without its modification time changing.
+  auto now = std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  if (info.modTime.seconds + minimumFileAge > uint64_t(now))
+    return;
+
+  FileInfo entry = info;
+  entry.checksum = checksum;
+
+  std::lock_guard<std::mutex> guard(entriesMutex);
+  auto& existing = entries[{ info.device, info.inode }];
+  touch(existing);
+  if (existing.info == entry)
+    return;
+  existing.info = entry;
+  isDirty = true;
+}
+
+bool FileChecksumCache::save(std::string* error_out) {
+  BinaryEncoder encoder;
+  {
+    std::lock_guard<std::mutex> guard(entriesMutex);
+    if (!isDirty && numTouchedEntries == entries.size())
+      return true;
+
+    encoder.writeBytes(StringRef(cacheMagic, sizeof(cacheMagic) - 1));
+    encoder.write(cacheVersion);
+    encoder.write(uint8_t(algorithm));
+    for (auto it = entries.begin(), ie = entries.end(); it != ie; ++it) {
+      if (it->second.isTouched)
+        encoder.write(it->second.info);
+      else
+        entries.erase(it);
+    }
+    isDirty = false;
+  }
+
+  auto fail = [&](const std::string& error) {
+    std::lock_guard<std::mutex> guard(entriesMutex);
+    isDirty = true;
+    *error_out = error;
+    return false;
+  };
+
+  // Write to a temporary file, and move it into place so that readers never
+  // observe a partially written cache.
+  int fd;
+  SmallString<256> tempPath;
+  if (auto ec = llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd,
+                                                tempPath)) {
+    return fail("unable to create '" + path + "': " + ec.message());
+  }
+  {
+    llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+    os.write(reinterpret_cast<const char*>(encoder.data()), encoder.size());
+    os.close();
+    if (os.has_error()) {
+      os.clear_error();
+      llvm::sys::fs::remove(tempPath);
+      return fail("unable to write '" + path + "'");
+    }
+  }
+  if (auto ec = llvm::sys::fs::rename(tempPath, path)) {
+    llvm::sys::fs::remove(tempPath);
+    return fail("unable to write '" + path + "': " + ec.message());
+  }
+  return true;
+}
@@ -12,13 +12,40 @@
 
 #include "llbuild/Basic/FileInfo.h"
 
+#include "llbuild/Basic/ContentHashing.h"
 #include "llbuild/Basic/Stat.h"
 
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstring>
 #include <fstream>
 #include <cstdio>
 #include <cerrno>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+// Batched stats use the io_uring statx operation, which is only present in
+// headers new enough to support probing for it.
+#if defined(IO_URING_OP_SUPPORTED) && defined(SYS_io_uring_setup) && \
+    defined(STATX_BASIC_STATS)
+#define LLBUILD_HAVE_IO_URING_STATX 1
+#endif
+#endif
+#endif
 
 using namespace llbuild;
 using namespace llbuild::basic;
@@ -27,24 +54,42 @@ bool FileInfo::isDirectory() const {
   return (mode & S_IFDIR) != 0;
 }
 
+static FileInfo makeMissingInfo() {
+  FileInfo result;
+  memset(&result, 0, sizeof(result));
+  assert(result.isMissing());
+  return result;
+}
+
+static FileInfo makeInfo(uint64_t device, uint64_t inode, uint64_t mode,
+                         uint64_t size, uint64_t seconds,
+                         uint64_t nanoseconds) {
+  FileInfo result;
+  result.device = device;
+  result.inode = inode;
+  result.mode = mode;
+  result.size = size;
+  result.modTime.seconds = seconds;
+  result.modTime.nanoseconds = nanoseconds;
+
+  // Enforce we never accidentally create our sentinel missing file value.
+  if (result.isMissing()) {
+    result.modTime.nanoseconds = 1;
+    assert(!result.isMissing());
+  }
+
+  return result;
+}
+
 /// Get the information to represent the state of the given node in the file
 /// system.
 FileInfo FileInfo::getInfoForPath(const std::string& path, bool asLink) {
-  FileInfo result;
-
   sys::StatStruct buf;
   auto statResult =
     asLink ? sys::lstat(path.c_str(), &buf) : sys::stat(path.c_str(), &buf);
-  if (statResult != 0) {
-    memset(&result, 0, sizeof(result));
-    assert(result.isMissing());
-    return result;
-  }
+  if (statResult != 0)
+    return makeMissingInfo();
 
-  result.device = buf.st_dev;
-  result.inode = buf.st_ino;
-  result.mode = buf.st_mode;
-  result.size = buf.st_size;
 #if defined(__APPLE__)
   auto seconds = buf.st_mtimespec.tv_sec;
   auto nanoseconds = buf.st_mtimespec.tv_nsec;
@@ -55,34 +100,321 @@ FileInfo FileInfo::getInfoForPath(const std::string& path, bool asLink) {
   auto seconds = buf.st_mtim.tv_sec;
   auto nanoseconds = buf.st_mtim.tv_nsec;
 #endif
-  result.modTime.seconds = seconds;
-  result.modTime.nanoseconds = nanoseconds;
+  return makeInfo(buf.st_dev, buf.st_ino, buf.st_mode, buf.st_size, seconds,
+                  nanoseconds);
+}
 
-  // Enforce we never accidentally create our sentinel missing file value.
-  if (result.isMissing()) {
-    result.modTime.nanoseconds = 1;
-    assert(!result.isMissing());
+#if defined(LLBUILD_HAVE_IO_URING_STATX)
+namespace {
+
+/// A minimal io_uring instance, used to issue batches of statx requests.
+class StatxRing {
+  int fd = -1;
+
+  void* ring = MAP_FAILED;
+  size_t ringSize = 0;
+  struct io_uring_sqe* sqes = (struct io_uring_sqe*)MAP_FAILED;
+  size_t sqesSize = 0;
+
+  unsigned* sqTail;
+  unsigned* sqMask;
+  unsigned* sqArray;
+  unsigned* cqHead;
+  unsigned* cqTail;
+  unsigned* cqMask;
+  struct io_uring_cqe* cqes;
+
+  /// The number of submission queue entries, which bounds the batch size.
+  unsigned numEntries = 0;
+
+  /// The statx results for the current batch.
+  std::vector<struct statx> buffers;
+
+  /// The completion results for the current batch.
+  std::vector<int> results;
+
+  template<typename T>
+  T* at(unsigned offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
   }
 
-  return result;
+public:
+  StatxRing() {}
+  StatxRing(const StatxRing&) = delete;
+  StatxRing& operator=(const StatxRing&) = delete;
+
+  ~StatxRing() {
+    if (sqes != MAP_FAILED)
+      munmap(sqes, sqesSize);
+    if (ring != MAP_FAILED)
+      munmap(ring, ringSize);
+    if (fd >= 0)
+      ::close(fd);
+  }
+
+  unsigned getBatchSize() const { return numEntries; }
+
+  /// Create the ring, returning false if io_uring or its statx operation are
+  /// not supported.
+  bool open(unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd = (int)syscall(SYS_io_uring_setup, entries, &params);
+    if (fd < 0)
+      return false;
+
+    // The statx operation postdates both the single mapping feature and the
+    // ability to probe for supported operations.
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+      return false;
+    const unsigned numProbeOps = 256;
+    std::vector<char> probeStorage(
+        sizeof(struct io_uring_probe) +
+        numProbeOps * sizeof(struct io_uring_probe_op));
+    auto* probe = reinterpret_cast<struct io_uring_probe*>(probeStorage.data());
+    if (syscall(SYS_io_uring_register, fd, IORING_REGISTER_PROBE, probe,
+                numProbeOps) < 0)
+      return false;
+    if (probe->last_op < IORING_OP_STATX ||
+        !(probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED))
+      return false;
+
+    ringSize = std::max(
+        params.sq_off.array + params.sq_entries * sizeof(unsigned),
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+    ring = mmap(nullptr, ringSize, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED)
+      return false;
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = (struct io_uring_sqe*)mmap(nullptr, sqesSize,
+                                      PROT_READ | PROT_WRITE,
+                                      MAP_SHARED | MAP_POPULATE, fd,
+                                      IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+      return false;
+
+    sqTail = at<unsigned>(params.sq_off.tail);
+    sqMask = at<unsigned>(params.sq_off.ring_mask);
+    sqArray = at<unsigned>(params.sq_off.array);
+    cqHead = at<unsigned>(params.cq_off.head);
+    cqTail = at<unsigned>(params.cq_off.tail);
+    cqMask = at<unsigned>(params.cq_off.ring_mask);
+    cqes = at<struct io_uring_cqe>(params.cq_off.cqes);
+    numEntries = params.sq_entries;
+    buffers.resize(numEntries);
+    results.resize(numEntries);
+    return true;
+  }
+
+  /// Stat a batch of at most \see getBatchSize() paths.
+  ///
+  /// \returns False if the requests could not be issued, in which case no
+  /// results have been written.
+  bool stat(const std::string* paths, unsigned count, bool asLink,
+            FileInfo* infos_out) {
+    assert(count <= numEntries);
+
+    // Queue a request for each path.
+    unsigned tail = *sqTail;
+    for (unsigned i = 0; i != count; ++i, ++tail) {
+      unsigned index = tail & *sqMask;
+      struct io_uring_sqe* sqe = &sqes[index];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_STATX;
+      sqe->fd = AT_FDCWD;
+      sqe->addr = (uint64_t)(uintptr_t)paths[i].c_str();
+      sqe->len = STATX_BASIC_STATS;
+      sqe->off = (uint64_t)(uintptr_t)&buffers[i];
+      sqe->statx_flags = asLink ? AT_SYMLINK_NOFOLLOW : 0;
+      sqe->user_data = i;
+      sqArray[index] = index;
+    }
+    __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+    // Submit the requests and wait for them to complete. If they cannot all
+    // be submitted, the ones which were are still waited for, since they
+    // reference our buffers and the paths.
+    unsigned numSubmitted = 0, numCompleted = 0;
+    bool failed = false;
+    while (numCompleted != (failed ? numSubmitted : count)) {
+      unsigned numToSubmit = failed ? 0 : count - numSubmitted;
+      int result = (int)syscall(SYS_io_uring_enter, fd, numToSubmit, 1,
+                                IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (result < 0) {
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+          if (!failed) {
+            // Withdraw the requests which were not submitted.
+            failed = true;
+            __atomic_store_n(sqTail, tail - numToSubmit, __ATOMIC_RELEASE);
+          } else {
+            // We cannot even wait, so poll for the remaining completions.
+            sched_yield();
+          }
+        }
+        result = 0;
+      }
+      numSubmitted += result;
+
+      // Reap the completions, which also makes room for them if the
+      // completion queue was full.
+      unsigned head = *cqHead;
+      unsigned cqTailValue = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+      for (; head != cqTailValue; ++head, ++numCompleted) {
+        const struct io_uring_cqe& cqe = cqes[head & *cqMask];
+        results[(unsigned)cqe.user_data] = cqe.res;
+      }
+      __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+    if (failed)
+      return false;
+
+    for (unsigned i = 0; i != count; ++i) {
+      if (results[i] < 0) {
+        infos_out[i] = makeMissingInfo();
+        continue;
+      }
+      const struct statx& buf = buffers[i];
+      infos_out[i] = makeInfo(makedev(buf.stx_dev_major, buf.stx_dev_minor),
+                              buf.stx_ino, buf.stx_mode, buf.stx_size,
+                              buf.stx_mtime.tv_sec, buf.stx_mtime.tv_nsec);
+    }
+    return true;
+  }
+};
+
+}
+#endif
+
+void FileInfo::getInfoForPaths(ArrayRef<std::string> paths,
+                               MutableArrayRef<FileInfo> infos_out,
+                               bool asLink) {
+  assert(paths.size() == infos_out.size());
+
+  // Batching is not worthwhile for a handful of paths, or without multiple
+  // cores to service the requests concurrently (the kernel completes statx
+  // requests on worker threads, so these would only add overhead).
+  const size_t minBatchedPaths = 64;
+  if (paths.size() < minBatchedPaths ||
+      std::thread::hardware_concurrency() <= 1) {
+    for (size_t i = 0, e = paths.size(); i != e; ++i)
+      infos_out[i] = getInfoForPath(paths[i], asLink);
+    return;
+  }
+
+  size_t numDone = 0;
+
+#if defined(LLBUILD_HAVE_IO_URING_STATX)
+  // Issue the requests through io_uring, which runs them concurrently in the
+  // kernel.
+  {
+    StatxRing ring;
+    if (ring.open(256)) {
+      while (numDone != paths.size()) {
+        unsigned count = (unsigned)std::min<size_t>(ring.getBatchSize(),
+                                                    paths.size() - numDone);
+        if (!ring.stat(&paths[numDone], count, asLink, &infos_out[numDone]))
+          break;
+        numDone += count;
+      }
+    }
+  }
+#endif
+
+  // Otherwise, stat the remaining paths from a pool of threads. The work is
+  // dominated by waiting on the file system, so use more threads than cores.
+  const size_t chunkSize = 64;
+  size_t numChunks = (paths.size() - numDone + chunkSize - 1) / chunkSize;
+  if (numChunks == 0)
+    return;
+  unsigned numThreads = std::min<size_t>(
+      numChunks, std::max(4u, 2 * std::thread::hardware_concurrency()));
+
+  std::atomic<size_t> nextChunk{0};
+  auto statChunks = [&]() {
+    while (true) {
+      size_t chunk = nextChunk++;
+      if (chunk >= numChunks)
+        return;
+      size_t begin = numDone + chunk * chunkSize;
+      size_t end = std::min(begin + chunkSize, paths.size());
+      for (size_t i = begin; i != end; ++i)
+        infos_out[i] = getInfoForPath(paths[i], asLink);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < numThreads; ++i)
+    threads.emplace_back(statChunks);
+  statChunks();
+  for (auto& thread: threads)
+    thread.join();
+}
+
+bool basic::parseFileChecksumAlgorithm(StringRef name,
+                                       FileChecksumAlgorithm* algorithm_out) {
+  if (name == "platform") {
+    *algorithm_out = FileChecksumAlgorithm::Platform;
+  } else if (name == "xxh64") {
+    *algorithm_out = FileChecksumAlgorithm::XXH64;
+  } else if (name == "blake3") {
+    *algorithm_out = FileChecksumAlgorithm::BLAKE3;
+  } else {
+    return false;
+  }
+  return true;
 }
 
-FileChecksum FileChecksum::getChecksumForPath(const std::string& path) {
+FileChecksum FileChecksum::getChecksumForPath(const std::string& path,
+                                              FileChecksumAlgorithm algorithm) {
   FileChecksum result;
 
   FileInfo fileInfo = FileInfo::getInfoForPath(path);
   if (fileInfo.isMissing()) {
-    memset(result.bytes, 0, sizeof(result.bytes));
+    return result;
   } else if (fileInfo.isDirectory()) {
     result.bytes[0] = 1;
-  } else {
+    return result;
+  }
+
+  // Read the contents in one go, which maps large files rather than copying
+  // them.
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer)
+    return result;
+  ArrayRef<uint8_t> contents(
+      reinterpret_cast<const uint8_t*>((*buffer)->getBufferStart()),
+      (*buffer)->getBufferSize());
+
+  // Hash large files on several threads.
+  const uint64_t minParallelSize = 16 * 1024 * 1024;
+  unsigned numThreads = contents.size() >= minParallelSize ?
+    std::thread::hardware_concurrency() : 1;
+
+  switch (algorithm) {
+  case FileChecksumAlgorithm::Platform: {
     PlatformSpecificHasher hasher(path);
-    if (hasher.readAndDigest()) {
-      hasher.copy(result.bytes);
-    } else {
-      memset(result.bytes, 0, sizeof(result.bytes));
-    }
+    hasher.update(contents.data(), contents.size());
+    hasher.finalize();
+    hasher.copy(result.bytes);
+    return result;
+  }
+
+  case FileChecksumAlgorithm::XXH64: {
+    uint64_t hash = hashXXH64Blocks(contents, numThreads);
+    for (unsigned i = 0; i != 8; ++i)
+      result.bytes[i] = uint8_t(hash >> (8 * i));
+    break;
+  }
+
+  case FileChecksumAlgorithm::BLAKE3: {
+    auto hash = hashBLAKE3(contents, numThreads);
+    std::copy(hash.begin(), hash.begin() + algorithmByte, result.bytes);
+    break;
+  }
   }
 
+  result.bytes[algorithmByte] = uint8_t(algorithm);
   return result;
 }
@@ -15,12 +15,14 @@
 #include "llbuild/Basic/Stat.h"
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/DJB.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/MemoryBuffer.h"
 
 #include <cassert>
 #include <cstring>
+#include <vector>
 
 // Cribbed from llvm, where it's been since removed.
 namespace {
@@ -133,6 +135,13 @@ bool FileSystem::createDirectories(const std::string& path) {
 }
 
 
+void FileSystem::getFileInfos(ArrayRef<std::string> paths,
+                              MutableArrayRef<FileInfo> infos_out) {
+  assert(paths.size() == infos_out.size());
+  for (size_t i = 0, e = paths.size(); i != e; ++i)
+    infos_out[i] = getFileInfo(paths[i]);
+}
+
 std::unique_ptr<llvm::MemoryBuffer>
 DeviceAgnosticFileSystem::getFileContents(const std::string& path) {
   return impl->getFileContents(path);
@@ -142,11 +151,38 @@ std::unique_ptr<llvm::MemoryBuffer>
 ChecksumOnlyFileSystem::getFileContents(const std::string& path) {
   return impl->getFileContents(path);
 }
+
+FileInfo ChecksumOnlyFileSystem::getFileInfo(const std::string& path) {
+  auto info = impl->getFileInfo(path);
+
+  // Only read the contents if the file has changed since its checksum was
+  // cached.
+  FileChecksum checksum;
+  if (!checksumCache || !checksumCache->lookup(info, &checksum)) {
+    checksum = impl->getFileChecksum(path);
+    if (checksumCache)
+      checksumCache->insert(info, checksum);
+  }
+
+  info.device = 0;
+  info.inode = 0;
+  info.modTime = FileTimestamp();
+  info.modTime.seconds = 0;
+  info.modTime.nanoseconds = 0;
+
+  info.checksum = checksum;
+
+  return info;
+}
 namespace {
 
 class LocalFileSystem : public FileSystem {
+  /// The algorithm used to checksum file contents.
+  FileChecksumAlgorithm checksumAlgorithm;
+
 public:
-  LocalFileSystem() {}
+  LocalFileSystem(FileChecksumAlgorithm checksumAlgorithm)
+      : checksumAlgorithm(checksumAlgorithm) {}
 
   virtual bool
   createDirectory(const std::string& path) override {
@@ -217,7 +253,7 @@ public:
   }
 
   virtual FileChecksum getFileChecksum(const std::string& path) override {
-    return FileChecksum::getChecksumForPath(path);
+    return FileChecksum::getChecksumForPath(path, checksumAlgorithm);
   }
 
   virtual FileInfo getFileInfo(const std::string& path) override {
@@ -228,6 +264,11 @@ public:
     return FileInfo::getInfoForPath(path, /*isLink:*/ true);
   }
 
+  virtual void getFileInfos(ArrayRef<std::string> paths,
+                            MutableArrayRef<FileInfo> infos_out) override {
+    FileInfo::getInfoForPaths(paths, infos_out);
+  }
+
   virtual bool createSymlink(const std::string& src,
                              const std::string& target) override {
     return (llbuild::basic::sys::symlink(src.c_str(), target.c_str()) == 0);
@@ -236,8 +277,9 @@ public:
   
 }
 
-std::unique_ptr<FileSystem> basic::createLocalFileSystem() {
-  return llvm::make_unique<LocalFileSystem>();
+std::unique_ptr<FileSystem>
+basic::createLocalFileSystem(FileChecksumAlgorithm checksumAlgorithm) {
+  return llvm::make_unique<LocalFileSystem>(checksumAlgorithm);
 }
 
 std::unique_ptr<FileSystem>
@@ -249,3 +291,175 @@ std::unique_ptr<FileSystem>
 basic::ChecksumOnlyFileSystem::from(std::unique_ptr<FileSystem> fs) {
   return llvm::make_unique<ChecksumOnlyFileSystem>(std::move(fs));
 }
+
+StatCachingFileSystem::Shard& StatCachingFileSystem::getShard(StringRef path) {
+  // Use the high bits of the hash, since the low bits select the bucket within
+  // the shard.
+  uint32_t hash = llvm::djbHash(path, 0);
+  return shards[(hash >> 16) & (NumShards - 1)];
+}
+
+FileInfo StatCachingFileSystem::getCachedInfo(const std::string& path,
+                                              bool asLink) {
+  auto& shard = getShard(path);
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto& infos = asLink ? shard.linkInfos : shard.fileInfos;
+    auto it = infos.find(path);
+    if (it != infos.end())
+      return it->second;
+    generation = shard.generation;
+  }
+
+  // Read the information without holding the lock, and only cache it if the
+  // shard was not invalidated in the meantime (and changes to the path will be
+  // noticed, if using a journal).
+  bool isCacheable = !journal || journal->watch(path);
+  FileInfo info = asLink ? impl->getLinkInfo(path) : impl->getFileInfo(path);
+  if (isCacheable) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    if (shard.generation == generation) {
+      auto& infos = asLink ? shard.linkInfos : shard.fileInfos;
+      infos[path] = info;
+    }
+  }
+  return info;
+}
+
+void StatCachingFileSystem::getFileInfos(ArrayRef<std::string> paths,
+                                         MutableArrayRef<FileInfo> infos_out) {
+  assert(paths.size() == infos_out.size());
+
+  uint64_t generations[NumShards];
+  for (unsigned i = 0; i != NumShards; ++i) {
+    std::lock_guard<std::mutex> guard(shards[i].mutex);
+    generations[i] = shards[i].generation;
+  }
+
+  // Serve what we can from the cache, and collect the remaining paths.
+  std::vector<size_t> missIndices;
+  std::vector<std::string> missPaths;
+  for (size_t i = 0, e = paths.size(); i != e; ++i) {
+    auto& shard = getShard(paths[i]);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto it = shard.fileInfos.find(paths[i]);
+    if (it != shard.fileInfos.end()) {
+      infos_out[i] = it->second;
+    } else {
+      missIndices.push_back(i);
+      missPaths.push_back(paths[i]);
+    }
+  }
+  if (missPaths.empty())
+    return;
+
+  // Retrieve the remaining information in bulk, and only cache it if the
+  // shard was not invalidated in the meantime.
+  std::vector<bool> isCacheable(missPaths.size(), true);
+  if (journal) {
+    for (size_t i = 0, e = missPaths.size(); i != e; ++i)
+      isCacheable[i] = journal->watch(missPaths[i]);
+  }
+  std::vector<FileInfo> missInfos(missPaths.size());
+  impl->getFileInfos(missPaths, missInfos);
+  for (size_t i = 0, e = missPaths.size(); i != e; ++i) {
+    infos_out[missIndices[i]] = missInfos[i];
+    if (!isCacheable[i])
+      continue;
+    auto& shard = getShard(missPaths[i]);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    if (shard.generation == generations[&shard - shards])
+      shard.fileInfos[missPaths[i]] = missInfos[i];
+  }
+}
+
+void StatCachingFileSystem::prefetchFileInfo(ArrayRef<std::string> paths) {
+  std::vector<FileInfo> infos(paths.size());
+  getFileInfos(paths, infos);
+}
+
+void StatCachingFileSystem::clear() {
+  for (auto& shard: shards) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    ++shard.generation;
+    shard.fileInfos.clear();
+    shard.linkInfos.clear();
+  }
+}
+
+void StatCachingFileSystem::attachJournal(
+    std::unique_ptr<FileChangeJournal> journal) {
+  // Nothing cached so far is being watched.
+  clear();
+  this->journal = std::move(journal);
+}
+
+void StatCachingFileSystem::revalidate() {
+  std::vector<std::string> changedPaths;
+  if (!journal || !journal->takeChanges(changedPaths)) {
+    clear();
+    return;
+  }
+
+  for (const auto& path: changedPaths)
+    invalidateFileInfo(path);
+}
+
+void StatCachingFileSystem::invalidateFileInfo(const std::string& path) {
+  // Modifying a path also modifies its parent directory, so drop the entries
+  // for all of the parents.
+  for (StringRef p = path; !p.empty(); p = llvm::sys::path::parent_path(p)) {
+    auto& shard = getShard(p);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    ++shard.generation;
+    shard.fileInfos.erase(p);
+    shard.linkInfos.erase(p);
+  }
+
+  impl->invalidateFileInfo(path);
+}
+
+bool StatCachingFileSystem::createDirectory(const std::string& path) {
+  bool result = impl->createDirectory(path);
+  invalidateFileInfo(path);
+  return result;
+}
+
+bool StatCachingFileSystem::createDirectories(const std::string& path) {
+  bool result = impl->createDirectories(path);
+  invalidateFileInfo(path);
+  return result;
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+StatCachingFileSystem::getFileContents(const std::string& path) {
+  return impl->getFileContents(path);
+}
+
+bool StatCachingFileSystem::remove(const std::string& path) {
+  bool result = impl->remove(path);
+  invalidateFileInfo(path);
+
+  // Removal is recursive, so also drop any entries within the path.
+  std::string prefix = path + "/";
+  for (auto& shard: shards) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    ++shard.generation;
+    for (auto* infos: { &shard.fileInfos, &shard.linkInfos }) {
+      for (auto it = infos->begin(), ie = infos->end(); it != ie;) {
+        auto current = it++;
+        if (current->getKey().startswith(prefix))
+          infos->erase(current);
+      }
+    }
+  }
+  return result;
+}
+
+bool StatCachingFileSystem::createSymlink(const std::string& src,
+                                          const std::string& target) {
+  bool result = impl->createSymlink(src, target);
+  invalidateFileInfo(target);
+  return result;
+}
@@ -22,6 +22,8 @@
 #include "llvm/ADT/Twine.h"
 
 #include <atomic>
+#include <chrono>
+#include <deque>
 #include <future>
 #include <queue>
 #include <random>
@@ -97,6 +99,41 @@ public:
   }
 };
 
+/// Orders jobs by their critical path estimate, such that the job with the
+/// longest estimate is the greatest, and otherwise by name.
+struct QueueJobCriticalPathLess {
+  bool operator()(const QueueJob& lhs, const QueueJob& rhs) const {
+    if (lhs.getCriticalPathEstimate() != rhs.getCriticalPathEstimate())
+      return lhs.getCriticalPathEstimate() < rhs.getCriticalPathEstimate();
+    return QueueJobLess()(lhs, rhs);
+  }
+};
+
+class CriticalPathScheduler : public Scheduler {
+private:
+  std::priority_queue<QueueJob, std::vector<QueueJob>,
+                      QueueJobCriticalPathLess> jobs;
+
+public:
+  void addJob(QueueJob job) override {
+    jobs.push(job);
+  }
+
+  QueueJob getNextJob() override {
+    QueueJob job = jobs.top();
+    jobs.pop();
+    return job;
+  }
+
+  bool empty() const override {
+    return jobs.empty();
+  }
+
+  uint64_t size() const override {
+    return jobs.size();
+  }
+};
+
 class FifoScheduler : public Scheduler {
 private:
   std::deque<QueueJob> jobs;
@@ -120,6 +157,16 @@ public:
     return jobs.size();
   }
 };
+
+class LaneBasedExecutionQueue;
+
+/// The interval at which the system load is sampled, when limited.
+const std::chrono::milliseconds loadSampleInterval(100);
+
+/// The queue and lane number of the current thread, if it is a lane thread.
+thread_local LaneBasedExecutionQueue* currentQueue = nullptr;
+thread_local unsigned currentLaneNumber = 0;
+
 /// Build execution queue.
 //
 // FIXME: Consider trying to share this with the Ninja implementation.
@@ -136,16 +183,53 @@ class LaneBasedExecutionQueue : public ExecutionQueue {
   /// The Quality of Service class to use for this queue.
   QualityOfService qos;
 
-  /// The ready queue of jobs to execute.
+  /// The ready queue of jobs to execute, or null if using the work-stealing
+  /// scheduler.
   std::unique_ptr<Scheduler> readyJobs;
   FifoScheduler readyPriorityJobs;
+
+  /// Whether the ready queue is ordered by critical path estimates.
+  bool criticalPathScheduling;
+
   std::mutex readyJobsMutex;
   std::condition_variable readyJobsCondition;
   bool cancelled { false };
   bool shutdown { false };
 
+  /// The ready jobs owned by a single lane, for the work-stealing scheduler.
+  struct LaneJobs {
+    std::mutex mutex;
+    std::deque<QueueJob> jobs;
+  };
+
+  /// The ready jobs for each lane, for the work-stealing scheduler.
+  ///
+  /// Jobs added by a lane are queued on that lane, and jobs added by any other
+  /// thread are distributed across the lanes. Each lane runs its own jobs in
+  /// order, and steals from the other lanes when it has none, so lanes only
+  /// take \see readyJobsMutex to sleep, wake or run priority jobs.
+  std::vector<std::unique_ptr<LaneJobs>> laneJobs;
+
+  /// The next lane to add a job to, for threads which are not lanes.
+  std::atomic<unsigned> nextLane{ 0 };
+
+  /// The number of jobs in \see laneJobs, only modified while holding the
+  /// mutex for the lane the job is queued on.
+  std::atomic<uint64_t> numLaneJobs{ 0 };
+
+  /// The number of jobs in \see readyPriorityJobs, only modified while holding
+  /// \see readyJobsMutex.
+  std::atomic<uint64_t> numPriorityJobs{ 0 };
+
+  /// The number of lanes waiting for jobs, only modified while holding \see
+  /// readyJobsMutex.
+  std::atomic<unsigned> numSleepingLanes{ 0 };
+
   ProcessGroup spawnedProcesses;
 
+  /// The reactor servicing spawned processes, if supported.
+  std::unique_ptr<ProcessReactor> reactor;
+
   /// Management of cancellation and SIGKILL escalation
   std::mutex killAfterTimeoutThreadMutex;
   std::unique_ptr<std::thread> killAfterTimeoutThread = nullptr;
@@ -157,9 +241,37 @@ class LaneBasedExecutionQueue : public ExecutionQueue {
   unsigned backgroundTaskMax = 0;
   std::atomic<unsigned> backgroundTaskCount{0};
 
+  /// The state of a resource pool used by the queue's jobs.
+  struct ResourcePoolState {
+    /// The total weight of the running jobs in the pool.
+    unsigned weightInUse = 0;
 
-  /// The base environment.
-  const char* const* environment;
+    /// The jobs held until the pool has capacity, in the order they were
+    /// taken by a lane.
+    std::deque<std::pair<QueueJob, QueueJobPriority>> waitingJobs;
+  };
+
+  /// The state of each resource pool, protected by \see resourcePoolsMutex.
+  std::mutex resourcePoolsMutex;
+  std::unordered_map<const ResourcePool*, ResourcePoolState> resourcePools;
+
+  /// The limits on the system load for starting new processes.
+  ExecutionQueueLoadLimits loadLimits;
+
+  /// Management of starting processes within the load limits, only used if
+  /// any limits are set.
+  std::mutex loadMutex;
+  std::condition_variable loadCondition;
+  unsigned numRunningProcesses = 0;
+  uint64_t reservedMemory = 0;
+  std::chrono::steady_clock::time_point lastLoadSampleTime;
+  bool lastLoadExceeded = false;
+  bool loadWaitCancelled = false;
+
+
+  /// The base environment, precomputed once since it is inherited by most
+  /// processes.
+  std::shared_ptr<const POSIXEnvironmentBlock> environment;
 
   void executeLane(uint32_t buildID, uint32_t laneNumber) {
     // Set the thread name, if available.
@@ -184,12 +296,19 @@ class LaneBasedExecutionQueue : public ExecutionQueue {
     uint32_t jobCount = 0;
     uint64_t laneID = (((uint64_t)buildID & 0xFFFF) << 32) + (((uint64_t)laneNumber & 0xFFFF) << 16);
 
+    currentQueue = this;
+    currentLaneNumber = laneNumber;
+
     // Execute items from the queue until shutdown.
     while (true) {
       // Take a job from the ready queue.
       QueueJob job{};
+      QueueJobPriority priority = QueueJobPriority::Normal;
       uint64_t readyJobsCount;
-      {
+      if (!readyJobs) {
+        if (!takeLaneJob(laneNumber, job, priority, readyJobsCount))
+          return;
+      } else {
         std::unique_lock<std::mutex> lock(readyJobsMutex);
 
         // While the queue is empty, wait for an item.
@@ -203,6 +322,7 @@ class LaneBasedExecutionQueue : public ExecutionQueue {
         // priority jobs.
         if (!readyPriorityJobs.empty()) {
           job = readyPriorityJobs.getNextJob();
+          priority = QueueJobPriority::High;
         } else {
           job = readyJobs->getNextJob();
         }
@@ -213,6 +333,11 @@ class LaneBasedExecutionQueue : public ExecutionQueue {
       if (!job.getDescriptor())
         break;
 
+      // If the job's resource pool is full, the pool holds it and the lane
+      // moves on to another job.
+      if (!acquireResourcePool(job, priority))
+        continue;
+
       // Process the job.
       jobCount++;
       uint64_t jobID = laneID + jobCount;
@@ -228,6 +353,196 @@ class LaneBasedExecutionQueue : public ExecutionQueue {
         job.execute(reinterpret_cast<QueueJobContext*>(&context));
         getDelegate().queueJobFinished(job.getDescriptor());
       }
+
+      releaseResourcePool(job);
+    }
+  }
+
+  /// Reserve the capacity for a job in its resource pool, if it has one.
+  ///
+  /// \returns False if the pool is full, in which case the job is held by the
+  /// pool until it has capacity, \see releaseResourcePool().
+  bool acquireResourcePool(QueueJob& job, QueueJobPriority priority) {
+    const ResourcePool* pool = job.getResourcePool();
+    if (!pool)
+      return true;
+
+    std::lock_guard<std::mutex> guard(resourcePoolsMutex);
+    auto& state = resourcePools[pool];
+
+    // Always admit a job to an idle pool, so jobs heavier than the pool's
+    // depth still run.
+    unsigned weight = job.getResourcePoolWeight();
+    if (state.weightInUse != 0 &&
+        state.weightInUse + weight > pool->getDepth()) {
+      state.waitingJobs.emplace_back(std::move(job), priority);
+      return false;
+    }
+    state.weightInUse += weight;
+    return true;
+  }
+
+  /// Release the capacity reserved for a finished job in its resource pool,
+  /// and requeue the held jobs which now fit.
+  ///
+  /// The requeued jobs reserve their capacity once taken by a lane, so may be
+  /// held again if other jobs in the pool are taken first.
+  void releaseResourcePool(const QueueJob& job) {
+    const ResourcePool* pool = job.getResourcePool();
+    if (!pool)
+      return;
+
+    std::vector<std::pair<QueueJob, QueueJobPriority>> requeuedJobs;
+    {
+      std::lock_guard<std::mutex> guard(resourcePoolsMutex);
+      auto& state = resourcePools[pool];
+      state.weightInUse -= job.getResourcePoolWeight();
+
+      unsigned weight = state.weightInUse;
+      while (!state.waitingJobs.empty()) {
+        unsigned jobWeight =
+          state.waitingJobs.front().first.getResourcePoolWeight();
+        if (weight != 0 && weight + jobWeight > pool->getDepth())
+          break;
+        weight += jobWeight;
+        requeuedJobs.push_back(std::move(state.waitingJobs.front()));
+        state.waitingJobs.pop_front();
+      }
+    }
+
+    for (auto& entry: requeuedJobs)
+      addJob(std::move(entry.first), entry.second);
+  }
+
+  /// Take a job for the given lane, for the work-stealing scheduler.
+  ///
+  /// \returns False if the queue is shutting down and no jobs remain.
+  bool takeLaneJob(unsigned laneNumber, QueueJob& job_out,
+                   QueueJobPriority& priority_out,
+                   uint64_t& readyJobsCount_out) {
+    while (true) {
+      // Preferentially run priority jobs.
+      if (numPriorityJobs != 0) {
+        std::lock_guard<std::mutex> guard(readyJobsMutex);
+        if (!readyPriorityJobs.empty()) {
+          job_out = readyPriorityJobs.getNextJob();
+          priority_out = QueueJobPriority::High;
+          --numPriorityJobs;
+          readyJobsCount_out = numLaneJobs;
+          return true;
+        }
+      }
+
+      // Take the oldest job from our own lane, then from the other lanes.
+      if (numLaneJobs != 0) {
+        for (unsigned i = 0, e = laneJobs.size(); i != e; ++i) {
+          auto& lane = *laneJobs[(laneNumber + i) % e];
+          std::lock_guard<std::mutex> guard(lane.mutex);
+          if (!lane.jobs.empty()) {
+            job_out = std::move(lane.jobs.front());
+            lane.jobs.pop_front();
+            readyJobsCount_out = --numLaneJobs;
+            return true;
+          }
+        }
+      }
+
+      // Wait for a job to be added. A lane marks itself as sleeping before
+      // checking for jobs, so it either sees a new job or is woken by
+      // addLaneJob().
+      std::unique_lock<std::mutex> lock(readyJobsMutex);
+      ++numSleepingLanes;
+      readyJobsCondition.wait(lock, [&] {
+          return shutdown || numLaneJobs != 0 || !readyPriorityJobs.empty();
+        });
+      --numSleepingLanes;
+      if (shutdown && numLaneJobs == 0 && readyPriorityJobs.empty())
+        return false;
+    }
+  }
+
+  /// Add a job to a lane, for the work-stealing scheduler.
+  void addLaneJob(QueueJob job) {
+    unsigned index;
+    if (currentQueue == this) {
+      index = currentLaneNumber;
+    } else {
+      index = nextLane++ % laneJobs.size();
+    }
+
+    uint64_t readyJobsCount;
+    {
+      auto& lane = *laneJobs[index];
+      std::lock_guard<std::mutex> guard(lane.mutex);
+      lane.jobs.push_back(std::move(job));
+      readyJobsCount = ++numLaneJobs;
+    }
+
+    if (numSleepingLanes != 0) {
+      std::lock_guard<std::mutex> guard(readyJobsMutex);
+      readyJobsCondition.notify_one();
+    }
+    TracingExecutionQueueDepth(readyJobsCount);
+  }
+
+  /// Check whether the system load exceeds the limits.
+  ///
+  /// The load is sampled at most once per interval, and the caller must hold
+  /// \see loadMutex.
+  bool isLoadExceeded() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastLoadSampleTime < loadSampleInterval)
+      return lastLoadExceeded;
+    lastLoadSampleTime = now;
+
+    auto exceeds = [](double value, double limit) {
+      // Ignore unavailable measurements.
+      return limit > 0.0 && value >= 0.0 && value > limit;
+    };
+    lastLoadExceeded =
+      exceeds(sys::getLoadAverage(), loadLimits.maxLoadAverage) ||
+      exceeds(sys::getPressureStallPercentage("cpu"),
+              loadLimits.maxCPUPressure) ||
+      exceeds(sys::getPressureStallPercentage("memory"),
+              loadLimits.maxMemoryPressure);
+    return lastLoadExceeded;
+  }
+
+  /// Check whether starting a process with the given memory estimate would
+  /// exceed the memory budget.
+  ///
+  /// The caller must hold \see loadMutex.
+  bool isMemoryBudgetExceeded(uint64_t memoryEstimate) const {
+    return loadLimits.memoryBudget != 0 &&
+      reservedMemory + memoryEstimate > loadLimits.memoryBudget;
+  }
+
+  /// Wait until a process can be started within the load limits, and count it
+  /// (and its memory estimate) as running.
+  void waitToStartProcess(uint64_t memoryEstimate) {
+    std::unique_lock<std::mutex> lock(loadMutex);
+
+    // Always allow one process to run, so the build makes progress.
+    while (!loadWaitCancelled && numRunningProcesses != 0 &&
+           (isMemoryBudgetExceeded(memoryEstimate) || isLoadExceeded())) {
+      loadCondition.wait_for(lock, loadSampleInterval);
+    }
+    ++numRunningProcesses;
+    reservedMemory += memoryEstimate;
+  }
+
+  /// Notify waiting lanes that a process counted by \see waitToStartProcess()
+  /// has completed.
+  void processCompleted(uint64_t memoryEstimate) {
+    std::lock_guard<std::mutex> guard(loadMutex);
+    --numRunningProcesses;
+    reservedMemory -= memoryEstimate;
+
+    // Releasing memory may allow several smaller processes to start.
+    if (memoryEstimate != 0) {
+      loadCondition.notify_all();
+    } else {
+      loadCondition.notify_one();
     }
   }
 
@@ -253,15 +568,25 @@ class LaneBasedExecutionQueue : public ExecutionQueue {
 public:
   LaneBasedExecutionQueue(ExecutionQueueDelegate& delegate,
                           unsigned numLanesSuggestion, SchedulerAlgorithm alg,
-                          QualityOfService qos, const char* const* environment)
+                          QualityOfService qos, const char* const* environment,
+                          const ExecutionQueueLoadLimits& loadLimits)
   : ExecutionQueue(delegate), buildID(std::random_device()()), qos(qos),
-        readyJobs(Scheduler::make(alg)), environment(environment)
+        readyJobs(Scheduler::make(alg)),
+        criticalPathScheduling(alg == SchedulerAlgorithm::CriticalPath),
+        reactor(createProcessReactor()),
+        loadLimits(loadLimits),
+        environment(std::make_shared<const POSIXEnvironmentBlock>(environment))
   {
 
     auto taskLimits = estimateTaskLimits(numLanesSuggestion);
     numLanes = taskLimits.first;
     backgroundTaskMax = taskLimits.second;
 
+    if (!readyJobs) {
+      for (unsigned i = 0; i != numLanes; ++i)
+        laneJobs.push_back(llvm::make_unique<LaneJobs>());
+    }
+
     for (unsigned i = 0; i != numLanes; ++i) {
       lanes.push_back(std::unique_ptr<std::thread>(
                           new std::thread(
@@ -281,6 +606,9 @@ public:
       lanes[i]->join();
     }
 
+    // Wait for any processes which released their lanes.
+    reactor.reset();
+
     {
       std::lock_guard<std::mutex> guard(killAfterTimeoutThreadMutex);
       if (killAfterTimeoutThread) {
@@ -325,8 +653,8 @@ public:
 
     // Configure the background task maximum. We currently support an
     // environmental override for experimentation purposes, but otherwise
-    // limit to a modest multiple of the core count, since we currently burn
-    // one thread per background task.
+    // limit to a modest multiple of the core count, since without a process
+    // reactor we burn one thread per background task.
     unsigned backgroundTaskMax = 0;
     char *p = getenv("LLBUILD_BACKGROUND_TASK_MAX");
     if (p && !StringRef(p).getAsInteger(10, backgroundTaskMax)) {
@@ -342,20 +670,34 @@ public:
   }
 
   virtual void addJob(QueueJob job, QueueJobPriority priority) override {
+    if (!readyJobs && priority != QueueJobPriority::High) {
+      addLaneJob(std::move(job));
+      return;
+    }
+
     uint64_t readyJobsCount;
     {
       std::lock_guard<std::mutex> guard(readyJobsMutex);
       if (priority == QueueJobPriority::High) {
         readyPriorityJobs.addJob(job);
+        ++numPriorityJobs;
       } else {
         readyJobs->addJob(job);
       }
       readyJobsCondition.notify_one();
-      readyJobsCount = readyJobs->size();
+      readyJobsCount = readyJobs ? readyJobs->size() : numLaneJobs.load();
     }
     TracingExecutionQueueDepth(readyJobsCount);
   }
 
+  bool usesCriticalPathEstimates() const override {
+    return criticalPathScheduling;
+  }
+
+  bool usesMemoryEstimates() const override {
+    return loadLimits.memoryBudget != 0;
+  }
+
   virtual void cancelAllJobs() override {
     {
       std::lock_guard<std::mutex> lock(readyJobsMutex);
@@ -366,6 +708,13 @@ public:
       readyJobsCondition.notify_all();
     }
 
+    // Stop waiting for the load to fall, the processes will be cancelled.
+    {
+      std::lock_guard<std::mutex> guard(loadMutex);
+      loadWaitCancelled = true;
+      loadCondition.notify_all();
+    }
+
     spawnedProcesses.signalAll(SIGINT);
     {
       std::lock_guard<std::mutex> guard(killAfterTimeoutThreadMutex);
@@ -416,14 +765,8 @@ public:
     }
 
     // Inherit the base environment, if desired.
-    //
-    // FIXME: This involves a lot of redundant allocation, currently. We could
-    // cache this for the common case of a directly inherited environment.
     if (attributes.inheritEnvironment) {
-      for (const char* const* p = this->environment; *p != nullptr; ++p) {
-        auto pair = StringRef(*p).split('=');
-        posixEnv.setIfMissing(pair.first, pair.second);
-      }
+      posixEnv.setBase(this->environment);
     }
 
     // Assign a process handle, which just needs to be unique for as long as we
@@ -431,9 +774,21 @@ public:
     ProcessHandle handle;
     handle.id = context.jobID;
 
-    ProcessReleaseFn releaseFn = [this](std::function<void()>&& processWait) {
+    // Whether the process released its lane and counts as a background task
+    // until it completes, when using the reactor.
+    auto isBackgroundTask = std::make_shared<bool>(false);
+
+    ProcessReleaseFn releaseFn = [this, isBackgroundTask](
+        std::function<void()>&& processWait) {
       auto previousTaskCount = backgroundTaskCount.fetch_add(1);
       if (previousTaskCount < backgroundTaskMax) {
+        // The reactor completes the process without a thread, so just release
+        // the lane.
+        if (reactor) {
+          *isBackgroundTask = true;
+          return;
+        }
+
         // Launch the process wait on a detached thread
         std::thread([this, processWait=std::move(processWait)]() mutable {
           processWait();
@@ -446,15 +801,28 @@ public:
       }
     };
 
+    bool hasLoadLimits = loadLimits.hasLimits();
+    uint64_t memoryEstimate =
+      loadLimits.memoryBudget != 0 ? context.job.getMemoryEstimate() : 0;
     ProcessCompletionFn laneCompletionFn{
-      [completionFn, lane=context.laneNumber](ProcessResult result) mutable {
+      [this, completionFn, hasLoadLimits, memoryEstimate, isBackgroundTask,
+       lane=context.laneNumber](ProcessResult result) mutable {
         TracingExecutionQueueSubprocessResult(lane, result.pid, result.utime,
                                               result.stime, result.maxrss);
+        if (*isBackgroundTask)
+          backgroundTaskCount--;
+        if (hasLoadLimits)
+          processCompleted(memoryEstimate);
         if (completionFn.hasValue())
           completionFn.getValue()(result);
       }
     };
 
+    // Hold the process until the system load and memory use are within the
+    // limits.
+    if (hasLoadLimits)
+      waitToStartProcess(memoryEstimate);
+
     spawnProcess(
         delegate ? *delegate : getDelegate(),
         reinterpret_cast<ProcessContext*>(context.job.getDescriptor()),
@@ -464,7 +832,8 @@ public:
         posixEnv,
         attributes,
         std::move(releaseFn),
-        std::move(laneCompletionFn)
+        std::move(laneCompletionFn),
+        reactor.get()
     );
   }
 };
@@ -475,6 +844,11 @@ std::unique_ptr<Scheduler> Scheduler::make(SchedulerAlgorithm alg) {
       return std::unique_ptr<Scheduler>(new PriorityQueueScheduler);
     case SchedulerAlgorithm::FIFO:
       return std::unique_ptr<Scheduler>(new FifoScheduler);
+    case SchedulerAlgorithm::WorkStealing:
+      // The per-lane queues are managed by the execution queue itself.
+      return nullptr;
+    case SchedulerAlgorithm::CriticalPath:
+      return std::unique_ptr<Scheduler>(new CriticalPathScheduler);
     default:
       assert(0 && "unknown scheduler algorithm");
       return std::unique_ptr<Scheduler>(nullptr);
@@ -491,11 +865,13 @@ extern "C" {
 
 ExecutionQueue* llbuild::basic::createLaneBasedExecutionQueue(
     ExecutionQueueDelegate& delegate, int numLanes, SchedulerAlgorithm alg,
-    QualityOfService qos, const char* const* environment
+    QualityOfService qos, const char* const* environment,
+    const ExecutionQueueLoadLimits& loadLimits
 ) {
   if (!environment) {
     environment = const_cast<const char* const*>(environ);
   }
-  return new LaneBasedExecutionQueue(delegate, numLanes, alg, qos, environment);
+  return new LaneBasedExecutionQueue(delegate, numLanes, alg, qos, environment,
+                                     loadLimits);
 }
 
@@ -27,6 +27,7 @@
 #endif
 #endif
 #include <stdio.h>
+#include <stdlib.h>
 
 #if defined(_WIN32)
 const HANDLE llbuild::basic::sys::FileDescriptorTraits<HANDLE>::InvalidDescriptor =
@@ -261,6 +262,36 @@ int sys::raiseOpenFileLimit(llbuild_rlim_t limit) {
 #endif
 }
 
+double sys::getLoadAverage() {
+#if defined(_WIN32)
+  return -1.0;
+#else
+  double loadAverage;
+  if (::getloadavg(&loadAverage, 1) != 1)
+    return -1.0;
+  return loadAverage;
+#endif
+}
+
+double sys::getPressureStallPercentage(const char* resource) {
+#if defined(__linux__)
+  std::string path = std::string("/proc/pressure/") + resource;
+  FILE* file = ::fopen(path.c_str(), "r");
+  if (!file)
+    return -1.0;
+
+  // The first line has the form "some avg10=0.00 avg60=0.00 ...".
+  double percentage;
+  int matched = ::fscanf(file, "some avg10=%lf", &percentage);
+  ::fclose(file);
+  if (matched != 1)
+    return -1.0;
+  return percentage;
+#else
+  return -1.0;
+#endif
+}
+
 sys::MATCH_RESULT sys::filenameMatch(const std::string& pattern,
                                      const std::string& filename) {
 #if defined(_WIN32)
@@ -160,8 +160,9 @@ class SerialExecutionQueue : public ExecutionQueue {
   /// Underlying queue implementation
   SerialQueueImpl* queue;
 
-  /// The base environment.
-  const char* const* environment;
+  /// The base environment, precomputed once since it is inherited by most
+  /// processes.
+  std::shared_ptr<const POSIXEnvironmentBlock> environment;
 
   struct SerialContext: public basic::QueueJobContext {
     uint64_t jobID;
@@ -206,7 +207,8 @@ class SerialExecutionQueue : public ExecutionQueue {
 public:
   SerialExecutionQueue(ExecutionQueueDelegate& delegate,
                        const char* const* environment)
-  : ExecutionQueue(delegate), buildID(std::random_device()()), queue(new SerialQueueImpl), environment(environment)
+  : ExecutionQueue(delegate), buildID(std::random_device()()), queue(new SerialQueueImpl),
+    environment(std::make_shared<const POSIXEnvironmentBlock>(environment))
   {
   }
 
@@ -285,14 +287,8 @@ public:
     }
 
     // Inherit the base environment, if desired.
-    //
-    // FIXME: This involves a lot of redundant allocation, currently. We could
-    // cache this for the common case of a directly inherited environment.
     if (attributes.inheritEnvironment) {
-      for (const char* const* p = this->environment; *p != nullptr; ++p) {
-        auto pair = StringRef(*p).split('=');
-        posixEnv.setIfMissing(pair.first, pair.second);
-      }
+      posixEnv.setBase(this->environment);
     }
 
     // Assign a process handle, which just needs to be unique for as long as we
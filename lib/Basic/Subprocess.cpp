@@ -17,6 +17,7 @@
 #include "llbuild/Basic/ShellUtility.h"
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Config/config.h"
@@ -28,6 +29,7 @@
 #include <atomic>
 #include <thread>
 #include <memory>
+#include <unordered_map>
 
 #include <fcntl.h>
 #if !defined(_WIN32)
@@ -44,6 +46,11 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #endif
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif
 
 #ifdef __APPLE__
 #include <pthread/spawn.h>
@@ -104,6 +111,12 @@ static int posix_spawn_file_actions_addchdir(posix_spawn_file_actions_t * __rest
 }
 #endif
 
+// The process reactor is implemented using epoll, and process file descriptors
+// for exit notifications.
+#if defined(__linux__) && defined(HAVE_POSIX_SPAWN) && defined(SYS_pidfd_open)
+#define LLBUILD_HAVE_PROCESS_REACTOR 1
+#endif
+
 using namespace llbuild;
 using namespace llbuild::basic;
 
@@ -514,6 +527,12 @@ static void cleanUpExecutedProcess(ProcessDelegate& delegate,
                     uint64_t(usage.ru_utime.tv_usec));
   uint64_t stime = (uint64_t(usage.ru_stime.tv_sec) * 1000000 +
                     uint64_t(usage.ru_stime.tv_usec));
+#if defined(__APPLE__)
+  uint64_t maxrss = usage.ru_maxrss;
+#else
+  // Linux (and most other platforms) report the value in kilobytes.
+  uint64_t maxrss = uint64_t(usage.ru_maxrss) * 1024;
+#endif
 
   // FIXME: We should report a statistic for how much output we read from the
   // subprocess (probably as a new point sample).
@@ -522,13 +541,302 @@ static void cleanUpExecutedProcess(ProcessDelegate& delegate,
   bool cancelled = WIFSIGNALED(exitCode) && (WTERMSIG(exitCode) == SIGINT || WTERMSIG(exitCode) == SIGKILL);
   ProcessStatus processStatus = cancelled ? ProcessStatus::Cancelled : (exitCode == 0) ? ProcessStatus::Succeeded : ProcessStatus::Failed;
   ProcessResult processResult(processStatus, exitCode, pid, utime, stime,
-                              usage.ru_maxrss);
+                              maxrss);
 #endif // else !defined(_WIN32)
   delegate.processFinished(ctx, handle, processResult);
   completionFn(processResult);
 }
 #endif
 
+#if defined(LLBUILD_HAVE_PROCESS_REACTOR)
+namespace {
+
+/// The state of a process serviced by a \see ProcessReactorImpl.
+///
+/// The spawning thread reads the pipes of a process until it asks to release
+/// its lane, at which point it is handed off to the reactor, which reads the
+/// rest of its output and completes it once it exits.
+struct ReactorProcess {
+  /// A file descriptor registered with the reactor.
+  struct Source {
+    enum Kind { Output, Exit };
+
+    ReactorProcess* process;
+    Kind kind;
+  };
+
+  ProcessDelegate& delegate;
+  ProcessContext* ctx;
+  ProcessGroup& pgrp;
+  ProcessHandle handle;
+  llbuild_pid_t pid;
+  ProcessCompletionFn completionFn;
+
+  ManagedDescriptor outputFd;
+
+  /// The control pipe, which is held open until the process exits.
+  ManagedDescriptor controlFd;
+
+  /// The process file descriptor, once the reactor is waiting for it to exit.
+  int pidFd = -1;
+
+  Source outputSource{ this, Source::Output };
+  Source exitSource{ this, Source::Exit };
+
+  /// The mutex protecting the handoff state.
+  std::mutex mutex;
+
+  /// Condition variable signalled when the process completes.
+  std::condition_variable condition;
+
+  /// Whether the process has been handed off to the reactor.
+  bool isHandedOff = false;
+
+  /// Whether the process has completed.
+  bool isComplete = false;
+
+  ReactorProcess(ProcessDelegate& delegate, ProcessContext* ctx,
+                 ProcessGroup& pgrp, ProcessHandle handle, llbuild_pid_t pid,
+                 ProcessCompletionFn&& completionFn,
+                 ManagedDescriptor&& outputFd, ManagedDescriptor&& controlFd)
+      : delegate(delegate), ctx(ctx), pgrp(pgrp), handle(handle), pid(pid),
+        completionFn(std::move(completionFn)), outputFd(std::move(outputFd)),
+        controlFd(std::move(controlFd)) {}
+};
+
+class ProcessReactorImpl : public ProcessReactor {
+  int epollFd;
+
+  /// An event descriptor used to wake the reactor for shutdown.
+  int wakeFd;
+
+  /// The reactor thread.
+  std::thread thread;
+
+  /// The processes the reactor is servicing, indexed by their address.
+  std::unordered_map<ReactorProcess*, std::shared_ptr<ReactorProcess>>
+    processes;
+
+  /// The mutex protecting \see processes.
+  std::mutex processesMutex;
+
+  /// Condition variable signalled when there are no processes.
+  std::condition_variable processesCondition;
+
+  bool addSource(ReactorProcess::Source& source, int fd) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = &source;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+  }
+
+  void removeSource(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+  }
+
+  /// Get the reactor's reference to a process.
+  std::shared_ptr<ReactorProcess> lookup(ReactorProcess& process) {
+    std::lock_guard<std::mutex> guard(processesMutex);
+    auto it = processes.find(&process);
+    assert(it != processes.end());
+    return it->second;
+  }
+
+  /// Stop servicing a completed process.
+  void forget(ReactorProcess& process) {
+    // The last reference may be the one in the map, so it is dropped after
+    // unlocking.
+    std::shared_ptr<ReactorProcess> ref;
+    std::lock_guard<std::mutex> guard(processesMutex);
+    auto it = processes.find(&process);
+    assert(it != processes.end());
+    ref = std::move(it->second);
+    processes.erase(it);
+    if (processes.empty())
+      processesCondition.notify_all();
+  }
+
+  /// Start reading the remaining output of a process, or wait for it to exit
+  /// if there is none.
+  void startReading(ReactorProcess& process) {
+    if (!process.outputFd.isValid()) {
+      watchExit(process);
+      return;
+    }
+    if (!addSource(process.outputSource,
+                   process.outputFd.unsafeDescriptor())) {
+      int err = errno;
+      process.delegate.processHadError(
+          process.ctx, process.handle,
+          Twine("failed to poll (") + strerror(err) + ")");
+      process.outputFd.close();
+      watchExit(process);
+    }
+  }
+
+  void readOutput(ReactorProcess& process) {
+    char buf[4096];
+    ssize_t numBytes = read(process.outputFd.unsafeDescriptor(), buf,
+                            sizeof(buf));
+    if (numBytes < 0) {
+      int err = errno;
+      process.delegate.processHadError(
+          process.ctx, process.handle,
+          Twine("unable to read process output (") + strerror(err) + ")");
+    }
+    if (numBytes <= 0) {
+      removeSource(process.outputFd.unsafeDescriptor());
+      process.outputFd.close();
+      watchExit(process);
+      return;
+    }
+
+    // Notify the client of the output.
+    process.delegate.processHadOutput(process.ctx, process.handle,
+                                      StringRef(buf, numBytes));
+  }
+
+  void processExited(ReactorProcess& process) {
+    removeSource(process.pidFd);
+    ::close(process.pidFd);
+    process.pidFd = -1;
+    complete(process);
+    forget(process);
+  }
+
+  /// Complete a process which has exited.
+  static void complete(ReactorProcess& process) {
+    cleanUpExecutedProcess(process.delegate, process.pgrp, process.pid,
+                           process.handle, process.ctx,
+                           std::move(process.completionFn), process.controlFd);
+
+    std::lock_guard<std::mutex> guard(process.mutex);
+    process.isComplete = true;
+    process.condition.notify_all();
+  }
+
+  /// Wait for a process, whose output has been drained, to exit.
+  void watchExit(ReactorProcess& process) {
+    process.pidFd = (int)syscall(SYS_pidfd_open, process.pid, 0);
+    if (process.pidFd >= 0 && addSource(process.exitSource, process.pidFd))
+      return;
+
+    // Fall back to waiting on a separate thread.
+    if (process.pidFd >= 0) {
+      ::close(process.pidFd);
+      process.pidFd = -1;
+    }
+    std::shared_ptr<ReactorProcess> ref = lookup(process);
+    std::thread([this, ref]() {
+        complete(*ref);
+        forget(*ref);
+      }).detach();
+  }
+
+  void run() {
+    pthread_setname_np(pthread_self(), "llbuild-reactor");
+
+    struct epoll_event events[64];
+    while (true) {
+      int numEvents = epoll_wait(epollFd, events, 64, -1);
+      if (numEvents < 0) {
+        if (errno == EINTR)
+          continue;
+        break;
+      }
+
+      for (int i = 0; i != numEvents; ++i) {
+        auto* source = static_cast<ReactorProcess::Source*>(events[i].data.ptr);
+        if (!source)
+          return;
+
+        switch (source->kind) {
+        case ReactorProcess::Source::Output:
+          readOutput(*source->process);
+          break;
+        case ReactorProcess::Source::Exit:
+          processExited(*source->process);
+          break;
+        }
+      }
+    }
+  }
+
+public:
+  ProcessReactorImpl(int epollFd, int wakeFd)
+      : epollFd(epollFd), wakeFd(wakeFd) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    thread = std::thread(&ProcessReactorImpl::run, this);
+  }
+
+  virtual ~ProcessReactorImpl() {
+    {
+      std::unique_lock<std::mutex> lock(processesMutex);
+      processesCondition.wait(lock, [&] { return processes.empty(); });
+    }
+
+    uint64_t value = 1;
+    (void)::write(wakeFd, &value, sizeof(value));
+    thread.join();
+    ::close(wakeFd);
+    ::close(epollFd);
+  }
+
+  /// Hand off a process which released its lane to the reactor, if it has
+  /// not been already, and optionally wait for it to complete.
+  void handOff(std::shared_ptr<ReactorProcess> process, bool wait) {
+    bool isHandedOff;
+    {
+      std::lock_guard<std::mutex> guard(process->mutex);
+      isHandedOff = process->isHandedOff;
+      process->isHandedOff = true;
+    }
+    if (!isHandedOff) {
+      {
+        std::lock_guard<std::mutex> guard(processesMutex);
+        processes[process.get()] = process;
+      }
+      startReading(*process);
+    }
+
+    if (wait) {
+      std::unique_lock<std::mutex> lock(process->mutex);
+      process->condition.wait(lock, [&] { return process->isComplete; });
+    }
+  }
+};
+
+}
+#endif
+
+ProcessReactor::~ProcessReactor() {}
+
+std::unique_ptr<ProcessReactor> llbuild::basic::createProcessReactor() {
+#if defined(LLBUILD_HAVE_PROCESS_REACTOR)
+  // Check that process file descriptors are supported by the kernel.
+  int pidFd = (int)syscall(SYS_pidfd_open, getpid(), 0);
+  if (pidFd < 0)
+    return nullptr;
+  ::close(pidFd);
+
+  int epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd < 0)
+    return nullptr;
+  int wakeFd = eventfd(0, EFD_CLOEXEC);
+  if (wakeFd < 0) {
+    ::close(epollFd);
+    return nullptr;
+  }
+  return llvm::make_unique<ProcessReactorImpl>(epollFd, wakeFd);
+#else
+  return nullptr;
+#endif
+}
+
 #if defined(_WIN32) || defined(HAVE_POSIX_SPAWN)
 #if defined(_WIN32)
   using PlatformSpecificPipesConfig = STARTUPINFOW;
@@ -655,7 +963,8 @@ void llbuild::basic::spawnProcess(
     POSIXEnvironment environment,
     ProcessAttributes attr,
     ProcessReleaseFn&& releaseFn,
-    ProcessCompletionFn&& completionFn
+    ProcessCompletionFn&& completionFn,
+    ProcessReactor* reactor
 ) {
   llbuild_pid_t pid = (llbuild_pid_t)-1;
   
@@ -952,6 +1261,10 @@ void llbuild::basic::spawnProcess(
     return;
   }
 
+#if !defined(LLBUILD_HAVE_PROCESS_REACTOR)
+  (void)reactor;
+#endif
+
 #if !defined(_WIN32)
   // Set up our poll() structures. We use assert() to ensure
   // the file descriptors are alive.
@@ -1092,6 +1405,21 @@ void llbuild::basic::spawnProcess(
     }
 
     if (control.shouldRelease()) {
+#if defined(LLBUILD_HAVE_PROCESS_REACTOR)
+      // If we have a reactor, it reads the rest of the output and completes
+      // the process once it exits, so the lane need not wait for it.
+      if (reactor) {
+        auto& reactorImpl = *static_cast<ProcessReactorImpl*>(reactor);
+        auto process = std::make_shared<ReactorProcess>(
+            delegate, ctx, pgrp, handle, pid, std::move(completionFn),
+            std::move(outputPipeParentEnd), std::move(controlPipeParentEnd));
+        releaseFn([&reactorImpl, process]() {
+            reactorImpl.handOff(process, /*wait=*/true);
+          });
+        reactorImpl.handOff(process, /*wait=*/false);
+        return;
+      }
+#endif
       std::shared_ptr<ManagedDescriptor> outputFdShared
         = std::make_shared<ManagedDescriptor>(std::move(outputPipeParentEnd));
       std::shared_ptr<ManagedDescriptor> controlFdShared
@@ -0,0 +1,255 @@
+//===-- WorkStealingPool.cpp ----------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "llbuild/Basic/WorkStealingPool.h"
+
+#include "llvm/ADT/STLExtras.h"
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+using namespace llbuild;
+using namespace llbuild::basic;
+
+namespace {
+
+class WorkStealingPoolImpl;
+
+/// The pool and worker index of the current thread, if it is a pool thread.
+thread_local WorkStealingPoolImpl* currentPool = nullptr;
+thread_local unsigned currentWorkerIndex = 0;
+
+class WorkStealingPoolImpl {
+  typedef std::function<void(void)> Operation;
+
+  /// The deque of operations owned by a single worker.
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Operation> operations;
+  };
+
+  /// The workers, which are never resized once the pool is created.
+  std::vector<std::unique_ptr<Worker>> workers;
+
+  /// The worker threads.
+  std::vector<std::thread> threads;
+
+  /// The next worker to add an operation to, for external threads.
+  std::atomic<unsigned> nextWorker{ 0 };
+
+  /// The number of operations which have been added but not yet taken.
+  std::atomic<size_t> numQueued{ 0 };
+
+  /// The number of operations which have been added but not yet completed.
+  std::atomic<size_t> numIncomplete{ 0 };
+
+  /// The number of worker threads waiting for operations, only modified while
+  /// holding \see idleMutex.
+  std::atomic<unsigned> numSleeping{ 0 };
+
+  /// The mutex used to coordinate sleeping and waking threads.
+  std::mutex idleMutex;
+
+  /// Condition variable used to signal when operations are available.
+  std::condition_variable workAvailableCondition;
+
+  /// Condition variable used to signal when all operations are complete.
+  std::condition_variable allCompleteCondition;
+
+  /// Whether the pool is shutting down, protected by \see idleMutex.
+  bool isShuttingDown = false;
+
+  /// Take an operation, preferring the given worker's own deque.
+  bool take(unsigned index, Operation& fn_out) {
+    // Take the most recently added operation from our own deque.
+    {
+      auto& worker = *workers[index];
+      std::lock_guard<std::mutex> guard(worker.mutex);
+      if (!worker.operations.empty()) {
+        fn_out = std::move(worker.operations.back());
+        worker.operations.pop_back();
+        --numQueued;
+        return true;
+      }
+    }
+
+    // Otherwise, steal the oldest operation from another worker.
+    for (unsigned i = 1, e = workers.size(); i != e; ++i) {
+      auto& victim = *workers[(index + i) % e];
+      std::lock_guard<std::mutex> guard(victim.mutex);
+      if (!victim.operations.empty()) {
+        fn_out = std::move(victim.operations.front());
+        victim.operations.pop_front();
+        --numQueued;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /// Run an operation which has been taken from the pool.
+  void execute(Operation& fn) {
+    fn();
+    fn = nullptr;
+
+    if (--numIncomplete == 0) {
+      std::lock_guard<std::mutex> guard(idleMutex);
+      allCompleteCondition.notify_all();
+    }
+  }
+
+  void run(unsigned index) {
+#if defined(__APPLE__)
+    pthread_setname_np("org.swift.llbuild WorkStealingPool");
+#elif defined(__linux__)
+    pthread_setname_np(pthread_self(), "llbuild-pool");
+#endif
+    currentPool = this;
+    currentWorkerIndex = index;
+
+    Operation fn;
+    while (true) {
+      if (take(index, fn)) {
+        execute(fn);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(idleMutex);
+      ++numSleeping;
+      workAvailableCondition.wait(lock, [&] {
+          return isShuttingDown || numQueued != 0;
+        });
+      --numSleeping;
+      if (isShuttingDown && numQueued == 0)
+        break;
+    }
+  }
+
+public:
+  WorkStealingPoolImpl(unsigned numThreads) {
+    if (numThreads == 0)
+      numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned i = 0; i != numThreads; ++i)
+      workers.push_back(llvm::make_unique<Worker>());
+
+    // Ensure all of the workers exist before starting any thread.
+    for (unsigned i = 0; i != numThreads; ++i)
+      threads.emplace_back(&WorkStealingPoolImpl::run, this, i);
+  }
+
+  ~WorkStealingPoolImpl() {
+    waitForAll();
+    {
+      std::lock_guard<std::mutex> guard(idleMutex);
+      isShuttingDown = true;
+      workAvailableCondition.notify_all();
+    }
+    for (auto& thread: threads)
+      thread.join();
+  }
+
+  unsigned getNumThreads() const {
+    return threads.size();
+  }
+
+  void async(Operation fn) {
+    assert(fn);
+
+    unsigned index;
+    if (currentPool == this) {
+      index = currentWorkerIndex;
+    } else {
+      index = nextWorker++ % workers.size();
+    }
+
+    ++numIncomplete;
+    {
+      auto& worker = *workers[index];
+      std::lock_guard<std::mutex> guard(worker.mutex);
+      worker.operations.push_back(std::move(fn));
+      ++numQueued;
+    }
+
+    // Wake a sleeping thread, if any. A thread marks itself as sleeping before
+    // checking for work, so it either sees the new operation or is woken here;
+    // the lock ensures the wakeup cannot be missed.
+    if (numSleeping != 0) {
+      std::lock_guard<std::mutex> guard(idleMutex);
+      workAvailableCondition.notify_one();
+    }
+  }
+
+  bool runOne() {
+    if (numQueued == 0)
+      return false;
+
+    Operation fn;
+    unsigned index = currentPool == this ? currentWorkerIndex :
+      nextWorker.load() % workers.size();
+    if (!take(index, fn))
+      return false;
+    execute(fn);
+    return true;
+  }
+
+  void waitForAll() {
+    while (numIncomplete != 0) {
+      if (runOne())
+        continue;
+
+      // The remaining operations are running, wait for them.
+      std::unique_lock<std::mutex> lock(idleMutex);
+      allCompleteCondition.wait(lock, [&] {
+          return numIncomplete == 0 || numQueued != 0;
+        });
+    }
+  }
+};
+
+}
+
+WorkStealingPool::WorkStealingPool(unsigned numThreads)
+    : impl(new WorkStealingPoolImpl(numThreads))
+{
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  delete static_cast<WorkStealingPoolImpl*>(impl);
+}
+
+unsigned WorkStealingPool::getNumThreads() const {
+  return static_cast<WorkStealingPoolImpl*>(impl)->getNumThreads();
+}
+
+void WorkStealingPool::async(std::function<void(void)> fn) {
+  static_cast<WorkStealingPoolImpl*>(impl)->async(std::move(fn));
+}
+
+bool WorkStealingPool::runOne() {
+  return static_cast<WorkStealingPoolImpl*>(impl)->runOne();
+}
+
+void WorkStealingPool::waitForAll() {
+  static_cast<WorkStealingPoolImpl*>(impl)->waitForAll();
+}
@@ -295,6 +295,9 @@ class BuildFileImpl {
   /// The set of all declared commands.
   BuildDescription::command_set commands;
 
+  /// The set of all declared resource pools.
+  BuildDescription::pool_set pools;
+
   /// Indicates if we should perform ownership analysis after we read the build file
   bool performOwnershipAnalysis = false;
 
@@ -416,6 +419,20 @@ class BuildFileImpl {
       ++it;
     }
 
+    // Parse the pools mapping, if present.
+    if (it != mapping->end() && nodeIsScalarString(it->getKey(), "pools")) {
+      if (it->getValue()->getType() != llvm::yaml::Node::NK_Mapping) {
+        error(it->getValue(), "unexpected 'pools' value (expected map)");
+        return false;
+      }
+
+      if (!parsePoolsMapping(
+              static_cast<llvm::yaml::MappingNode*>(it->getValue()))) {
+        return false;
+      }
+      ++it;
+    }
+
     // Parse the targets mapping, if present.
     if (it != mapping->end() && nodeIsScalarString(it->getKey(), "targets")) {
       if (it->getValue()->getType() != llvm::yaml::Node::NK_Mapping) {
@@ -630,6 +647,59 @@ class BuildFileImpl {
     return true;
   }
   
+  bool parsePoolsMapping(llvm::yaml::MappingNode* map) {
+    for (auto& entry: *map) {
+      // Every key must be scalar.
+      if (entry.getKey()->getType() != llvm::yaml::Node::NK_Scalar) {
+        error(entry.getKey(), "invalid key type in 'pools' map");
+        continue;
+      }
+      // Every value must be a mapping.
+      if (entry.getValue()->getType() != llvm::yaml::Node::NK_Mapping) {
+        error(entry.getValue(), "invalid value type in 'pools' map");
+        continue;
+      }
+
+      std::string name = stringFromScalarNode(
+          static_cast<llvm::yaml::ScalarNode*>(entry.getKey()));
+      llvm::yaml::MappingNode* attrs = static_cast<llvm::yaml::MappingNode*>(
+          entry.getValue());
+
+      // Check that the pool is not a duplicate.
+      if (pools.count(name) != 0) {
+        error(entry.getKey(), "duplicate pool in 'pools' map");
+        continue;
+      }
+
+      // The only attribute is the (required) depth.
+      auto it = attrs->begin();
+      if (it == attrs->end() || !nodeIsScalarString(it->getKey(), "depth")) {
+        error(entry.getKey(), "missing 'depth' for pool in 'pools' map");
+        while (it != attrs->end()) ++it;
+        continue;
+      }
+      unsigned depth;
+      auto value = it->getValue();
+      if (value->getType() != llvm::yaml::Node::NK_Scalar ||
+          StringRef(stringFromScalarNode(
+                        static_cast<llvm::yaml::ScalarNode*>(value)))
+            .getAsInteger(10, depth) || depth == 0) {
+        error(value, "invalid 'depth' value for pool in 'pools' map");
+        while (it != attrs->end()) ++it;
+        continue;
+      }
+      if (++it != attrs->end()) {
+        error(it->getKey(), "unexpected key for pool in 'pools' map");
+        while (it != attrs->end()) ++it;
+        continue;
+      }
+
+      pools[name] = llvm::make_unique<basic::ResourcePool>(name, depth);
+    }
+
+    return true;
+  }
+
   bool parseTargetsMapping(llvm::yaml::MappingNode* map) {
     for (auto& entry: *map) {
       // Every key must be scalar.
@@ -923,6 +993,29 @@ class BuildFileImpl {
           command->configureDescription(
               getContext(key), stringFromScalarNode(
                   static_cast<llvm::yaml::ScalarNode*>(value)));
+        } else if (nodeIsScalarString(key, "pool")) {
+          if (value->getType() != llvm::yaml::Node::NK_Scalar) {
+            error(value, "invalid value type for 'pool' command key");
+            continue;
+          }
+
+          auto it = pools.find(stringFromScalarNode(
+                                   static_cast<llvm::yaml::ScalarNode*>(value)));
+          if (it == pools.end()) {
+            error(value, "undeclared pool for 'pool' command key");
+            continue;
+          }
+          command->pool = it->second.get();
+        } else if (nodeIsScalarString(key, "pool-weight")) {
+          unsigned weight;
+          if (value->getType() != llvm::yaml::Node::NK_Scalar ||
+              StringRef(stringFromScalarNode(
+                            static_cast<llvm::yaml::ScalarNode*>(value)))
+                .getAsInteger(10, weight) || weight == 0) {
+            error(value, "invalid value for 'pool-weight' command key");
+            continue;
+          }
+          command->poolWeight = weight;
         } else {
           // Otherwise, it should be an attribute assignment.
           
@@ -1079,6 +1172,7 @@ public:
     std::swap(description->getDefaultTarget(), defaultTarget);
     std::swap(description->getCommands(), commands);
     std::swap(description->getTools(), tools);
+    std::swap(description->getPools(), pools);
     return description;
   }
 };
@@ -15,8 +15,10 @@
 #include "llbuild/BuildSystem/BuildSystemFrontend.h"
 #include "llbuild/BuildSystem/BuildSystemHandlers.h"
 
+#include "llbuild/Basic/BuildProfiler.h"
 #include "llbuild/Basic/CrossPlatformCompatibility.h"
 #include "llbuild/Basic/ExecutionQueue.h"
+#include "llbuild/Basic/FileChecksumCache.h"
 #include "llbuild/Basic/FileInfo.h"
 #include "llbuild/Basic/FileSystem.h"
 #include "llbuild/Basic/Hashing.h"
@@ -188,6 +190,15 @@ private:
   /// The file system used by the build system
   std::unique_ptr<basic::FileSystem> fileSystem;
 
+  /// The cache of file information for the current build, if enabled.
+  StatCachingFileSystem* statCache = nullptr;
+
+  /// The checksum-only file system, if the build file requested one.
+  ChecksumOnlyFileSystem* checksumFileSystem = nullptr;
+
+  /// The persistent cache of file checksums, if enabled.
+  std::unique_ptr<basic::FileChecksumCache> checksumCache;
+
   /// The name of the main input file.
   std::string mainFilename;
 
@@ -197,6 +208,9 @@ private:
   /// The build description, once loaded.
   std::unique_ptr<BuildDescription> buildDescription;
 
+  /// The profiler of the commands which run, if enabled.
+  basic::BuildProfiler profiler;
+
   /// The delegate used for building the file contents.
   BuildSystemEngineDelegate engineDelegate;
 
@@ -256,6 +270,10 @@ public:
     return *fileSystem;
   }
 
+  basic::BuildProfiler& getProfiler() {
+    return profiler;
+  }
+
   // FIXME: We should eliminate this, it isn't well formed when loading
   // descriptions not from a file. We currently only use that for unit testing,
   // though.
@@ -296,8 +314,9 @@ public:
           new DeviceAgnosticFileSystem(std::move(fileSystem)));
       fileSystem.swap(newFS);
     } else if (mode == 2) {
-      std::unique_ptr<basic::FileSystem> newFS(
-          new ChecksumOnlyFileSystem(std::move(fileSystem)));
+      checksumFileSystem = new ChecksumOnlyFileSystem(std::move(fileSystem));
+      checksumFileSystem->attachChecksumCache(checksumCache.get());
+      std::unique_ptr<basic::FileSystem> newFS(checksumFileSystem);
       fileSystem.swap(newFS);
     }
   }
@@ -322,19 +341,54 @@ public:
     buildDescription = std::move(description);
   }
 
-  bool attachDB(StringRef filename, std::string* error_out) {
+  bool attachDB(StringRef filename, core::BuildDBFormat format,
+                unsigned writeBatchSize, bool preload,
+                std::string* error_out) {
     // FIXME: How do we pass the client schema version here, if we haven't
     // loaded the file yet.
     std::unique_ptr<core::BuildDB> db(
-                                      core::createSQLiteBuildDB(filename, getMergedSchemaVersion(), /* recreateUnmatchedVersion = */ true, error_out));
+                                      core::createBuildDB(format, filename, getMergedSchemaVersion(), /* recreateUnmatchedVersion = */ true, error_out));
     if (!db)
       return false;
+    if (writeBatchSize)
+      db = core::createWriteBehindBuildDB(std::move(db), writeBatchSize);
+    if (preload)
+      db = core::createPreloadingBuildDB(std::move(db));
 
     return buildEngine.attachDB(std::move(db), error_out);
   }
 
-  bool enableTracing(StringRef filename, std::string* error_out) {
-    return buildEngine.enableTracing(filename, error_out);
+  bool enableTracing(StringRef filename, core::BuildEngineTraceFormat format,
+                     std::string* error_out) {
+    return buildEngine.enableTracing(filename, format, error_out);
+  }
+
+  bool enableProfiling(StringRef filename, std::string* error_out) {
+    return profiler.open(filename, error_out);
+  }
+
+  void enableFileInfoCache() {
+    if (statCache)
+      return;
+    statCache = new StatCachingFileSystem(std::move(fileSystem));
+    fileSystem.reset(statCache);
+  }
+
+  bool enableFileChangeJournal(std::string* error_out) {
+    auto journal = basic::createFileChangeJournal(error_out);
+    if (!journal)
+      return false;
+    enableFileInfoCache();
+    statCache->attachJournal(std::move(journal));
+    return true;
+  }
+
+  void enableChecksumCache(StringRef path,
+                           basic::FileChecksumAlgorithm algorithm) {
+    checksumCache = llvm::make_unique<basic::FileChecksumCache>(path,
+                                                                algorithm);
+    if (checksumFileSystem)
+      checksumFileSystem->attachChecksumCache(checksumCache.get());
   }
 
   /// Build the given key, and return the result and an indication of success.
@@ -1540,6 +1594,7 @@ class CommandTask : public Task {
 
   virtual void start(TaskInterface ti) override {
     // Notify the client the command is preparing to run.
+    getBuildSystem(ti).getProfiler().commandPreparing(&command);
     getBuildSystem(ti).getDelegate().commandPreparing(&command);
 
     command.start(getBuildSystem(ti).getBuildSystem(), ti);
@@ -1574,9 +1629,20 @@ class CommandTask : public Task {
         ti.complete(BuildValue::makeSkippedCommand().toData());
         return;
       }
-    
+
+      auto& profiler = getBuildSystem(ti).getProfiler();
+      if (profiler.isOpen()) {
+        SmallString<64> description;
+        command.getShortDescription(description);
+        if (description.empty())
+          description = command.getName();
+        profiler.commandStarted(&command, description, context->laneID());
+      }
+
       // Execute the command, with notifications to the delegate.
-      command.execute(getBuildSystem(ti).getBuildSystem(), ti, context, [ti](BuildValue&& result) mutable {
+      command.execute(getBuildSystem(ti).getBuildSystem(), ti, context, [ti, &profiler, command=&command](BuildValue&& result) mutable {
+        profiler.commandFinished(command);
+
         // Inform the engine of the result.
         if (result.isFailedCommand()) {
           getBuildSystem(ti).getDelegate().hadCommandFailure();
@@ -1591,7 +1657,12 @@ class CommandTask : public Task {
       DetachedContext ctx;
       fn(&ctx);
     } else {
-      ti.spawn({ &command, std::move(fn) });
+      getBuildSystem(ti).getProfiler().commandQueued(&command);
+      QueueJob job{ &command, std::move(fn) };
+      job.setMemoryEstimate(command.getMemoryEstimate());
+      if (command.pool)
+        job.setResourcePool(command.pool, command.poolWeight);
+      ti.spawn(std::move(job));
     }
   }
 
@@ -1654,6 +1725,17 @@ convertStatusKind(core::Rule::StatusKind kind) {
   return BuildSystemDelegate::CommandStatusKind::IsScanning;
 }
 
+static void updateCommandStatus(BuildEngine& engine, Command* command,
+                                core::Rule::StatusKind status) {
+  auto& system = ::getBuildSystem(engine);
+  if (status == core::Rule::StatusKind::IsScanning) {
+    system.getProfiler().commandScanning(command);
+  } else {
+    system.getProfiler().commandFinished(command);
+  }
+  system.getDelegate().commandStatusChanged(command, convertStatusKind(status));
+}
+
 class BuildSystemRule : public Rule {
 private:
   /// Called to create the task to build the rule, when necessary.
@@ -1761,8 +1843,7 @@ std::unique_ptr<Rule> BuildSystemEngineDelegate::lookupRule(const KeyType& keyDa
       },
       /*UpdateStatus=*/ [command](BuildEngine& engine,
                                   core::Rule::StatusKind status) {
-        return ::getBuildSystem(engine).getDelegate().commandStatusChanged(
-            command, convertStatusKind(status));
+        return updateCommandStatus(engine, command, status);
       }
     ));
   }
@@ -1794,8 +1875,7 @@ std::unique_ptr<Rule> BuildSystemEngineDelegate::lookupRule(const KeyType& keyDa
         },
         /*UpdateStatus=*/ [command](BuildEngine& engine,
                                     core::Rule::StatusKind status) {
-          return ::getBuildSystem(engine).getDelegate().commandStatusChanged(
-              command, convertStatusKind(status));
+          return updateCommandStatus(engine, command, status);
         }
       ));
     }
@@ -2083,9 +2163,21 @@ llvm::Optional<BuildValue> BuildSystemImpl::build(BuildKey key) {
     return None;
   }
 
-  // Build the target.
+  // Build the target, with file information (if cached) only cached during
+  // the build unless a journal tells us which of it has changed since.
   buildWasAborted = false;
+  if (statCache)
+    statCache->revalidate();
   auto result = buildEngine.build(key.toData());
+  if (statCache && !statCache->hasJournal())
+    statCache->clear();
+
+  // Persist any newly computed checksums. This is only an optimization, so a
+  // failure to write them is ignored.
+  if (checksumCache) {
+    std::string error;
+    (void)checksumCache->save(&error);
+  }
     
   // Clear out the shell handlers, as we do not want to hold on to them across
   // multiple builds.
@@ -4122,6 +4214,10 @@ basic::FileSystem& BuildSystem::getFileSystem() {
   return static_cast<BuildSystemImpl*>(impl)->getFileSystem();
 }
 
+basic::BuildProfiler& BuildSystem::getProfiler() {
+  return static_cast<BuildSystemImpl*>(impl)->getProfiler();
+}
+
 bool BuildSystem::loadDescription(StringRef mainFilename) {
   return static_cast<BuildSystemImpl*>(impl)->loadDescription(mainFilename);
 }
@@ -4134,12 +4230,47 @@ void BuildSystem::loadDescription(
 
 bool BuildSystem::attachDB(StringRef path,
                                 std::string* error_out) {
-  return static_cast<BuildSystemImpl*>(impl)->attachDB(path, error_out);
+  return static_cast<BuildSystemImpl*>(impl)->attachDB(
+      path, core::BuildDBFormat::SQLite, /*writeBatchSize=*/0,
+      /*preload=*/false, error_out);
+}
+
+bool BuildSystem::attachDB(StringRef path, core::BuildDBFormat format,
+                           unsigned writeBatchSize, bool preload,
+                           std::string* error_out) {
+  return static_cast<BuildSystemImpl*>(impl)->attachDB(
+      path, format, writeBatchSize, preload, error_out);
+}
+
+bool BuildSystem::enableTracing(StringRef path,
+                                std::string* error_out) {
+  return static_cast<BuildSystemImpl*>(impl)->enableTracing(
+      path, core::BuildEngineTraceFormat::JSON, error_out);
 }
 
 bool BuildSystem::enableTracing(StringRef path,
+                                core::BuildEngineTraceFormat format,
                                 std::string* error_out) {
-  return static_cast<BuildSystemImpl*>(impl)->enableTracing(path, error_out);
+  return static_cast<BuildSystemImpl*>(impl)->enableTracing(path, format,
+                                                            error_out);
+}
+
+bool BuildSystem::enableProfiling(StringRef path, std::string* error_out) {
+  return static_cast<BuildSystemImpl*>(impl)->enableProfiling(path, error_out);
+}
+
+void BuildSystem::enableFileInfoCache() {
+  static_cast<BuildSystemImpl*>(impl)->enableFileInfoCache();
+}
+
+bool BuildSystem::enableFileChangeJournal(std::string* error_out) {
+  return static_cast<BuildSystemImpl*>(impl)->enableFileChangeJournal(
+      error_out);
+}
+
+void BuildSystem::enableChecksumCache(StringRef path,
+                                      basic::FileChecksumAlgorithm algorithm) {
+  static_cast<BuildSystemImpl*>(impl)->enableChecksumCache(path, algorithm);
 }
 
 llvm::Optional<BuildValue> BuildSystem::build(BuildKey key) {
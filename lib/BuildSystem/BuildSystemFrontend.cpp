@@ -12,8 +12,10 @@
 
 #include "llbuild/BuildSystem/BuildSystemFrontend.h"
 
+#include "llbuild/Basic/BuildProfiler.h"
 #include "llbuild/Basic/Defer.h"
 #include "llbuild/Basic/ExecutionQueue.h"
+#include "llbuild/Basic/FileInfo.h"
 #include "llbuild/Basic/FileSystem.h"
 #include "llbuild/Basic/LLVM.h"
 #include "llbuild/Basic/PlatformUtility.h"
@@ -51,12 +53,33 @@ void BuildSystemInvocation::getUsage(int optionWidth, raw_ostream& os) {
     { "-C <PATH>, --chdir <PATH>", "change directory to PATH before building" },
     { "--no-db", "disable use of a build database" },
     { "--db <PATH>", "enable building against the database at PATH" },
+    { "--db-format <FORMAT>", "the database format, 'sqlite' or 'log'" },
+    { "--db-preload", "load all results from the database in a single read" },
+    { "--db-write-batch <N>",
+      "write results to the database in the background, N at a time" },
+    { "--cache-file-info",
+      "read file information once per build, if commands only modify "
+      "their outputs" },
+    { "--watch-files",
+      "keep file information between builds, re-reading only changed files" },
+    { "--checksum-algorithm <ALG>",
+      "checksum file contents using ALG (xxh64, blake3, or platform)" },
     { "-f <PATH>", "load the build task file at PATH" },
     { "--serial", "do not build in parallel" },
     { "--scheduler <SCHEDULER>", "set scheduler algorithm" },
     { "-j,--jobs <JOBS>", "set how many concurrent jobs (lanes) to run" },
+    { "-l,--max-load <N>",
+      "start commands only when the load average is below N" },
+    { "--max-cpu-pressure <PCT>",
+      "start commands only when CPU pressure is below PCT percent" },
+    { "--max-memory-pressure <PCT>",
+      "start commands only when memory pressure is below PCT percent" },
+    { "--memory-budget <MB>",
+      "start commands only while their estimated memory use fits in MB" },
     { "-v, --verbose", "show verbose status information" },
     { "--trace <PATH>", "trace build engine operation to PATH" },
+    { "--trace-format <FORMAT>", "the trace format, 'json' or 'binary'" },
+    { "--profile <PATH>", "write a build profile trace event file to PATH" },
   };
   
   for (const auto& entry: options) {
@@ -103,6 +126,43 @@ void BuildSystemInvocation::parse(llvm::ArrayRef<std::string> args,
       }
       dbPath = args[0];
       args = args.slice(1);
+    } else if (option == "--db-format") {
+      if (args.empty()) {
+        error("missing argument to '" + option + "'");
+        break;
+      }
+      if (!core::parseBuildDBFormat(args[0], &dbFormat)) {
+        error("unknown database format '" + args[0] + "'");
+        break;
+      }
+      args = args.slice(1);
+    } else if (option == "--db-preload") {
+      dbPreload = true;
+    } else if (option == "--cache-file-info") {
+      useFileInfoCache = true;
+    } else if (option == "--watch-files") {
+      useFileChangeJournal = true;
+    } else if (option == "--checksum-algorithm") {
+      if (args.empty()) {
+        error("missing argument to '" + option + "'");
+        break;
+      }
+      if (!basic::parseFileChecksumAlgorithm(args[0], &checksumAlgorithm)) {
+        error("unknown checksum algorithm '" + args[0] + "'");
+        break;
+      }
+      args = args.slice(1);
+    } else if (option == "--db-write-batch") {
+      if (args.empty()) {
+        error("missing argument to '" + option + "'");
+        break;
+      }
+      char *end;
+      dbWriteBatchSize = ::strtol(args[0].c_str(), &end, 10);
+      if (*end != '\0') {
+        error("invalid argument '" + args[0] + "' to '" + option + "'");
+      }
+      args = args.slice(1);
     } else if (option == "-C" || option == "--chdir") {
       if (args.empty()) {
         error("missing argument to '" + option + "'");
@@ -129,6 +189,12 @@ void BuildSystemInvocation::parse(llvm::ArrayRef<std::string> args,
         schedulerAlgorithm = SchedulerAlgorithm::NamePriority;
       } else if (algorithm == "fifo") {
         schedulerAlgorithm = SchedulerAlgorithm::FIFO;
+      } else if (algorithm == "workStealing" ||
+                 algorithm == "work-stealing") {
+        schedulerAlgorithm = SchedulerAlgorithm::WorkStealing;
+      } else if (algorithm == "criticalPath" ||
+                 algorithm == "critical-path") {
+        schedulerAlgorithm = SchedulerAlgorithm::CriticalPath;
       } else {
         error("unknown scheduler algorithm '" + algorithm + "'");
         break;
@@ -151,6 +217,37 @@ void BuildSystemInvocation::parse(llvm::ArrayRef<std::string> args,
       if (*end != '\0') {
         error("invalid argument to '-j'");
       }
+    } else if (option == "-l" || option == "--max-load" ||
+               option == "--max-cpu-pressure" ||
+               option == "--max-memory-pressure") {
+      if (args.empty()) {
+        error("missing argument to '" + option + "'");
+        break;
+      }
+      char *end;
+      double limit = ::strtod(args[0].c_str(), &end);
+      if (*end != '\0') {
+        error("invalid argument '" + args[0] + "' to '" + option + "'");
+      }
+      if (option == "--max-cpu-pressure") {
+        loadLimits.maxCPUPressure = limit;
+      } else if (option == "--max-memory-pressure") {
+        loadLimits.maxMemoryPressure = limit;
+      } else {
+        loadLimits.maxLoadAverage = limit;
+      }
+      args = args.slice(1);
+    } else if (option == "--memory-budget") {
+      if (args.empty()) {
+        error("missing argument to '" + option + "'");
+        break;
+      }
+      uint64_t megabytes;
+      if (StringRef(args[0]).getAsInteger(10, megabytes)) {
+        error("invalid argument '" + args[0] + "' to '" + option + "'");
+      }
+      loadLimits.memoryBudget = megabytes * 1024 * 1024;
+      args = args.slice(1);
     } else if (option == "-v" || option == "--verbose") {
       showVerboseStatus = true;
     } else if (option == "--trace") {
@@ -160,6 +257,23 @@ void BuildSystemInvocation::parse(llvm::ArrayRef<std::string> args,
       }
       traceFilePath = args[0];
       args = args.slice(1);
+    } else if (option == "--trace-format") {
+      if (args.empty()) {
+        error("missing argument to '" + option + "'");
+        break;
+      }
+      if (!core::parseBuildEngineTraceFormat(args[0], &traceFormat)) {
+        error("unknown trace format '" + args[0] + "'");
+        break;
+      }
+      args = args.slice(1);
+    } else if (option == "--profile") {
+      if (args.empty()) {
+        error("missing argument to '" + option + "'");
+        break;
+      }
+      profileFilePath = args[0];
+      args = args.slice(1);
     } else {
       error("invalid option '" + option + "'");
       break;
@@ -279,6 +393,7 @@ public:
 
   virtual void processFinished(ProcessContext* command, ProcessHandle handle,
                                const ProcessResult& result) override {
+    getSystem().getProfiler().commandProcessFinished(command, result);
     static_cast<BuildSystemFrontendDelegate*>(&getSystem().getDelegate())->
       commandProcessFinished(
           reinterpret_cast<Command*>(command),
@@ -314,6 +429,59 @@ public:
 
 #pragma mark - BuildSystemFrontendImpl
 
+/// A file system which forwards to one owned by the frontend, so that the
+/// frontend can recreate its build system without losing the client's file
+/// system.
+class FrontendFileSystem : public basic::FileSystem {
+  basic::FileSystem& impl;
+
+public:
+  explicit FrontendFileSystem(basic::FileSystem& impl) : impl(impl) {}
+
+  virtual bool createDirectory(const std::string& path) override {
+    return impl.createDirectory(path);
+  }
+
+  virtual bool createDirectories(const std::string& path) override {
+    return impl.createDirectories(path);
+  }
+
+  virtual std::unique_ptr<llvm::MemoryBuffer>
+  getFileContents(const std::string& path) override {
+    return impl.getFileContents(path);
+  }
+
+  virtual bool remove(const std::string& path) override {
+    return impl.remove(path);
+  }
+
+  virtual FileChecksum getFileChecksum(const std::string& path) override {
+    return impl.getFileChecksum(path);
+  }
+
+  virtual FileInfo getFileInfo(const std::string& path) override {
+    return impl.getFileInfo(path);
+  }
+
+  virtual FileInfo getLinkInfo(const std::string& path) override {
+    return impl.getLinkInfo(path);
+  }
+
+  virtual void getFileInfos(ArrayRef<std::string> paths,
+                            MutableArrayRef<FileInfo> infos_out) override {
+    impl.getFileInfos(paths, infos_out);
+  }
+
+  virtual bool createSymlink(const std::string& src,
+                             const std::string& target) override {
+    return impl.createSymlink(src, target);
+  }
+
+  virtual void invalidateFileInfo(const std::string& path) override {
+    impl.invalidateFileInfo(path);
+  }
+};
+
 struct BuildSystemFrontendImpl {
   BuildSystemFrontendDelegate& delegate;
   BuildSystemFrontendDelegateImpl* delegateImpl;
@@ -322,6 +490,20 @@ struct BuildSystemFrontendImpl {
   std::unique_ptr<basic::FileSystem> fileSystem;
   std::unique_ptr<BuildSystem> system;
 
+  /// Whether the working directory has been changed for `--chdir`.
+  bool didChdir = false;
+
+  /// The path of the attached database, if any.
+  std::string dbPath;
+
+  /// The fingerprint of the build file when the resident build system loaded
+  /// it.
+  FileInfo buildFileInfo{};
+
+  /// The fingerprint of the database when the resident build system last
+  /// finished with it.
+  FileInfo dbInfo{};
+
 
 public:
   BuildSystemFrontendImpl(BuildSystemFrontendDelegate& delegate,
@@ -353,6 +535,25 @@ public:
   void resetAfterBuild() {
     std::lock_guard<std::mutex> lock(stateMutex);
     cancelled = false;
+
+    // Record the state the build left the database in, so that a later build
+    // can tell whether anyone else has written to it since.
+    if (system && !dbPath.empty())
+      dbInfo = FileInfo::getInfoForPath(dbPath);
+  }
+
+  /// Check whether the resident build system still reflects the build file
+  /// and database on disk.
+  ///
+  /// The engine trusts the results it holds in memory over those in the
+  /// database, so a build file edit, or a build of the same database by
+  /// another process, requires starting over with a fresh build system.
+  bool isResidentSystemValid() {
+    if (fileSystem->getFileInfo(invocation.buildFilePath) != buildFileInfo)
+      return false;
+    if (!dbPath.empty() && FileInfo::getInfoForPath(dbPath) != dbInfo)
+      return false;
+    return true;
   }
 
   bool initialize() {
@@ -365,28 +566,29 @@ public:
       return false;
 
     if (system) {
-      // Already exists, just reset state
-      system->resetForBuild();
-      return true;
+      // Already exists, just reset state, unless it has gone stale.
+      if (isResidentSystemValid()) {
+        system->resetForBuild();
+        return true;
+      }
+      system = nullptr;
     }
 
-    if (!invocation.chdirPath.empty()) {
+    if (!invocation.chdirPath.empty() && !didChdir) {
       if (!sys::chdir(invocation.chdirPath.c_str())) {
         delegate.error(Twine("unable to honor --chdir: ") + strerror(errno));
         return false;
       }
-    }
-
-    if (!fileSystem) {
-      // Catch and report client misuse of a failed build system object
-      delegate.error(Twine("invalid reuse after initialization failure"));
-      return false;
+      didChdir = true;
     }
 
     // Create the build system.
-    system = std::make_unique<BuildSystem>(delegate, std::move(fileSystem));
+    system = std::make_unique<BuildSystem>(
+        delegate, llvm::make_unique<FrontendFileSystem>(*fileSystem));
 
-    // Load the build file.
+    // Load the build file, fingerprinting it first so any edit made while it
+    // is being loaded is noticed by the next build.
+    buildFileInfo = fileSystem->getFileInfo(invocation.buildFilePath);
     if (!system->loadDescription(invocation.buildFilePath)) {
       system = nullptr;
       return false;
@@ -403,14 +605,40 @@ public:
       }
 
       std::string error;
-      if (!system->enableTracing(invocation.traceFilePath, &error)) {
+      if (!system->enableTracing(invocation.traceFilePath,
+                                 invocation.traceFormat, &error)) {
         delegate.error(Twine("unable to enable tracing: ") + error);
         system = nullptr;
         return false;
       }
     }
 
+    // Cache file information, if requested.
+    if (invocation.useFileInfoCache)
+      system->enableFileInfoCache();
+
+    // Watch for file changes, if requested.
+    if (invocation.useFileChangeJournal) {
+      std::string error;
+      if (!system->enableFileChangeJournal(&error)) {
+        delegate.error(Twine("unable to watch files: ") + error);
+        system = nullptr;
+        return false;
+      }
+    }
+
+    // Enable the build profile, if requested.
+    if (!invocation.profileFilePath.empty()) {
+      std::string error;
+      if (!system->enableProfiling(invocation.profileFilePath, &error)) {
+        delegate.error(Twine("unable to enable profiling: ") + error);
+        system = nullptr;
+        return false;
+      }
+    }
+
     // Attach the database.
+    this->dbPath.clear();
     if (!invocation.dbPath.empty()) {
       // If the database path is relative, always make it relative to the input
       // file.
@@ -425,11 +653,24 @@ public:
       }
 
       std::string error;
-      if (!system->attachDB(dbPath, &error)) {
+      if (!system->attachDB(dbPath, invocation.dbFormat,
+                            invocation.dbWriteBatchSize,
+                            invocation.dbPreload, &error)) {
         delegate.error(Twine("unable to attach DB: ") + error);
         system = nullptr;
         return false;
       }
+
+      // Only databases which live in a file can be fingerprinted.
+      if (!dbPath.startswith(":") && dbPath.find("://") == StringRef::npos) {
+        this->dbPath = dbPath;
+        dbInfo = FileInfo::getInfoForPath(this->dbPath);
+
+        // Keep file checksums alongside the database, so that checksum-only
+        // builds need not re-read unchanged files.
+        system->enableChecksumCache(this->dbPath + ".checksums",
+                                    invocation.checksumAlgorithm);
+      }
     }
 
     return true;
@@ -593,7 +834,8 @@ BuildSystemFrontendDelegate::createExecutionQueue() {
     return std::unique_ptr<ExecutionQueue>(
         createLaneBasedExecutionQueue(impl->executionQueueDelegate, 1,
                                       invocation.schedulerAlgorithm, qos,
-                                      invocation.environment));
+                                      invocation.environment,
+                                      invocation.loadLimits));
   }
     
   // Get the number of CPUs to use.
@@ -611,7 +853,8 @@ BuildSystemFrontendDelegate::createExecutionQueue() {
   return std::unique_ptr<ExecutionQueue>(
       createLaneBasedExecutionQueue(impl->executionQueueDelegate, numLanes,
                                     invocation.schedulerAlgorithm, qos,
-                                    invocation.environment));
+                                    invocation.environment,
+                                    invocation.loadLimits));
 }
 
 void BuildSystemFrontendDelegate::cancel() {
@@ -97,6 +97,15 @@ configureAttribute(const ConfigureContext& ctx, StringRef name,
     alwaysOutOfDate = value == "true";
     return true;
     
+  } else if (name == "memory-estimate") {
+    uint64_t megabytes;
+    if (value.getAsInteger(10, megabytes)) {
+      ctx.error("invalid value: '" + value + "' for attribute '" +
+                name + "'");
+      return false;
+    }
+    memoryEstimate = megabytes * 1024 * 1024;
+    return true;
   } else if (name == "repair-via-ownership-analysis") {
     if (value == "true") {
       repairViaOwnershipAnalysis = true;
@@ -336,6 +345,22 @@ bool ExternalCommand::canUpdateIfNewerWithResult(const BuildValue& result) {
   return true;
 }
 
+uint64_t ExternalCommand::getOutputBytes(const BuildValue& result) const {
+  // Subclasses may compute results which do not describe the outputs.
+  if (!result.isSuccessfulCommand() || result.getNumOutputs() != outputs.size())
+    return 0;
+
+  uint64_t outputBytes = 0;
+  for (unsigned i = 0, e = outputs.size(); i != e; ++i) {
+    if (outputs[i]->isVirtual() || outputs[i]->isCommandTimestamp())
+      continue;
+    const FileInfo& outputInfo = result.getNthOutputInfo(i);
+    if (!outputInfo.isMissing())
+      outputBytes += outputInfo.size;
+  }
+  return outputBytes;
+}
+
 BuildValue
 ExternalCommand::computeCommandResult(BuildSystem& system, core::TaskInterface ti) {
   // Capture the file information for each of the output nodes.
@@ -353,6 +378,9 @@ ExternalCommand::computeCommandResult(BuildSystem& system, core::TaskInterface t
     } else if (node->isVirtual()) {
       outputInfos.push_back(FileInfo{});
     } else {
+      // The command may have written the output, so discard any information
+      // cached before it ran.
+      system.getFileSystem().invalidateFileInfo(node->getName().str());
       outputInfos.push_back(node->getFileInfo(
                                 system.getFileSystem()));
     }
@@ -425,6 +453,7 @@ void ExternalCommand::execute(BuildSystem& system,
   system.getDelegate().commandStarted(this);
   executeExternalCommand(system, ti, context, {[this, &system, ti, resultFn](ProcessResult result) mutable {
     system.getDelegate().commandFinished(this, result.status);
+    ti.reportStatistics(result.maxrss, 0);
 
     // Process the result.
     switch (result.status) {
@@ -434,9 +463,12 @@ void ExternalCommand::execute(BuildSystem& system,
     case ProcessStatus::Cancelled:
       resultFn(BuildValue::makeCancelledCommand());
       return;
-    case ProcessStatus::Succeeded:
-      resultFn(computeCommandResult(system, ti));
+    case ProcessStatus::Succeeded: {
+      BuildValue value = computeCommandResult(system, ti);
+      ti.reportStatistics(0, getOutputBytes(value));
+      resultFn(std::move(value));
       return;
+    }
     case ProcessStatus::Skipped:
     case ProcessStatus::Unknown:
       // It is illegal to get skipped result at this point.
@@ -17,6 +17,8 @@
 #include "llbuild/Core/BuildEngine.h"
 #include "llbuild/Evo/EvoEngine.h"
 
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include <cassert>
@@ -149,9 +151,9 @@ struct AckermannTask : core::Task {
     if (m == 0) {
       ;
     } else if (n == 0) {
-      ti.request(AckermannKey(m-1, 1), 0);
+      ti.request(core::KeyType(AckermannKey(m-1, 1)), 0);
     } else {
-      ti.request(AckermannKey(m, n-1), 0);
+      ti.request(core::KeyType(AckermannKey(m, n-1)), 0);
     }
   }
 
@@ -163,7 +165,7 @@ struct AckermannTask : core::Task {
 
       // Request the second recursive result, if needed.
       if (m != 0 && n != 0) {
-        ti.request(AckermannKey(m-1, recursiveResultA), 1);
+        ti.request(core::KeyType(AckermannKey(m-1, recursiveResultA)), 1);
       }
     } else {
       assert(inputID == 1 && "invalid input ID");
@@ -493,6 +495,89 @@ static int executeAckermannCommand(std::string cmd, std::vector<std::string> arg
 
 
 
+}
+
+#pragma mark - Convert Trace Command
+
+static void convertTraceUsage() {
+  int optionWidth = 20;
+  fprintf(stderr, "Usage: %s buildengine convert-trace [options] <INPUT> "
+          "<OUTPUT>\n", getProgramName());
+  fprintf(stderr, "\nConvert a binary build engine trace.\n");
+  fprintf(stderr, "\nOptions:\n");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--help",
+          "show this help message and exit");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--format <FORMAT>",
+          "the output format, 'json' or 'chrome' [default='json']");
+  ::exit(1);
+}
+
+static int executeConvertTraceCommand(std::vector<std::string> args) {
+  core::BuildEngineTraceConversion conversion =
+    core::BuildEngineTraceConversion::JSON;
+  while (!args.empty() && args[0][0] == '-') {
+    const std::string option = args[0];
+    args.erase(args.begin());
+
+    if (option == "--")
+      break;
+
+    if (option == "--help") {
+      convertTraceUsage();
+    } else if (option == "--format") {
+      if (args.empty()) {
+        fprintf(stderr, "error: %s: missing argument to '%s'\n\n",
+                getProgramName(), option.c_str());
+        convertTraceUsage();
+      }
+      if (args[0] == "json") {
+        conversion = core::BuildEngineTraceConversion::JSON;
+      } else if (args[0] == "chrome") {
+        conversion = core::BuildEngineTraceConversion::Chrome;
+      } else {
+        fprintf(stderr, "error: %s: unknown output format '%s'\n\n",
+                getProgramName(), args[0].c_str());
+        convertTraceUsage();
+      }
+      args.erase(args.begin());
+    } else {
+      fprintf(stderr, "error: %s: invalid option: '%s'\n\n",
+              getProgramName(), option.c_str());
+      convertTraceUsage();
+    }
+  }
+
+  if (args.size() != 2) {
+    fprintf(stderr, "error: %s: invalid number of arguments\n",
+            getProgramName());
+    convertTraceUsage();
+  }
+
+  auto input = llvm::MemoryBuffer::getFile(args[0]);
+  if (!input) {
+    fprintf(stderr, "error: %s: unable to read '%s' (%s)\n",
+            getProgramName(), args[0].c_str(),
+            input.getError().message().c_str());
+    return 1;
+  }
+
+  std::error_code ec;
+  llvm::raw_fd_ostream os(args[1], ec, llvm::sys::fs::F_Text);
+  if (ec) {
+    fprintf(stderr, "error: %s: unable to open '%s' (%s)\n",
+            getProgramName(), args[1].c_str(), ec.message().c_str());
+    return 1;
+  }
+
+  std::string error;
+  if (!core::convertBinaryBuildEngineTrace((*input)->getBuffer(), conversion,
+                                           os, &error)) {
+    fprintf(stderr, "error: %s: unable to convert '%s' (%s)\n",
+            getProgramName(), args[0].c_str(), error.c_str());
+    return 1;
+  }
+
+  return 0;
 }
 
 #pragma mark - Build Engine Top-Level Command
@@ -504,6 +589,7 @@ static void usage() {
   fprintf(stderr, "Available commands:\n");
   fprintf(stderr, "  ack           -- Compute Ackermann\n");
   fprintf(stderr, "  evo           -- Compute Ackermann - Evo Engine\n");
+  fprintf(stderr, "  convert-trace -- Convert a binary build engine trace\n");
   fprintf(stderr, "\n");
   exit(1);
 }
@@ -515,6 +601,8 @@ int commands::executeBuildEngineCommand(const std::vector<std::string> &args) {
 
   if (args[0] == "ack" || args[0] == "evo") {
     return executeAckermannCommand(args[0], {args.begin()+1, args.end()});
+  } else if (args[0] == "convert-trace") {
+    return executeConvertTraceCommand({args.begin()+1, args.end()});
   } else {
     fprintf(stderr, "error: %s: unknown command '%s'\n", getProgramName(),
             args[0].c_str());
@@ -27,18 +27,23 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "CommandUtil.h"
 
 #include <cerrno>
+#include <cstring>
 #include <thread>
 
 #include <signal.h>
 #if defined(_WIN32)
 #include <windows.h>
 #else
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <unistd.h>
 #endif
 
@@ -503,7 +508,8 @@ public:
                                    const BuildSystemInvocation& invocation)
       : BuildSystemFrontendDelegate(sourceMgr,
                                     "basic", /*version=*/0),
-        fileSystem(basic::createLocalFileSystem()) {
+        fileSystem(
+            basic::createLocalFileSystem(invocation.checksumAlgorithm)) {
     // Register an interrupt handler.
 #if defined(_WIN32)
     previousSigintHandler =
@@ -600,8 +606,9 @@ static int executeBuildCommand(std::vector<std::string> args) {
 
   // Create the frontend object.
   BasicBuildSystemFrontendDelegate delegate(sourceMgr, invocation);
-  BuildSystemFrontend frontend(delegate, invocation,
-                               basic::createLocalFileSystem());
+  BuildSystemFrontend frontend(
+      delegate, invocation,
+      basic::createLocalFileSystem(invocation.checksumAlgorithm));
   if (!frontend.build(targetToBuild)) {
     // If there were failed commands, report the count and return an error.
     if (delegate.getNumFailedCommands()) {
@@ -615,6 +622,377 @@ static int executeBuildCommand(std::vector<std::string> args) {
   return 0;
 }
 
+#pragma mark - Serve Command
+
+#if !defined(_WIN32)
+
+// The build server keeps a single frontend, and therefore the loaded build
+// file, the build engine and its in-memory rule state, resident across builds.
+//
+// Clients connect over a Unix domain socket and send a single request line,
+// either "build <target>" or "shutdown". A build request carries the client's
+// stdout and stderr descriptors (as SCM_RIGHTS ancillary data), which the
+// server uses as its own for the duration of the build. The server replies
+// with the exit status of the request as a decimal line, and closes the
+// connection.
+
+static void serveUsage(int exitCode) {
+  int optionWidth = 25;
+  fprintf(stderr, "Usage: %s buildsystem serve [options] <socket-path>\n",
+          getProgramName());
+  fprintf(stderr, "\nOptions:\n");
+  BuildSystemInvocation::getUsage(optionWidth, llvm::errs());
+  ::exit(exitCode);
+}
+
+static void connectUsage(int exitCode) {
+  int optionWidth = 20;
+  fprintf(stderr, "Usage: %s buildsystem connect [options] <socket-path> "
+          "[<target>]\n", getProgramName());
+  fprintf(stderr, "\nOptions:\n");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--help",
+          "show this help message and exit");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--shutdown",
+          "ask the build server to exit, instead of building");
+  ::exit(exitCode);
+}
+
+/// Fill in the address of the socket at \arg path.
+///
+/// \returns False if the path is too long to be a socket address.
+static bool getSocketAddress(StringRef path, struct sockaddr_un* addr_out) {
+  *addr_out = {};
+  addr_out->sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr_out->sun_path)) {
+    fprintf(stderr, "error: %s: socket path is too long: '%s'\n",
+            getProgramName(), path.str().c_str());
+    return false;
+  }
+  memcpy(addr_out->sun_path, path.data(), path.size());
+  return true;
+}
+
+/// Remove the socket left behind at \arg path by a server which is no longer
+/// running, if any.
+///
+/// \returns False if the path exists and is not such a socket.
+static bool removeStaleSocket(StringRef path,
+                              const struct sockaddr_un& addr) {
+  struct stat statBuf;
+  if (::lstat(path.str().c_str(), &statBuf) != 0) {
+    if (errno == ENOENT)
+      return true;
+    fprintf(stderr, "error: %s: unable to check '%s': %s\n",
+            getProgramName(), path.str().c_str(), strerror(errno));
+    return false;
+  }
+  if (!S_ISSOCK(statBuf.st_mode)) {
+    fprintf(stderr, "error: %s: '%s' exists and is not a socket\n",
+            getProgramName(), path.str().c_str());
+    return false;
+  }
+
+  // Only a socket which refuses connections is stale.
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("socket");
+    return false;
+  }
+  int result = connect(fd, reinterpret_cast<const struct sockaddr*>(&addr),
+                       sizeof(addr));
+  int err = errno;
+  basic::sys::close(fd);
+  if (result == 0) {
+    fprintf(stderr, "error: %s: a build server is already listening on '%s'\n",
+            getProgramName(), path.str().c_str());
+    return false;
+  }
+  if (err != ECONNREFUSED) {
+    fprintf(stderr, "error: %s: unable to check '%s': %s\n",
+            getProgramName(), path.str().c_str(), strerror(err));
+    return false;
+  }
+
+  if (::unlink(path.str().c_str()) != 0) {
+    fprintf(stderr, "error: %s: unable to remove '%s': %s\n",
+            getProgramName(), path.str().c_str(), strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+/// Read a build server request, and any descriptors passed along with it.
+///
+/// \returns False if the connection did not contain a complete request.
+static bool readRequest(int fd, std::string* request_out,
+                        std::vector<int>* fds_out) {
+  char buffer[4096];
+  struct iovec iov = { buffer, sizeof(buffer) };
+  union {
+    struct cmsghdr header;
+    char data[CMSG_SPACE(2 * sizeof(int))];
+  } control;
+  struct msghdr msg {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data;
+  msg.msg_controllen = sizeof(control.data);
+
+  ssize_t n;
+  do {
+    n = recvmsg(fd, &msg, 0);
+  } while (n < 0 && errno == EINTR);
+  if (n <= 0)
+    return false;
+
+  for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+    size_t numFDs = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    const int* fds = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+    fds_out->insert(fds_out->end(), fds, fds + numFDs);
+  }
+
+  // Read the remainder of the request line, if it was split.
+  request_out->assign(buffer, n);
+  while (request_out->back() != '\n') {
+    n = basic::sys::read(fd, buffer, sizeof(buffer));
+    if (n <= 0)
+      return false;
+    request_out->append(buffer, n);
+  }
+  request_out->pop_back();
+  return true;
+}
+
+/// Build the target requested by a client, with the client's output
+/// descriptors standing in for our own.
+static int serveBuildRequest(BuildSystemFrontend& frontend,
+                             BasicBuildSystemFrontendDelegate& delegate,
+                             StringRef targetToBuild, int outputFD,
+                             int errorFD) {
+  fflush(stdout);
+  fflush(stderr);
+  int savedOutputFD = dup(STDOUT_FILENO);
+  int savedErrorFD = dup(STDERR_FILENO);
+  dup2(outputFD, STDOUT_FILENO);
+  dup2(errorFD, STDERR_FILENO);
+
+  int result = 0;
+  if (!frontend.build(targetToBuild)) {
+    if (delegate.getNumFailedCommands()) {
+      delegate.error("build had " + Twine(delegate.getNumFailedCommands()) +
+                     " command failures");
+    }
+    result = 1;
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+  dup2(savedOutputFD, STDOUT_FILENO);
+  dup2(savedErrorFD, STDERR_FILENO);
+  basic::sys::close(savedOutputFD);
+  basic::sys::close(savedErrorFD);
+  return result;
+}
+
+static int executeServeCommand(std::vector<std::string> args) {
+  // The source manager to use for diagnostics.
+  llvm::SourceMgr sourceMgr;
+
+  // Create the invocation.
+  BuildSystemInvocation invocation{};
+
+  // Initialize defaults.
+  invocation.dbPath = "build.db";
+  invocation.buildFilePath = "build.llbuild";
+  invocation.parse(args, sourceMgr);
+
+  // Handle invocation actions.
+  if (invocation.showUsage) {
+    serveUsage(0);
+  } else if (invocation.hadErrors) {
+    serveUsage(1);
+  }
+
+  if (invocation.positionalArgs.size() != 1) {
+    fprintf(stderr, "error: %s: invalid number of arguments\n",
+            getProgramName());
+    serveUsage(1);
+  }
+
+  // Socket addresses are short, so bind to the path as given, but remember
+  // where it is for cleanup, since the frontend may change directories.
+  StringRef socketPath = invocation.positionalArgs[0];
+  SmallString<256> absoluteSocketPath(socketPath);
+  llvm::sys::fs::make_absolute(absoluteSocketPath);
+
+  struct sockaddr_un addr;
+  if (!getSocketAddress(socketPath, &addr))
+    return 1;
+
+  // Replace any socket left behind by a previous server.
+  if (!removeStaleSocket(absoluteSocketPath, addr))
+    return 1;
+
+  int listenFD = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenFD < 0) {
+    perror("socket");
+    return 1;
+  }
+
+  if (bind(listenFD, reinterpret_cast<struct sockaddr*>(&addr),
+           sizeof(addr)) < 0 ||
+      listen(listenFD, SOMAXCONN) < 0) {
+    fprintf(stderr, "error: %s: unable to listen on '%s': %s\n",
+            getProgramName(), socketPath.str().c_str(), strerror(errno));
+    basic::sys::close(listenFD);
+    return 1;
+  }
+
+  // Don't let a client which goes away mid-build take down the server.
+  signal(SIGPIPE, SIG_IGN);
+
+  // Create the frontend object, which is reused by every build.
+  BasicBuildSystemFrontendDelegate delegate(sourceMgr, invocation);
+  BuildSystemFrontend frontend(
+      delegate, invocation,
+      basic::createLocalFileSystem(invocation.checksumAlgorithm));
+
+  while (true) {
+    int fd = accept(listenFD, nullptr, nullptr);
+    if (fd < 0) {
+      // An interrupt while idle shuts the server down.
+      if (errno == EINTR)
+        break;
+      perror("accept");
+      continue;
+    }
+
+    std::string request;
+    std::vector<int> fds;
+    bool shutdown = false;
+    int result = 1;
+    if (readRequest(fd, &request, &fds)) {
+      StringRef requestRef(request);
+      if (requestRef == "shutdown") {
+        shutdown = true;
+        result = 0;
+      } else if (requestRef.startswith("build ") && fds.size() == 2) {
+        result = serveBuildRequest(frontend, delegate, requestRef.substr(6),
+                                   fds[0], fds[1]);
+      } else {
+        fprintf(stderr, "error: %s: invalid build server request: '%s'\n",
+                getProgramName(), request.c_str());
+      }
+    }
+    for (int passedFD: fds)
+      basic::sys::close(passedFD);
+
+    std::string reply = std::to_string(result) + "\n";
+    basic::sys::write(fd, &reply[0], reply.size());
+    basic::sys::close(fd);
+
+    if (shutdown)
+      break;
+  }
+
+  basic::sys::close(listenFD);
+  ::unlink(absoluteSocketPath.c_str());
+  return 0;
+}
+
+static int executeConnectCommand(std::vector<std::string> args) {
+  bool shutdown = false;
+
+  // Parse options
+  while (!args.empty() && args[0][0] == '-') {
+    const std::string option = args[0];
+    args.erase(args.begin());
+
+    if (option == "--")
+      break;
+
+    if (option == "--help") {
+      connectUsage(0);
+    } else if (option == "--shutdown") {
+      shutdown = true;
+    } else {
+      fprintf(stderr, "error: %s: invalid option: '%s'\n\n",
+              getProgramName(), option.c_str());
+      connectUsage(1);
+    }
+  }
+
+  if (args.size() < 1 || args.size() > (shutdown ? 1 : 2)) {
+    fprintf(stderr, "error: %s: invalid number of arguments\n",
+            getProgramName());
+    connectUsage(1);
+  }
+
+  struct sockaddr_un addr;
+  if (!getSocketAddress(args[0], &addr))
+    return 1;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("socket");
+    return 1;
+  }
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr),
+              sizeof(addr)) < 0) {
+    fprintf(stderr, "error: %s: unable to connect to build server: %s\n",
+            getProgramName(), strerror(errno));
+    basic::sys::close(fd);
+    return 1;
+  }
+
+  // Send the request, along with our output descriptors.
+  std::string request = shutdown ? "shutdown\n" :
+    "build " + (args.size() > 1 ? args[1] : "") + "\n";
+  struct iovec iov = { &request[0], request.size() };
+  union {
+    struct cmsghdr header;
+    char data[CMSG_SPACE(2 * sizeof(int))];
+  } control;
+  struct msghdr msg {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if (!shutdown) {
+    const int fds[2] = { STDOUT_FILENO, STDERR_FILENO };
+    msg.msg_control = control.data;
+    msg.msg_controllen = sizeof(control.data);
+    auto* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  }
+  if (sendmsg(fd, &msg, 0) != ssize_t(request.size())) {
+    fprintf(stderr, "error: %s: unable to send build request: %s\n",
+            getProgramName(), strerror(errno));
+    basic::sys::close(fd);
+    return 1;
+  }
+
+  // Wait for the exit status.
+  std::string reply;
+  char buffer[64];
+  ssize_t n;
+  while ((n = basic::sys::read(fd, buffer, sizeof(buffer))) > 0)
+    reply.append(buffer, n);
+  basic::sys::close(fd);
+
+  if (reply.empty() || reply.back() != '\n') {
+    fprintf(stderr, "error: %s: lost connection to build server\n",
+            getProgramName());
+    return 1;
+  }
+  return atoi(reply.c_str());
+}
+
+#endif
+
 #pragma mark - DB Command
 
 static void dbUsage(int exitCode) {
@@ -641,8 +1019,8 @@ class KeyMapDelegate : public BuildDBDelegate {
 public:
   llvm::StringMap<KeyID> keyTable;
 
-  const KeyID getKeyID(const KeyType& key) override {
-    auto it = keyTable.insert(std::make_pair(key.str(), KeyID::novalue())).first;
+  const KeyID getKeyID(StringRef key) override {
+    auto it = keyTable.try_emplace(key, KeyID::novalue()).first;
     return KeyID(it->getKey().data());
   }
 
@@ -765,6 +1143,10 @@ static void usage(int exitCode) {
   fprintf(stderr, "  parse         -- Parse a build file\n");
   fprintf(stderr, "  build         -- Build using a build file\n");
   fprintf(stderr, "  db            -- Interrogate a build.db\n");
+#if !defined(_WIN32)
+  fprintf(stderr, "  serve         -- Serve builds from a resident build system\n");
+  fprintf(stderr, "  connect       -- Build using a build server\n");
+#endif
   fprintf(stderr, "\n");
   exit(exitCode);
 }
@@ -780,6 +1162,12 @@ int commands::executeBuildSystemCommand(const std::vector<std::string> &args) {
     return executeBuildCommand({args.begin()+1, args.end()});
   } else if (args[0] == "db") {
     return executeDBCommand({args.begin()+1, args.end()});
+#if !defined(_WIN32)
+  } else if (args[0] == "serve") {
+    return executeServeCommand({args.begin()+1, args.end()});
+  } else if (args[0] == "connect") {
+    return executeConnectCommand({args.begin()+1, args.end()});
+#endif
   } else {
     fprintf(stderr, "error: %s: unknown command '%s'\n", getProgramName(),
             args[0].c_str());
@@ -12,10 +12,12 @@
 
 #include "NinjaBuildCommand.h"
 
+#include "llbuild/Basic/BuildProfiler.h"
 #include "llbuild/Basic/Compiler.h"
 #include "llbuild/Basic/CrossPlatformCompatibility.h"
 #include "llbuild/Basic/ExecutionQueue.h"
 #include "llbuild/Basic/FileInfo.h"
+#include "llbuild/Basic/FileSystem.h"
 #include "llbuild/Basic/Hashing.h"
 #include "llbuild/Basic/PlatformUtility.h"
 #include "llbuild/Basic/SerialQueue.h"
@@ -48,6 +50,7 @@
 #include <deque>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <fcntl.h>
@@ -71,11 +74,6 @@ extern "C" {
 }
 #endif
 
-static uint64_t getTimeInMicroseconds() {
-  auto now = std::chrono::high_resolution_clock::now();
-  return std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
-}
-
 static std::string getFormattedString(const char* fmt, va_list ap1) {
   va_list ap2;
   va_copy(ap2, ap1);
@@ -117,6 +115,14 @@ static void usage(int exitCode=1) {
           "do not persist build results");
   fprintf(stderr, "  %-*s %s\n", optionWidth, "--db <PATH>",
           "persist build results at PATH [default='build.db']");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--db-format <FORMAT>",
+          "the build database format, 'sqlite' or 'log' [default='sqlite']");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--db-preload",
+          "load all results from the database in a single read");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--db-write-batch <N>",
+          "write results to the database in the background, N at a time");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--scan-threads <N>",
+          "check for changed inputs on N threads [default=0]");
   fprintf(stderr, "  %-*s %s\n", optionWidth, "-f <PATH>",
           "load the manifest at PATH [default='build.ninja']");
   fprintf(stderr, "  %-*s %s\n", optionWidth, "-k <N>",
@@ -137,17 +143,64 @@ static void usage(int exitCode=1) {
           "use strict mode (no bug compatibility)");
   fprintf(stderr, "  %-*s %s\n", optionWidth, "--trace <PATH>",
           "trace build engine operation to PATH");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--trace-format <FORMAT>",
+          "the trace format, 'json' or 'binary' [default='json']");
   fprintf(stderr, "  %-*s %s\n", optionWidth, "--quiet",
           "don't show information on executed commands");
   fprintf(stderr, "  %-*s %s\n", optionWidth, "-v, --verbose",
           "show full invocation for executed commands");
   fprintf(stderr, "  %-*s %s\n", optionWidth, "-l <N>",
-          "start jobs only when load average is below N [not implemented]");
+          "start jobs only when load average is below N");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--max-cpu-pressure <PCT>",
+          "start jobs only when CPU pressure is below PCT percent");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--max-memory-pressure <PCT>",
+          "start jobs only when memory pressure is below PCT percent");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--memory-budget <MB>",
+          "start jobs only while their estimated memory use fits in MB");
   fprintf(stderr, "  %-*s %s\n", optionWidth, "-d <TOOL>",
           "enable debugging tool TOOL. 'list' for available [not implemented]");
   ::exit(exitCode);
 }
 
+/// Extract the included files reported by a command using MSVC style implicit
+/// dependencies (via /showIncludes) from its output.
+///
+/// \param prefix The prefix of the lines which name an included file.
+/// \param includes_out On return, the (unique) included files.
+/// \returns The output with the lines naming included files removed, along
+/// with the name of the source file which the compiler echoes.
+static std::string filterShowIncludes(StringRef output, StringRef prefix,
+                                      std::vector<std::string>& includes_out) {
+  std::string filtered;
+  std::unordered_set<std::string> seen;
+  while (!output.empty()) {
+    StringRef line;
+    std::tie(line, output) = output.split('\n');
+    StringRef content = line.rtrim("\r");
+
+    if (content.startswith(prefix)) {
+      auto include = content.drop_front(prefix.size()).ltrim(' ').str();
+      if (seen.insert(include).second)
+        includes_out.push_back(std::move(include));
+      continue;
+    }
+
+    // Drop the source file name, which the compiler prints on its own line.
+    std::string lowered = content.lower();
+    if (content.find(' ') == StringRef::npos &&
+        (StringRef(lowered).endswith(".c") ||
+         StringRef(lowered).endswith(".cc") ||
+         StringRef(lowered).endswith(".cxx") ||
+         StringRef(lowered).endswith(".cpp") ||
+         StringRef(lowered).endswith(".c++")))
+      continue;
+
+    filtered += line;
+    filtered += '\n';
+  }
+  return filtered;
+}
+
 namespace {
 
 /// Result value that is computed by the rules for input and command files.
@@ -369,6 +422,9 @@ public:
   /// The Ninja manifest we are operating on.
   std::unique_ptr<ninja::Manifest> manifest;
 
+  /// The file information cache for the current build.
+  StatCachingFileSystem fileSystem{createLocalFileSystem()};
+
   /// User-defined prefix for the status line.
   std::string statusLinePrefixFormat = "[%f/%t] ";
 
@@ -390,8 +446,11 @@ public:
   int numJobsInParallel{0};
   basic::SchedulerAlgorithm schedulerAlgorithm{basic::SchedulerAlgorithm::NamePriority};
 
-  /// The build profile output file.
-  FILE *profileFP = nullptr;
+  /// The system load above which new commands are not started.
+  basic::ExecutionQueueLoadLimits loadLimits;
+
+  /// The build profiler, if a build profile was requested.
+  BuildProfiler profiler;
 
   /// Whether the build has been cancelled or not.
   std::atomic<bool> isCancelled{false};
@@ -433,6 +492,12 @@ public:
   std::unordered_map<uint64_t, SmallString<1024>> outputBuffers;
   std::mutex outputBufferMutex;
 
+  /// The files included by each successful command using MSVC style implicit
+  /// dependencies, as reported in its output, until they are processed.
+  std::unordered_map<const ninja::Command*, std::vector<std::string>>
+    msvcDependencies;
+  std::mutex msvcDependenciesMutex;
+
   std::unique_ptr<std::thread> signalHandlerThread;
 
   /// The previous SIGINT handler.
@@ -683,9 +748,24 @@ public:
   void processFinished(ProcessContext* ctx, ProcessHandle handle,
                        const ProcessResult& result) override {
     ninja::Command* job = reinterpret_cast<ninja::Command*>(ctx);
+    profiler.commandProcessFinished(job, result);
     std::unique_lock<std::mutex> lock(outputBufferMutex);
     auto& outputData = outputBuffers[handle.id];
     lock.unlock();
+
+    // Remove the included files from the output of commands which report them
+    // there, and keep them for the command to record as its dependencies.
+    if (job->getDepsStyle() == ninja::Command::DepsStyleKind::MSVC) {
+      std::vector<std::string> includes;
+      std::string filtered = filterShowIncludes(
+          outputData.str(), job->getMSVCDepsPrefix(), includes);
+      outputData = filtered;
+      if (result.status == ProcessStatus::Succeeded) {
+        std::lock_guard<std::mutex> guard(msvcDependenciesMutex);
+        msvcDependencies[job] = std::move(includes);
+      }
+    }
+
     if (result.status == ProcessStatus::Succeeded) {
       if (!outputData.empty()) {
         emitText(std::string(outputData.data(), outputData.size()));
@@ -1034,6 +1114,9 @@ buildCommand(BuildContext& context, ninja::Command* command) {
       // to fix it.
       bool isPhony = command->getRule() == context.manifest->getPhonyRule();
 
+      if (!isPhony)
+        context.profiler.commandPreparing(command);
+
       // Request all of the explicit and implicit inputs (the only difference
       // between them is that implicit inputs do not appear in ${in} during
       // variable expansion, but that has already been performed).
@@ -1078,13 +1161,13 @@ buildCommand(BuildContext& context, ninja::Command* command) {
       unsigned numOutputs = command->getOutputs().size();
       if (numOutputs == 1) {
         return BuildValue::makeSuccessfulCommand(
-            FileInfo::getInfoForPath(
+            context.fileSystem.getFileInfo(
                 command->getOutputs()[0]->getCanonicalPath()),
             commandHash);
       } else {
         std::vector<FileInfo> outputInfos(numOutputs);
         for (unsigned i = 0; i != numOutputs; ++i) {
-          outputInfos[i] = FileInfo::getInfoForPath(
+          outputInfos[i] = context.fileSystem.getFileInfo(
               command->getOutputs()[i]->getCanonicalPath());
         }
         return BuildValue::makeSuccessfulCommand(outputInfos.data(), numOutputs,
@@ -1211,6 +1294,7 @@ buildCommand(BuildContext& context, ninja::Command* command) {
 
       auto addExecuteJob = [this, ti](std::function<void(void)>&& jobFullyExecuted) mutable {
         // Otherwise, enqueue the job to run later.
+        context.profiler.commandQueued(command);
         ti.spawn({command, [this, ti, done=std::move(jobFullyExecuted)] (QueueJobContext* qctx) mutable {
           // Suppress static analyzer false positive on generalized lambda capture
           // (rdar://problem/22165130).
@@ -1221,31 +1305,14 @@ buildCommand(BuildContext& context, ninja::Command* command) {
           ninja::Command* localCommand(command);
           auto bucket = qctx->laneID();
 
-          if (localContext.profileFP) {
-            localContext.consoleQueue.async(
-              [&localContext=localContext, localCommand=localCommand, bucket] {
-                uint64_t startTime = getTimeInMicroseconds();
-                fprintf(localContext.profileFP,
-                        ("{ \"name\": \"%s\", \"ph\": \"B\", \"pid\": 0, "
-                         "\"tid\": %d, \"ts\": %llu},\n"),
-                        localCommand->getEffectiveDescription().c_str(), bucket,
-                        static_cast<unsigned long long>(startTime));
-              });
+          if (localContext.profiler.isOpen()) {
+            localContext.profiler.commandStarted(
+                localCommand, localCommand->getEffectiveDescription(), bucket);
           }
 
           executeCommand(ti, qctx);
 
-          if (localContext.profileFP) {
-            localContext.consoleQueue.async(
-              [&localContext=localContext, localCommand=localCommand, bucket] {
-                uint64_t endTime = getTimeInMicroseconds();
-                fprintf(localContext.profileFP,
-                        ("{ \"name\": \"%s\", \"ph\": \"E\", \"pid\": 0, "
-                         "\"tid\": %d, \"ts\": %llu},\n"),
-                        localCommand->getEffectiveDescription().c_str(), bucket,
-                        static_cast<unsigned long long>(endTime));
-              });
-          }
+          localContext.profiler.commandFinished(localCommand);
           done();
 #endif
         }});
@@ -1346,6 +1413,12 @@ buildCommand(BuildContext& context, ninja::Command* command) {
 
       ti.spawn(qctx, args, {}, {true, isConsolePool}, {
         [this, ti](ProcessResult result) mutable {
+          // The command may have written its outputs, so discard any
+          // information cached before it ran.
+          for (const auto* output: command->getOutputs())
+            context.fileSystem.invalidateFileInfo(output->getCanonicalPath());
+          ti.reportStatistics(result.maxrss, 0);
+
           // Actually run the command.
           if (result.status != ProcessStatus::Succeeded) {
             // If the command failed, complete the task with the failed result and
@@ -1367,6 +1440,13 @@ buildCommand(BuildContext& context, ninja::Command* command) {
           // forcing downstream propagation if it isn't set.
           auto commandHash = CommandSignature(command->getCommandString());
           BuildValue resultValue = computeCommandResult(commandHash);
+          uint64_t outputBytes = 0;
+          for (unsigned i = 0, e = resultValue.getNumOutputs(); i != e; ++i) {
+            const FileInfo& outputInfo = resultValue.getNthOutputInfo(i);
+            if (!outputInfo.isMissing())
+              outputBytes += outputInfo.size;
+          }
+          ti.reportStatistics(0, outputBytes);
 
           // Remove response file.
           const auto rspFile = command->getRspFile();
@@ -1386,8 +1466,24 @@ buildCommand(BuildContext& context, ninja::Command* command) {
       case ninja::Command::DepsStyleKind::None:
         return true;
       case ninja::Command::DepsStyleKind::MSVC: {
-        context.emitError("MSVC style dependencies are unsupported");
-        return false;
+        // The included files were extracted from the command output when the
+        // process finished.
+        std::vector<std::string> includes;
+        {
+          std::lock_guard<std::mutex> guard(context.msvcDependenciesMutex);
+          auto it = context.msvcDependencies.find(command);
+          if (it != context.msvcDependencies.end()) {
+            includes = std::move(it->second);
+            context.msvcDependencies.erase(it);
+          }
+        }
+
+        for (const auto& include: includes) {
+          SmallString<256> path = StringRef(include);
+          if (ninja::Manifest::normalize_path(context.workingDirectory, path))
+            ti.discoveredDependency(path.str());
+        }
+        return true;
       }
       case ninja::Command::DepsStyleKind::GCC: {
         // Read the dependencies file.
@@ -1448,7 +1544,15 @@ buildCommand(BuildContext& context, ninja::Command* command) {
         DepsActions actions(context, ti, context.workingDirectory, command->getDepsFile());
         core::MakefileDepsParser(bufferOrError.get()->getBuffer(),
                                  actions, false).parse();
-        return actions.numErrors == 0;
+        if (actions.numErrors != 0)
+          return false;
+
+        // The dependencies are recorded with the command's result in the build
+        // database, so the file is no longer needed if it was only written for
+        // us.
+        if (command->hasRemoveDepsFileFlag())
+          llvm::sys::fs::remove(command->getDepsFile());
+        return true;
       }
       }
 
@@ -1479,7 +1583,7 @@ static core::Task* buildInput(BuildContext& context, ninja::Node* input) {
         return;
       }
 
-      auto outputInfo = FileInfo::getInfoForPath(node->getCanonicalPath());
+      auto outputInfo = context.fileSystem.getFileInfo(node->getCanonicalPath());
       if (outputInfo.isMissing()) {
         ti.complete(BuildValue::makeMissingInput().toValue());
         return;
@@ -1594,7 +1698,7 @@ selectCompositeBuildResult(BuildContext& context, ninja::Command* command,
   return new SelectResultTask(context, command, inputIndex, compositeRuleName);
 }
 
-static bool buildInputIsResultValid(ninja::Node* node,
+static bool buildInputIsResultValid(BuildContext& context, ninja::Node* node,
                                     const core::ValueType& valueData) {
   BuildValue value = BuildValue::fromValue(valueData);
 
@@ -1605,19 +1709,17 @@ static bool buildInputIsResultValid(ninja::Node* node,
   // Otherwise, the result is valid if the path exists and the hash has not
   // changed.
   //
-  // FIXME: This is inefficient, we will end up doing the stat twice, once when
-  // we check the value for up to dateness, and once when we "build" the output.
-  //
-  // We can solve this by caching ourselves but I wonder if it is something the
-  // engine should support more naturally.
-  auto info = FileInfo::getInfoForPath(node->getCanonicalPath());
+  // The file information is cached for the build, so the stat is shared with
+  // the input task if it needs to run.
+  auto info = context.fileSystem.getFileInfo(node->getCanonicalPath());
   if (info.isMissing())
     return false;
 
   return value.getOutputInfo() == info;
 }
 
-static bool buildCommandIsResultValid(ninja::Command* command,
+static bool buildCommandIsResultValid(BuildContext& context,
+                                      ninja::Command* command,
                                       const core::ValueType& valueData) {
   BuildValue value = BuildValue::fromValue(valueData);
 
@@ -1635,7 +1737,7 @@ static bool buildCommandIsResultValid(ninja::Command* command,
   // Check the timestamps on each of the outputs.
   for (unsigned i = 0, e = command->getOutputs().size(); i != e; ++i) {
     // Always rebuild if the output is missing.
-    auto info = FileInfo::getInfoForPath(command->getOutputs()[i]->getCanonicalPath());
+    auto info = context.fileSystem.getFileInfo(command->getOutputs()[i]->getCanonicalPath());
     if (info.isMissing())
       return false;
 
@@ -1679,14 +1781,17 @@ static void updateCommandStatus(BuildContext& context,
   // the total number of completed commands.
   if (status == core::Rule::StatusKind::IsScanning) {
     ++context.numCommandsScanning;
+    context.profiler.commandScanning(command);
   } else if (status == core::Rule::StatusKind::IsUpToDate) {
     --context.numCommandsScanning;
     ++context.numCommandsUpToDate;
     ++context.numCommandsCompleted;
+    context.profiler.commandFinished(command);
   } else {
     assert(status == core::Rule::StatusKind::IsComplete);
     --context.numCommandsScanning;
     ++context.numCommandsCompleted;
+    context.profiler.commandFinished(command);
   }
 }
 
@@ -1717,7 +1822,7 @@ std::unique_ptr<core::Rule> NinjaBuildEngineDelegate::lookupRule(const core::Key
       // If simulating, assume cached results are valid.
       if (context->simulate) return true;
 
-      return buildInputIsResultValid(node, value);
+      return buildInputIsResultValid(*context, node, value);
     }
   };
 
@@ -1752,6 +1857,50 @@ void NinjaBuildEngineDelegate::error(const Twine& message) {
   // Cancel the build.
   context->isCancelled = true;
 }
+
+/// Collect the paths of the nodes the given targets (transitively) depend on,
+/// along with the outputs of the commands which produce them, which are the
+/// paths whose file information the build will need.
+///
+/// Dependencies discovered from dependency files are not included.
+static std::vector<std::string>
+collectBuildPaths(const ninja::Manifest& manifest,
+                  ArrayRef<std::string> targets) {
+  std::unordered_map<const ninja::Node*, const ninja::Command*> producers;
+  for (const auto* command: manifest.getCommands()) {
+    for (const auto* output: command->getOutputs())
+      producers[output] = command;
+  }
+
+  std::vector<std::string> paths;
+  std::unordered_set<const ninja::Node*> visitedNodes;
+  std::unordered_set<const ninja::Command*> visitedCommands;
+  std::vector<const ninja::Node*> worklist;
+  auto visit = [&](const ninja::Node* node) {
+    if (visitedNodes.insert(node).second) {
+      paths.push_back(node->getCanonicalPath());
+      worklist.push_back(node);
+    }
+  };
+  for (const auto& target: targets) {
+    auto it = manifest.getNodes().find(target);
+    if (it != manifest.getNodes().end())
+      visit(it->getValue());
+  }
+  while (!worklist.empty()) {
+    const ninja::Node* node = worklist.back();
+    worklist.pop_back();
+
+    auto it = producers.find(node);
+    if (it == producers.end() || !visitedCommands.insert(it->second).second)
+      continue;
+    for (const auto* output: it->second->getOutputs())
+      visit(output);
+    for (const auto* input: it->second->getInputs())
+      visit(input);
+  }
+  return paths;
+}
 } // namespace
 
 
@@ -1759,7 +1908,11 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
   std::string chdirPath = "";
   std::string customTool = "";
   std::string dbFilename = "build.db";
+  core::BuildDBFormat dbFormat = core::BuildDBFormat::SQLite;
+  unsigned dbWriteBatchSize = 0;
+  bool dbPreload = false;
   std::string dumpGraphPath, profileFilename, traceFilename;
+  core::BuildEngineTraceFormat traceFormat = core::BuildEngineTraceFormat::JSON;
   std::string manifestFilename = "build.ninja";
 
   // Create a context for the build.
@@ -1769,9 +1922,10 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
   bool strict = false;
   bool verbose = false;
   unsigned numJobsInParallel = 0;
+  unsigned numScanThreads = 0;
   SchedulerAlgorithm schedulerAlgorithm = SchedulerAlgorithm::NamePriority;
   unsigned numFailedCommandsToTolerate = 1;
-  double maximumLoadAverage = 0.0;
+  ExecutionQueueLoadLimits loadLimits;
   std::vector<std::string> debugTools;
 
   if (basic::sys::raiseOpenFileLimit() != 0) {
@@ -1816,6 +1970,34 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
       }
       dbFilename = args[0];
       args.erase(args.begin());
+    } else if (option == "--db-format") {
+      if (args.empty()) {
+        fprintf(stderr, "%s: error: missing argument to '%s'\n\n",
+                getProgramName(), option.c_str());
+        usage();
+      }
+      if (!core::parseBuildDBFormat(args[0], &dbFormat)) {
+        fprintf(stderr, "%s: error: unknown database format '%s'\n\n",
+                getProgramName(), args[0].c_str());
+        usage();
+      }
+      args.erase(args.begin());
+    } else if (option == "--db-preload") {
+      dbPreload = true;
+    } else if (option == "--db-write-batch") {
+      if (args.empty()) {
+        fprintf(stderr, "%s: error: missing argument to '%s'\n\n",
+                getProgramName(), option.c_str());
+        usage();
+      }
+      char *end;
+      dbWriteBatchSize = ::strtol(args[0].c_str(), &end, 10);
+      if (*end != '\0') {
+        fprintf(stderr, "%s: error: invalid argument '%s' to '%s'\n\n",
+                getProgramName(), args[0].c_str(), option.c_str());
+        usage();
+      }
+      args.erase(args.begin());
     } else if (option == "--dump-graph") {
       if (args.empty()) {
         fprintf(stderr, "%s: error: missing argument to '%s'\n\n",
@@ -1846,20 +2028,56 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
           usage();
       }
       args.erase(args.begin());
-    } else if (option == "-l") {
+    } else if (option == "--scan-threads") {
       if (args.empty()) {
         fprintf(stderr, "%s: error: missing argument to '%s'\n\n",
                 getProgramName(), option.c_str());
         usage();
       }
       char *end;
-      maximumLoadAverage = ::strtod(args[0].c_str(), &end);
+      numScanThreads = ::strtol(args[0].c_str(), &end, 10);
       if (*end != '\0') {
           fprintf(stderr, "%s: error: invalid argument '%s' to '%s'\n\n",
                   getProgramName(), args[0].c_str(), option.c_str());
           usage();
       }
       args.erase(args.begin());
+    } else if (option == "-l" || option == "--max-cpu-pressure" ||
+               option == "--max-memory-pressure") {
+      if (args.empty()) {
+        fprintf(stderr, "%s: error: missing argument to '%s'\n\n",
+                getProgramName(), option.c_str());
+        usage();
+      }
+      char *end;
+      double limit = ::strtod(args[0].c_str(), &end);
+      if (*end != '\0') {
+          fprintf(stderr, "%s: error: invalid argument '%s' to '%s'\n\n",
+                  getProgramName(), args[0].c_str(), option.c_str());
+          usage();
+      }
+      if (option == "-l") {
+        loadLimits.maxLoadAverage = limit;
+      } else if (option == "--max-cpu-pressure") {
+        loadLimits.maxCPUPressure = limit;
+      } else {
+        loadLimits.maxMemoryPressure = limit;
+      }
+      args.erase(args.begin());
+    } else if (option == "--memory-budget") {
+      if (args.empty()) {
+        fprintf(stderr, "%s: error: missing argument to '%s'\n\n",
+                getProgramName(), option.c_str());
+        usage();
+      }
+      uint64_t megabytes;
+      if (StringRef(args[0]).getAsInteger(10, megabytes)) {
+          fprintf(stderr, "%s: error: invalid argument '%s' to '%s'\n\n",
+                  getProgramName(), args[0].c_str(), option.c_str());
+          usage();
+      }
+      loadLimits.memoryBudget = megabytes * 1024 * 1024;
+      args.erase(args.begin());
     } else if (option == "-j" || option == "--jobs") {
       if (args.empty()) {
         fprintf(stderr, "%s: error: missing argument to '%s'\n\n",
@@ -1885,6 +2103,12 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
         schedulerAlgorithm = SchedulerAlgorithm::NamePriority;
       } else if (algorithm == "fifo") {
         schedulerAlgorithm = SchedulerAlgorithm::FIFO;
+      } else if (algorithm == "workStealing" ||
+                 algorithm == "work-stealing") {
+        schedulerAlgorithm = SchedulerAlgorithm::WorkStealing;
+      } else if (algorithm == "criticalPath" ||
+                 algorithm == "critical-path") {
+        schedulerAlgorithm = SchedulerAlgorithm::CriticalPath;
       } else {
         fprintf(stderr, "%s: error: unknown scheduler algorithm '%s'\n\n",
                 getProgramName(), args[0].c_str());
@@ -1935,6 +2159,18 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
       }
       traceFilename = args[0];
       args.erase(args.begin());
+    } else if (option == "--trace-format") {
+      if (args.empty()) {
+        fprintf(stderr, "%s: error: missing argument to '%s'\n\n",
+                getProgramName(), option.c_str());
+        usage();
+      }
+      if (!core::parseBuildEngineTraceFormat(args[0], &traceFormat)) {
+        fprintf(stderr, "%s: error: unknown trace format '%s'\n\n",
+                getProgramName(), args[0].c_str());
+        usage();
+      }
+      args.erase(args.begin());
     } else if (option == "-v" || option == "--verbose") {
       verbose = true;
     } else {
@@ -1944,11 +2180,6 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
     }
   }
 
-  if (maximumLoadAverage > 0.0) {
-    fprintf(stderr, "%s: warning: maximum load average %.8g not implemented\n",
-            getProgramName(), maximumLoadAverage);
-  }
-
   if (!debugTools.empty()) {
     if (std::find(debugTools.begin(), debugTools.end(), "list")
         != debugTools.end()) {
@@ -2039,6 +2270,7 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
     context.verbose = verbose;
     context.numJobsInParallel = numJobsInParallel;
     context.schedulerAlgorithm = schedulerAlgorithm;
+    context.loadLimits = loadLimits;
 
     // Load the manifest.
     BuildManifestActions actions(context);
@@ -2092,10 +2324,14 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
     if (!dbFilename.empty()) {
       std::string error;
       std::unique_ptr<core::BuildDB> db(
-        core::createSQLiteBuildDB(dbFilename,
-                                  BuildValue::currentSchemaVersion,
-                                  /* recreateUnmatchedVersion = */ true,
-                                  &error));
+        core::createBuildDB(dbFormat, dbFilename,
+                            BuildValue::currentSchemaVersion,
+                            /* recreateUnmatchedVersion = */ true,
+                            &error));
+      if (db && dbWriteBatchSize)
+        db = core::createWriteBehindBuildDB(std::move(db), dbWriteBatchSize);
+      if (db && dbPreload)
+        db = core::createPreloadingBuildDB(std::move(db));
       if (!db || !context.engine.attachDB(std::move(db), &error)) {
         context.emitError("unable to open build database: %s", error.c_str());
         return 1;
@@ -2105,12 +2341,17 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
     // Enable tracing, if requested.
     if (!traceFilename.empty()) {
       std::string error;
-      if (!context.engine.enableTracing(traceFilename, &error)) {
+      if (!context.engine.enableTracing(traceFilename, traceFormat, &error)) {
         context.emitError("unable to enable tracing: %s", error.c_str());
         return 1;
       }
     }
 
+    // Enable parallel scanning, if requested. The rule validity checks only
+    // stat the file system, so are safe to run concurrently.
+    if (numScanThreads)
+      context.engine.enableParallelScanning(numScanThreads);
+
     class NinjaBuildCommandRule: public core::Rule {
       BuildContext& context;
       ninja::Command* command;
@@ -2128,7 +2369,7 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
         if (context.simulate)
           return true;
 
-        return buildCommandIsResultValid(command, value);
+        return buildCommandIsResultValid(context, command, value);
       }
 
       void updateStatus(core::BuildEngine&, core::Rule::StatusKind status) override {
@@ -2232,14 +2473,11 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
 
     // If using a build profile, open it.
     if (!profileFilename.empty()) {
-      context.profileFP = ::fopen(profileFilename.c_str(), "w");
-      if (!context.profileFP) {
-        context.emitError("unable to open build profile '%s' (%s)\n",
-                          profileFilename.c_str(), strerror(errno));
+      std::string error;
+      if (!context.profiler.open(profileFilename, &error)) {
+        context.emitError("unable to enable build profile: %s", error.c_str());
         return 1;
       }
-
-      fprintf(context.profileFP, "[\n");
     }
 
     // Parse the positional arguments.
@@ -2288,6 +2526,18 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
       return 1;
     }
 
+    // File information is only cached for the duration of each build.
+    context.fileSystem.clear();
+
+    // Retrieve the file information for the nodes the targets depend on in
+    // bulk, rather than one stat at a time as the rules are scanned. This only
+    // pays off when the stats can be serviced concurrently; on a single core it
+    // is slower than letting the rules stat the files they need.
+    if (!context.simulate && std::thread::hardware_concurrency() > 1) {
+      context.fileSystem.prefetchFileInfo(
+          collectBuildPaths(*context.manifest, targetsToBuild));
+    }
+
     // If building multiple targets, do so via a dummy rule to allow them to
     // build concurrently (and without duplicates).
     //
@@ -2308,12 +2558,15 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
     }
 
     // Close the build profile, if used.
-    if (context.profileFP) {
-      ::fclose(context.profileFP);
-
-      context.emitNote(
-          "wrote build profile to '%s', use Chrome's about:tracing to view.",
-          profileFilename.c_str());
+    if (context.profiler.isOpen()) {
+      std::string error;
+      if (!context.profiler.close(&error)) {
+        context.emitError("unable to close build profile: %s", error.c_str());
+      } else {
+        context.emitNote(
+            "wrote build profile to '%s', use Chrome's about:tracing or "
+            "Perfetto to view.", profileFilename.c_str());
+      }
     }
 
     // If the build was cancelled by SIGINT, cause ourself to also die by SIGINT
@@ -2366,6 +2619,6 @@ int commands::executeNinjaBuildCommand(std::vector<std::string> args) {
 
 std::unique_ptr<basic::ExecutionQueue> NinjaBuildEngineDelegate::createExecutionQueue() {
   return std::unique_ptr<basic::ExecutionQueue>(
-    createLaneBasedExecutionQueue(*context, context->numJobsInParallel, context->schedulerAlgorithm, getDefaultQualityOfService(), nullptr)
+    createLaneBasedExecutionQueue(*context, context->numJobsInParallel, context->schedulerAlgorithm, getDefaultQualityOfService(), nullptr, context->loadLimits)
   );
 }
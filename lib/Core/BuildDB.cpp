@@ -12,9 +12,98 @@
 
 #include "llbuild/Core/BuildDB.h"
 
+#include "llbuild/Basic/BinaryCoding.h"
+
+#include <cstring>
+
 using namespace llbuild;
 using namespace llbuild::core;
 
+/// The number of fields in the encoding of \see RuleStatistics.
+static const uint32_t numRuleStatisticsFields = 4;
+
+constexpr double RuleStatistics::durationWeight;
+
+void RuleStatistics::addRun(double duration, uint64_t peakRSS,
+                            uint64_t outputBytes) {
+  if (runCount == 0) {
+    weightedDuration = duration;
+  } else {
+    weightedDuration = durationWeight * duration +
+      (1.0 - durationWeight) * weightedDuration;
+  }
+  ++runCount;
+  this->peakRSS = peakRSS;
+  this->outputBytes = outputBytes;
+}
+
+void RuleStatistics::encode(basic::BinaryEncoder& coder) const {
+  uint64_t duration;
+  memcpy(&duration, &weightedDuration, sizeof(duration));
+
+  coder.write(numRuleStatisticsFields);
+  coder.write(runCount);
+  coder.write(duration);
+  coder.write(peakRSS);
+  coder.write(outputBytes);
+}
+
+bool RuleStatistics::decode(StringRef data) {
+  if (data.size() < sizeof(uint32_t))
+    return false;
+  basic::BinaryDecoder coder(data);
+  uint32_t numFields;
+  coder.read(numFields);
+  if (data.size() != sizeof(uint32_t) + uint64_t(numFields) * sizeof(uint64_t))
+    return false;
+
+  // Read the known fields, and ignore any added by later versions.
+  uint64_t fields[numRuleStatisticsFields];
+  for (uint32_t i = 0; i != numFields; ++i) {
+    uint64_t value;
+    coder.read(value);
+    if (i < numRuleStatisticsFields)
+      fields[i] = value;
+  }
+  if (numFields > 0)
+    runCount = fields[0];
+  if (numFields > 1)
+    memcpy(&weightedDuration, &fields[1], sizeof(weightedDuration));
+  if (numFields > 2)
+    peakRSS = fields[2];
+  if (numFields > 3)
+    outputBytes = fields[3];
+  return true;
+}
+
 BuildDBDelegate::~BuildDBDelegate() { }
 
 BuildDB::~BuildDB() { }
+
+bool core::parseBuildDBFormat(StringRef name, BuildDBFormat* format_out) {
+  if (name == "sqlite") {
+    *format_out = BuildDBFormat::SQLite;
+    return true;
+  }
+  if (name == "log") {
+    *format_out = BuildDBFormat::Log;
+    return true;
+  }
+  return false;
+}
+
+std::unique_ptr<BuildDB> core::createBuildDB(BuildDBFormat format,
+                                             StringRef path,
+                                             uint32_t clientSchemaVersion,
+                                             bool recreateUnmatchedVersion,
+                                             std::string* error_out) {
+  switch (format) {
+  case BuildDBFormat::SQLite:
+    return createSQLiteBuildDB(path, clientSchemaVersion,
+                               recreateUnmatchedVersion, error_out);
+  case BuildDBFormat::Log:
+    return createLogBuildDB(path, clientSchemaVersion,
+                            recreateUnmatchedVersion, error_out);
+  }
+  return nullptr;
+}
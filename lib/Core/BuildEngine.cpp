@@ -15,24 +15,28 @@
 #include "llbuild/Basic/Defer.h"
 #include "llbuild/Basic/ExecutionQueue.h"
 #include "llbuild/Basic/Tracing.h"
+#include "llbuild/Basic/WorkStealingPool.h"
 #include "llbuild/Core/BuildDB.h"
+#include "llbuild/Core/InternedKeyTable.h"
 #include "llbuild/Core/KeyID.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
-#include "llvm/ADT/StringMap.h"
 
 #include "BuildEngineTrace.h"
 
 #include <atomic>
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <cstdio>
 #include <condition_variable>
 #include <deque>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -62,6 +66,147 @@ CancellationDelegate::~CancellationDelegate() = default;
 
 namespace {
 
+/// An append-only sequence of objects, which are allocated in fixed-size
+/// chunks so that the address of an element never changes.
+template <typename T, size_t ChunkSize>
+class StableChunkedVector {
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+  std::vector<std::unique_ptr<Storage[]>> chunks;
+  size_t count = 0;
+
+  T* getElement(size_t index) const {
+    return reinterpret_cast<T*>(&chunks[index / ChunkSize][index % ChunkSize]);
+  }
+
+public:
+  StableChunkedVector() {}
+  StableChunkedVector(const StableChunkedVector&) = delete;
+  StableChunkedVector& operator=(const StableChunkedVector&) = delete;
+  ~StableChunkedVector() { clear(); }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    if (count == chunks.size() * ChunkSize)
+      chunks.emplace_back(new Storage[ChunkSize]);
+    T* element = getElement(count);
+    new (element) T(std::forward<Args>(args)...);
+    ++count;
+    return *element;
+  }
+
+  bool empty() const { return count == 0; }
+  size_t size() const { return count; }
+
+  T& operator[](size_t index) {
+    assert(index < count);
+    return *getElement(index);
+  }
+
+  void clear() {
+    for (size_t i = 0; i != count; ++i)
+      getElement(i)->~T();
+    chunks.clear();
+    count = 0;
+  }
+
+  template <typename Fn>
+  void forEach(Fn fn) {
+    for (size_t i = 0; i != count; ++i)
+      fn(*getElement(i));
+  }
+};
+
+/// An allocator for objects of a single type, which carves them out of
+/// fixed-size chunks and recycles the memory of destroyed objects.
+///
+/// Each object also has a handle, which identifies it until it is destroyed,
+/// and is not confused with a later object which reuses its memory.
+template <typename T, size_t ChunkSize>
+class SlabAllocator {
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+  struct Slot {
+    Storage storage;
+    /// The index of the slot.
+    uint32_t index;
+    /// The number of times an object in the slot has been destroyed.
+    uint32_t generation;
+  };
+
+  /// The number of bits of a handle which hold the generation of the object.
+  static const unsigned generationBits = sizeof(uintptr_t) == 8 ? 32 : 8;
+  static const uintptr_t generationMask =
+    (uintptr_t(1) << generationBits) - 1;
+
+  std::vector<std::unique_ptr<Slot[]>> chunks;
+  std::vector<Slot*> freeList;
+  Slot* currentPos = nullptr;
+  Slot* currentEnd = nullptr;
+
+  static Slot* getSlot(T* object) {
+    static_assert(offsetof(Slot, storage) == 0, "unexpected slot layout");
+    return reinterpret_cast<Slot*>(object);
+  }
+
+public:
+  SlabAllocator() {}
+  SlabAllocator(const SlabAllocator&) = delete;
+  SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+  /// Create a new object.
+  template <typename... Args>
+  T* create(Args&&... args) {
+    Slot* slot;
+    if (!freeList.empty()) {
+      slot = freeList.back();
+      freeList.pop_back();
+    } else {
+      if (currentPos == currentEnd) {
+        chunks.emplace_back(new Slot[ChunkSize]);
+        currentPos = chunks.back().get();
+        currentEnd = currentPos + ChunkSize;
+        for (size_t i = 0; i != ChunkSize; ++i) {
+          currentPos[i].index = uint32_t((chunks.size() - 1) * ChunkSize + i);
+          currentPos[i].generation = 0;
+        }
+      }
+      slot = currentPos++;
+    }
+    return new (&slot->storage) T(std::forward<Args>(args)...);
+  }
+
+  /// Destroy an object previously returned by \see create().
+  void destroy(T* object) {
+    object->~T();
+    Slot* slot = getSlot(object);
+    ++slot->generation;
+    freeList.push_back(slot);
+  }
+
+  /// Get the handle of a live object.
+  uintptr_t getHandle(T* object) const {
+    Slot* slot = getSlot(object);
+    return (uintptr_t(slot->index) << generationBits) |
+      (slot->generation & generationMask);
+  }
+
+  /// Get the object identified by a handle.
+  ///
+  /// \returns The object, or null if it has been destroyed.
+  T* lookup(uintptr_t handle) const {
+    size_t index = handle >> generationBits;
+    if (index / ChunkSize >= chunks.size())
+      return nullptr;
+    Slot& slot = chunks[index / ChunkSize][index % ChunkSize];
+    if (&slot >= currentPos && &slot < currentEnd)
+      return nullptr;
+    if ((slot.generation & generationMask) != (handle & generationMask))
+      return nullptr;
+    return reinterpret_cast<T*>(&slot.storage);
+  }
+};
+
 class BuildEngineImpl : public BuildDBDelegate {
   struct RuleInfo;
   struct TaskInfo;
@@ -74,11 +219,11 @@ class BuildEngineImpl : public BuildDBDelegate {
 
   BuildEngineDelegate& delegate;
 
-  /// The key table, used when there is no database.
-  llvm::StringMap<KeyID> keyTable;
-
-  /// The mutex that protects the key table.
-  std::mutex keyTableMutex;
+  /// The key table.
+  ///
+  /// The value for each key is the registered rule for the key, if any. This
+  /// allows the rule for a KeyID to be found without a separate lookup.
+  InternedKeyTable<RuleInfo*> keyTable;
 
   /// The build database, if attached.
   std::unique_ptr<BuildDB> db;
@@ -89,6 +234,24 @@ class BuildEngineImpl : public BuildDBDelegate {
   /// Path of the trace file to write to, if set.
   std::string traceFile;
 
+  /// The format of the trace file.
+  BuildEngineTraceFormat traceFormat = BuildEngineTraceFormat::JSON;
+
+  /// The pool used to check rule results in parallel while scanning, if
+  /// enabled.
+  std::unique_ptr<basic::WorkStealingPool> scanPool;
+
+  /// The number of tasks which have completed, used to detect speculative
+  /// validity checks which may have raced with the work of a task.
+  std::atomic<uint64_t> numCompletedTasks{ 0 };
+
+  /// The number of threads waiting for a speculative validity check.
+  std::atomic<unsigned> numValidityCheckWaiters{ 0 };
+
+  /// The mutex and condition used to wait for speculative validity checks.
+  std::mutex validityCheckMutex;
+  std::condition_variable validityCheckCondition;
+
   /// Mutex for access to execution queue.
   std::mutex executionQueueMutex;
 
@@ -96,6 +259,14 @@ class BuildEngineImpl : public BuildDBDelegate {
   /// actually in progress.
   std::unique_ptr<ExecutionQueue> executionQueue;
 
+  /// The estimated critical path of each rule with a prior result, in seconds,
+  /// when the execution queue schedules jobs using them.
+  llvm::DenseMap<KeyID, double> criticalPathEstimates;
+
+  /// Whether the execution queue admits jobs using their memory estimates, in
+  /// which case they are taken from the peak RSS in the rule statistics.
+  bool useMemoryEstimates = false;
+
   /// The current build iteration, used to sequentially timestamp build results.
   Epoch currentEpoch = 0;
 
@@ -187,6 +358,22 @@ class BuildEngineImpl : public BuildDBDelegate {
       Complete
     };
 
+    /// The state of a speculative check of whether the result is still valid,
+    /// \see startInputValidityChecks().
+    enum class ValidityCheckState : uint8_t {
+      /// The check is waiting to be run.
+      Queued = 0,
+
+      /// The check is running.
+      Running,
+
+      /// The check found the result is valid.
+      Valid,
+
+      /// The check found the result is invalid.
+      Invalid
+    };
+
     RuleInfo(KeyID keyID, std::unique_ptr<Rule>&& rule) : keyID(keyID), rule(std::move(rule)) {}
 
     /// The ID for the rule key.
@@ -205,6 +392,17 @@ class BuildEngineImpl : public BuildDBDelegate {
     /// The current state of the rule.
     StateKind state = StateKind::Incomplete;
     bool wasForced = false;
+    /// The \see Result::builtAt of the result stored in the database, if any.
+    Epoch persistedBuiltAt = 0;
+    /// The epoch in which a speculative validity check was started, if any.
+    Epoch validityCheckEpoch = 0;
+    /// The number of tasks which had completed when the speculative validity
+    /// check was started, \see BuildEngineImpl::numCompletedTasks.
+    uint64_t validityCheckStamp = 0;
+    /// The state of the speculative validity check, if started in the current
+    /// epoch.
+    std::atomic<ValidityCheckState> validityCheckState{
+      ValidityCheckState::Queued };
 
   public:
     bool isScanning() const {
@@ -244,6 +442,10 @@ class BuildEngineImpl : public BuildDBDelegate {
     }
 
     void setComplete(const BuildEngineImpl* engine) {
+      // Only a result which was just computed has a new end time; rules which
+      // did not need to run keep the timing of the build which computed them.
+      if (state == StateKind::InProgressComputing)
+        result.end = basic::Clock::now();
       state = StateKind::Complete;
       // Note we do not push this change to the database. This is essentially a
       // mark we maintain to allow a lazy transition to Incomplete when the
@@ -253,7 +455,6 @@ class BuildEngineImpl : public BuildDBDelegate {
       // Result to being totally managed by the database. However, it is just a
       // matter of keeping an extra timestamp outside the Result to fix.
       result.builtAt = engine->getCurrentEpoch();
-      result.end = basic::Clock::now();
     }
 
     void setCancelled() {
@@ -291,14 +492,11 @@ class BuildEngineImpl : public BuildDBDelegate {
     }
   };
 
-  // The map of registered rules.
-  //
-  // NOTE: We currently rely on the unordered_map behavior that ensures that
-  // references to elements are not invalidated by insertion. We will need to
-  // move to an alternate allocation strategy if we switch to DenseMap style
-  // table. This is probably a good idea in any case, because we would benefit
-  // from pool allocating RuleInfo instances.
-  std::unordered_map<KeyID, RuleInfo> ruleInfos;
+  /// The storage for registered rules.
+  ///
+  /// Rules are found via their entry in the \see keyTable, and rely on this
+  /// storage never moving a RuleInfo once it is created.
+  StableChunkedVector<RuleInfo, 1024> ruleInfos;
 
   /// Information tracked for executing tasks.
   //
@@ -309,6 +507,8 @@ class BuildEngineImpl : public BuildDBDelegate {
     TaskInfo(Task* task) : task(task) {}
 
     std::unique_ptr<Task> task;
+    /// The index of this task in \see taskInfos.
+    size_t index = 0;
     /// The list of input requests that are waiting on this task, which will be
     /// fulfilled once the task is complete.
     //
@@ -328,6 +528,19 @@ class BuildEngineImpl : public BuildDBDelegate {
     unsigned waitCount = 0;
     /// The list of discovered dependencies found during execution of the task.
     DependencyKeyIDs discoveredDependencies;
+    /// The dependencies and signature of the rule's result prior to running
+    /// the task, used to determine whether the new result must be persisted.
+    DependencyKeyIDs priorDependencies;
+    basic::CommandSignature priorSignature;
+    /// Whether the task performed work whose statistics should be recorded,
+    /// \see TaskInterface::reportStatistics().
+    bool hasStatistics = false;
+    /// The peak RSS and output bytes reported by the task.
+    uint64_t peakRSS = 0;
+    uint64_t outputBytes = 0;
+    /// The peak RSS of the rule's prior run, for the jobs it spawns, or zero if
+    /// unknown or unused.
+    uint64_t memoryEstimate = 0;
 
 #ifndef NDEBUG
     void dump() const {
@@ -346,12 +559,48 @@ class BuildEngineImpl : public BuildDBDelegate {
 
   /// The tracked information for executing tasks.
   ///
+  /// The handle of the TaskInfo for a task is passed as the context of its
+  /// TaskInterface, so this is only used to enumerate the live tasks.
+  ///
   /// Access to this must be protected via \see taskInfosMutex.
-  std::unordered_map<Task*, TaskInfo> taskInfos;
+  std::vector<TaskInfo*> taskInfos;
+
+  /// The allocator for \see taskInfos.
+  SlabAllocator<TaskInfo, 256> taskInfoAllocator;
 
-  /// The mutex that protects the task info map.
+  /// The mutex that protects the task info list.
   std::mutex taskInfosMutex;
 
+  /// Create the tracking information for a new task.
+  TaskInfo* createTaskInfo(Task* task) {
+    std::lock_guard<std::mutex> guard(taskInfosMutex);
+    TaskInfo* taskInfo = taskInfoAllocator.create(task);
+    taskInfo->index = taskInfos.size();
+    taskInfos.push_back(taskInfo);
+    return taskInfo;
+  }
+
+  /// Destroy the tracking information (and the task) for a finished task.
+  ///
+  /// This method is not thread-safe. The caller must hold the taskInfosMutex.
+  void destroyTaskInfo(TaskInfo* taskInfo) {
+    assert(taskInfos[taskInfo->index] == taskInfo);
+    TaskInfo* last = taskInfos.back();
+    last->index = taskInfo->index;
+    taskInfos[taskInfo->index] = last;
+    taskInfos.pop_back();
+    taskInfoAllocator.destroy(taskInfo);
+  }
+
+  /// Destroy all of the tracked tasks.
+  ///
+  /// This method is not thread-safe. The caller must hold the taskInfosMutex.
+  void destroyAllTaskInfos() {
+    for (auto* taskInfo: taskInfos)
+      taskInfoAllocator.destroy(taskInfo);
+    taskInfos.clear();
+  }
+
   /// The queue of tasks ready to be finalized.
   std::deque<TaskInfo*> readyTaskInfos;
 
@@ -484,7 +733,7 @@ private:
     // FIXME: We should probably try and move this so that it can be done by
     // clients in the background, either by us backgrounding it, or by using a
     // completion model as we do for inputs.
-    if (!ruleInfo.rule->isResultValid(buildEngine, ruleInfo.result.value)) {
+    if (!checkResultValid(ruleInfo)) {
       if (trace)
         trace->ruleNeedsToRunBecauseInvalidValue(ruleInfo.rule.get());
       ruleInfo.state = RuleInfo::StateKind::NeedsToRun;
@@ -512,9 +761,117 @@ private:
     ruleInfo.setPendingScanRecord(newRuleScanRecord());
     ruleInfosToScan.push_back({ &ruleInfo, /*InputIndex=*/0, nullptr, false });
 
+    if (scanPool)
+      startInputValidityChecks(ruleInfo);
+
     return false;
   }
 
+  /// Speculatively check whether the results of the inputs of a rule which is
+  /// being scanned are still valid, on the scan pool.
+  ///
+  /// Checking validity is usually the most expensive part of scanning (e.g.,
+  /// it requires a stat for each file), and the inputs are likely to be
+  /// scanned shortly, at which point \see checkResultValid() will use the
+  /// result of the check. This only issues checks for inputs which would reach
+  /// the validity check when scanned; all other state transitions still happen
+  /// on the engine thread.
+  void startInputValidityChecks(RuleInfo& ruleInfo) {
+    // The checks are issued in small batches, to amortize the cost of handing
+    // them to the pool.
+    const size_t batchSize = 8;
+    std::vector<RuleInfo*> batch;
+    auto issueBatch = [&] {
+      scanPool->async([this, batch] {
+          for (auto* input: batch)
+            runValidityCheck(*input);
+        });
+      batch.clear();
+    };
+
+    for (auto keyIDAndFlag: ruleInfo.result.dependencies) {
+      RuleInfo& inputRuleInfo = getRuleInfoForKey(keyIDAndFlag.keyID);
+      if (inputRuleInfo.isScanned(this) || inputRuleInfo.isScanning() ||
+          inputRuleInfo.validityCheckEpoch == currentEpoch ||
+          inputRuleInfo.result.builtAt == 0 ||
+          inputRuleInfo.rule->signature != inputRuleInfo.result.signature)
+        continue;
+
+      inputRuleInfo.validityCheckEpoch = currentEpoch;
+      inputRuleInfo.validityCheckStamp = numCompletedTasks;
+      inputRuleInfo.validityCheckState = RuleInfo::ValidityCheckState::Queued;
+      batch.push_back(&inputRuleInfo);
+      if (batch.size() == batchSize)
+        issueBatch();
+    }
+    if (!batch.empty())
+      issueBatch();
+  }
+
+  /// Run a speculative validity check, unless another thread already has.
+  void runValidityCheck(RuleInfo& ruleInfo) {
+    if (claimValidityCheck(ruleInfo))
+      performValidityCheck(ruleInfo);
+  }
+
+  /// Claim a speculative validity check, if no thread has started it yet.
+  static bool claimValidityCheck(RuleInfo& ruleInfo) {
+    auto expected = RuleInfo::ValidityCheckState::Queued;
+    return ruleInfo.validityCheckState.compare_exchange_strong(
+        expected, RuleInfo::ValidityCheckState::Running);
+  }
+
+  /// Perform a claimed speculative validity check.
+  void performValidityCheck(RuleInfo& ruleInfo) {
+    bool isValid = ruleInfo.rule->isResultValid(buildEngine,
+                                                ruleInfo.result.value);
+    ruleInfo.validityCheckState = isValid ?
+      RuleInfo::ValidityCheckState::Valid :
+      RuleInfo::ValidityCheckState::Invalid;
+
+    // Wake the engine thread if it is waiting for a check.
+    if (numValidityCheckWaiters != 0) {
+      std::lock_guard<std::mutex> guard(validityCheckMutex);
+      validityCheckCondition.notify_all();
+    }
+  }
+
+  /// Check whether the result of a rule which is being scanned is still valid,
+  /// using the speculative check for the rule if one was started.
+  bool checkResultValid(RuleInfo& ruleInfo) {
+    if (ruleInfo.validityCheckEpoch != currentEpoch || !scanPool)
+      return ruleInfo.rule->isResultValid(buildEngine, ruleInfo.result.value);
+
+    // Run the check now if no pool thread has picked it up yet, in which case
+    // its result is current.
+    if (claimValidityCheck(ruleInfo)) {
+      ruleInfo.validityCheckStamp = numCompletedTasks;
+      performValidityCheck(ruleInfo);
+    }
+
+    // Otherwise, wait for the pool thread running it.
+    auto isDone = [&] {
+      auto state = ruleInfo.validityCheckState.load();
+      return state == RuleInfo::ValidityCheckState::Valid ||
+        state == RuleInfo::ValidityCheckState::Invalid;
+    };
+    if (!isDone()) {
+      ++numValidityCheckWaiters;
+      std::unique_lock<std::mutex> lock(validityCheckMutex);
+      validityCheckCondition.wait(lock, isDone);
+      --numValidityCheckWaiters;
+    }
+
+    // The check may have run before the work of a task which has completed
+    // since it was started (e.g., a command which adds a file to a directory
+    // this rule checks), in which case it must be repeated.
+    if (ruleInfo.validityCheckStamp != numCompletedTasks)
+      return ruleInfo.rule->isResultValid(buildEngine, ruleInfo.result.value);
+
+    return ruleInfo.validityCheckState ==
+      RuleInfo::ValidityCheckState::Valid;
+  }
+
   /// Request the construction of the key specified by the given rule.
   ///
   /// \returns True if the rule is already available, otherwise the rule will be
@@ -550,11 +907,7 @@ private:
     assert(task && "rule action returned null task");
 
     // register the task
-    taskInfosMutex.lock();
-    auto result = taskInfos.emplace(task, TaskInfo(task));
-    assert(result.second && "task already registered");
-    auto taskInfo = &(result.first)->second;
-    taskInfosMutex.unlock();
+    auto taskInfo = createTaskInfo(task);
     taskInfo->forRuleInfo = &ruleInfo;
 
     if (trace)
@@ -567,12 +920,26 @@ private:
     // Reset the Rule Dependencies, which we just append to during processing,
     // but we reset the others to ensure no one ever inadvertently uses them
     // during an invalid state.
+    //
+    // The prior dependencies are retained to check if the stored result is
+    // still accurate once the task completes.
+    taskInfo->priorDependencies = std::move(ruleInfo.result.dependencies);
+    taskInfo->priorSignature = ruleInfo.result.signature;
     ruleInfo.result.dependencies.clear();
 
+    // Estimate the memory the task's jobs will use from its prior run. The
+    // estimate is only a hint, so errors are ignored.
+    if (useMemoryEstimates) {
+      RuleStatistics statistics;
+      std::string error;
+      if (db->lookupRuleStatistics(ruleInfo.keyID, &statistics, &error))
+        taskInfo->memoryEstimate = statistics.peakRSS;
+    }
+
     // Inform the task it should start.
     {
       TracingEngineTaskCallback i(EngineTaskCallbackKind::Start, ruleInfo.keyID);
-      TaskInterface iface{this, task};
+      TaskInterface iface{this, getContextForTaskInfo(taskInfo)};
       task->start(iface);
     }
 
@@ -585,7 +952,7 @@ private:
     if (ruleInfo.result.builtAt != 0 &&
         ruleInfo.rule->signature == ruleInfo.result.signature) {
       TracingEngineTaskCallback i(EngineTaskCallbackKind::ProvidePriorValue, ruleInfo.keyID);
-      TaskInterface iface{this, task};
+      TaskInterface iface{this, getContextForTaskInfo(taskInfo)};
       task->providePriorValue(iface, ruleInfo.result.value);
     }
 
@@ -597,6 +964,124 @@ private:
     return false;
   }
 
+  /// Check whether the result of a rule which has just been run must be
+  /// written to the database.
+  ///
+  /// The stored \see Result::builtAt is only ever compared against the
+  /// computedAt of the rule's inputs, so a result which is otherwise identical
+  /// to the stored one does not need to be rewritten just to advance builtAt,
+  /// as long as none of its inputs were recomputed after the stored builtAt.
+  /// This avoids rewriting every rule which is always rerun on a null build.
+  bool resultNeedsPersisting(const RuleInfo& ruleInfo,
+                             const TaskInfo& taskInfo) {
+    const Result& result = ruleInfo.result;
+    if (ruleInfo.persistedBuiltAt == 0 ||
+        result.computedAt == currentEpoch ||
+        result.signature != taskInfo.priorSignature ||
+        result.dependencies != taskInfo.priorDependencies)
+      return true;
+
+    for (auto keyIDAndFlag: result.dependencies) {
+      const RuleInfo* dependency = findRuleInfo(keyIDAndFlag.keyID);
+      if (!dependency ||
+          dependency->result.computedAt > ruleInfo.persistedBuiltAt)
+        return true;
+    }
+    return false;
+  }
+
+  /// Estimate the critical path of each rule from the durations of its prior
+  /// result in the database, if the execution queue will use them.
+  ///
+  /// The critical path of a rule is its own duration, plus the longest critical
+  /// path of the rules which depend upon it. Dependency cycles in the prior
+  /// results are broken arbitrarily.
+  void computeCriticalPathEstimates() {
+    criticalPathEstimates.clear();
+    if (!db || !executionQueue || !executionQueue->usesCriticalPathEstimates())
+      return;
+
+    // The estimates are only used as a hint, so the build proceeds without
+    // them if the prior results are unavailable.
+    std::vector<KeyType> keys;
+    std::vector<Result> results;
+    std::string error;
+    if (!db->getKeysWithResult(keys, results, &error))
+      return;
+
+    // Number the rules, and collect the dependents of each (in the order the
+    // rules are numbered).
+    unsigned numRules = keys.size();
+    std::vector<KeyID> keyIDs(numRules);
+    llvm::DenseMap<KeyID, unsigned> ruleIndices;
+    for (unsigned i = 0; i != numRules; ++i) {
+      keyIDs[i] = getKeyID(keys[i].str());
+      ruleIndices.insert({ keyIDs[i], i });
+    }
+    std::vector<unsigned> dependentsStart(numRules + 1, 0);
+    for (unsigned i = 0; i != numRules; ++i) {
+      for (auto keyIDAndFlag: results[i].dependencies) {
+        auto it = ruleIndices.find(keyIDAndFlag.keyID);
+        if (it != ruleIndices.end())
+          ++dependentsStart[it->second + 1];
+      }
+    }
+    for (unsigned i = 0; i != numRules; ++i)
+      dependentsStart[i + 1] += dependentsStart[i];
+    std::vector<unsigned> dependents(dependentsStart[numRules]);
+    std::vector<unsigned> nextDependent(dependentsStart.begin(),
+                                        dependentsStart.end() - 1);
+    for (unsigned i = 0; i != numRules; ++i) {
+      for (auto keyIDAndFlag: results[i].dependencies) {
+        auto it = ruleIndices.find(keyIDAndFlag.keyID);
+        if (it != ruleIndices.end())
+          dependents[nextDependent[it->second]++] = i;
+      }
+    }
+
+    // Compute the estimates with a depth-first walk of the dependents, so that
+    // the estimates of all of a rule's dependents are known before its own.
+    enum class VisitState : uint8_t { Unvisited, Visiting, Visited };
+    std::vector<VisitState> visitStates(numRules, VisitState::Unvisited);
+    std::vector<double> estimates(numRules, 0.0);
+    std::vector<std::pair<unsigned, unsigned>> stack;
+    for (unsigned root = 0; root != numRules; ++root) {
+      if (visitStates[root] != VisitState::Unvisited)
+        continue;
+      visitStates[root] = VisitState::Visiting;
+      stack.push_back({ root, dependentsStart[root] });
+      while (!stack.empty()) {
+        unsigned rule = stack.back().first;
+        unsigned& edge = stack.back().second;
+
+        // Visit the next dependent, ignoring those which would form a cycle.
+        if (edge != dependentsStart[rule + 1]) {
+          unsigned dependent = dependents[edge++];
+          if (visitStates[dependent] == VisitState::Unvisited) {
+            visitStates[dependent] = VisitState::Visiting;
+            stack.push_back({ dependent, dependentsStart[dependent] });
+          }
+          continue;
+        }
+
+        double longestDependent = 0.0;
+        for (unsigned i = dependentsStart[rule],
+               e = dependentsStart[rule + 1]; i != e; ++i) {
+          longestDependent = std::max(longestDependent,
+                                      estimates[dependents[i]]);
+        }
+        const Result& result = results[rule];
+        estimates[rule] = std::max(0.0, result.end - result.start) +
+          longestDependent;
+        visitStates[rule] = VisitState::Visited;
+        stack.pop_back();
+      }
+    }
+
+    for (unsigned i = 0; i != numRules; ++i)
+      criticalPathEstimates.insert({ keyIDs[i], estimates[i] });
+  }
+
   /// Process an individual scan request.
   ///
   /// This will process all of the inputs required by the requesting rule, in
@@ -884,7 +1369,7 @@ private:
           assert(request.inputID == kMustFollowInputID);
         } else {
           TracingEngineTaskCallback i(EngineTaskCallbackKind::ProvideValue, request.inputRuleInfo->keyID);
-          TaskInterface iface{this, request.taskInfo->task.get()};
+          TaskInterface iface{this, getContextForTaskInfo(request.taskInfo)};
           request.taskInfo->task->provideValue(
               iface, request.inputID, request.inputRuleInfo->rule->key, request.inputRuleInfo->result.value);
         }
@@ -919,7 +1404,7 @@ private:
         // task ever requests additional inputs.
         {
           TracingEngineTaskCallback i(EngineTaskCallbackKind::InputsAvailable, ruleInfo->keyID);
-          TaskInterface iface{this, taskInfo->task.get()};
+          TaskInterface iface{this, getContextForTaskInfo(taskInfo)};
           taskInfo->task->inputsAvailable(iface);
         }
 
@@ -985,11 +1470,19 @@ private:
           }
         }
 
-        // Update the database record, if attached.
+        // Update the database record, if attached and out-of-date, and the
+        // rule's statistics.
         if (db) {
           std::string error;
-          bool result = db->setRuleResult(
-              ruleInfo->keyID, *ruleInfo->rule, ruleInfo->result, &error);
+          bool result = true;
+          if (resultNeedsPersisting(*ruleInfo, *taskInfo)) {
+            result = db->setRuleResult(
+                ruleInfo->keyID, *ruleInfo->rule, ruleInfo->result, &error);
+            if (result)
+              ruleInfo->persistedBuiltAt = ruleInfo->result.builtAt;
+          }
+          if (result)
+            result = recordRuleStatistics(*ruleInfo, *taskInfo, &error);
           if (!result) {
             delegate.error(error);
 
@@ -1026,9 +1519,7 @@ private:
         // Delete the pending task.
         {
           std::lock_guard<std::mutex> guard(taskInfosMutex);
-          auto it = taskInfos.find(taskInfo->task.get());
-          assert(it != taskInfos.end());
-          taskInfos.erase(it);
+          destroyTaskInfo(taskInfo);
         }
       }
 
@@ -1102,8 +1593,8 @@ private:
     // Gather all of the successor relationships.
     std::unordered_map<Rule*, std::vector<Rule*>> successorGraph;
     std::vector<const RuleScanRecord *> activeRuleScanRecords;
-    for (const auto& it: taskInfos) {
-      const TaskInfo& taskInfo = it.second;
+    for (const auto* it: taskInfos) {
+      const TaskInfo& taskInfo = *it;
       assert(taskInfo.forRuleInfo);
       std::vector<Rule*> successors;
       for (const auto& request: taskInfo.requestedBy) {
@@ -1122,13 +1613,12 @@ private:
     // NOTE: There is a very subtle condition around this versus adding the ones
     // accessible via the tasks, see https://bugs.swift.org/browse/SR-1948.
     // Unfortunately, we do not have a test case for this!
-    for (const auto& it: ruleInfos) {
-      const RuleInfo& ruleInfo = it.second;
+    ruleInfos.forEach([&](const RuleInfo& ruleInfo) {
       if (ruleInfo.isScanning()) {
         const auto* scanRecord = ruleInfo.getPendingScanRecord();
         activeRuleScanRecords.push_back(scanRecord);
       }
-    }
+    });
 
     // Gather dependencies from all of the active scan records.
     std::unordered_set<const RuleScanRecord*> visitedRuleScanRecords;
@@ -1344,7 +1834,7 @@ private:
 
     std::lock_guard<std::mutex> guard(taskInfosMutex);
 
-    for (auto& it: taskInfos) {
+    for (auto* taskInfo: taskInfos) {
       // Cancel the task, marking it incomplete.
       //
       // This will force it to rerun in a later build, but since it was already
@@ -1358,7 +1848,6 @@ private:
       // NOTE: Actually, we currently don't sync this write to the database, so
       // in some cases we do actually preserve this information (if the client
       // ends up cancelling, then reloading froom the database).
-      TaskInfo* taskInfo = &it.second;
       RuleInfo* ruleInfo = taskInfo->forRuleInfo;
       assert(taskInfo == ruleInfo->getPendingTaskInfo());
       ruleInfo->setPendingTaskInfo(nullptr);
@@ -1368,12 +1857,12 @@ private:
     // FIXME: This is currently an O(n) operation that could be relatively
     // expensive on larger projects.  We should be able to do something more
     // targeted. rdar://problem/39386591
-    for (auto& it: ruleInfos) {
+    ruleInfos.forEach([](RuleInfo& ruleInfo) {
       // Cancel outstanding activity on rules
-      if (it.second.isScanning()) {
-        it.second.setCancelled();
+      if (ruleInfo.isScanning()) {
+        ruleInfo.setCancelled();
       }
-    }
+    });
 
     // Delete all of the tasks.
     ruleInfosToScan.clear();
@@ -1381,7 +1870,7 @@ private:
     finishedInputRequests.clear();
     readyTaskInfos.clear();
     finishedTaskInfos.clear();
-    taskInfos.clear();
+    destroyAllTaskInfos();
   }
 
 public:
@@ -1393,12 +1882,71 @@ public:
     // Make sure that there aren't any currently running builds before
     // tearing down.
     std::lock_guard<std::mutex> lock(buildEngineMutex);
+
+    std::lock_guard<std::mutex> guard(taskInfosMutex);
+    destroyAllTaskInfos();
   }
 
   BuildEngineDelegate* getDelegate() {
     return &delegate;
   }
 
+  /// Get the context of the \see TaskInterface for a task.
+  void* getContextForTaskInfo(TaskInfo* taskInfo) {
+    std::lock_guard<std::mutex> guard(taskInfosMutex);
+    return reinterpret_cast<void*>(taskInfoAllocator.getHandle(taskInfo));
+  }
+
+  /// Get the task information from the context of a \see TaskInterface.
+  ///
+  /// \returns The task information, or null if the task no longer exists (for
+  /// example, when a job calls back after the build was cancelled), in which
+  /// case the callback should be ignored.
+  TaskInfo* getTaskInfoForContext(void* context) {
+    std::lock_guard<std::mutex> guard(taskInfosMutex);
+    return taskInfoAllocator.lookup(reinterpret_cast<uintptr_t>(context));
+  }
+
+  /// Add a job spawned by a task to the execution queue, with the critical
+  /// path estimate of its rule.
+  void spawnJob(TaskInfo* taskInfo, basic::QueueJob&& job,
+                basic::QueueJobPriority priority) {
+    taskInfo->hasStatistics = true;
+    if (job.getMemoryEstimate() == 0)
+      job.setMemoryEstimate(taskInfo->memoryEstimate);
+    if (!criticalPathEstimates.empty()) {
+      auto it = criticalPathEstimates.find(taskInfo->forRuleInfo->keyID);
+      if (it != criticalPathEstimates.end())
+        job.setCriticalPathEstimate(it->second);
+    }
+    getExecutionQueue().addJob(std::move(job), priority);
+  }
+
+  void taskReportedStatistics(TaskInfo* taskInfo, uint64_t peakRSS,
+                              uint64_t outputBytes) {
+    taskInfo->hasStatistics = true;
+    taskInfo->peakRSS = std::max(taskInfo->peakRSS, peakRSS);
+    taskInfo->outputBytes += outputBytes;
+  }
+
+  /// Update the stored execution statistics of a rule whose task finished.
+  ///
+  /// \returns True on success.
+  bool recordRuleStatistics(const RuleInfo& ruleInfo, const TaskInfo& taskInfo,
+                            std::string* error_out) {
+    if (!taskInfo.hasStatistics)
+      return true;
+
+    RuleStatistics statistics;
+    if (!db->lookupRuleStatistics(ruleInfo.keyID, &statistics, error_out) &&
+        !error_out->empty())
+      return false;
+    statistics.addRun(
+        std::max(0.0, ruleInfo.result.end - ruleInfo.result.start),
+        taskInfo.peakRSS, taskInfo.outputBytes);
+    return db->setRuleStatistics(ruleInfo.keyID, statistics, error_out);
+  }
+
   ExecutionQueue& getExecutionQueue() {
     return *executionQueue;
   }
@@ -1409,30 +1957,29 @@ public:
 
   // When changing the implementation of those, do also copy
   // the changes to CAPIBuildDB.
-  virtual const KeyID getKeyID(const KeyType& key) override {
-    std::lock_guard<std::mutex> guard(keyTableMutex);
-
-    // The RHS of the mapping is actually ignored, we use the StringMap's ptr
-    // identity because it allows us to efficiently map back to the key string
-    // in `getRuleInfoForKey`.
-    auto it = keyTable.insert(std::make_pair(key.str(), KeyID::novalue())).first;
-    return KeyID(it->getKey().data());
+  virtual const KeyID getKeyID(StringRef key) override {
+    return keyTable.getKeyID(key);
   }
 
   virtual KeyType getKeyForID(const KeyID key) override {
-    // Note that we don't need to lock `keyTable` here because the key entries
-    // themselves don't change once created.
-    return llvm::StringMapEntry<KeyID>::GetStringMapEntryFromKeyData(
-      (const char*)(uintptr_t)key).getKey();
+    return InternedKeyTable<RuleInfo*>::getKey(key);
   }
 
-  RuleInfo& getRuleInfoForKey(const KeyType& key) {
+  virtual void error(const Twine& message) override {
+    delegate.error(message);
+  }
+
+  /// Find the registered rule for a KeyID, if any.
+  RuleInfo* findRuleInfo(KeyID keyID) {
+    return InternedKeyTable<RuleInfo*>::getValue(keyID);
+  }
+
+  RuleInfo& getRuleInfoForKey(StringRef key) {
     auto keyID = getKeyID(key);
 
     // Check if we have already found the rule.
-    auto it = ruleInfos.find(keyID);
-    if (it != ruleInfos.end())
-      return it->second;
+    if (RuleInfo* ruleInfo = findRuleInfo(keyID))
+      return *ruleInfo;
 
     // Otherwise, request it from the delegate and add it.
     return addRule(keyID, delegate.lookupRule(key));
@@ -1440,21 +1987,14 @@ public:
 
   RuleInfo& getRuleInfoForKey(KeyID keyID) {
     // Check if we have already found the rule.
-    auto it = ruleInfos.find(keyID);
-    if (it != ruleInfos.end())
-      return it->second;
+    if (RuleInfo* ruleInfo = findRuleInfo(keyID))
+      return *ruleInfo;
 
     // Otherwise, we need to resolve the full key so we can request it from the
     // delegate.
     return addRule(keyID, delegate.lookupRule(getKeyForID(keyID)));
   }
 
-  TaskInfo* getTaskInfo(Task* task) {
-    std::lock_guard<std::mutex> guard(taskInfosMutex);
-    auto it = taskInfos.find(task);
-    return it == taskInfos.end() ? nullptr : &it->second;
-  }
-
   /// @name Rule Definition
   /// @{
 
@@ -1463,9 +2003,9 @@ public:
   }
 
   RuleInfo& addRule(KeyID keyID, std::unique_ptr<Rule>&& rule) {
-    auto result = ruleInfos.emplace(keyID, RuleInfo(keyID, std::move(rule)));
-    if (!result.second) {
-      RuleInfo& ruleInfo = result.first->second;
+    RuleInfo*& entry = InternedKeyTable<RuleInfo*>::getValue(keyID);
+    if (entry) {
+      RuleInfo& ruleInfo = *entry;
       delegate.error("attempt to register duplicate rule \"" + ruleInfo.rule->key.str() + "\"\n");
 
       // Set cancelled, but return something 'valid' for use until it is
@@ -1479,10 +2019,12 @@ public:
     // FIXME: Investigate retrieving this result lazily. If the DB is
     // particularly efficient, it may be best to retrieve this only when we need
     // it and never duplicate it.
-    RuleInfo& ruleInfo = result.first->second;
+    RuleInfo& ruleInfo = ruleInfos.emplace_back(keyID, std::move(rule));
+    entry = &ruleInfo;
     if (db) {
       std::string error;
       db->lookupRuleResult(ruleInfo.keyID, *ruleInfo.rule, &ruleInfo.result, &error);
+      ruleInfo.persistedBuiltAt = ruleInfo.result.builtAt;
       if (!error.empty()) {
         // FIXME: Investigate changing the database error handling model to
         // allow builds to proceed without the database.
@@ -1550,6 +2092,10 @@ public:
       executionQueue.reset();
     };
 
+    computeCriticalPathEstimates();
+    useMemoryEstimates = db && executionQueue &&
+      executionQueue->usesMemoryEstimates();
+
     // Increment our running iteration count.
     //
     // At this point, we should conceptually mark each complete rule as
@@ -1564,7 +2110,7 @@ public:
       auto trace = llvm::make_unique<BuildEngineTrace>();
 
       std::string error;
-      if (!trace->open(traceFile, &error))
+      if (!trace->open(traceFile, traceFormat, &error))
         delegate.error(error);
 
       this->trace = std::move(trace);
@@ -1594,6 +2140,12 @@ public:
       ruleScanRecordBlocks.clear();
     };
 
+    llbuild_defer {
+      // Wait for any speculative validity checks which were never used.
+      if (scanPool)
+        scanPool->waitForAll();
+    };
+
     // Run the build engine, to process any necessary tasks.
     bool success = executeTasks(key);
 
@@ -1684,11 +2236,22 @@ public:
     return success;
   }
 
-  bool enableTracing(const std::string& filename, std::string* error_out) {
+  bool enableTracing(const std::string& filename,
+                     BuildEngineTraceFormat format, std::string* error_out) {
     traceFile = filename;
+    traceFormat = format;
     return true;
   }
 
+  void enableParallelScanning(unsigned numThreads) {
+    assert(!buildRunning && "invalid enableParallelScanning() call");
+    if (numThreads == 0) {
+      scanPool.reset();
+    } else {
+      scanPool = llvm::make_unique<basic::WorkStealingPool>(numThreads);
+    }
+  }
+
   /// Dump the build state to a file in Graphviz DOT format.
   void dumpGraphToFile(const std::string& path) {
     FILE* fp = ::fopen(path.c_str(), "w");
@@ -1706,8 +2269,9 @@ public:
 
     // Create a canonical node ordering.
     std::vector<const RuleInfo*> orderedRuleInfos;
-    for (const auto& entry: ruleInfos)
-      orderedRuleInfos.push_back(&entry.second);
+    ruleInfos.forEach([&](const RuleInfo& ruleInfo) {
+      orderedRuleInfos.push_back(&ruleInfo);
+    });
     std::sort(orderedRuleInfos.begin(), orderedRuleInfos.end(),
               [] (const RuleInfo* a, const RuleInfo* b) {
         return a->rule->key < b->rule->key;
@@ -1729,8 +2293,7 @@ public:
     fclose(fp);
   }
 
-  void addTaskInputRequest(Task* task, const KeyType& key, uintptr_t inputID, bool orderOnly, bool singleUse) {
-    auto taskInfo = getTaskInfo(task);
+  void addTaskInputRequest(TaskInfo* taskInfo, StringRef key, uintptr_t inputID, bool orderOnly, bool singleUse) {
 
     // Validate that the task is in a valid state to request inputs.
     if (!taskInfo->forRuleInfo->isInProgressWaiting()) {
@@ -1751,7 +2314,7 @@ public:
   /// @name Task Management Client APIs
   /// @{
 
-  void taskNeedsInput(Task* task, const KeyType& key, uintptr_t inputID) {
+  void taskNeedsInput(TaskInfo* taskInfo, StringRef key, uintptr_t inputID) {
     // Validate the InputID.
     if (inputID > BuildEngine::kMaximumInputID) {
       delegate.error("attempt to use reserved input ID");
@@ -1759,10 +2322,10 @@ public:
       return;
     }
 
-    addTaskInputRequest(task, key, inputID, false, false);
+    addTaskInputRequest(taskInfo, key, inputID, false, false);
   }
   
-  void taskNeedsSingleUseInput(Task* task, const KeyType& key, uintptr_t inputID) {
+  void taskNeedsSingleUseInput(TaskInfo* taskInfo, StringRef key, uintptr_t inputID) {
     // Validate the InputID.
     if (inputID > BuildEngine::kMaximumInputID) {
       delegate.error("attempt to use reserved input ID");
@@ -1770,18 +2333,16 @@ public:
       return;
     }
 
-    addTaskInputRequest(task, key, inputID, false, true);
+    addTaskInputRequest(taskInfo, key, inputID, false, true);
   }
 
-  void taskMustFollow(Task* task, const KeyType& key) {
+  void taskMustFollow(TaskInfo* taskInfo, StringRef key) {
     // The inputID is not used when taskMustFollow is used.
     // (The user-supplied provideValue() is not called).
-    addTaskInputRequest(task, key, kMustFollowInputID, true, false);
+    addTaskInputRequest(taskInfo, key, kMustFollowInputID, true, false);
   }
 
-  void taskDiscoveredDependency(Task* task, const KeyType& key) {
-    // Find the task info.
-    auto taskInfo = getTaskInfo(task);
+  void taskDiscoveredDependency(TaskInfo* taskInfo, StringRef key) {
     assert(taskInfo && "cannot request inputs for an unknown task");
 
     if (!taskInfo->forRuleInfo->isInProgressComputing()) {
@@ -1794,11 +2355,10 @@ public:
     taskInfo->discoveredDependencies.push_back(dependencyID, false, false);
   }
 
-  void taskIsComplete(Task* task, ValueType&& value, bool forceChange) {
+  void taskIsComplete(TaskInfo* taskInfo, ValueType&& value, bool forceChange) {
     // FIXME: We should flag the task to ensure this is only called once, and
     // that no other API calls are made once complete.
 
-    auto taskInfo = getTaskInfo(task);
     assert(taskInfo && "cannot request inputs for an unknown task");
 
     if (!taskInfo->forRuleInfo->isInProgressComputing()) {
@@ -1807,6 +2367,10 @@ public:
       return;
     }
 
+    // Invalidate any speculative validity checks which may have missed the
+    // work done by the task.
+    ++numCompletedTasks;
+
     RuleInfo* ruleInfo = taskInfo->forRuleInfo;
     assert(taskInfo == ruleInfo->getPendingTaskInfo());
 
@@ -1859,35 +2423,47 @@ BuildEngineDelegate* TaskInterface::delegate() {
   return static_cast<BuildEngineImpl*>(impl)->getDelegate();
 }
 
-void TaskInterface::request(const KeyType& key, uintptr_t inputID) {
-  Task* task = static_cast<Task*>(ctx);
-  static_cast<BuildEngineImpl*>(impl)->taskNeedsInput(task, key, inputID);
+void TaskInterface::request(StringRef key, uintptr_t inputID) {
+  auto engine = static_cast<BuildEngineImpl*>(impl);
+  if (auto taskInfo = engine->getTaskInfoForContext(ctx))
+    engine->taskNeedsInput(taskInfo, key, inputID);
 }
 
-void TaskInterface::requestSingleUse(const KeyType &key, uintptr_t inputID) {
-  Task* task = static_cast<Task*>(ctx);
-  static_cast<BuildEngineImpl*>(impl)->taskNeedsSingleUseInput(task, key, inputID);
+void TaskInterface::requestSingleUse(StringRef key, uintptr_t inputID) {
+  auto engine = static_cast<BuildEngineImpl*>(impl);
+  if (auto taskInfo = engine->getTaskInfoForContext(ctx))
+    engine->taskNeedsSingleUseInput(taskInfo, key, inputID);
 }
 
-void TaskInterface::mustFollow(const KeyType& key) {
-  Task* task = static_cast<Task*>(ctx);
-  static_cast<BuildEngineImpl*>(impl)->taskMustFollow(task, key);
+void TaskInterface::mustFollow(StringRef key) {
+  auto engine = static_cast<BuildEngineImpl*>(impl);
+  if (auto taskInfo = engine->getTaskInfoForContext(ctx))
+    engine->taskMustFollow(taskInfo, key);
 }
 
-void TaskInterface::discoveredDependency(const KeyType& key) {
-  Task* task = static_cast<Task*>(ctx);
-  static_cast<BuildEngineImpl*>(impl)->taskDiscoveredDependency(task, key);
+void TaskInterface::discoveredDependency(StringRef key) {
+  auto engine = static_cast<BuildEngineImpl*>(impl);
+  if (auto taskInfo = engine->getTaskInfoForContext(ctx))
+    engine->taskDiscoveredDependency(taskInfo, key);
+}
+
+void TaskInterface::reportStatistics(uint64_t peakRSS, uint64_t outputBytes) {
+  auto engine = static_cast<BuildEngineImpl*>(impl);
+  if (auto taskInfo = engine->getTaskInfoForContext(ctx))
+    engine->taskReportedStatistics(taskInfo, peakRSS, outputBytes);
 }
 
 void TaskInterface::complete(ValueType &&value, bool forceChange) {
-  Task* task = static_cast<Task*>(ctx);
-  static_cast<BuildEngineImpl*>(impl)->taskIsComplete(task, std::move(value),
-                                                      forceChange);
+  auto engine = static_cast<BuildEngineImpl*>(impl);
+  if (auto taskInfo = engine->getTaskInfoForContext(ctx))
+    engine->taskIsComplete(taskInfo, std::move(value), forceChange);
 }
 
 void TaskInterface::spawn(basic::QueueJob&& job, basic::QueueJobPriority priority) {
   // FIXME: handle environment
-  static_cast<BuildEngineImpl*>(impl)->getExecutionQueue().addJob(std::move(job), priority);
+  auto engine = static_cast<BuildEngineImpl*>(impl);
+  if (auto taskInfo = engine->getTaskInfoForContext(ctx))
+    engine->spawnJob(taskInfo, std::move(job), priority);
 }
 
 void TaskInterface::spawn(basic::QueueJobContext *context,
@@ -1964,5 +2540,17 @@ bool BuildEngine::attachDB(std::unique_ptr<BuildDB> database, std::string* error
 
 bool BuildEngine::enableTracing(const std::string& path,
                                 std::string* error_out) {
-  return static_cast<BuildEngineImpl*>(impl)->enableTracing(path, error_out);
+  return static_cast<BuildEngineImpl*>(impl)->enableTracing(
+      path, BuildEngineTraceFormat::JSON, error_out);
+}
+
+bool BuildEngine::enableTracing(const std::string& path,
+                                BuildEngineTraceFormat format,
+                                std::string* error_out) {
+  return static_cast<BuildEngineImpl*>(impl)->enableTracing(path, format,
+                                                            error_out);
+}
+
+void BuildEngine::enableParallelScanning(unsigned numThreads) {
+  static_cast<BuildEngineImpl*>(impl)->enableParallelScanning(numThreads);
 }
@@ -14,47 +14,350 @@
 
 #include "llbuild/Core/BuildEngine.h"
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <errno.h>
 
 using namespace llbuild;
 using namespace llbuild::core;
 
+/// The kinds of trace events.
+///
+/// The values are part of the binary trace format, so new kinds must only be
+/// added at the end.
+enum class BuildEngineTrace::EventKind : uint8_t {
+  NewTask,
+  NewRule,
+  BuildStarted,
+  HandlingBuildInputRequest,
+  CreatedTaskForRule,
+  HandlingTaskInputRequest,
+  PausedInputRequestForRuleScan,
+  ReadyingTaskInputRequest,
+  AddedRulePendingTask,
+  CompletedTaskInputRequest,
+  UpdatedTaskWaitCount,
+  UnblockedTask,
+  ReadiedTask,
+  FinishedTask,
+  BuildEnded,
+  CheckingRuleNeedsToRun,
+  RuleScheduledForScanning,
+  RuleScanningNextInput,
+  RuleScanningDeferredOnInput,
+  RuleScanningDeferredOnTask,
+  RuleNeedsToRunBecauseNeverBuilt,
+  RuleNeedsToRunBecauseSignatureChanged,
+  RuleNeedsToRunBecauseInvalidValue,
+  RuleNeedsToRunBecauseInputMissing,
+  RuleNeedsToRunBecauseInputRebuilt,
+  RuleDoesNotNeedToRun,
+  CycleForceRuleNeedsToRun,
+  CycleSupplyPriorValue,
+};
+
+namespace {
+
+typedef BuildEngineTrace::EventKind EventKind;
+
+/// The description of an event kind.
+struct EventInfo {
+  /// The name of the event in the JSON format.
+  const char* name;
+
+  /// The operands of the event, one character per operand: 'T' for a task
+  /// number, 'R' for a rule number, 'N' for a count, and 'C' for a changed
+  /// flag. A \see EventKind::NewRule event is also followed by its key.
+  const char* operands;
+
+  /// An additional string to report following the first operand, if any.
+  const char* reason;
+};
+
+const EventInfo eventInfos[] = {
+  { "new-task", "T", nullptr },
+  { "new-rule", "R", nullptr },
+  { "build-started", "", nullptr },
+  { "handling-build-input-request", "R", nullptr },
+  { "created-task-for-rule", "TR", nullptr },
+  { "handling-task-input-request", "TR", nullptr },
+  { "paused-input-request-for-rule-scan", "R", nullptr },
+  { "readying-task-input-request", "TR", nullptr },
+  { "added-rule-pending-task", "RT", nullptr },
+  { "completed-task-input-request", "TR", nullptr },
+  { "updated-task-wait-count", "TN", nullptr },
+  { "unblocked-task", "T", nullptr },
+  { "readied-task", "TR", nullptr },
+  { "finished-task", "TRC", nullptr },
+  { "build-ended", "", nullptr },
+  { "checking-rule-needs-to-run", "R", nullptr },
+  { "rule-scheduled-for-scanning", "R", nullptr },
+  { "rule-scanning-next-input", "RR", nullptr },
+  { "rule-scanning-deferred-on-input", "RR", nullptr },
+  { "rule-scanning-deferred-on-task", "RT", nullptr },
+  { "rule-needs-to-run", "R", "never-built" },
+  { "rule-needs-to-run", "R", "signature-changed" },
+  { "rule-needs-to-run", "R", "invalid-value" },
+  { "rule-needs-to-run", "R", "input-missing" },
+  { "rule-needs-to-run", "RR", "input-rebuilt" },
+  { "rule-does-not-need-to-run", "R", nullptr },
+  { "cycle-force-rule-needs-to-run", "R", nullptr },
+  { "cycle-supply-prior-value", "RT", nullptr },
+};
+
+const unsigned numEventKinds = sizeof(eventInfos) / sizeof(eventInfos[0]);
+static_assert(numEventKinds == unsigned(EventKind::CycleSupplyPriorValue) + 1,
+              "missing event descriptions");
+
+/// The magic bytes which begin a binary trace, followed by the format version.
+const char binaryTraceMagic[] = { 'l', 'l', 'b', 't', 'r', 'a', 'c', 'e' };
+const uint64_t binaryTraceVersion = 1;
+
+/// Get a printable form of a rule key.
+//
+// FIXME: This is currently encoding the key by merely stripping the
+// non-printable characters. Should probably encode this into a real encoding.
+std::string getPrintableKey(StringRef key) {
+  std::string encoded = key.str();
+  encoded.erase(
+                std::remove_if(encoded.begin(), encoded.end(),
+                               [](char c) -> bool {
+                                 return c < 32 || c > 127; }),
+                encoded.end());
+  return encoded;
+}
+
+/// Write an event in the JSON trace format.
+void writeJSONEvent(raw_ostream& os, EventKind kind, const uint64_t* operands,
+                    StringRef ruleKey) {
+  const auto& info = eventInfos[unsigned(kind)];
+  os << "{ \"" << info.name << "\"";
+  for (unsigned i = 0; info.operands[i] != '\0'; ++i) {
+    os << ", ";
+    switch (info.operands[i]) {
+    case 'T':
+      os << "\"T" << operands[i] << "\"";
+      break;
+    case 'R':
+      os << "\"R" << operands[i] << "\"";
+      break;
+    case 'N':
+      os << operands[i];
+      break;
+    case 'C':
+      os << (operands[i] ? "\"changed\"" : "\"unchanged\"");
+      break;
+    }
+    if (i == 0 && info.reason)
+      os << ", \"" << info.reason << "\"";
+  }
+  if (kind == EventKind::NewRule)
+    os << ", \"" << getPrintableKey(ruleKey) << "\"";
+  os << " },\n";
+}
+
+}
+
+#pragma mark - Binary Trace Writer
+
+/// Writes the binary trace format.
+///
+/// Each event is recorded as its kind, the time since the previous event (in
+/// microseconds) and its operands, all as variable length integers. Records
+/// are appended to a fixed ring of blocks, which are written out by a
+/// background thread as they fill, so recording an event never waits on the
+/// file system unless the writer falls a full ring behind.
+class BuildEngineTrace::BinaryWriter {
+  static const size_t blockSize = 256 * 1024;
+  static const unsigned numBlocks = 4;
+
+  FILE* fp;
+
+  std::unique_ptr<uint8_t[]> storage;
+
+  /// The block being filled, which is owned by the recording thread.
+  uint8_t* block;
+  size_t blockPos = 0;
+
+  /// The time the trace was opened, and the timestamp of the last event.
+  std::chrono::steady_clock::time_point startTime;
+  uint64_t lastTimestamp = 0;
+
+  std::mutex mutex;
+  std::condition_variable blockFilled;
+  std::condition_variable blockFreed;
+
+  /// The blocks waiting to be written, and their sizes.
+  std::deque<std::pair<uint8_t*, size_t>> filledBlocks;
+  std::vector<uint8_t*> freeBlocks;
+  bool closing = false;
+  bool writeFailed = false;
+
+  std::thread writerThread;
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      blockFilled.wait(lock, [&] { return closing || !filledBlocks.empty(); });
+      if (filledBlocks.empty())
+        return;
+
+      auto entry = filledBlocks.front();
+      filledBlocks.pop_front();
+      lock.unlock();
+      bool success = fwrite(entry.first, 1, entry.second, fp) == entry.second;
+      lock.lock();
+      if (!success)
+        writeFailed = true;
+      freeBlocks.push_back(entry.first);
+      blockFreed.notify_one();
+    }
+  }
+
+  /// Hand the current block to the writer, and start filling a free one.
+  void flushBlock() {
+    std::unique_lock<std::mutex> lock(mutex);
+    filledBlocks.emplace_back(block, blockPos);
+    blockFilled.notify_one();
+    blockFreed.wait(lock, [&] { return !freeBlocks.empty(); });
+    block = freeBlocks.back();
+    freeBlocks.pop_back();
+    blockPos = 0;
+  }
+
+public:
+  explicit BinaryWriter(FILE* fp)
+      : fp(fp), storage(new uint8_t[blockSize * numBlocks]),
+        block(storage.get()), startTime(std::chrono::steady_clock::now())
+  {
+    for (unsigned i = 1; i != numBlocks; ++i)
+      freeBlocks.push_back(storage.get() + i * blockSize);
+    writerThread = std::thread(&BinaryWriter::run, this);
+
+    writeBytes(StringRef(binaryTraceMagic, sizeof(binaryTraceMagic)));
+    writeVarint(binaryTraceVersion);
+  }
+
+  ~BinaryWriter() {
+    if (writerThread.joinable()) {
+      std::string error;
+      close(&error);
+    }
+  }
+
+  void writeByte(uint8_t value) {
+    if (blockPos == blockSize)
+      flushBlock();
+    block[blockPos++] = value;
+  }
+
+  void writeVarint(uint64_t value) {
+    while (value >= 0x80) {
+      writeByte(uint8_t(value) | 0x80);
+      value >>= 7;
+    }
+    writeByte(uint8_t(value));
+  }
+
+  void writeBytes(StringRef bytes) {
+    for (char c: bytes)
+      writeByte(uint8_t(c));
+  }
+
+  /// Write the time since the previous event.
+  void writeTimestamp() {
+    uint64_t timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+    writeVarint(timestamp - lastTimestamp);
+    lastTimestamp = timestamp;
+  }
+
+  bool close(std::string* error_out) {
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      filledBlocks.emplace_back(block, blockPos);
+      closing = true;
+    }
+    blockFilled.notify_one();
+    writerThread.join();
+
+    bool success = !writeFailed;
+    if (fclose(fp) != 0)
+      success = false;
+    if (!success) {
+      *error_out = "unable to write trace file";
+      return false;
+    }
+    return true;
+  }
+};
+
 BuildEngineTrace::BuildEngineTrace() {}
 
 BuildEngineTrace::~BuildEngineTrace() {}
 
 bool BuildEngineTrace::open(const std::string& filename,
+                            BuildEngineTraceFormat format,
                             std::string* error_out) {
   assert(!isOpen());
 
-  FILE *fp = fopen(filename.c_str(), "wb");
-  if (!fp) {
-    *error_out = "unable to open '" + filename + "' (" +
-      ::strerror(errno) + ")";
+  if (format == BuildEngineTraceFormat::Binary) {
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (!fp) {
+      *error_out = "unable to open '" + filename + "' (" +
+        ::strerror(errno) + ")";
+      return false;
+    }
+    binaryWriter.reset(new BinaryWriter(fp));
+    assert(isOpen());
+    return true;
+  }
+
+  std::error_code ec;
+  jsonOS = llvm::make_unique<llvm::raw_fd_ostream>(filename, ec,
+                                                   llvm::sys::fs::F_None);
+  if (ec) {
+    jsonOS.reset();
+    *error_out = "unable to open '" + filename + "' (" + ec.message() + ")";
     return false;
   }
-  outputPtr = fp;
   assert(isOpen());
 
   // Write the opening header.
-  fprintf(fp, "[\n");
+  *jsonOS << "[\n";
   return true;
 }
 
 bool BuildEngineTrace::close(std::string* error_out) {
   assert(isOpen());
 
-  FILE *fp = static_cast<FILE*>(outputPtr);
+  if (binaryWriter) {
+    bool success = binaryWriter->close(error_out);
+    binaryWriter.reset();
+    assert(!isOpen());
+    return success;
+  }
 
   // Write the footer.
-  fprintf(fp, "]\n");
+  *jsonOS << "]\n";
 
-  bool success = fclose(fp) == 0;
-  outputPtr = nullptr;
+  jsonOS->close();
+  bool success = !jsonOS->has_error();
+  jsonOS->clear_error();
+  jsonOS.reset();
   assert(!isOpen());
 
   if (!success) {
@@ -65,251 +368,426 @@ bool BuildEngineTrace::close(std::string* error_out) {
   return true;
 }
 
-#pragma mark - Tracing APIs
-
-const char* BuildEngineTrace::getTaskName(const Task* task) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  // See if we have already assigned a name.
-  auto it = taskNames.find(task);
-  if (it != taskNames.end())
-    return it->second.c_str();
+void BuildEngineTrace::record(EventKind kind, uint64_t a, uint64_t b,
+                              uint64_t c, StringRef ruleKey) {
+  const uint64_t operands[] = { a, b, c };
 
-  // Otherwise, create a name.
-  char name[64];
-  snprintf(name, sizeof(name), "T%d", ++numNamedTasks);
-  auto result = taskNames.emplace(task, name);
-
-  // Report the newly seen rule.
-  fprintf(fp, "{ \"new-task\", \"%s\" },\n", name);
+  if (jsonOS) {
+    writeJSONEvent(*jsonOS, kind, operands, ruleKey);
+    return;
+  }
 
-  return result.first->second.c_str();
+  binaryWriter->writeVarint(uint64_t(kind));
+  binaryWriter->writeTimestamp();
+  const char* operandKinds = eventInfos[unsigned(kind)].operands;
+  for (unsigned i = 0; operandKinds[i] != '\0'; ++i)
+    binaryWriter->writeVarint(operands[i]);
+  if (kind == EventKind::NewRule) {
+    binaryWriter->writeVarint(ruleKey.size());
+    binaryWriter->writeBytes(ruleKey);
+  }
 }
 
-const char* BuildEngineTrace::getRuleName(const Rule* rule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
+#pragma mark - Tracing APIs
 
+unsigned BuildEngineTrace::getTaskID(const Task* task) {
   // See if we have already assigned a name.
-  auto it = ruleNames.find(rule);
-  if (it != ruleNames.end())
-    return it->second.c_str();
-
-  // Otherwise, create a name.
-  char name[64];
-  snprintf(name, sizeof(name), "R%d", ++numNamedRules);
-  auto result = ruleNames.emplace(rule, name);
-
-  // Report the newly seen rule.
-  // FIXME: This is currently encoding the key by merely stripping the
-  // non-printable characters. Should probably encode this into a real encoding.
-  std::string encoded = rule->key.str();
-  encoded.erase(
-                std::remove_if(encoded.begin(), encoded.end(),
-                               [](char c) -> bool {
-                                 return c < 32 || c > 127; }),
-                encoded.end());
-  fprintf(fp, "{ \"new-rule\", \"%s\", \"%s\" },\n", name, encoded.c_str());
+  auto it = taskIDs.find(task);
+  if (it != taskIDs.end())
+    return it->second;
+
+  // Otherwise, create a name, and report the newly seen task.
+  unsigned id = ++numNamedTasks;
+  taskIDs.insert({task, id});
+  record(EventKind::NewTask, id);
+  return id;
+}
 
-  return result.first->second.c_str();
+unsigned BuildEngineTrace::getRuleID(const Rule* rule) {
+  // See if we have already assigned a name.
+  auto it = ruleIDs.find(rule);
+  if (it != ruleIDs.end())
+    return it->second;
+
+  // Otherwise, create a name, and report the newly seen rule.
+  unsigned id = ++numNamedRules;
+  ruleIDs.insert({rule, id});
+  record(EventKind::NewRule, id, 0, 0, rule->key);
+  return id;
 }
 
 void BuildEngineTrace::buildStarted() {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"build-started\" },\n");
+  record(EventKind::BuildStarted);
 }
 
 void BuildEngineTrace::handlingBuildInputRequest(const Rule* rule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"handling-build-input-request\", \"%s\" },\n",
-          getRuleName(rule));
+  record(EventKind::HandlingBuildInputRequest, getRuleID(rule));
 }
 
 void BuildEngineTrace::createdTaskForRule(const Task* task,
                                           const Rule* rule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"created-task-for-rule\", \"%s\", \"%s\" },\n",
-          getTaskName(task), getRuleName(rule));
+  auto taskID = getTaskID(task);
+  record(EventKind::CreatedTaskForRule, taskID, getRuleID(rule));
 }
 
 void BuildEngineTrace::handlingTaskInputRequest(const Task* task,
                                                 const Rule* rule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"handling-task-input-request\", \"%s\", \"%s\" },\n",
-          getTaskName(task), getRuleName(rule));
+  auto taskID = getTaskID(task);
+  record(EventKind::HandlingTaskInputRequest, taskID, getRuleID(rule));
 }
 
 void BuildEngineTrace::pausedInputRequestForRuleScan(const Rule* rule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"paused-input-request-for-rule-scan\", \"%s\" },\n",
-          getRuleName(rule));
+  record(EventKind::PausedInputRequestForRuleScan, getRuleID(rule));
 }
 
 void BuildEngineTrace::readyingTaskInputRequest(const Task* task,
                                                 const Rule* rule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"readying-task-input-request\", \"%s\", \"%s\" },\n",
-          getTaskName(task), getRuleName(rule));
+  auto taskID = getTaskID(task);
+  record(EventKind::ReadyingTaskInputRequest, taskID, getRuleID(rule));
 }
 
 void BuildEngineTrace::addedRulePendingTask(const Rule* rule,
                                             const Task* task) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"added-rule-pending-task\", \"%s\", \"%s\" },\n",
-          getRuleName(rule), getTaskName(task));
+  auto ruleID = getRuleID(rule);
+  record(EventKind::AddedRulePendingTask, ruleID, getTaskID(task));
 }
 
 void BuildEngineTrace::completedTaskInputRequest(const Task* task,
                                                  const Rule* rule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"completed-task-input-request\", \"%s\", \"%s\" },\n",
-          getTaskName(task), getRuleName(rule));
+  auto taskID = getTaskID(task);
+  record(EventKind::CompletedTaskInputRequest, taskID, getRuleID(rule));
 }
 
 void BuildEngineTrace::updatedTaskWaitCount(const Task* task,
                                             unsigned waitCount) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"updated-task-wait-count\", \"%s\", %d },\n",
-          getTaskName(task), waitCount);
+  record(EventKind::UpdatedTaskWaitCount, getTaskID(task), waitCount);
 }
 
 void BuildEngineTrace::unblockedTask(const Task* task) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"unblocked-task\", \"%s\" },\n", getTaskName(task));
+  record(EventKind::UnblockedTask, getTaskID(task));
 }
 
 void BuildEngineTrace::readiedTask(const Task* task, const Rule* rule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"readied-task\", \"%s\", \"%s\" },\n",
-          getTaskName(task), getRuleName(rule));
+  auto taskID = getTaskID(task);
+  record(EventKind::ReadiedTask, taskID, getRuleID(rule));
 }
 
 void BuildEngineTrace::finishedTask(const Task* task, const Rule* rule,
                                     bool wasChanged) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"finished-task\", \"%s\", \"%s\", \"%s\" },\n",
-          getTaskName(task), getRuleName(rule),
-          wasChanged ? "changed" : "unchanged");
+  auto taskID = getTaskID(task);
+  record(EventKind::FinishedTask, taskID, getRuleID(rule), wasChanged);
 
   // Delete the task entry, as it could be reused.
-  taskNames.erase(taskNames.find(task));
+  taskIDs.erase(task);
 }
 
 void BuildEngineTrace::buildEnded() {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"build-ended\" },\n");
+  record(EventKind::BuildEnded);
 }
 
 #pragma mark - Dependency Scanning Tracing APIs
 
 void BuildEngineTrace::checkingRuleNeedsToRun(const Rule* forRule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"checking-rule-needs-to-run\", \"%s\" },\n",
-          getRuleName(forRule));
+  record(EventKind::CheckingRuleNeedsToRun, getRuleID(forRule));
 }
 
 void BuildEngineTrace::ruleScheduledForScanning(const Rule* forRule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, ("{ \"rule-scheduled-for-scanning\", \"%s\"},\n"),
-          getRuleName(forRule));
+  record(EventKind::RuleScheduledForScanning, getRuleID(forRule));
 }
 
 void BuildEngineTrace::ruleScanningNextInput(const Rule* forRule,
                                              const Rule* inputRule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, ("{ \"rule-scanning-next-input\", \"%s\", \"%s\" },\n"),
-          getRuleName(forRule), getRuleName(inputRule));
+  auto ruleID = getRuleID(forRule);
+  record(EventKind::RuleScanningNextInput, ruleID, getRuleID(inputRule));
 }
 
 void
 BuildEngineTrace::ruleScanningDeferredOnInput(const Rule* forRule,
                                               const Rule* inputRule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, ("{ \"rule-scanning-deferred-on-input\", \"%s\", \"%s\" },\n"),
-          getRuleName(forRule), getRuleName(inputRule));
+  auto ruleID = getRuleID(forRule);
+  record(EventKind::RuleScanningDeferredOnInput, ruleID,
+         getRuleID(inputRule));
 }
 
 void
 BuildEngineTrace::ruleScanningDeferredOnTask(const Rule* forRule,
                                              const Task* inputTask) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, ("{ \"rule-scanning-deferred-on-task\", \"%s\", \"%s\" },\n"),
-          getRuleName(forRule), getTaskName(inputTask));
+  auto ruleID = getRuleID(forRule);
+  record(EventKind::RuleScanningDeferredOnTask, ruleID, getTaskID(inputTask));
 }
 
 void BuildEngineTrace::ruleNeedsToRunBecauseNeverBuilt(const Rule* forRule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"rule-needs-to-run\", \"%s\", \"never-built\" },\n",
-          getRuleName(forRule));
+  record(EventKind::RuleNeedsToRunBecauseNeverBuilt, getRuleID(forRule));
 }
 
 void BuildEngineTrace::ruleNeedsToRunBecauseSignatureChanged(const Rule* forRule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"rule-needs-to-run\", \"%s\", \"signature-changed\" },\n",
-          getRuleName(forRule));
+  record(EventKind::RuleNeedsToRunBecauseSignatureChanged,
+         getRuleID(forRule));
 }
 
 void BuildEngineTrace::ruleNeedsToRunBecauseInvalidValue(const Rule* forRule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"rule-needs-to-run\", \"%s\", \"invalid-value\" },\n",
-          getRuleName(forRule));
+  record(EventKind::RuleNeedsToRunBecauseInvalidValue, getRuleID(forRule));
 }
 
 void
 BuildEngineTrace::ruleNeedsToRunBecauseInputMissing(const Rule* forRule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"rule-needs-to-run\", \"%s\", \"input-missing\" },\n",
-          getRuleName(forRule));
+  record(EventKind::RuleNeedsToRunBecauseInputMissing, getRuleID(forRule));
 }
 
 void
 BuildEngineTrace::ruleNeedsToRunBecauseInputRebuilt(const Rule* forRule,
                                                     const Rule* inputRule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, ("{ \"rule-needs-to-run\", \"%s\", "
-               "\"input-rebuilt\", \"%s\" },\n"),
-          getRuleName(forRule), getRuleName(inputRule));
+  auto ruleID = getRuleID(forRule);
+  record(EventKind::RuleNeedsToRunBecauseInputRebuilt, ruleID,
+         getRuleID(inputRule));
 }
 
 void BuildEngineTrace::ruleDoesNotNeedToRun(const Rule* forRule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"rule-does-not-need-to-run\", \"%s\" },\n",
-          getRuleName(forRule));
+  record(EventKind::RuleDoesNotNeedToRun, getRuleID(forRule));
 }
 
 void BuildEngineTrace::cycleForceRuleNeedsToRun(const Rule* forRule) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
-
-  fprintf(fp, "{ \"cycle-force-rule-needs-to-run\", \"%s\" },\n",
-          getRuleName(forRule));
+  record(EventKind::CycleForceRuleNeedsToRun, getRuleID(forRule));
 }
 
 void BuildEngineTrace::cycleSupplyPriorValue(const Rule* forRule, const Task* toTask) {
-  FILE *fp = static_cast<FILE*>(outputPtr);
+  auto ruleID = getRuleID(forRule);
+  record(EventKind::CycleSupplyPriorValue, ruleID, getTaskID(toTask));
+}
+
+#pragma mark - Binary Trace Conversion
+
+bool core::parseBuildEngineTraceFormat(StringRef name,
+                                       BuildEngineTraceFormat* format_out) {
+  if (name == "json") {
+    *format_out = BuildEngineTraceFormat::JSON;
+    return true;
+  }
+  if (name == "binary") {
+    *format_out = BuildEngineTraceFormat::Binary;
+    return true;
+  }
+  return false;
+}
+
+namespace {
+
+/// Reads the events of a binary trace.
+class BinaryTraceReader {
+  const uint8_t* pos;
+  const uint8_t* end;
+
+  uint64_t timestamp = 0;
+
+  bool readVarint(uint64_t& value_out) {
+    value_out = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      if (pos == end)
+        return false;
+      uint8_t byte = *pos++;
+      value_out |= uint64_t(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+public:
+  explicit BinaryTraceReader(StringRef data)
+      : pos(reinterpret_cast<const uint8_t*>(data.begin())),
+        end(reinterpret_cast<const uint8_t*>(data.end())) {}
+
+  /// Read the trace header.
+  bool readHeader(std::string* error_out) {
+    uint64_t version;
+    if (size_t(end - pos) < sizeof(binaryTraceMagic) ||
+        memcmp(pos, binaryTraceMagic, sizeof(binaryTraceMagic)) != 0) {
+      *error_out = "not a binary trace file";
+      return false;
+    }
+    pos += sizeof(binaryTraceMagic);
+    if (!readVarint(version) || version != binaryTraceVersion) {
+      *error_out = "unsupported binary trace version";
+      return false;
+    }
+    return true;
+  }
+
+  bool isAtEnd() const { return pos == end; }
+
+  /// Read the next event.
+  ///
+  /// \param timestamp_out The time of the event, in microseconds since the
+  /// trace was started.
+  bool readEvent(EventKind& kind_out, uint64_t& timestamp_out,
+                 uint64_t* operands_out, StringRef& ruleKey_out,
+                 std::string* error_out) {
+    uint64_t kind, delta;
+    if (!readVarint(kind) || !readVarint(delta)) {
+      *error_out = "truncated binary trace";
+      return false;
+    }
+    if (kind >= numEventKinds) {
+      *error_out = "invalid event kind in binary trace";
+      return false;
+    }
+    kind_out = EventKind(kind);
+    timestamp += delta;
+    timestamp_out = timestamp;
+
+    const char* operandKinds = eventInfos[kind].operands;
+    std::fill(operands_out, operands_out + 3, 0);
+    for (unsigned i = 0; operandKinds[i] != '\0'; ++i) {
+      if (!readVarint(operands_out[i])) {
+        *error_out = "truncated binary trace";
+        return false;
+      }
+    }
+
+    ruleKey_out = {};
+    if (kind_out == EventKind::NewRule) {
+      uint64_t size;
+      if (!readVarint(size) || size > uint64_t(end - pos)) {
+        *error_out = "truncated binary trace";
+        return false;
+      }
+      ruleKey_out = StringRef(reinterpret_cast<const char*>(pos), size);
+      pos += size;
+    }
+    return true;
+  }
+};
+
+/// Write a string as a JSON string literal.
+void writeJSONString(raw_ostream& os, StringRef value) {
+  os << '"';
+  for (char c: value) {
+    if (c == '"' || c == '\\')
+      os << '\\';
+    os << c;
+  }
+  os << '"';
+}
+
+/// Converts trace events into Chrome trace events, with a complete event for
+/// each task spanning from when it was readied until it finished.
+class ChromeTraceWriter {
+  raw_ostream& os;
+  bool isFirstEvent = true;
+
+  /// The printable keys of each rule, by number.
+  std::vector<std::string> ruleKeys;
+
+  struct RunningTask {
+    uint64_t startTime;
+    unsigned lane;
+  };
+  std::unordered_map<uint64_t, RunningTask> runningTasks;
+
+  /// Whether each lane (displayed as a thread) is occupied by a running task.
+  std::vector<bool> busyLanes;
+
+  void beginEvent() {
+    os << (isFirstEvent ? "\n" : ",\n");
+    isFirstEvent = false;
+  }
 
-  fprintf(fp, "{ \"cycle-supply-prior-value\", \"%s\", \"%s\" },\n",
-          getRuleName(forRule), getTaskName(toTask));
+public:
+  explicit ChromeTraceWriter(raw_ostream& os) : os(os) {
+    os << "[";
+  }
+
+  ~ChromeTraceWriter() {
+    os << "\n]\n";
+  }
+
+  void addEvent(EventKind kind, uint64_t timestamp, const uint64_t* operands,
+                StringRef ruleKey) {
+    switch (kind) {
+    case EventKind::NewRule:
+      if (operands[0] >= ruleKeys.size())
+        ruleKeys.resize(operands[0] + 1);
+      ruleKeys[operands[0]] = getPrintableKey(ruleKey);
+      break;
+
+    case EventKind::BuildStarted:
+    case EventKind::BuildEnded:
+      beginEvent();
+      os << "{ \"name\": \"" << eventInfos[unsigned(kind)].name
+         << "\", \"ph\": \"i\", \"s\": \"g\", \"pid\": 0, \"tid\": 0, "
+         << "\"ts\": " << timestamp << " }";
+      break;
+
+    case EventKind::ReadiedTask: {
+      auto it = std::find(busyLanes.begin(), busyLanes.end(), false);
+      unsigned lane = it - busyLanes.begin();
+      if (it == busyLanes.end())
+        busyLanes.push_back(true);
+      else
+        *it = true;
+      runningTasks[operands[0]] = { timestamp, lane };
+      break;
+    }
+
+    case EventKind::FinishedTask: {
+      auto it = runningTasks.find(operands[0]);
+      if (it == runningTasks.end())
+        break;
+      auto task = it->second;
+      runningTasks.erase(it);
+      busyLanes[task.lane] = false;
+
+      StringRef name;
+      if (operands[1] < ruleKeys.size())
+        name = ruleKeys[operands[1]];
+      beginEvent();
+      os << "{ \"name\": ";
+      writeJSONString(os, name);
+      os << ", \"cat\": \"task\", \"ph\": \"X\", \"pid\": 0, "
+         << "\"tid\": " << task.lane << ", \"ts\": " << task.startTime
+         << ", \"dur\": " << (timestamp - task.startTime)
+         << ", \"args\": { \"changed\": "
+         << (operands[2] ? "true" : "false") << " } }";
+      break;
+    }
+
+    default:
+      break;
+    }
+  }
+};
+
+}
+
+bool core::convertBinaryBuildEngineTrace(StringRef data,
+                                         BuildEngineTraceConversion conversion,
+                                         raw_ostream& os,
+                                         std::string* error_out) {
+  BinaryTraceReader reader(data);
+  if (!reader.readHeader(error_out))
+    return false;
+
+  std::unique_ptr<ChromeTraceWriter> chromeWriter;
+  if (conversion == BuildEngineTraceConversion::Chrome)
+    chromeWriter = llvm::make_unique<ChromeTraceWriter>(os);
+  else
+    os << "[\n";
+
+  while (!reader.isAtEnd()) {
+    EventKind kind;
+    uint64_t timestamp;
+    uint64_t operands[3];
+    StringRef ruleKey;
+    if (!reader.readEvent(kind, timestamp, operands, ruleKey, error_out))
+      return false;
+
+    if (chromeWriter)
+      chromeWriter->addEvent(kind, timestamp, operands, ruleKey);
+    else
+      writeJSONEvent(os, kind, operands, ruleKey);
+  }
+
+  if (!chromeWriter)
+    os << "]\n";
+  return true;
 }
@@ -13,8 +13,17 @@
 #ifndef LLBUILD_CORE_BUILDENGINETRACE_H
 #define LLBUILD_CORE_BUILDENGINETRACE_H
 
+#include "llbuild/Core/BuildEngine.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <cstdint>
+#include <memory>
 #include <string>
-#include <unordered_map>
+
+namespace llvm {
+class raw_fd_ostream;
+}
 
 namespace llbuild {
 namespace core {
@@ -25,17 +34,32 @@ class Task;
 /// This class assists in writing build engine tracing information to an
 /// external log file, suitable for ex post facto debugging and analysis.
 class BuildEngineTrace {
-    /// The output file pointer.
-    void* outputPtr = nullptr;
+public:
+    /// The kinds of events recorded in the trace.
+    enum class EventKind : uint8_t;
+
+private:
+    class BinaryWriter;
+
+    /// The output stream, when writing the JSON format.
+    std::unique_ptr<llvm::raw_fd_ostream> jsonOS;
+
+    /// The output writer, when writing the binary format.
+    std::unique_ptr<BinaryWriter> binaryWriter;
 
     unsigned numNamedTasks = 0;
-    std::unordered_map<const Task*, std::string> taskNames;
+    llvm::DenseMap<const Task*, unsigned> taskIDs;
     unsigned numNamedRules = 0;
-    std::unordered_map<const Rule*, std::string> ruleNames;
+    llvm::DenseMap<const Rule*, unsigned> ruleIDs;
 
 private:
-    const char* getTaskName(const Task*);
-    const char* getRuleName(const Rule*);
+    unsigned getTaskID(const Task*);
+    unsigned getRuleID(const Rule*);
+
+    /// Record an event with the given operands, whose meaning is determined by
+    /// the event kind.
+    void record(EventKind kind, uint64_t a = 0, uint64_t b = 0,
+                uint64_t c = 0, StringRef ruleKey = {});
 
 public:
     BuildEngineTrace();
@@ -45,7 +69,8 @@ public:
     /// recording, and may only be called once per trace object.
     ///
     /// \returns True on success.
-    bool open(const std::string& path, std::string* error_out);
+    bool open(const std::string& path, BuildEngineTraceFormat format,
+              std::string* error_out);
 
     /// Close the output file; no subsequest trace recording may be done.
     ///
@@ -53,7 +78,7 @@ public:
     bool close(std::string* error_out);
 
     /// Check if the trace output is open.
-    bool isOpen() const { return outputPtr != nullptr; }
+    bool isOpen() const { return jsonOS || binaryWriter; }
 
     /// @name Trace Recording APIs
     /// @{
@@ -0,0 +1,1012 @@
+//===-- LogBuildDB.cpp ----------------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "llbuild/Core/BuildDB.h"
+
+#include "llbuild/Basic/BinaryCoding.h"
+#include "llbuild/Basic/PlatformUtility.h"
+#include "llbuild/Core/BuildEngine.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <random>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace llbuild;
+using namespace llbuild::core;
+
+// Log-structured BuildDB Implementation
+
+#if !defined(_WIN32)
+
+namespace {
+
+/// A BuildDB backed by an append-only log file.
+///
+/// The file consists of a fixed header followed by a sequence of 8-byte
+/// aligned records, each with a (kind, payload size) prefix. Key records
+/// implicitly assign dense database key IDs (starting at 1) in the order in
+/// which they appear, and each result (or statistics) record supersedes any
+/// earlier result (or statistics) for the same key.
+///
+/// When opened, the log is memory-mapped and scanned once to build an in-memory
+/// index from database key IDs to the offset of their latest result, after
+/// which lookups decode directly out of the mapped file. New records are
+/// buffered in memory and appended in batches. If superseded records make up
+/// the majority of the file, it is compacted on open.
+///
+/// A torn (partially written) trailing record, e.g. from a crash, is discarded
+/// when the log is next opened.
+class LogBuildDB : public BuildDB {
+  /// Version History:
+  /// * 3: Add the log generation to the header.
+  /// * 2: Add rule statistics records.
+  /// * 1: Initial version.
+  static const uint32_t currentFormatVersion = 3;
+
+  /// The file identification bytes.
+  static constexpr const char* fileMagic = "llbdblog";
+
+  /// The size of the file header: magic, format version, client version,
+  /// generation.
+  static const uint64_t headerSize = 24;
+
+  /// The size of the record prefix: kind, payload size.
+  static const uint64_t recordHeaderSize = 8;
+
+  /// The size of the fixed fields of a result record: key ID, signature,
+  /// built at, computed at, start, end and the number of dependencies.
+  static const uint64_t resultFixedSize = 7 * sizeof(uint64_t);
+
+  /// The amount of buffered data which triggers a write to the log.
+  static const size_t writeBatchSize = 1 << 20;
+
+  /// The minimum size of a log before it is considered for compaction.
+  static const uint64_t minimumCompactionSize = 1 << 20;
+
+  enum class RecordKind : uint32_t {
+    Key = 1,
+    Result = 2,
+    Iteration = 3,
+    Statistics = 4,
+  };
+
+  std::string path;
+  uint32_t clientSchemaVersion;
+  /// If this is `true`, the database will be re-created if the client/schema
+  /// version mismatches. If `false`, it will not be re-created but returns an
+  /// error instead.
+  bool recreateOnUnmatchedVersion;
+
+  /// The file descriptor of the open (and locked) log, or -1.
+  int fd = -1;
+
+  /// The read-only mapping of the log, covering the first \see mappedSize
+  /// bytes of the file.
+  const char* mappedData = nullptr;
+  uint64_t mappedSize = 0;
+
+  /// The number of bytes which have been written to the file.
+  uint64_t fileSize = 0;
+
+  /// Records which have been appended but not yet written to the file, which
+  /// logically begin at \see fileSize.
+  std::vector<char> pendingData;
+
+  /// The mutex to protect all access to the database.
+  std::mutex dbMutex;
+
+  /// The delegate pointer
+  BuildDBDelegate* delegate = nullptr;
+
+  /// The current build iteration.
+  Epoch iteration = 0;
+
+  /// The generation of the log, a random value chosen whenever the log is
+  /// (re)created, which identifies the assignment of database key IDs.
+  uint64_t generation = 0;
+
+  /// The map of key names to database key IDs.
+  ///
+  /// The map entries also own the storage for all key names.
+  llvm::StringMap<uint64_t> keyIndex;
+
+  /// The key name for each database key ID.
+  std::vector<StringRef> keyNames;
+
+  /// The offset of the latest result record for each database key ID, or 0 if
+  /// the key has no result.
+  std::vector<uint64_t> resultOffsets;
+
+  /// The offset of the latest statistics record for each database key ID, or 0
+  /// if the key has no statistics.
+  std::vector<uint64_t> statisticsOffsets;
+
+  /// Local cache of database key IDs (indices) to engine KeyIDs, the default
+  /// (zero) KeyID indicates the mapping has not been established.
+  ///
+  /// Like the database key IDs themselves, these mappings remain valid when the
+  /// log is closed and reopened, unless it is recreated (by any process), which
+  /// is detected by a change of its generation.
+  std::vector<KeyID> engineKeyIDs;
+
+  /// Local cache of engine KeyIDs to database key IDs.
+  llvm::DenseMap<KeyID, uint64_t> dbKeyIDs;
+
+  std::string getErrorMessage(const Twine& message) {
+    return ("error: accessing build database \"" + path + "\": " +
+            message).str();
+  }
+
+  static uint64_t alignedRecordSize(uint64_t payloadSize) {
+    return (recordHeaderSize + payloadSize + 7) & ~uint64_t(7);
+  }
+
+  static uint64_t encodeDouble(double value) {
+    uint64_t result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+  }
+
+  static double decodeDouble(uint64_t value) {
+    double result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+  }
+
+  /// Write the entire buffer at the given file offset.
+  bool writeAt(int fileDescriptor, const char* data, size_t size,
+               uint64_t offset, std::string* error_out) {
+    while (size) {
+      ssize_t n = ::pwrite(fileDescriptor, data, size, offset);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        *error_out = getErrorMessage(Twine("unable to write: ") +
+                                     ::strerror(errno));
+        return false;
+      }
+      data += n;
+      size -= n;
+      offset += n;
+    }
+    return true;
+  }
+
+  static void encodeHeader(basic::BinaryEncoder& coder,
+                           uint32_t clientSchemaVersion, uint64_t generation) {
+    coder.writeBytes(StringRef(fileMagic, 8));
+    coder.write(currentFormatVersion);
+    coder.write(clientSchemaVersion);
+    coder.write(generation);
+  }
+
+  /// Discard the cached mappings to engine KeyIDs, if the log is not of the
+  /// given generation.
+  void setGeneration(uint64_t newGeneration) {
+    if (newGeneration == generation)
+      return;
+    generation = newGeneration;
+    engineKeyIDs.clear();
+    dbKeyIDs.clear();
+  }
+
+  bool map(std::string* error_out) {
+    unmap();
+    if (fileSize == 0)
+      return true;
+    void* data = ::mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      *error_out = getErrorMessage(Twine("unable to map: ") +
+                                   ::strerror(errno));
+      return false;
+    }
+    mappedData = static_cast<const char*>(data);
+    mappedSize = fileSize;
+    return true;
+  }
+
+  void unmap() {
+    if (mappedData)
+      ::munmap(const_cast<char*>(mappedData), mappedSize);
+    mappedData = nullptr;
+    mappedSize = 0;
+  }
+
+  /// Get the payload of the record at the given offset.
+  ///
+  /// This method is not thread-safe. The caller must protect access via the
+  /// dbMutex.
+  StringRef getRecordPayload(uint64_t offset, std::string* error_out) {
+    const char* record;
+    if (offset >= fileSize) {
+      record = pendingData.data() + (offset - fileSize);
+    } else {
+      // Records written since the log was mapped require a new mapping.
+      if (offset >= mappedSize && !map(error_out))
+        return {};
+      record = mappedData + offset;
+    }
+
+    basic::BinaryDecoder decoder(StringRef(record, recordHeaderSize));
+    uint32_t kind, payloadSize;
+    decoder.read(kind);
+    decoder.read(payloadSize);
+    return StringRef(record + recordHeaderSize, payloadSize);
+  }
+
+  /// Append a record to the pending data.
+  ///
+  /// \returns The offset of the new record.
+  uint64_t appendRecord(RecordKind kind, StringRef payload) {
+    uint64_t offset = fileSize + pendingData.size();
+    basic::BinaryEncoder coder;
+    coder.write(uint32_t(kind));
+    coder.write(uint32_t(payload.size()));
+    pendingData.insert(pendingData.end(), coder.data(),
+                       coder.data() + coder.size());
+    pendingData.insert(pendingData.end(), payload.begin(), payload.end());
+    pendingData.resize(offset - fileSize + alignedRecordSize(payload.size()));
+    return offset;
+  }
+
+  /// Write any pending records to the file.
+  bool flush(std::string* error_out) {
+    if (pendingData.empty())
+      return true;
+    if (!writeAt(fd, pendingData.data(), pendingData.size(), fileSize,
+                 error_out))
+      return false;
+    fileSize += pendingData.size();
+    pendingData.clear();
+    return true;
+  }
+
+  /// Initialize an empty log with a header.
+  bool initialize(std::string* error_out) {
+    if (::ftruncate(fd, 0) != 0) {
+      *error_out = getErrorMessage(Twine("unable to truncate: ") +
+                                   ::strerror(errno));
+      return false;
+    }
+    // Any previously assigned key IDs are no longer valid.
+    std::random_device randomDevice;
+    uint64_t newGeneration;
+    do {
+      newGeneration = (uint64_t(randomDevice()) << 32) | randomDevice();
+    } while (newGeneration == generation);
+    setGeneration(newGeneration);
+
+    basic::BinaryEncoder coder;
+    encodeHeader(coder, clientSchemaVersion, generation);
+    if (!writeAt(fd, (const char*)coder.data(), coder.size(), 0, error_out))
+      return false;
+    fileSize = coder.size();
+    return true;
+  }
+
+  /// Add a key to the in-memory index.
+  uint64_t addKey(StringRef key) {
+    uint64_t dbKeyID = keyNames.size();
+    auto it = keyIndex.insert(std::make_pair(key, dbKeyID)).first;
+    keyNames.push_back(it->getKey());
+    resultOffsets.push_back(0);
+    statisticsOffsets.push_back(0);
+    if (engineKeyIDs.size() < keyNames.size())
+      engineKeyIDs.push_back(KeyID());
+    return dbKeyID;
+  }
+
+  /// Scan the mapped log and populate the in-memory index.
+  ///
+  /// \returns The number of bytes in the log which are not superseded.
+  uint64_t scan() {
+    keyIndex.clear();
+    keyNames.clear();
+    resultOffsets.clear();
+    statisticsOffsets.clear();
+    iteration = 0;
+
+    // Database key IDs start at one.
+    keyNames.push_back(StringRef());
+    resultOffsets.push_back(0);
+    statisticsOffsets.push_back(0);
+    if (engineKeyIDs.empty())
+      engineKeyIDs.push_back(KeyID());
+
+    uint64_t liveSize = headerSize;
+    uint64_t offset = headerSize;
+    while (offset + recordHeaderSize <= mappedSize) {
+      basic::BinaryDecoder decoder(
+          StringRef(mappedData + offset, recordHeaderSize));
+      uint32_t kind, payloadSize;
+      decoder.read(kind);
+      decoder.read(payloadSize);
+      uint64_t recordSize = alignedRecordSize(payloadSize);
+      if (offset + recordSize > mappedSize)
+        break;
+
+      StringRef payload(mappedData + offset + recordHeaderSize, payloadSize);
+      bool valid = true;
+      switch (RecordKind(kind)) {
+      case RecordKind::Key:
+        if (keyIndex.count(payload)) {
+          valid = false;
+          break;
+        }
+        addKey(payload);
+        liveSize += recordSize;
+        break;
+
+      case RecordKind::Result: {
+        if (payloadSize < resultFixedSize) {
+          valid = false;
+          break;
+        }
+        basic::BinaryDecoder resultDecoder(payload);
+        uint64_t dbKeyID;
+        resultDecoder.read(dbKeyID);
+        uint64_t numDependencies;
+        resultDecoder.read(numDependencies); // signature
+        resultDecoder.read(numDependencies); // built at
+        resultDecoder.read(numDependencies); // computed at
+        resultDecoder.read(numDependencies); // start
+        resultDecoder.read(numDependencies); // end
+        resultDecoder.read(numDependencies);
+        if (dbKeyID == 0 || dbKeyID >= keyNames.size() ||
+            numDependencies > (payloadSize - resultFixedSize) / 8) {
+          valid = false;
+          break;
+        }
+        if (auto previous = resultOffsets[dbKeyID]) {
+          liveSize -= alignedRecordSize(
+              getRecordPayload(previous, nullptr).size());
+        }
+        resultOffsets[dbKeyID] = offset;
+        liveSize += recordSize;
+        break;
+      }
+
+      case RecordKind::Statistics: {
+        if (payloadSize < sizeof(uint64_t)) {
+          valid = false;
+          break;
+        }
+        basic::BinaryDecoder statisticsDecoder(payload);
+        uint64_t dbKeyID;
+        statisticsDecoder.read(dbKeyID);
+        if (dbKeyID == 0 || dbKeyID >= keyNames.size()) {
+          valid = false;
+          break;
+        }
+        if (auto previous = statisticsOffsets[dbKeyID]) {
+          liveSize -= alignedRecordSize(
+              getRecordPayload(previous, nullptr).size());
+        }
+        statisticsOffsets[dbKeyID] = offset;
+        liveSize += recordSize;
+        break;
+      }
+
+      case RecordKind::Iteration: {
+        if (payloadSize != sizeof(uint64_t)) {
+          valid = false;
+          break;
+        }
+        basic::BinaryDecoder iterationDecoder(payload);
+        iterationDecoder.read(iteration);
+        break;
+      }
+
+      default:
+        valid = false;
+        break;
+      }
+      if (!valid)
+        break;
+
+      offset += recordSize;
+    }
+
+    // Discard any trailing torn or invalid data.
+    if (offset != fileSize && ::ftruncate(fd, offset) == 0) {
+      // The mapping must not extend past the end of the file.
+      std::string error;
+      fileSize = offset;
+      map(&error);
+    }
+
+    // If the log lost keys since it was last opened, the cached mappings can no
+    // longer be trusted.
+    if (engineKeyIDs.size() > keyNames.size()) {
+      engineKeyIDs.assign(keyNames.size(), KeyID());
+      dbKeyIDs.clear();
+    }
+
+    // The iteration is always rewritten by compaction.
+    return liveSize + alignedRecordSize(sizeof(uint64_t));
+  }
+
+  /// Rewrite the log with only the live records.
+  ///
+  /// Key IDs are preserved, so the encoded dependencies can be copied as is.
+  bool compact(std::string* error_out) {
+    std::string compactPath = path + ".compact";
+    int newFD = ::open(compactPath.c_str(),
+                       O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (newFD < 0) {
+      *error_out = getErrorMessage(Twine("unable to compact: ") +
+                                   ::strerror(errno));
+      return false;
+    }
+    if (::flock(newFD, LOCK_EX | LOCK_NB) != 0) {
+      *error_out = getErrorMessage(Twine("unable to compact: ") +
+                                   ::strerror(errno));
+      ::close(newFD);
+      return false;
+    }
+
+    std::vector<char> data;
+    basic::BinaryEncoder header;
+    encodeHeader(header, clientSchemaVersion, generation);
+    data.insert(data.end(), header.data(), header.data() + header.size());
+
+    auto appendRecordData = [&](RecordKind kind, StringRef payload) {
+      basic::BinaryEncoder coder;
+      coder.write(uint32_t(kind));
+      coder.write(uint32_t(payload.size()));
+      uint64_t offset = data.size();
+      data.insert(data.end(), coder.data(), coder.data() + coder.size());
+      data.insert(data.end(), payload.begin(), payload.end());
+      data.resize(offset + alignedRecordSize(payload.size()));
+      return offset;
+    };
+
+    for (uint64_t i = 1, e = keyNames.size(); i != e; ++i)
+      appendRecordData(RecordKind::Key, keyNames[i]);
+    std::vector<uint64_t> newResultOffsets(resultOffsets.size(), 0);
+    for (uint64_t i = 1, e = resultOffsets.size(); i != e; ++i) {
+      if (!resultOffsets[i])
+        continue;
+      newResultOffsets[i] = appendRecordData(
+          RecordKind::Result, getRecordPayload(resultOffsets[i], nullptr));
+    }
+    std::vector<uint64_t> newStatisticsOffsets(statisticsOffsets.size(), 0);
+    for (uint64_t i = 1, e = statisticsOffsets.size(); i != e; ++i) {
+      if (!statisticsOffsets[i])
+        continue;
+      newStatisticsOffsets[i] = appendRecordData(
+          RecordKind::Statistics,
+          getRecordPayload(statisticsOffsets[i], nullptr));
+    }
+    basic::BinaryEncoder iterationCoder;
+    iterationCoder.write(uint64_t(iteration));
+    appendRecordData(RecordKind::Iteration,
+                     StringRef((const char*)iterationCoder.data(),
+                               iterationCoder.size()));
+
+    if (!writeAt(newFD, data.data(), data.size(), 0, error_out) ||
+        ::rename(compactPath.c_str(), path.c_str()) != 0) {
+      if (error_out->empty()) {
+        *error_out = getErrorMessage(Twine("unable to compact: ") +
+                                     ::strerror(errno));
+      }
+      ::close(newFD);
+      ::unlink(compactPath.c_str());
+      return false;
+    }
+
+    // Switch over to the compacted log.
+    unmap();
+    ::close(fd);
+    fd = newFD;
+    fileSize = data.size();
+    resultOffsets = std::move(newResultOffsets);
+    statisticsOffsets = std::move(newStatisticsOffsets);
+    return map(error_out);
+  }
+
+  bool open(std::string* error_out) {
+    // The db is opened lazily whenever an operation on it occurs. Thus if it is
+    // already open, we don't need to do any further work.
+    if (fd >= 0) return true;
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (fd < 0) {
+      *error_out = "unable to open database: " + std::string(::strerror(errno));
+      return false;
+    }
+
+    // Only a single client may use the log at a time.
+    if (::flock(fd, LOCK_EX | LOCK_NB) != 0) {
+      if (errno == EWOULDBLOCK) {
+        *error_out = getErrorMessage(
+            "database is locked. Possibly there are two concurrent builds "
+            "running in the same filesystem location.");
+      } else {
+        *error_out = getErrorMessage(Twine("unable to lock: ") +
+                                     ::strerror(errno));
+      }
+      ::close(fd);
+      fd = -1;
+      return false;
+    }
+
+    struct ::stat statbuf;
+    if (::fstat(fd, &statbuf) != 0) {
+      *error_out = getErrorMessage(Twine("unable to stat: ") +
+                                   ::strerror(errno));
+      close();
+      return false;
+    }
+    fileSize = statbuf.st_size;
+
+    // Validate the header.
+    int version = -1;
+    uint32_t clientVersion = 0;
+    uint64_t fileGeneration = 0;
+    if (fileSize >= headerSize) {
+      char header[headerSize];
+      if (::pread(fd, header, headerSize, 0) == ssize_t(headerSize) &&
+          StringRef(header, 8) == StringRef(fileMagic, 8)) {
+        basic::BinaryDecoder decoder(StringRef(header + 8, headerSize - 8));
+        uint32_t formatVersion;
+        decoder.read(formatVersion);
+        decoder.read(clientVersion);
+        version = formatVersion;
+        if (formatVersion == currentFormatVersion)
+          decoder.read(fileGeneration);
+      }
+    }
+
+    if (fileSize == 0) {
+      if (!initialize(error_out)) {
+        close();
+        return false;
+      }
+    } else if (version != int(currentFormatVersion) ||
+               clientVersion != clientSchemaVersion) {
+      if (!recreateOnUnmatchedVersion) {
+        // We don't re-create the database in this case and return an error
+        *error_out = std::string("Version mismatch. (database-schema: ") + std::to_string(version) + std::string(" requested schema: ") + std::to_string(currentFormatVersion) + std::string(". database-client: ") + std::to_string(clientVersion) + std::string(" requested client: ") + std::to_string(clientSchemaVersion) + std::string(")");
+        close();
+        return false;
+      }
+
+      // Always recreate the database from scratch when the schema changes.
+      if (!initialize(error_out)) {
+        close();
+        return false;
+      }
+    } else {
+      // The log may have been recreated by another process since it was last
+      // opened.
+      setGeneration(fileGeneration);
+    }
+
+    if (!map(error_out)) {
+      close();
+      return false;
+    }
+
+    uint64_t liveSize = scan();
+    if (fileSize >= minimumCompactionSize && liveSize * 2 < fileSize) {
+      if (!compact(error_out)) {
+        close();
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /// Close the log, writing any pending records.
+  ///
+  /// \returns False if the pending records could not be written.
+  bool close(std::string* error_out = nullptr) {
+    if (fd < 0) return true;
+
+    std::string error;
+    bool success = flush(&error);
+    if (!success && error_out)
+      *error_out = error;
+    unmap();
+    ::close(fd);
+    fd = -1;
+    fileSize = 0;
+    pendingData.clear();
+    return success;
+  }
+
+  /// Lookup or create a database key ID for a given engine KeyID.
+  ///
+  /// This method is not thread-safe. The caller must protect access via the
+  /// dbMutex.
+  uint64_t getKeyID(KeyID keyID) {
+    // Try to fetch the database key ID from the cache
+    auto it = dbKeyIDs.find(keyID);
+    if (it != dbKeyIDs.end()) {
+      return it->second;
+    }
+
+    auto key = delegate->getKeyForID(keyID);
+    uint64_t dbKeyID;
+    auto indexIt = keyIndex.find(key.str());
+    if (indexIt != keyIndex.end()) {
+      dbKeyID = indexIt->second;
+    } else {
+      dbKeyID = addKey(key.str());
+      appendRecord(RecordKind::Key, key.str());
+    }
+
+    // Cache the ID mappings
+    engineKeyIDs[dbKeyID] = keyID;
+    dbKeyIDs[keyID] = dbKeyID;
+    return dbKeyID;
+  }
+
+  /// Maps a database key ID into an engine KeyID
+  ///
+  /// This method is not thread-safe. The caller must protect access via the
+  /// dbMutex.
+  KeyID getKeyIDForID(uint64_t dbKeyID) {
+    KeyID& keyID = engineKeyIDs[dbKeyID];
+    if (keyID == KeyID()) {
+      keyID = delegate->getKeyID(keyNames[dbKeyID]);
+      dbKeyIDs[keyID] = dbKeyID;
+    }
+    return keyID;
+  }
+
+  /// Decode the result record at the given offset.
+  ///
+  /// This method is not thread-safe. The caller must protect access via the
+  /// dbMutex.
+  bool decodeResult(uint64_t offset, Result* result_out,
+                    std::string* error_out) {
+    StringRef payload = getRecordPayload(offset, error_out);
+    if (payload.empty())
+      return false;
+
+    basic::BinaryDecoder decoder(payload);
+    uint64_t dbKeyID, signature, start, end, numDependencies;
+    decoder.read(dbKeyID);
+    decoder.read(signature);
+    decoder.read(result_out->builtAt);
+    decoder.read(result_out->computedAt);
+    decoder.read(start);
+    decoder.read(end);
+    decoder.read(numDependencies);
+    result_out->signature = basic::CommandSignature(signature);
+    result_out->start = decodeDouble(start);
+    result_out->end = decodeDouble(end);
+
+    result_out->dependencies.resize(numDependencies);
+    for (uint64_t i = 0; i != numDependencies; ++i) {
+      uint64_t raw;
+      decoder.read(raw);
+      bool orderOnly = raw & 1;
+      bool singleUse = (raw >> 1) & 1;
+      uint64_t dependencyID = raw >> 2;
+      if (dependencyID == 0 || dependencyID >= keyNames.size()) {
+        *error_out = (llvm::Twine("unexpected contents for database result: ") +
+                      llvm::Twine((int)dbKeyID)).str();
+        return false;
+      }
+      result_out->dependencies.set(i, getKeyIDForID(dependencyID), orderOnly,
+                                   singleUse);
+    }
+
+    // The value is the remainder of the record.
+    StringRef value;
+    decoder.readBytes(payload.size() - resultFixedSize - numDependencies * 8,
+                      value);
+    result_out->value.assign(value.begin(), value.end());
+    return true;
+  }
+
+public:
+  LogBuildDB(StringRef path, uint32_t clientSchemaVersion,
+             bool recreateOnUnmatchedVersion)
+    : path(path), clientSchemaVersion(clientSchemaVersion),
+      recreateOnUnmatchedVersion(recreateOnUnmatchedVersion) { }
+
+  virtual ~LogBuildDB() {
+    std::lock_guard<std::mutex> guard(dbMutex);
+    close();
+  }
+
+  /// @name BuildDB API
+  /// @{
+
+  virtual void attachDelegate(BuildDBDelegate* delegate) override {
+    this->delegate = delegate;
+  }
+
+  virtual Epoch getCurrentEpoch(bool* success_out,
+                                std::string* error_out) override {
+    std::lock_guard<std::mutex> guard(dbMutex);
+
+    if (!open(error_out)) {
+      *success_out = false;
+      return 0;
+    }
+
+    *success_out = true;
+    return iteration;
+  }
+
+  virtual bool setCurrentIteration(uint64_t value,
+                                   std::string* error_out) override {
+    std::lock_guard<std::mutex> guard(dbMutex);
+
+    if (!open(error_out)) {
+      return false;
+    }
+
+    iteration = value;
+    basic::BinaryEncoder coder;
+    coder.write(value);
+    appendRecord(RecordKind::Iteration,
+                 StringRef((const char*)coder.data(), coder.size()));
+    return true;
+  }
+
+  virtual bool lookupRuleResult(KeyID keyID, const KeyType& key,
+                                Result* result_out,
+                                std::string* error_out) override {
+    assert(delegate != nullptr);
+    std::lock_guard<std::mutex> guard(dbMutex);
+    assert(result_out->builtAt == 0);
+
+    if (!open(error_out)) {
+      return false;
+    }
+
+    uint64_t dbKeyID;
+    auto it = dbKeyIDs.find(keyID);
+    if (it != dbKeyIDs.end()) {
+      dbKeyID = it->second;
+    } else {
+      auto indexIt = keyIndex.find(key.str());
+      if (indexIt == keyIndex.end())
+        return false;
+      dbKeyID = indexIt->second;
+
+      // Cache the engine key mapping
+      engineKeyIDs[dbKeyID] = keyID;
+      dbKeyIDs[keyID] = dbKeyID;
+    }
+
+    uint64_t offset = resultOffsets[dbKeyID];
+    if (!offset)
+      return false;
+
+    return decodeResult(offset, result_out, error_out);
+  }
+
+  virtual bool setRuleResult(KeyID keyID,
+                             const Rule& rule,
+                             const Result& ruleResult,
+                             std::string* error_out) override {
+    assert(delegate != nullptr);
+    std::lock_guard<std::mutex> guard(dbMutex);
+
+    if (!open(error_out)) {
+      return false;
+    }
+
+    auto dbKeyID = getKeyID(keyID);
+
+    basic::BinaryEncoder coder;
+    coder.write(dbKeyID);
+    coder.write(uint64_t(ruleResult.signature.value));
+    coder.write(uint64_t(ruleResult.builtAt));
+    coder.write(uint64_t(ruleResult.computedAt));
+    coder.write(encodeDouble(ruleResult.start));
+    coder.write(encodeDouble(ruleResult.end));
+    coder.write(uint64_t(ruleResult.dependencies.size()));
+    for (auto dependency: ruleResult.dependencies) {
+      // Map the engine keyID to a database key ID
+      auto dependencyID = getKeyID(dependency.keyID);
+      coder.write((dependencyID << 2) + (dependency.singleUse << 1) +
+                  dependency.orderOnly);
+    }
+    coder.writeBytes(StringRef((const char*)ruleResult.value.data(),
+                               ruleResult.value.size()));
+
+    resultOffsets[dbKeyID] = appendRecord(
+        RecordKind::Result, StringRef((const char*)coder.data(), coder.size()));
+
+    if (pendingData.size() >= writeBatchSize)
+      return flush(error_out);
+    return true;
+  }
+
+  virtual bool lookupRuleStatistics(KeyID keyID,
+                                    RuleStatistics* statistics_out,
+                                    std::string* error_out) override {
+    assert(delegate != nullptr);
+    std::lock_guard<std::mutex> guard(dbMutex);
+
+    if (!open(error_out)) {
+      return false;
+    }
+
+    auto dbKeyID = getKeyID(keyID);
+    uint64_t offset = statisticsOffsets[dbKeyID];
+    if (!offset)
+      return false;
+
+    StringRef payload = getRecordPayload(offset, error_out);
+    if (payload.size() < sizeof(uint64_t) ||
+        !statistics_out->decode(payload.drop_front(sizeof(uint64_t)))) {
+      if (error_out->empty()) {
+        *error_out = (llvm::Twine("unexpected contents for database statistics: ") +
+                      llvm::Twine((int)dbKeyID)).str();
+      }
+      return false;
+    }
+    return true;
+  }
+
+  virtual bool setRuleStatistics(KeyID keyID,
+                                 const RuleStatistics& statistics,
+                                 std::string* error_out) override {
+    assert(delegate != nullptr);
+    std::lock_guard<std::mutex> guard(dbMutex);
+
+    if (!open(error_out)) {
+      return false;
+    }
+
+    auto dbKeyID = getKeyID(keyID);
+
+    basic::BinaryEncoder coder;
+    coder.write(dbKeyID);
+    statistics.encode(coder);
+
+    statisticsOffsets[dbKeyID] = appendRecord(
+        RecordKind::Statistics,
+        StringRef((const char*)coder.data(), coder.size()));
+
+    if (pendingData.size() >= writeBatchSize)
+      return flush(error_out);
+    return true;
+  }
+
+  virtual bool buildStarted(std::string* error_out) override {
+    std::lock_guard<std::mutex> guard(dbMutex);
+
+    return open(error_out);
+  }
+
+  virtual void buildComplete() override {
+    std::lock_guard<std::mutex> guard(dbMutex);
+
+    // Write out any buffered records and release the lock on the file, so
+    // that other clients may use the database between builds.
+    std::string error;
+    if (!close(&error) && delegate)
+      delegate->error("unable to write build results: " + error);
+  }
+
+  virtual bool getKeys(std::vector<KeyType>& keys_out,
+                       std::string* error_out) override {
+    std::lock_guard<std::mutex> guard(dbMutex);
+
+    if (!open(error_out))
+      return false;
+
+    for (uint64_t i = 1, e = keyNames.size(); i != e; ++i) {
+      keys_out.push_back(KeyType(keyNames[i]));
+    }
+
+    return true;
+  }
+
+  virtual bool getKeysWithResult(std::vector<KeyType>& keys_out,
+                                 std::vector<Result>& results_out,
+                                 std::string* error_out) override {
+    assert(delegate != nullptr);
+    std::lock_guard<std::mutex> guard(dbMutex);
+
+    if (!open(error_out))
+      return false;
+
+    for (uint64_t i = 1, e = keyNames.size(); i != e; ++i) {
+      if (!resultOffsets[i])
+        continue;
+
+      Result result;
+      if (!decodeResult(resultOffsets[i], &result, error_out))
+        return false;
+
+      keys_out.push_back(KeyType(keyNames[i]));
+      results_out.push_back(std::move(result));
+    }
+
+    return true;
+  }
+
+  virtual void dump(raw_ostream& os) override {
+    std::lock_guard<std::mutex> guard(dbMutex);
+
+    std::string error;
+    if (!open(&error)) {
+      os << "error: " << error << "\n";
+      return;
+    }
+
+    os << "keys:\n";
+    for (uint64_t i = 1, e = keyNames.size(); i != e; ++i) {
+      os << i << " -- " << keyNames[i] << "\n";
+    }
+
+    os << "\nresults:\n";
+    for (uint64_t i = 1, e = resultOffsets.size(); i != e; ++i) {
+      if (!resultOffsets[i])
+        continue;
+
+      StringRef payload = getRecordPayload(resultOffsets[i], &error);
+      basic::BinaryDecoder decoder(payload);
+      uint64_t dbKeyID, signature, built, computed, start, end;
+      decoder.read(dbKeyID);
+      decoder.read(signature);
+      decoder.read(built);
+      decoder.read(computed);
+      decoder.read(start);
+      decoder.read(end);
+
+      os << i << " -- " << built << ", " << computed << ", "
+         << decodeDouble(end) - decodeDouble(start) << "s\n";
+    }
+  }
+
+  /// @}
+};
+
+}
+
+std::unique_ptr<BuildDB> core::createLogBuildDB(StringRef path,
+                                                uint32_t clientSchemaVersion,
+                                                bool recreateUnmatchedVersion,
+                                                std::string* error_out) {
+  return llvm::make_unique<LogBuildDB>(path, clientSchemaVersion,
+                                       recreateUnmatchedVersion);
+}
+
+#else
+
+std::unique_ptr<BuildDB> core::createLogBuildDB(StringRef path,
+                                                uint32_t clientSchemaVersion,
+                                                bool recreateUnmatchedVersion,
+                                                std::string* error_out) {
+  *error_out = "log build database is not supported on this platform";
+  return nullptr;
+}
+
+#endif
@@ -0,0 +1,172 @@
+//===-- PreloadingBuildDB.cpp ---------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "llbuild/Core/BuildDB.h"
+
+#include "llbuild/Core/BuildEngine.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+
+#include <cassert>
+#include <mutex>
+#include <vector>
+
+using namespace llbuild;
+using namespace llbuild::core;
+
+namespace {
+
+/// A BuildDB which forwards to another database, but reads all of the stored
+/// results in a single bulk query the first time a result is looked up.
+///
+/// The engine looks up the result for each rule exactly once, when the rule is
+/// first added. For large graphs, this means the underlying database sees one
+/// point query per rule (plus one per previously unseen dependency key), which
+/// dominates the time of a null build. Instead, this loads every result (via
+/// \see BuildDB::getKeysWithResult()) into a table indexed by key, and serves
+/// lookups from it.
+///
+/// Each preloaded result is handed out at most once, and is dropped if the
+/// result is replaced. The table is retained across builds (e.g., the Ninja
+/// manifest and main builds share an engine), so results written to the
+/// database by other processes after it is loaded are not observed. This makes
+/// it suitable for clients which run a single invocation per process.
+class PreloadingBuildDB : public BuildDB {
+  /// The underlying database.
+  std::unique_ptr<BuildDB> db;
+
+  /// The mutex protecting the preloaded state.
+  std::mutex preloadMutex;
+
+  /// The preloaded results which have not yet been looked up.
+  //
+  // The results are indexed by the key name, rather than the KeyID, to avoid
+  // interning every key with the engine a second time.
+  llvm::StringMap<Result> results;
+
+  /// Whether the results have been loaded.
+  bool isLoaded = false;
+
+  /// Load all of the results from the underlying database.
+  ///
+  /// This method is not thread-safe. The caller must hold the preloadMutex.
+  bool load(std::string* error_out) {
+    assert(!isLoaded);
+    isLoaded = true;
+
+    std::vector<KeyType> keys;
+    std::vector<Result> loadedResults;
+    if (!db->getKeysWithResult(keys, loadedResults, error_out))
+      return false;
+    assert(keys.size() == loadedResults.size());
+
+    for (size_t i = 0, e = keys.size(); i != e; ++i) {
+      results[keys[i].str()] = std::move(loadedResults[i]);
+    }
+    return true;
+  }
+
+public:
+  PreloadingBuildDB(std::unique_ptr<BuildDB> db) : db(std::move(db)) {}
+
+  /// @name BuildDB API
+  /// @{
+
+  virtual void attachDelegate(BuildDBDelegate* delegate) override {
+    db->attachDelegate(delegate);
+  }
+
+  virtual Epoch getCurrentEpoch(bool* success_out,
+                                std::string* error_out) override {
+    return db->getCurrentEpoch(success_out, error_out);
+  }
+
+  virtual bool setCurrentIteration(uint64_t value,
+                                   std::string* error_out) override {
+    return db->setCurrentIteration(value, error_out);
+  }
+
+  virtual bool lookupRuleResult(KeyID keyID, const KeyType& key,
+                                Result* result_out,
+                                std::string* error_out) override {
+    std::lock_guard<std::mutex> guard(preloadMutex);
+    if (!isLoaded && !load(error_out))
+      return false;
+
+    // Every stored result was loaded, so a missing entry has no result.
+    auto it = results.find(key.str());
+    if (it == results.end())
+      return false;
+    *result_out = std::move(it->second);
+    results.erase(it);
+    return true;
+  }
+
+  virtual bool setRuleResult(KeyID keyID, const Rule& rule,
+                             const Result& result,
+                             std::string* error_out) override {
+    {
+      // Drop any preloaded result, which is now stale.
+      std::lock_guard<std::mutex> guard(preloadMutex);
+      if (isLoaded)
+        results.erase(rule.key.str());
+    }
+    return db->setRuleResult(keyID, rule, result, error_out);
+  }
+
+  virtual bool lookupRuleStatistics(KeyID keyID,
+                                    RuleStatistics* statistics_out,
+                                    std::string* error_out) override {
+    return db->lookupRuleStatistics(keyID, statistics_out, error_out);
+  }
+
+  virtual bool setRuleStatistics(KeyID keyID,
+                                 const RuleStatistics& statistics,
+                                 std::string* error_out) override {
+    return db->setRuleStatistics(keyID, statistics, error_out);
+  }
+
+  virtual bool buildStarted(std::string* error_out) override {
+    return db->buildStarted(error_out);
+  }
+
+  virtual void buildComplete() override {
+    db->buildComplete();
+  }
+
+  virtual bool getKeys(std::vector<KeyType>& keys_out,
+                       std::string* error_out) override {
+    return db->getKeys(keys_out, error_out);
+  }
+
+  virtual bool getKeysWithResult(std::vector<KeyType>& keys_out,
+                                 std::vector<Result>& results_out,
+                                 std::string* error_out) override {
+    return db->getKeysWithResult(keys_out, results_out, error_out);
+  }
+
+  virtual void dump(raw_ostream& os) override {
+    db->dump(os);
+  }
+
+  /// @}
+};
+
+}
+
+std::unique_ptr<BuildDB>
+core::createPreloadingBuildDB(std::unique_ptr<BuildDB> db) {
+  if (!db)
+    return nullptr;
+  return llvm::make_unique<PreloadingBuildDB>(std::move(db));
+}
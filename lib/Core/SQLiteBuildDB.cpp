@@ -80,6 +80,10 @@ class SQLiteBuildDB : public BuildDB {
   /// * 6: Added `ordinal` field for dependencies.
   /// * 5: Switched to using `WITHOUT ROWID` for dependencies.
   /// * 4: Pre-history
+  ///
+  /// Tables which only add information, and which older clients can ignore,
+  /// are created on open if missing rather than changing the version, so that
+  /// existing databases are not discarded (\see createOptionalTables()).
   static const int currentSchemaVersion = 17;
 
   std::string path;
@@ -113,6 +117,24 @@ class SQLiteBuildDB : public BuildDB {
     return out;
   }
 
+  /// Create the tables added since the current schema version, if missing.
+  bool createOptionalTables(std::string *error_out) {
+    char *cError;
+    int result = sqlite3_exec(
+      db, ("CREATE TABLE IF NOT EXISTS rule_statistics ("
+           "key_id INTEGER PRIMARY KEY, "
+           "statistics BLOB, "
+           "FOREIGN KEY(key_id) REFERENCES key_names(id));"),
+      nullptr, nullptr, &cError);
+    if (result != SQLITE_OK) {
+      *error_out = (std::string("unable to initialize database (") + cError
+                    + ")");
+      sqlite3_free(cError);
+      return false;
+    }
+    return true;
+  }
+
   bool open(std::string *error_out) {
     // The db is opened lazily whenever an operation on it occurs. Thus if it is
     // already open, we don't need to do any further work.
@@ -268,6 +290,12 @@ class SQLiteBuildDB : public BuildDB {
       }
     }
 
+    if (!createOptionalTables(error_out)) {
+      sqlite3_close(db);
+      db = nullptr;
+      return false;
+    }
+
     // Initialize prepared statements.
     result = sqlite3_prepare_v2(
       db, findKeyIDForKeyStmtSQL,
@@ -309,6 +337,16 @@ class SQLiteBuildDB : public BuildDB {
       -1, &getKeysWithResultStmt, nullptr);
     checkSQLiteResultOKReturnFalse(result);
 
+    result = sqlite3_prepare_v2(
+      db, findRuleStatisticsStmtSQL,
+      -1, &findRuleStatisticsStmt, nullptr);
+    checkSQLiteResultOKReturnFalse(result);
+
+    result = sqlite3_prepare_v2(
+      db, insertIntoRuleStatisticsStmtSQL,
+      -1, &insertIntoRuleStatisticsStmt, nullptr);
+    checkSQLiteResultOKReturnFalse(result);
+
     return true;
   }
 
@@ -332,6 +370,10 @@ class SQLiteBuildDB : public BuildDB {
     insertIntoRuleResultsStmt = nullptr;
     sqlite3_finalize(getKeysWithResultStmt);
     getKeysWithResultStmt = nullptr;
+    sqlite3_finalize(findRuleStatisticsStmt);
+    findRuleStatisticsStmt = nullptr;
+    sqlite3_finalize(insertIntoRuleStatisticsStmt);
+    insertIntoRuleStatisticsStmt = nullptr;
 
     int result = sqlite3_close(db);
     (void)result; // use the variable if we're building without asserts
@@ -675,6 +717,98 @@ public:
     return true;
   }
 
+  static constexpr const char *findRuleStatisticsStmtSQL = (
+      "SELECT statistics FROM rule_statistics WHERE key_id == ?;");
+  sqlite3_stmt* findRuleStatisticsStmt = nullptr;
+
+  static constexpr const char *insertIntoRuleStatisticsStmtSQL =
+    "INSERT OR REPLACE INTO rule_statistics VALUES (?, ?);";
+  sqlite3_stmt* insertIntoRuleStatisticsStmt = nullptr;
+
+  virtual bool lookupRuleStatistics(KeyID keyID,
+                                    RuleStatistics* statistics_out,
+                                    std::string *error_out) override {
+    assert(delegate != nullptr);
+    std::lock_guard<std::mutex> guard(dbMutex);
+    int result;
+
+    if (!open(error_out)) {
+      return false;
+    }
+
+    auto dbKeyID = getKeyID(keyID, error_out);
+    if (!error_out->empty()) {
+      return false;
+    }
+
+    result = sqlite3_reset(findRuleStatisticsStmt);
+    checkSQLiteResultOKReturnFalse(result);
+    result = sqlite3_clear_bindings(findRuleStatisticsStmt);
+    checkSQLiteResultOKReturnFalse(result);
+    result = sqlite3_bind_int64(findRuleStatisticsStmt, /*index=*/1,
+                                dbKeyID.value);
+    checkSQLiteResultOKReturnFalse(result);
+
+    // If the rule has no statistics, we are done.
+    result = sqlite3_step(findRuleStatisticsStmt);
+    if (result == SQLITE_DONE)
+      return false;
+    if (result != SQLITE_ROW) {
+      *error_out = getCurrentErrorMessage();
+      return false;
+    }
+
+    assert(sqlite3_column_count(findRuleStatisticsStmt) == 1);
+    StringRef data(
+        (const char*)sqlite3_column_blob(findRuleStatisticsStmt, 0),
+        sqlite3_column_bytes(findRuleStatisticsStmt, 0));
+    if (!statistics_out->decode(data)) {
+      *error_out = (llvm::Twine("unexpected contents for database statistics: ") +
+                    llvm::Twine((int)dbKeyID.value)).str();
+      return false;
+    }
+    return true;
+  }
+
+  virtual bool setRuleStatistics(KeyID keyID,
+                                 const RuleStatistics& statistics,
+                                 std::string *error_out) override {
+    assert(delegate != nullptr);
+    std::lock_guard<std::mutex> guard(dbMutex);
+    int result;
+
+    if (!open(error_out)) {
+      return false;
+    }
+
+    auto dbKeyID = getKeyID(keyID, error_out);
+    if (!error_out->empty()) {
+      return false;
+    }
+
+    basic::BinaryEncoder encoder{};
+    statistics.encode(encoder);
+
+    result = sqlite3_reset(insertIntoRuleStatisticsStmt);
+    checkSQLiteResultOKReturnFalse(result);
+    result = sqlite3_clear_bindings(insertIntoRuleStatisticsStmt);
+    checkSQLiteResultOKReturnFalse(result);
+    result = sqlite3_bind_int64(insertIntoRuleStatisticsStmt, /*index=*/1,
+                                dbKeyID.value);
+    checkSQLiteResultOKReturnFalse(result);
+    result = sqlite3_bind_blob(insertIntoRuleStatisticsStmt, /*index=*/2,
+                               encoder.data(), encoder.size(),
+                               SQLITE_STATIC);
+    checkSQLiteResultOKReturnFalse(result);
+    result = sqlite3_step(insertIntoRuleStatisticsStmt);
+    if (result != SQLITE_DONE) {
+      *error_out = getCurrentErrorMessage();
+      return false;
+    }
+
+    return true;
+  }
+
   virtual bool buildStarted(std::string *error_out) override {
     std::lock_guard<std::mutex> guard(dbMutex);
 
@@ -743,6 +877,11 @@ public:
     if (!open(error_out))
       return false;
     
+    // Map all of the keys up front, so the dependencies below don't require a
+    // query per key.
+    if (!loadAllKeyIDs(error_out))
+      return false;
+
     auto stmt = getKeysWithResultStmt;
     
     int result = sqlite3_reset(stmt);
@@ -754,10 +893,6 @@ public:
       auto dbKeyID = DBKeyID(sqlite3_column_int64(stmt, 0));
       auto key = KeyType((const char *)sqlite3_column_text(stmt, 1), sqlite3_column_bytes(stmt, 1));
       
-      auto engineKeyID = delegate->getKeyID(key);
-      engineKeyIDs[dbKeyID] = engineKeyID;
-      dbKeyIDs[engineKeyID] = dbKeyID;
-      
       Result result;
       int numValueBytes = sqlite3_column_bytes(stmt, 2);
       result.value.resize(numValueBytes);
@@ -801,7 +936,7 @@ public:
       result.signature = basic::CommandSignature(sqlite3_column_int64(stmt, 8));
       
       keys_out.push_back(key);
-      results_out.push_back(result);
+      results_out.push_back(std::move(result));
     }
     
     return true;
@@ -942,6 +1077,39 @@ if (result != SQLITE_OK) { \
 #undef checkSQLiteResultOKReturnDBKeyID
   }
 
+  /// Populate the local key ID caches with every key in the database, using a
+  /// single query.
+  ///
+  /// This method is not thread-safe. The caller must protect access via the
+  /// dbMutex.
+  bool loadAllKeyIDs(std::string *error_out) {
+    int result;
+    sqlite3_stmt* stmt;
+    result = sqlite3_prepare_v2(db, "SELECT id, key FROM key_names;",
+                                -1, &stmt, nullptr);
+    checkSQLiteResultOKReturnFalse(result);
+
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+      assert(sqlite3_column_count(stmt) == 2);
+      DBKeyID dbKeyID(sqlite3_column_int64(stmt, 0));
+      if (engineKeyIDs.count(dbKeyID))
+        continue;
+
+      auto size = sqlite3_column_bytes(stmt, 1);
+      auto text = (const char*) sqlite3_column_text(stmt, 1);
+      auto engineKeyID = delegate->getKeyID(StringRef(text, size));
+      engineKeyIDs[dbKeyID] = engineKeyID;
+      dbKeyIDs[engineKeyID] = dbKeyID;
+    }
+    sqlite3_finalize(stmt);
+
+    if (result != SQLITE_DONE) {
+      *error_out = getCurrentErrorMessage();
+      return false;
+    }
+    return true;
+  }
+
   /// Maps a DBKeyID into an engine KeyID
   ///
   /// This method is not thread-safe. The caller must protect access via the
@@ -979,7 +1147,7 @@ if (result != SQLITE_OK) { \
     auto text = (const char*) sqlite3_column_text(findKeyNameForKeyIDStmt, 0);
 
     // Map the key to an engine ID
-    auto engineKeyID = delegate->getKeyID(KeyType(text, size));
+    auto engineKeyID = delegate->getKeyID(StringRef(text, size));
 
     // Cache the mapping locally
     engineKeyIDs[dbKeyID] = engineKeyID;
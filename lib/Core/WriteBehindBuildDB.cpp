@@ -0,0 +1,350 @@
+//===-- WriteBehindBuildDB.cpp --------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "llbuild/Core/BuildDB.h"
+
+#include "llbuild/Core/BuildEngine.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+using namespace llbuild;
+using namespace llbuild::core;
+
+namespace {
+
+/// A BuildDB which forwards to another database, but performs rule result
+/// writes asynchronously on a background thread.
+///
+/// Results passed to \see setRuleResult() (and statistics passed to \see
+/// setRuleStatistics()) are copied into a pending batch, which is handed off to
+/// the writer thread once it reaches the batch size. Lookups of unwritten
+/// statistics are served from the batch, and every other operation first acts
+/// as a barrier, waiting for all outstanding writes to complete, so the
+/// underlying database always observes operations in the order they were made.
+/// In particular, \see setCurrentIteration() and \see buildComplete() flush
+/// all writes for the build.
+///
+/// Errors from asynchronous writes are reported by the next \see
+/// setRuleResult() or \see setCurrentIteration() call, or, if there is no such
+/// call before the build completes, to the delegate by \see buildComplete().
+class WriteBehindBuildDB : public BuildDB {
+  struct PendingResult {
+    KeyID keyID;
+    /// The rule whose result is written, or null if this writes statistics.
+    const Rule* rule;
+    Result result;
+    RuleStatistics statistics;
+  };
+
+  /// The underlying database.
+  std::unique_ptr<BuildDB> db;
+
+  /// The delegate, used to report errors from the last writes of a build.
+  BuildDBDelegate* delegate = nullptr;
+
+  /// The number of results to accumulate before handing them to the writer.
+  const unsigned batchSize;
+
+  /// The writer thread.
+  std::unique_ptr<std::thread> writerThread;
+
+  /// The mutex protecting the queue state.
+  std::mutex queueMutex;
+
+  /// Condition variable used to signal the writer thread.
+  std::condition_variable writerCondition;
+
+  /// Condition variable used to signal when the writer becomes idle.
+  std::condition_variable idleCondition;
+
+  /// The results which have not yet been taken by the writer.
+  std::vector<PendingResult> pending;
+
+  /// The number of unwritten results for each key, used to ensure a lookup
+  /// never observes a stale result.
+  llvm::DenseMap<KeyID, unsigned> numPendingForKey;
+
+  /// The latest unwritten statistics for each key, and the number of unwritten
+  /// statistics, which are served to lookups directly.
+  llvm::DenseMap<KeyID, std::pair<RuleStatistics, unsigned>>
+    pendingStatisticsForKey;
+
+  /// Whether the writer has been asked to write all pending results.
+  bool flushRequested = false;
+
+  /// Whether the writer is currently writing a batch.
+  bool isWriting = false;
+
+  /// Whether the writer thread should exit.
+  bool isShuttingDown = false;
+
+  /// The first error reported by an asynchronous write, if any.
+  std::string writeError;
+
+  /// Whether \see writeError has been returned to a caller.
+  bool isWriteErrorReported = false;
+
+  void run() {
+#if defined(__APPLE__)
+    pthread_setname_np("org.swift.llbuild BuildDB-Writer");
+#elif defined(__linux__)
+    pthread_setname_np(pthread_self(), "llbuild-dbwrite");
+#endif
+
+    std::vector<PendingResult> batch;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        isWriting = false;
+        batch.clear();
+        idleCondition.notify_all();
+
+        writerCondition.wait(lock, [&] {
+          return isShuttingDown || pending.size() >= batchSize ||
+            (flushRequested && !pending.empty());
+        });
+        if (pending.empty() && isShuttingDown)
+          break;
+
+        std::swap(batch, pending);
+        isWriting = true;
+      }
+
+      // Write the batch, without holding the queue lock.
+      std::string error;
+      for (auto& entry: batch) {
+        if (!error.empty())
+          break;
+        if (entry.rule) {
+          db->setRuleResult(entry.keyID, *entry.rule, entry.result, &error);
+        } else {
+          db->setRuleStatistics(entry.keyID, entry.statistics, &error);
+        }
+      }
+
+      std::lock_guard<std::mutex> guard(queueMutex);
+      if (!error.empty() && writeError.empty())
+        writeError = error;
+      for (const auto& entry: batch) {
+        if (entry.rule) {
+          auto it = numPendingForKey.find(entry.keyID);
+          if (--it->second == 0)
+            numPendingForKey.erase(it);
+        } else {
+          auto it = pendingStatisticsForKey.find(entry.keyID);
+          if (--it->second.second == 0)
+            pendingStatisticsForKey.erase(it);
+        }
+      }
+    }
+  }
+
+  /// Wait for all outstanding writes to complete.
+  ///
+  /// \returns False if any asynchronous write failed.
+  bool flush(std::string* error_out) {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    if (!pending.empty()) {
+      flushRequested = true;
+      writerCondition.notify_one();
+    }
+    idleCondition.wait(lock, [&] { return pending.empty() && !isWriting; });
+    flushRequested = false;
+
+    if (!writeError.empty()) {
+      if (error_out) {
+        *error_out = writeError;
+        isWriteErrorReported = true;
+      }
+      return false;
+    }
+    return true;
+  }
+
+  /// Wait for all outstanding writes to complete, and take the write error
+  /// for the build if it has not yet been reported.
+  std::string takeUnreportedWriteError() {
+    flush(nullptr);
+
+    std::lock_guard<std::mutex> guard(queueMutex);
+    std::string error;
+    if (!isWriteErrorReported)
+      error = std::move(writeError);
+    writeError.clear();
+    isWriteErrorReported = false;
+    return error;
+  }
+
+public:
+  WriteBehindBuildDB(std::unique_ptr<BuildDB> db, unsigned batchSize)
+    : db(std::move(db)), batchSize(std::max(batchSize, 1u))
+  {
+    pending.reserve(this->batchSize);
+    writerThread = llvm::make_unique<std::thread>(&WriteBehindBuildDB::run,
+                                                  this);
+  }
+
+  virtual ~WriteBehindBuildDB() {
+    {
+      std::lock_guard<std::mutex> guard(queueMutex);
+      isShuttingDown = true;
+      writerCondition.notify_one();
+    }
+    writerThread->join();
+  }
+
+  /// @name BuildDB API
+  /// @{
+
+  virtual void attachDelegate(BuildDBDelegate* delegate) override {
+    this->delegate = delegate;
+    db->attachDelegate(delegate);
+  }
+
+  virtual Epoch getCurrentEpoch(bool* success_out,
+                                std::string* error_out) override {
+    flush(nullptr);
+    return db->getCurrentEpoch(success_out, error_out);
+  }
+
+  virtual bool setCurrentIteration(uint64_t value,
+                                   std::string* error_out) override {
+    if (!flush(error_out))
+      return false;
+    return db->setCurrentIteration(value, error_out);
+  }
+
+  virtual bool lookupRuleResult(KeyID keyID, const KeyType& key,
+                                Result* result_out,
+                                std::string* error_out) override {
+    // The engine only looks up results for rules it has not yet computed, so
+    // this is expected to be rare.
+    bool hasPendingWrite;
+    {
+      std::lock_guard<std::mutex> guard(queueMutex);
+      hasPendingWrite = numPendingForKey.count(keyID) != 0;
+    }
+    if (hasPendingWrite)
+      flush(nullptr);
+
+    return db->lookupRuleResult(keyID, key, result_out, error_out);
+  }
+
+  virtual bool setRuleResult(KeyID keyID, const Rule& rule,
+                             const Result& result,
+                             std::string* error_out) override {
+    std::lock_guard<std::mutex> guard(queueMutex);
+    if (!writeError.empty()) {
+      *error_out = writeError;
+      isWriteErrorReported = true;
+      return false;
+    }
+
+    pending.push_back({ keyID, &rule, result, {} });
+    ++numPendingForKey[keyID];
+    if (pending.size() >= batchSize)
+      writerCondition.notify_one();
+    return true;
+  }
+
+  virtual bool lookupRuleStatistics(KeyID keyID,
+                                    RuleStatistics* statistics_out,
+                                    std::string* error_out) override {
+    {
+      std::lock_guard<std::mutex> guard(queueMutex);
+      auto it = pendingStatisticsForKey.find(keyID);
+      if (it != pendingStatisticsForKey.end()) {
+        *statistics_out = it->second.first;
+        return true;
+      }
+    }
+
+    return db->lookupRuleStatistics(keyID, statistics_out, error_out);
+  }
+
+  virtual bool setRuleStatistics(KeyID keyID,
+                                 const RuleStatistics& statistics,
+                                 std::string* error_out) override {
+    std::lock_guard<std::mutex> guard(queueMutex);
+    if (!writeError.empty()) {
+      *error_out = writeError;
+      isWriteErrorReported = true;
+      return false;
+    }
+
+    pending.push_back({ keyID, nullptr, {}, statistics });
+    auto& entry = pendingStatisticsForKey[keyID];
+    entry.first = statistics;
+    ++entry.second;
+    if (pending.size() >= batchSize)
+      writerCondition.notify_one();
+    return true;
+  }
+
+  virtual bool buildStarted(std::string* error_out) override {
+    // Report any error from a previous build which was never completed.
+    std::string error = takeUnreportedWriteError();
+    if (!error.empty()) {
+      *error_out = error;
+      return false;
+    }
+    return db->buildStarted(error_out);
+  }
+
+  virtual void buildComplete() override {
+    std::string error = takeUnreportedWriteError();
+    if (!error.empty() && delegate)
+      delegate->error(error);
+    db->buildComplete();
+  }
+
+  virtual bool getKeys(std::vector<KeyType>& keys_out,
+                       std::string* error_out) override {
+    flush(nullptr);
+    return db->getKeys(keys_out, error_out);
+  }
+
+  virtual bool getKeysWithResult(std::vector<KeyType>& keys_out,
+                                 std::vector<Result>& results_out,
+                                 std::string* error_out) override {
+    flush(nullptr);
+    return db->getKeysWithResult(keys_out, results_out, error_out);
+  }
+
+  virtual void dump(raw_ostream& os) override {
+    flush(nullptr);
+    db->dump(os);
+  }
+
+  /// @}
+};
+
+}
+
+std::unique_ptr<BuildDB>
+core::createWriteBehindBuildDB(std::unique_ptr<BuildDB> db,
+                               unsigned batchSize) {
+  if (!db)
+    return nullptr;
+  return llvm::make_unique<WriteBehindBuildDB>(std::move(db), batchSize);
+}
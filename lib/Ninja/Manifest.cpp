@@ -26,6 +26,7 @@ bool Rule::isValidParameterName(StringRef name) {
     name == "deps" ||
     name == "depfile" ||
     name == "generator" ||
+    name == "msvc_deps_prefix" ||
     name == "pool" ||
     name == "restat" ||
     name == "rspfile" ||
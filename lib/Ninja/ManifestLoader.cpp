@@ -485,6 +485,13 @@ public:
       error("invalid 'deps' style '" + deps.str().str() + "'", startTok);
     }
     decl->setDepsStyle(depsStyle);
+    decl->setRemoveDepsFileFlag(deps.str() == "gcc");
+    if (depsStyle == Command::DepsStyleKind::MSVC) {
+      SmallString<256> prefix;
+      lookupNamedBuildParameter(decl, startTok, "msvc_deps_prefix", prefix);
+      decl->setMSVCDepsPrefix(prefix.empty() ? "Note: including file: " :
+                              prefix.str());
+    }
 
     if (!depfile.str().empty()) {
       if (depsStyle != Command::DepsStyleKind::GCC) {
@@ -0,0 +1,133 @@
+//===-- BasicBenchmarks.cpp -----------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+
+#include "llbuild/Basic/BinaryCoding.h"
+#include "llbuild/Basic/POSIXEnvironment.h"
+#include "llbuild/Basic/Subprocess.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+
+using namespace llbuild;
+using namespace llbuild::basic;
+using namespace llbuild::benchmarks;
+
+namespace {
+
+class BenchmarkProcessDelegate : public ProcessDelegate {
+  void processStarted(ProcessContext*, ProcessHandle, llbuild_pid_t) override {}
+  void processHadError(ProcessContext*, ProcessHandle, const Twine&) override {}
+  void processHadOutput(ProcessContext*, ProcessHandle, StringRef) override {}
+  void processFinished(ProcessContext*, ProcessHandle,
+                       const ProcessResult&) override {}
+};
+
+/// Spawn and wait for 200 trivial processes.
+static bool spawnProcesses(ProcessAttributes attr, std::string* error_out) {
+  BenchmarkProcessDelegate delegate;
+  ProcessGroup pgrp;
+  ProcessHandle handle{0};
+  std::vector<StringRef> cmd({"/usr/bin/true"});
+  POSIXEnvironment environment;
+
+  bool success = true;
+  for (int i = 0; i < 200; i++) {
+    ProcessReleaseFn releaseFn = [](std::function<void()>&& pwait) {
+      pwait();
+    };
+    ProcessCompletionFn completionFn = [&](ProcessResult result) {
+      if (result.status != ProcessStatus::Succeeded)
+        success = false;
+    };
+    spawnProcess(delegate, nullptr, pgrp, handle, cmd, environment, attr,
+                 std::move(releaseFn), std::move(completionFn));
+  }
+
+  if (!success)
+    *error_out = "unable to spawn /usr/bin/true";
+  return success;
+}
+
+}
+
+void benchmarks::registerBasicBenchmarks(BenchmarkRegistry& registry) {
+  // Check encoding 100MB of uint64_ts.
+  registry.add(
+      "basic.binary-coding.encode", "encode 100MB of uint64_t values", 10,
+      [](BenchmarkContext&, std::string*) -> std::unique_ptr<Benchmark> {
+        return llvm::make_unique<FunctionBenchmark>([](std::string* error_out) {
+          // We do 100 iterations to sum to 100 MBs.
+          for (int j = 0; j != 100; ++j) {
+            BinaryEncoder coder;
+            // Encode 1MB of 64-bit values.
+            for (auto i = 0; i != (1 << 20) / 8; ++i) {
+              coder.write(uint64_t(0xAABBCCDDAABBCCDDULL));
+            }
+            if (coder.contents().size() != (size_t)1 << 20) {
+              *error_out = "unexpected encoded size";
+              return false;
+            }
+          }
+          return true;
+        });
+      });
+
+  // Check decoding 1000MB of uint64_ts.
+  registry.add(
+      "basic.binary-coding.decode", "decode 1000MB of uint64_t values", 10,
+      [](BenchmarkContext&, std::string*) -> std::unique_ptr<Benchmark> {
+        // Write the data.
+        BinaryEncoder coder;
+        for (auto i = 0; i != (1 << 20) / 8; ++i) {
+          coder.write(uint64_t(0xAABBCCDDAABBCCDDULL ^ i));
+        }
+        auto data = std::make_shared<std::vector<uint8_t>>(coder.contents());
+
+        return llvm::make_unique<FunctionBenchmark>(
+            [data](std::string* error_out) {
+          // We do 1000 iterations to sum to 1000 MBs.
+          for (int j = 0; j != 1000; ++j) {
+            BinaryDecoder decoder(*data);
+            for (auto i = 0; i != (1 << 20) / 8; ++i) {
+              uint64_t value;
+              decoder.read(value);
+              if (value != (0xAABBCCDDAABBCCDDULL ^ i)) {
+                *error_out = "unexpected decoded value";
+                return false;
+              }
+            }
+            decoder.finish();
+          }
+          return true;
+        });
+      });
+
+  registry.add(
+      "basic.subprocess.spawn", "spawn 200 processes", 10,
+      [](BenchmarkContext&, std::string*) -> std::unique_ptr<Benchmark> {
+        return llvm::make_unique<FunctionBenchmark>([](std::string* error_out) {
+          return spawnProcesses(ProcessAttributes{true}, error_out);
+        });
+      });
+
+  registry.add(
+      "basic.subprocess.spawn-working-directory",
+      "spawn 200 processes with a working directory", 10,
+      [](BenchmarkContext&, std::string*) -> std::unique_ptr<Benchmark> {
+        return llvm::make_unique<FunctionBenchmark>([](std::string* error_out) {
+          return spawnProcesses(ProcessAttributes{true, false, "/tmp"},
+                                error_out);
+        });
+      });
+}
@@ -0,0 +1,304 @@
+//===-- Benchmark.cpp -----------------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+
+#include "llbuild/Basic/Clock.h"
+#include "llbuild/Basic/JSON.h"
+#include "llbuild/Basic/Version.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace llbuild;
+using namespace llbuild::benchmarks;
+
+Benchmark::~Benchmark() {}
+
+#pragma mark - BenchmarkContext
+
+static bool runShellCommand(const std::string& command,
+                            std::string* error_out) {
+  int result = ::system(command.c_str());
+  if (result != 0) {
+    *error_out = "shell command failed (" + std::to_string(result) + "): " +
+      command;
+    return false;
+  }
+  return true;
+}
+
+static std::string quote(StringRef path) {
+  return "\"" + path.str() + "\"";
+}
+
+std::string BenchmarkContext::getInputPath(StringRef name) const {
+  SmallString<256> path(inputsPath);
+  llvm::sys::path::append(path, name);
+  return path.str();
+}
+
+std::string BenchmarkContext::createSandbox(StringRef name,
+                                            std::string* error_out) {
+  SmallString<256> path(sandboxRoot);
+  llvm::sys::path::append(path, name);
+  if (!runShellCommand("rm -rf " + quote(path), error_out) ||
+      !runShellCommand("mkdir -p " + quote(path), error_out))
+    return "";
+  return path.str();
+}
+
+bool BenchmarkContext::copyInput(StringRef name, StringRef destPath,
+                                 bool decompress, std::string* error_out) {
+  auto inputPath = getInputPath(name);
+  if (!llvm::sys::fs::exists(inputPath)) {
+    *error_out = "missing benchmark input: " + inputPath;
+    return false;
+  }
+
+  if (decompress) {
+    return runShellCommand("gzip -dc " + quote(inputPath) + " > " +
+                           quote(destPath), error_out);
+  }
+  return runShellCommand("cp " + quote(inputPath) + " " + quote(destPath),
+                         error_out);
+}
+
+bool BenchmarkContext::extractInput(StringRef name, StringRef destDir,
+                                    std::string* error_out) {
+  auto inputPath = getInputPath(name);
+  if (!llvm::sys::fs::exists(inputPath)) {
+    *error_out = "missing benchmark input: " + inputPath;
+    return false;
+  }
+
+  return runShellCommand("tar -C " + quote(destDir) + " -xzf " +
+                         quote(inputPath), error_out);
+}
+
+bool benchmarks::runToolCommand(
+    std::function<int(const std::vector<std::string>&)> entryPoint,
+    const std::vector<std::string>& args, std::string* error_out) {
+  SmallString<256> cwd;
+  if (llvm::sys::fs::current_path(cwd)) {
+    *error_out = "unable to determine the current working directory";
+    return false;
+  }
+
+  int result = entryPoint(args);
+
+  if (::chdir(cwd.c_str()) != 0) {
+    *error_out = "unable to restore the working directory";
+    return false;
+  }
+
+  if (result != 0) {
+    std::string command;
+    for (const auto& arg: args) {
+      if (!command.empty())
+        command += " ";
+      command += arg;
+    }
+    *error_out = "command failed (" + std::to_string(result) + "): " + command;
+    return false;
+  }
+  return true;
+}
+
+#pragma mark - Benchmark Runner
+
+namespace {
+
+/// A snapshot of the process CPU usage.
+struct CPUUsage {
+  double user;
+  double system;
+  uint64_t maxRSS;
+
+  static CPUUsage now() {
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    CPUUsage result;
+    result.user = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+    result.system = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#if defined(__APPLE__)
+    result.maxRSS = usage.ru_maxrss;
+#else
+    // Linux (and most other platforms) report the value in kilobytes.
+    result.maxRSS = uint64_t(usage.ru_maxrss) * 1024;
+#endif
+    return result;
+  }
+};
+
+/// Summary statistics over a list of samples.
+struct SampleStatistics {
+  double min = 0;
+  double max = 0;
+  double mean = 0;
+  double median = 0;
+  double stddev = 0;
+
+  explicit SampleStatistics(std::vector<double> samples) {
+    if (samples.empty())
+      return;
+
+    std::sort(samples.begin(), samples.end());
+    min = samples.front();
+    max = samples.back();
+    size_t n = samples.size();
+    median = (n % 2) ? samples[n / 2]
+                     : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+
+    double sum = 0;
+    for (auto sample: samples)
+      sum += sample;
+    mean = sum / n;
+
+    if (n > 1) {
+      double variance = 0;
+      for (auto sample: samples)
+        variance += (sample - mean) * (sample - mean);
+      stddev = std::sqrt(variance / (n - 1));
+    }
+  }
+};
+
+}
+
+BenchmarkResult benchmarks::runBenchmark(const BenchmarkInfo& info,
+                                         BenchmarkContext& context,
+                                         unsigned iterations) {
+  BenchmarkResult result;
+  result.name = info.name;
+
+  auto benchmark = info.factory(context, &result.error);
+  if (!benchmark) {
+    if (result.error.empty())
+      result.error = "benchmark setup failed";
+    return result;
+  }
+
+  for (unsigned i = 0; i != iterations; ++i) {
+    if (!benchmark->prepareIteration(&result.error))
+      break;
+
+    auto startUsage = CPUUsage::now();
+    auto start = basic::Clock::now();
+    bool success = benchmark->run(&result.error);
+    auto end = basic::Clock::now();
+    auto endUsage = CPUUsage::now();
+    if (!success)
+      break;
+
+    result.wallTimes.push_back(end - start);
+    result.userTimes.push_back(endUsage.user - startUsage.user);
+    result.systemTimes.push_back(endUsage.system - startUsage.system);
+  }
+
+  // Tear down the benchmark state before reporting, so that the next benchmark
+  // starts from a clean slate.
+  benchmark.reset();
+  result.maxRSS = CPUUsage::now().maxRSS;
+
+  return result;
+}
+
+static void writeStatisticsAsJSON(StringRef name,
+                                  const std::vector<double>& samples,
+                                  raw_ostream& os) {
+  SampleStatistics stats(samples);
+  os << "      \"" << name << "\": {\n";
+  os << "        \"samples\": [";
+  for (size_t i = 0, e = samples.size(); i != e; ++i) {
+    if (i != 0)
+      os << ", ";
+    os << llvm::format("%.6f", samples[i]);
+  }
+  os << "],\n";
+  os << "        \"min\": " << llvm::format("%.6f", stats.min) << ",\n";
+  os << "        \"max\": " << llvm::format("%.6f", stats.max) << ",\n";
+  os << "        \"mean\": " << llvm::format("%.6f", stats.mean) << ",\n";
+  os << "        \"median\": " << llvm::format("%.6f", stats.median) << ",\n";
+  os << "        \"stddev\": " << llvm::format("%.6f", stats.stddev) << "\n";
+  os << "      }";
+}
+
+void benchmarks::writeResultsAsJSON(const std::vector<BenchmarkResult>& results,
+                                    raw_ostream& os) {
+  char hostname[256] = {0};
+  ::gethostname(hostname, sizeof(hostname) - 1);
+
+  os << "{\n";
+  os << "  \"format-version\": 1,\n";
+  os << "  \"llbuild-version\": \""
+     << basic::escapeForJSON(getLLBuildFullVersion()) << "\",\n";
+  os << "  \"host\": \"" << basic::escapeForJSON(std::string(hostname))
+     << "\",\n";
+  os << "  \"unit\": \"seconds\",\n";
+  os << "  \"benchmarks\": [";
+  for (size_t i = 0, e = results.size(); i != e; ++i) {
+    const auto& result = results[i];
+    os << (i == 0 ? "\n" : ",\n");
+    os << "    {\n";
+    os << "      \"name\": \"" << basic::escapeForJSON(result.name) << "\",\n";
+    if (!result.error.empty()) {
+      os << "      \"error\": \"" << basic::escapeForJSON(result.error)
+         << "\",\n";
+    }
+    os << "      \"iterations\": " << result.wallTimes.size() << ",\n";
+    os << "      \"max-rss\": " << result.maxRSS << ",\n";
+    writeStatisticsAsJSON("wall", result.wallTimes, os);
+    os << ",\n";
+    writeStatisticsAsJSON("user", result.userTimes, os);
+    os << ",\n";
+    writeStatisticsAsJSON("system", result.systemTimes, os);
+    os << "\n    }";
+  }
+  os << "\n  ]\n";
+  os << "}\n";
+}
+
+void benchmarks::writeResultsAsText(const std::vector<BenchmarkResult>& results,
+                                    raw_ostream& os) {
+  size_t nameWidth = 10;
+  for (const auto& result: results)
+    nameWidth = std::max(nameWidth, result.name.size());
+
+  char buffer[512];
+  snprintf(buffer, sizeof(buffer), "%-*s %5s %10s %10s %10s %10s\n",
+           int(nameWidth), "benchmark", "iters", "min (s)", "median (s)",
+           "mean (s)", "stddev");
+  os << buffer;
+  for (const auto& result: results) {
+    SampleStatistics stats(result.wallTimes);
+    snprintf(buffer, sizeof(buffer), "%-*s %5u %10.4f %10.4f %10.4f %10.4f",
+             int(nameWidth), result.name.c_str(),
+             unsigned(result.wallTimes.size()), stats.min, stats.median,
+             stats.mean, stats.stddev);
+    os << buffer;
+    if (!result.error.empty())
+      os << "  error: " << result.error;
+    os << "\n";
+  }
+}
@@ -0,0 +1,198 @@
+//===- Benchmark.h ----------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the minimal harness used by the portable `llbuild-bench`
+// tool. Benchmarks are registered by name with a factory which performs any
+// (untimed) setup, and the runner then measures a number of iterations of the
+// returned benchmark and reports the results.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLBUILD_PERFTESTS_BENCHMARK_H
+#define LLBUILD_PERFTESTS_BENCHMARK_H
+
+#include "llbuild/Basic/Compiler.h"
+#include "llbuild/Basic/LLVM.h"
+
+#include "llvm/ADT/StringRef.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llbuild {
+namespace benchmarks {
+
+/// Shared state for a benchmark run.
+class BenchmarkContext {
+  /// The directory containing the benchmark input corpora.
+  std::string inputsPath;
+
+  /// The directory under which per-benchmark sandboxes are created.
+  std::string sandboxRoot;
+
+public:
+  BenchmarkContext(StringRef inputsPath, StringRef sandboxRoot)
+      : inputsPath(inputsPath), sandboxRoot(sandboxRoot) {}
+
+  /// Get the path of the named input file.
+  std::string getInputPath(StringRef name) const;
+
+  /// Create a fresh (empty) sandbox directory for the named benchmark.
+  ///
+  /// \returns The sandbox path, or the empty string on failure.
+  std::string createSandbox(StringRef name, std::string* error_out);
+
+  /// Copy the named (optionally gzip compressed) input into the sandbox.
+  ///
+  /// \param decompress If true, the input is expected to have a `.gz`
+  /// extension and is decompressed into \arg destPath.
+  bool copyInput(StringRef name, StringRef destPath, bool decompress,
+                 std::string* error_out);
+
+  /// Extract the named tarball input into the given directory.
+  bool extractInput(StringRef name, StringRef destDir, std::string* error_out);
+};
+
+/// A benchmark instance, which is created (and set up) by a registered factory.
+class Benchmark {
+  // DO NOT COPY
+  Benchmark(const Benchmark&) LLBUILD_DELETED_FUNCTION;
+  void operator=(const Benchmark&) LLBUILD_DELETED_FUNCTION;
+
+public:
+  Benchmark() {}
+  virtual ~Benchmark();
+
+  /// Perform any untimed work required before each iteration (for example,
+  /// removing a database to force a from scratch build).
+  virtual bool prepareIteration(std::string* error_out) { return true; }
+
+  /// Run one timed iteration of the benchmark.
+  virtual bool run(std::string* error_out) = 0;
+};
+
+/// A benchmark defined by a pair of functions.
+class FunctionBenchmark : public Benchmark {
+public:
+  typedef std::function<bool(std::string*)> FnType;
+
+private:
+  FnType runFn;
+  FnType prepareFn;
+
+public:
+  FunctionBenchmark(FnType runFn, FnType prepareFn = nullptr)
+      : runFn(runFn), prepareFn(prepareFn) {}
+
+  virtual bool prepareIteration(std::string* error_out) override {
+    return prepareFn ? prepareFn(error_out) : true;
+  }
+
+  virtual bool run(std::string* error_out) override {
+    return runFn(error_out);
+  }
+};
+
+/// Factory function for a benchmark, which is responsible for any setup.
+///
+/// \returns The benchmark, or null if setup failed (in which case \arg
+/// error_out is populated).
+typedef std::function<std::unique_ptr<Benchmark>(BenchmarkContext&,
+                                                 std::string* error_out)>
+    BenchmarkFactory;
+
+/// Information on a registered benchmark.
+struct BenchmarkInfo {
+  /// The unique (dotted) name of the benchmark, e.g. `ninja.llvm-only.null`.
+  std::string name;
+
+  /// A short description of what is measured.
+  std::string description;
+
+  /// The default number of measured iterations.
+  unsigned iterations;
+
+  /// The factory for the benchmark.
+  BenchmarkFactory factory;
+};
+
+/// The list of all known benchmarks.
+class BenchmarkRegistry {
+  std::vector<BenchmarkInfo> benchmarks;
+
+public:
+  void add(StringRef name, StringRef description, unsigned iterations,
+           BenchmarkFactory factory) {
+    benchmarks.push_back({name, description, iterations, factory});
+  }
+
+  const std::vector<BenchmarkInfo>& getBenchmarks() const {
+    return benchmarks;
+  }
+};
+
+/// The measurements for a single benchmark.
+struct BenchmarkResult {
+  std::string name;
+
+  /// The wall clock time of each iteration, in seconds.
+  std::vector<double> wallTimes;
+
+  /// The user CPU time of each iteration, in seconds.
+  std::vector<double> userTimes;
+
+  /// The system CPU time of each iteration, in seconds.
+  std::vector<double> systemTimes;
+
+  /// The peak resident set size of the process after the benchmark, in bytes.
+  uint64_t maxRSS = 0;
+
+  /// The error, if the benchmark failed.
+  std::string error;
+};
+
+/// Run a single benchmark.
+BenchmarkResult runBenchmark(const BenchmarkInfo& info,
+                             BenchmarkContext& context, unsigned iterations);
+
+/// Write the given results as JSON.
+void writeResultsAsJSON(const std::vector<BenchmarkResult>& results,
+                        raw_ostream& os);
+
+/// Write the given results as a human readable table.
+void writeResultsAsText(const std::vector<BenchmarkResult>& results,
+                        raw_ostream& os);
+
+/// Run an llbuild command-line tool entry point, preserving the working
+/// directory (which some subtools change).
+///
+/// \returns True if the command succeeded.
+bool runToolCommand(
+    std::function<int(const std::vector<std::string>&)> entryPoint,
+    const std::vector<std::string>& args, std::string* error_out);
+
+/// @name Benchmark Registration
+/// @{
+
+void registerBasicBenchmarks(BenchmarkRegistry& registry);
+void registerCoreBenchmarks(BenchmarkRegistry& registry);
+void registerNinjaBenchmarks(BenchmarkRegistry& registry);
+void registerBuildSystemBenchmarks(BenchmarkRegistry& registry);
+
+/// @}
+
+}
+}
+
+#endif
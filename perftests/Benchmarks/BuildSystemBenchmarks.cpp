@@ -0,0 +1,50 @@
+//===-- BuildSystemBenchmarks.cpp -----------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+
+#include "llbuild/Commands/Commands.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Path.h"
+
+using namespace llbuild;
+using namespace llbuild::benchmarks;
+
+void benchmarks::registerBuildSystemBenchmarks(BenchmarkRegistry& registry) {
+  // Test the build file parsing/loading time for the Chromium fake build file.
+  registry.add(
+      "buildsystem.chromium.parse",
+      "parse --no-output of the Chromium fake build file", 5,
+      [](BenchmarkContext& context,
+         std::string* error_out) -> std::unique_ptr<Benchmark> {
+        auto sandbox = context.createSandbox("ChromiumFakeBuildFileLoading",
+                                             error_out);
+        if (sandbox.empty())
+          return nullptr;
+        SmallString<256> buildFilePath(sandbox);
+        llvm::sys::path::append(buildFilePath,
+                                "chromium-fake-manifest.llbuild");
+        if (!context.copyInput("chromium-fake-manifest.llbuild.gz",
+                               buildFilePath, /*decompress=*/true, error_out))
+          return nullptr;
+
+        std::string path = buildFilePath.str();
+        return llvm::make_unique<FunctionBenchmark>(
+            [=](std::string* error_out) {
+              return runToolCommand(commands::executeBuildSystemCommand,
+                                    { "parse", "--no-output", path },
+                                    error_out);
+            });
+      });
+}
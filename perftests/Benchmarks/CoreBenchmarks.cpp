@@ -0,0 +1,856 @@
+//===-- CoreBenchmarks.cpp ------------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+
+#include "llbuild/Basic/ExecutionQueue.h"
+#include "llbuild/Basic/FileInfo.h"
+#include "llbuild/Commands/Commands.h"
+#include "llbuild/Core/BuildDB.h"
+#include "llbuild/Core/BuildEngine.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+#include <functional>
+#include <thread>
+
+using namespace llbuild;
+using namespace llbuild::benchmarks;
+using namespace llbuild::core;
+
+namespace {
+
+#pragma mark - Support Classes
+
+static int32_t intFromValue(const ValueType& value) {
+  if (value.size() != 4)
+    return -1;
+  return ((value[0] << 0) |
+          (value[1] << 8) |
+          (value[2] << 16) |
+          (value[3] << 24));
+}
+static ValueType intToValue(int32_t value) {
+  std::vector<uint8_t> result(4);
+  result[0] = (value >> 0) & 0xFF;
+  result[1] = (value >> 8) & 0xFF;
+  result[2] = (value >> 16) & 0xFF;
+  result[3] = (value >> 24) & 0xFF;
+  return result;
+}
+
+// Simple task implementation which takes a fixed set of dependencies, evaluates
+// them all, and then provides the output.
+//
+// FIXME: This is copied from the Core BuildEngine unittest, we should figure
+// out if it should be shared in a common build engine support library at some
+// point.
+class SimpleTask : public Task {
+public:
+  typedef std::function<int(const std::vector<int>&)> ComputeFnType;
+
+private:
+  std::vector<KeyType> inputs;
+  std::vector<int> inputValues;
+  ComputeFnType compute;
+
+public:
+  SimpleTask(const std::vector<KeyType>& inputs, ComputeFnType compute)
+    : inputs(inputs), compute(compute)
+  {
+    inputValues.resize(inputs.size());
+  }
+
+  virtual void start(TaskInterface ti) override {
+    // Request all of the inputs.
+    for (int i = 0, e = inputs.size(); i != e; ++i) {
+      ti.request(inputs[i], i);
+    }
+  }
+
+  virtual void provideValue(TaskInterface, uintptr_t inputID,
+                            const KeyType& key,
+                            const ValueType& value) override {
+    // Update the input values.
+    assert(inputID < inputValues.size());
+    inputValues[inputID] = intFromValue(value);
+  }
+
+  virtual void inputsAvailable(TaskInterface ti) override {
+    ti.complete(intToValue(compute(inputValues)));
+  }
+};
+
+/// Task which completes asynchronously, from a job on the execution queue.
+class AsyncTask : public Task, public basic::JobDescriptor {
+  KeyType key;
+  std::vector<KeyType> inputs;
+  int value = 0;
+
+public:
+  AsyncTask(const KeyType& key, const std::vector<KeyType>& inputs)
+    : key(key), inputs(inputs) {}
+
+  virtual void start(TaskInterface ti) override {
+    for (int i = 0, e = inputs.size(); i != e; ++i) {
+      ti.request(inputs[i], i);
+    }
+  }
+
+  virtual void provideValue(TaskInterface, uintptr_t, const KeyType&,
+                            const ValueType& inputValue) override {
+    value += intFromValue(inputValue);
+  }
+
+  virtual void inputsAvailable(TaskInterface ti) override {
+    ti.spawn({ this, [this, ti](basic::QueueJobContext*) mutable {
+      ti.complete(intToValue(value + 1));
+    }});
+  }
+
+  virtual StringRef getOrdinalName() const override { return key.str(); }
+  virtual void getShortDescription(SmallVectorImpl<char>&) const override {}
+  virtual void getVerboseDescription(SmallVectorImpl<char>&) const override {}
+};
+
+class SimpleRule: public Rule {
+public:
+  typedef std::function<bool(const ValueType& value)> ValidFnType;
+
+private:
+  SimpleTask::ComputeFnType compute;
+  std::vector<KeyType> inputs;
+  ValidFnType valid;
+
+public:
+  SimpleRule(const KeyType& key, SimpleTask::ComputeFnType compute,
+             const std::vector<KeyType>& inputs, ValidFnType valid = nullptr)
+    : Rule(key), compute(compute), inputs(inputs), valid(valid) { }
+
+  Task* createTask(BuildEngine&) override {
+    return new SimpleTask(inputs, compute);
+  }
+
+  bool isResultValid(BuildEngine&, const ValueType& value) override {
+    if (!valid) return true;
+    return valid(value);
+  }
+};
+
+class AsyncRule: public Rule {
+  std::vector<KeyType> inputs;
+
+public:
+  AsyncRule(const KeyType& key, const std::vector<KeyType>& inputs)
+    : Rule(key), inputs(inputs) { }
+
+  Task* createTask(BuildEngine&) override {
+    return new AsyncTask(key, inputs);
+  }
+
+  bool isResultValid(BuildEngine&, const ValueType&) override { return true; }
+};
+
+/// Delegate for synthetic graphs, which never expects dynamic rules or cycles.
+class SyntheticDelegate : public BuildEngineDelegate,
+                          public basic::ExecutionQueueDelegate {
+  /// The number of lanes to use, or zero for a serial queue.
+  unsigned numLanes;
+
+  /// The scheduler algorithm to use for the lanes.
+  basic::SchedulerAlgorithm schedulerAlgorithm;
+
+public:
+  std::string errorMessage;
+
+  explicit SyntheticDelegate(unsigned numLanes = 0,
+                             basic::SchedulerAlgorithm schedulerAlgorithm =
+                               basic::SchedulerAlgorithm::NamePriority)
+    : numLanes(numLanes), schedulerAlgorithm(schedulerAlgorithm) {}
+
+  virtual std::unique_ptr<Rule> lookupRule(const KeyType& key) override {
+    errorMessage = "unexpected rule lookup for \"" + key.str() + "\"";
+    return nullptr;
+  }
+
+  virtual void cycleDetected(const std::vector<Rule*>&) override {
+    errorMessage = "unexpected cycle";
+  }
+
+  virtual void error(const Twine& message) override {
+    errorMessage = message.str();
+  }
+
+  void processStarted(basic::ProcessContext*, basic::ProcessHandle,
+                      llbuild_pid_t) override { }
+  void processHadError(basic::ProcessContext*, basic::ProcessHandle,
+                       const Twine&) override { }
+  void processHadOutput(basic::ProcessContext*, basic::ProcessHandle,
+                        StringRef) override { }
+  void processFinished(basic::ProcessContext*, basic::ProcessHandle,
+                       const basic::ProcessResult&) override { }
+  void queueJobStarted(basic::JobDescriptor*) override { }
+  void queueJobFinished(basic::JobDescriptor*) override { }
+
+  std::unique_ptr<basic::ExecutionQueue> createExecutionQueue() override {
+    if (numLanes == 0)
+      return basic::createSerialQueue(*this, nullptr);
+    return std::unique_ptr<basic::ExecutionQueue>(
+        basic::createLaneBasedExecutionQueue(
+            *this, numLanes, schedulerAlgorithm,
+            basic::QualityOfService::Normal, nullptr));
+  }
+};
+
+static int64_t i64pow(int64_t value, int64_t exponent) {
+  int64_t result = 1;
+  for (int64_t i = 0; i != exponent; ++i)
+    result *= value;
+  return result;
+}
+
+static std::string nodeName(int i) {
+  return "i" + std::to_string(i);
+}
+
+static std::string nodeName(int i, int j) {
+  return "i" + std::to_string(i) + "," + std::to_string(j);
+}
+
+/// Add rules for a 2D {M}x{N} matrix where each node depends on the nodes
+/// which are adjacent above or to the right::
+///
+///   i1,N --> i2,N --> ... --> iM,N
+///    ^        ^       ...      ^
+///    |        |                |
+///   i1,1 --> i2,1 --> ... --> iM,1
+static void addMatrixRules(BuildEngine& engine, int M, int N,
+                           const int* lastInputValue) {
+  auto first = [] (const std::vector<int>& inputs) { return inputs[0]; };
+  for (int i = 1; i <= M; ++i) {
+    for (int j = 1; j <= N; ++j) {
+      std::vector<KeyType> inputs;
+      if (i != M)
+        inputs.push_back(nodeName(i + 1, j));
+      if (j != N)
+        inputs.push_back(nodeName(i, j + 1));
+      if (!inputs.empty()) {
+        engine.addRule(llvm::make_unique<SimpleRule>(
+                           nodeName(i, j), first, inputs));
+      } else {
+        engine.addRule(llvm::make_unique<SimpleRule>(
+            nodeName(i, j),
+            [=] (const std::vector<int>&) { return *lastInputValue; }, inputs,
+            [=] (const ValueType& value) {
+              return *lastInputValue == intFromValue(value);
+            }));
+      }
+    }
+  }
+}
+
+/// Benchmark of the null build time of a synthetic graph.
+class SyntheticGraphBenchmark : public Benchmark {
+  SyntheticDelegate delegate;
+  BuildEngine engine;
+  KeyType rootKey;
+  int lastInputValue = 42;
+
+public:
+  typedef std::function<void(BuildEngine&, const int* lastInputValue)>
+    AddRulesFnType;
+
+  SyntheticGraphBenchmark(KeyType rootKey)
+    : engine(delegate), rootKey(rootKey) {}
+
+  bool setUp(AddRulesFnType addRules, std::string* error_out) {
+    addRules(engine, &lastInputValue);
+
+    // Build the initial result, and run a single null build to warm the
+    // timings.
+    for (int i = 0; i != 2; ++i) {
+      if (!run(error_out))
+        return false;
+    }
+    return true;
+  }
+
+  virtual bool run(std::string* error_out) override {
+    auto result = intFromValue(engine.build(rootKey));
+    if (!delegate.errorMessage.empty()) {
+      *error_out = delegate.errorMessage;
+      return false;
+    }
+    if (result != lastInputValue) {
+      *error_out = "unexpected build result";
+      return false;
+    }
+    return true;
+  }
+};
+
+static BenchmarkFactory
+syntheticGraph(KeyType rootKey, SyntheticGraphBenchmark::AddRulesFnType fn) {
+  return [=](BenchmarkContext&,
+             std::string* error_out) -> std::unique_ptr<Benchmark> {
+    auto benchmark = llvm::make_unique<SyntheticGraphBenchmark>(rootKey);
+    if (!benchmark->setUp(fn, error_out))
+      return nullptr;
+    return std::move(benchmark);
+  };
+}
+
+/// Benchmark of the engine scheduling overhead for a wide graph of rules which
+/// complete asynchronously on the execution queue.
+class SchedulingBenchmark : public Benchmark {
+  unsigned numLanes;
+  basic::SchedulerAlgorithm schedulerAlgorithm;
+  int width;
+  int depth;
+
+  std::unique_ptr<SyntheticDelegate> delegate;
+  std::unique_ptr<BuildEngine> engine;
+
+public:
+  SchedulingBenchmark(unsigned numLanes,
+                      basic::SchedulerAlgorithm schedulerAlgorithm, int width,
+                      int depth)
+    : numLanes(numLanes), schedulerAlgorithm(schedulerAlgorithm), width(width),
+      depth(depth) {}
+
+  virtual bool prepareIteration(std::string*) override {
+    // Each iteration is a from scratch build of a fresh engine.
+    engine.reset();
+    delegate = llvm::make_unique<SyntheticDelegate>(numLanes,
+                                                    schedulerAlgorithm);
+    engine = llvm::make_unique<BuildEngine>(*delegate);
+
+    // The graph is `depth` layers of `width` independent rules, where each
+    // rule depends on the corresponding rule in the layer below.
+    std::vector<KeyType> roots;
+    for (int j = 1; j <= width; ++j) {
+      for (int i = 1; i <= depth; ++i) {
+        std::vector<KeyType> inputs;
+        if (i != depth)
+          inputs.push_back(nodeName(i + 1, j));
+        engine->addRule(llvm::make_unique<AsyncRule>(nodeName(i, j), inputs));
+      }
+      roots.push_back(nodeName(1, j));
+    }
+    engine->addRule(llvm::make_unique<AsyncRule>("root", roots));
+    return true;
+  }
+
+  virtual bool run(std::string* error_out) override {
+    auto result = intFromValue(engine->build("root"));
+    if (!delegate->errorMessage.empty()) {
+      *error_out = delegate->errorMessage;
+      return false;
+    }
+    if (result != width * depth + 1) {
+      *error_out = "unexpected build result";
+      return false;
+    }
+    return true;
+  }
+};
+
+/// Rule for an input file, whose value is the file size.
+class FileSizeRule : public Rule {
+  std::string path;
+
+  static int getFileSize(StringRef path) {
+    auto info = basic::FileInfo::getInfoForPath(path);
+    return info.isMissing() ? -1 : int(info.size);
+  }
+
+public:
+  FileSizeRule(const KeyType& key, StringRef path) : Rule(key), path(path) {}
+
+  Task* createTask(BuildEngine&) override {
+    int size = getFileSize(path);
+    return new SimpleTask({}, [=](const std::vector<int>&) { return size; });
+  }
+
+  bool isResultValid(BuildEngine&, const ValueType& value) override {
+    return getFileSize(path) == intFromValue(value);
+  }
+};
+
+/// Benchmark of the null build time of a wide graph of file inputs, where
+/// every input must be stat'd to check it is unchanged.
+///
+/// The graph is a root depending on `numGroups` rules, which each depend on
+/// `numFilesPerGroup` files.
+class ParallelScanBenchmark : public Benchmark {
+  SyntheticDelegate delegate;
+  BuildEngine engine;
+  int numGroups;
+  int numFilesPerGroup;
+
+public:
+  ParallelScanBenchmark(unsigned numThreads, int numGroups,
+                        int numFilesPerGroup)
+    : engine(delegate), numGroups(numGroups),
+      numFilesPerGroup(numFilesPerGroup)
+  {
+    engine.enableParallelScanning(numThreads);
+  }
+
+  bool setUp(StringRef sandbox, std::string* error_out) {
+    auto sum = [] (const std::vector<int>& inputs) {
+      int result = 0;
+      for (int value: inputs)
+        result += value;
+      return result;
+    };
+
+    std::vector<KeyType> groups;
+    for (int i = 1; i <= numGroups; ++i) {
+      std::vector<KeyType> files;
+      for (int j = 1; j <= numFilesPerGroup; ++j) {
+        SmallString<256> path(sandbox);
+        llvm::sys::path::append(path, nodeName(i, j));
+        std::error_code ec;
+        llvm::raw_fd_ostream os(path, ec, llvm::sys::fs::F_None);
+        if (ec) {
+          *error_out = "unable to create input file: " + ec.message();
+          return false;
+        }
+        os << "x";
+
+        files.push_back(path.str());
+        engine.addRule(llvm::make_unique<FileSizeRule>(path.str(), path));
+      }
+      groups.push_back(nodeName(i));
+      engine.addRule(llvm::make_unique<SimpleRule>(nodeName(i), sum, files));
+    }
+    engine.addRule(llvm::make_unique<SimpleRule>("root", sum, groups));
+
+    // Build the initial result.
+    return run(error_out);
+  }
+
+  virtual bool run(std::string* error_out) override {
+    auto result = intFromValue(engine.build("root"));
+    if (!delegate.errorMessage.empty()) {
+      *error_out = delegate.errorMessage;
+      return false;
+    }
+    if (result != numGroups * numFilesPerGroup) {
+      *error_out = "unexpected build result";
+      return false;
+    }
+    return true;
+  }
+};
+
+#pragma mark - Build Database Benchmarks
+
+/// Minimal BuildDBDelegate for a fixed list of keys.
+class FixedKeysDBDelegate : public BuildDBDelegate {
+  std::vector<KeyType> keys;
+  llvm::StringMap<KeyID> keyIDs;
+
+public:
+  explicit FixedKeysDBDelegate(std::vector<KeyType>&& keysIn)
+    : keys(std::move(keysIn)) {
+    for (const auto& key: keys)
+      keyIDs[key.str()] = KeyID(&key);
+  }
+
+  const std::vector<KeyType>& getKeys() const { return keys; }
+
+  KeyID getKeyIDForIndex(size_t index) const { return KeyID(&keys[index]); }
+
+  virtual const KeyID getKeyID(StringRef key) override {
+    return keyIDs[key];
+  }
+
+  virtual KeyType getKeyForID(const KeyID key) override {
+    return *reinterpret_cast<const KeyType*>(uintptr_t(key.value()));
+  }
+};
+
+class NullRule : public Rule {
+public:
+  NullRule(const KeyType& key) : Rule(key) {}
+  Task* createTask(BuildEngine&) override { return nullptr; }
+  bool isResultValid(BuildEngine&, const ValueType&) override { return true; }
+};
+
+/// Benchmark of raw writes and reads of rule results to a build database.
+class DBRoundTripBenchmark : public Benchmark {
+  BuildDBFormat format;
+  std::string dbPath;
+  bool measureWrites;
+  FixedKeysDBDelegate keys;
+  std::vector<std::unique_ptr<NullRule>> rules;
+
+  static std::vector<KeyType> makeKeys(int numKeys) {
+    std::vector<KeyType> result;
+    result.reserve(numKeys);
+    for (int i = 0; i != numKeys; ++i)
+      result.push_back(nodeName(i));
+    return result;
+  }
+
+  std::unique_ptr<BuildDB> open(std::string* error_out) {
+    auto db = createBuildDB(format, dbPath, /*clientSchemaVersion=*/1,
+                            /*recreateUnmatchedVersion=*/true, error_out);
+    if (db)
+      db->attachDelegate(&keys);
+    return db;
+  }
+
+  bool writeAll(std::string* error_out) {
+    auto db = open(error_out);
+    if (!db || !db->buildStarted(error_out))
+      return false;
+
+    size_t numKeys = keys.getKeys().size();
+    Result result;
+    result.value = intToValue(42);
+    result.computedAt = result.builtAt = 1;
+    for (size_t i = 0; i != numKeys; ++i) {
+      // Give each result a pair of dependencies, to exercise the encoding.
+      result.dependencies.clear();
+      result.dependencies.push_back(keys.getKeyIDForIndex((i + 1) % numKeys),
+                                    false, false);
+      result.dependencies.push_back(keys.getKeyIDForIndex((i + 2) % numKeys),
+                                    true, false);
+      if (!db->setRuleResult(keys.getKeyIDForIndex(i), *rules[i], result,
+                             error_out))
+        return false;
+    }
+    db->buildComplete();
+    return true;
+  }
+
+public:
+  DBRoundTripBenchmark(BuildDBFormat format, StringRef dbPath, int numKeys,
+                       bool measureWrites)
+    : format(format), dbPath(dbPath), measureWrites(measureWrites),
+      keys(makeKeys(numKeys)) {
+    rules.reserve(numKeys);
+    for (const auto& key: keys.getKeys())
+      rules.push_back(llvm::make_unique<NullRule>(key));
+  }
+
+  bool setUp(std::string* error_out) {
+    // Populate the database once for the read benchmark.
+    return measureWrites || writeAll(error_out);
+  }
+
+  virtual bool prepareIteration(std::string* error_out) override {
+    if (measureWrites)
+      llvm::sys::fs::remove(dbPath);
+    return true;
+  }
+
+  virtual bool run(std::string* error_out) override {
+    if (measureWrites)
+      return writeAll(error_out);
+
+    auto db = open(error_out);
+    if (!db)
+      return false;
+    for (size_t i = 0, e = keys.getKeys().size(); i != e; ++i) {
+      Result result;
+      if (!db->lookupRuleResult(keys.getKeyIDForIndex(i), *rules[i], &result,
+                                error_out)) {
+        if (error_out->empty())
+          *error_out = "missing result for " + rules[i]->key.str();
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+/// Benchmark of a null build of a fresh engine against an existing database,
+/// which measures the cost of loading all of the prior results.
+class DBNullBuildBenchmark : public Benchmark {
+  BuildDBFormat format;
+  std::string dbPath;
+  int M, N;
+  bool preload;
+  int lastInputValue = 42;
+
+  bool build(std::string* error_out) {
+    SyntheticDelegate delegate;
+    BuildEngine engine(delegate);
+    auto db = createBuildDB(format, dbPath, 1, true, error_out);
+    if (db && preload)
+      db = createPreloadingBuildDB(std::move(db));
+    if (!db || !engine.attachDB(std::move(db), error_out))
+      return false;
+    addMatrixRules(engine, M, N, &lastInputValue);
+    auto result = intFromValue(engine.build(nodeName(1, 1)));
+    if (!delegate.errorMessage.empty()) {
+      *error_out = delegate.errorMessage;
+      return false;
+    }
+    if (result != lastInputValue) {
+      *error_out = "unexpected build result";
+      return false;
+    }
+    return true;
+  }
+
+public:
+  DBNullBuildBenchmark(BuildDBFormat format, StringRef dbPath, int M, int N,
+                       bool preload)
+    : format(format), dbPath(dbPath), M(M), N(N), preload(preload) {}
+
+  bool setUp(std::string* error_out) {
+    llvm::sys::fs::remove(dbPath);
+    return build(error_out);
+  }
+
+  virtual bool run(std::string* error_out) override {
+    return build(error_out);
+  }
+};
+
+static std::string getDBPath(BenchmarkContext& context, StringRef name,
+                             std::string* error_out) {
+  auto sandbox = context.createSandbox(name, error_out);
+  if (sandbox.empty())
+    return "";
+  SmallString<256> path(sandbox);
+  llvm::sys::path::append(path, "build.db");
+  return path.str();
+}
+
+}
+
+void benchmarks::registerCoreBenchmarks(BenchmarkRegistry& registry) {
+  // Test the timing of 'buildengine ack 3 14'.
+  //
+  // This test uses ~300k rules, and is a good stress test for the core engine
+  // operation.
+  registry.add(
+      "core.ack", "buildengine ack 3 14 (~300k rules)", 5,
+      [](BenchmarkContext&, std::string*) -> std::unique_ptr<Benchmark> {
+        return llvm::make_unique<FunctionBenchmark>([](std::string* error_out) {
+          return runToolCommand(commands::executeBuildEngineCommand,
+                                { "ack", "3", "14" }, error_out);
+        });
+      });
+
+  // Test the timing of 'buildengine ack 3 11', with a high recompute count.
+  //
+  // This test uses ~40k rules, but then recomputes the results multiple times,
+  // which is a stress test of the dependency scanning performance.
+  registry.add(
+      "core.ack-recompute", "buildengine ack --recompute 100 3 11", 5,
+      [](BenchmarkContext&, std::string*) -> std::unique_ptr<Benchmark> {
+        return llvm::make_unique<FunctionBenchmark>([](std::string* error_out) {
+          return runToolCommand(commands::executeBuildEngineCommand,
+                                { "ack", "--recompute", "100", "3", "11" },
+                                error_out);
+        });
+      });
+
+  // Test the scanning performance on a deep linear build graph of M nodes::
+  //
+  //   i1 -> i2 -> ... -> iM
+  registry.add(
+      "core.scan.linear-chain", "null build of a 1M node linear chain", 10,
+      syntheticGraph(nodeName(1), [](BuildEngine& engine,
+                                     const int* lastInputValue) {
+        int M = 1000000;
+        for (int i = 1; i <= M; ++i) {
+          if (i != M) {
+            engine.addRule(llvm::make_unique<SimpleRule>(
+                nodeName(i),
+                [] (const std::vector<int>& inputs) { return inputs[0]; },
+                std::vector<KeyType>{ nodeName(i + 1) }));
+          } else {
+            engine.addRule(llvm::make_unique<SimpleRule>(
+                nodeName(i),
+                [=] (const std::vector<int>&) { return *lastInputValue; },
+                std::vector<KeyType>{},
+                [=] (const ValueType& value) {
+                  return *lastInputValue == intFromValue(value);
+                }));
+          }
+        }
+      }));
+
+  // Test the scanning performance on an M-height N-ary tree with no sharing::
+  //
+  //   i1,1 ---> i2,1 ... ---> iM,1
+  //         \-> i2,2       ...
+  //         \-> i2,N          iM,{N**(M-1)}
+  registry.add(
+      "core.scan.nary-tree", "null build of a 13-deep 3-ary tree (797k nodes)",
+      10, syntheticGraph(nodeName(1, 1), [](BuildEngine& engine,
+                                            const int* lastInputValue) {
+        int M = 13, N = 3;
+        for (int i = 1; i <= M; ++i) {
+          // Compute the total number of groups at this depth.
+          int numNodes = i64pow(N, i - 1);
+          for (int j = 1; j <= numNodes; ++j) {
+            if (i != M) {
+              std::vector<KeyType> inputs;
+              for (int k = 1; k <= N; ++k)
+                inputs.push_back(nodeName(i + 1, 1 + (j - 1) * N + (k - 1)));
+              engine.addRule(llvm::make_unique<SimpleRule>(
+                  nodeName(i, j),
+                  [] (const std::vector<int>& inputs) { return inputs[0]; },
+                  inputs));
+            } else {
+              engine.addRule(llvm::make_unique<SimpleRule>(
+                  nodeName(i, j),
+                  [=] (const std::vector<int>&) { return *lastInputValue; },
+                  std::vector<KeyType>{},
+                  [=] (const ValueType& value) {
+                    return *lastInputValue == intFromValue(value);
+                  }));
+            }
+          }
+        }
+      }));
+
+  // Test the scanning performance on a 2D matrix, which is an easy to construct
+  // synthetic graph which is scalable and has sharing.
+  registry.add(
+      "core.scan.matrix", "null build of a 100x100 matrix with sharing", 10,
+      syntheticGraph(nodeName(1, 1), [](BuildEngine& engine,
+                                        const int* lastInputValue) {
+        addMatrixRules(engine, 100, 100, lastInputValue);
+      }));
+
+  // Test the scaling of parallel scanning, on a null build of 100x200 files,
+  // with an increasing number of scan threads (zero is the serial scan).
+  for (unsigned numThreads: { 0, 1, 2, 4, 8 }) {
+    std::string name = "core.parallel-scan." + std::to_string(numThreads) +
+      "-threads";
+    std::string description = "null build of 20k file inputs, " +
+      (numThreads ? "scanned on " + std::to_string(numThreads) + " threads" :
+       std::string("scanned serially"));
+    registry.add(
+        name, description, 5,
+        [=](BenchmarkContext& context,
+            std::string* error_out) -> std::unique_ptr<Benchmark> {
+          auto sandbox = context.createSandbox(name, error_out);
+          if (sandbox.empty())
+            return nullptr;
+          auto benchmark = llvm::make_unique<ParallelScanBenchmark>(
+              numThreads, 100, 200);
+          if (!benchmark->setUp(sandbox, error_out))
+            return nullptr;
+          return std::move(benchmark);
+        });
+  }
+
+  // Test the engine scheduling overhead, for tasks which complete on the
+  // execution queue.
+  registry.add(
+      "core.scheduling.serial-queue",
+      "from scratch build of 100x100 async tasks on a serial queue", 5,
+      [](BenchmarkContext&, std::string*) -> std::unique_ptr<Benchmark> {
+        return llvm::make_unique<SchedulingBenchmark>(
+            0, basic::SchedulerAlgorithm::NamePriority, 100, 100);
+      });
+  registry.add(
+      "core.scheduling.lane-queue",
+      "from scratch build of 100x100 async tasks on a lane based queue", 5,
+      [](BenchmarkContext&, std::string*) -> std::unique_ptr<Benchmark> {
+        unsigned numLanes = std::max(2u, std::thread::hardware_concurrency());
+        return llvm::make_unique<SchedulingBenchmark>(
+            numLanes, basic::SchedulerAlgorithm::NamePriority, 100, 100);
+      });
+  registry.add(
+      "core.scheduling.work-stealing-queue",
+      "from scratch build of 100x100 async tasks on a work-stealing queue", 5,
+      [](BenchmarkContext&, std::string*) -> std::unique_ptr<Benchmark> {
+        unsigned numLanes = std::max(2u, std::thread::hardware_concurrency());
+        return llvm::make_unique<SchedulingBenchmark>(
+            numLanes, basic::SchedulerAlgorithm::WorkStealing, 100, 100);
+      });
+
+  // Test the raw database round trip performance, for each database format.
+  const struct {
+    const char* name;
+    BuildDBFormat format;
+  } dbFormats[] = {
+    { "sqlite-db", BuildDBFormat::SQLite },
+    { "log-db", BuildDBFormat::Log },
+  };
+  for (const auto& entry: dbFormats) {
+    std::string prefix = std::string("core.") + entry.name;
+    BuildDBFormat format = entry.format;
+    registry.add(
+        prefix + ".write", "write 100k rule results to a fresh database", 5,
+        [=](BenchmarkContext& context,
+            std::string* error_out) -> std::unique_ptr<Benchmark> {
+          auto dbPath = getDBPath(context, prefix + ".write", error_out);
+          if (dbPath.empty())
+            return nullptr;
+          auto benchmark = llvm::make_unique<DBRoundTripBenchmark>(
+              format, dbPath, 100000, /*measureWrites=*/true);
+          if (!benchmark->setUp(error_out))
+            return nullptr;
+          return std::move(benchmark);
+        });
+    registry.add(
+        prefix + ".read", "read 100k rule results from a database", 5,
+        [=](BenchmarkContext& context,
+            std::string* error_out) -> std::unique_ptr<Benchmark> {
+          auto dbPath = getDBPath(context, prefix + ".read", error_out);
+          if (dbPath.empty())
+            return nullptr;
+          auto benchmark = llvm::make_unique<DBRoundTripBenchmark>(
+              format, dbPath, 100000, /*measureWrites=*/false);
+          if (!benchmark->setUp(error_out))
+            return nullptr;
+          return std::move(benchmark);
+        });
+    registry.add(
+        prefix + ".null-build",
+        "null build of a 100x100 matrix by a fresh engine with a database", 5,
+        [=](BenchmarkContext& context,
+            std::string* error_out) -> std::unique_ptr<Benchmark> {
+          auto dbPath = getDBPath(context, prefix + ".null-build", error_out);
+          if (dbPath.empty())
+            return nullptr;
+          auto benchmark = llvm::make_unique<DBNullBuildBenchmark>(
+              format, dbPath, 100, 100, /*preload=*/false);
+          if (!benchmark->setUp(error_out))
+            return nullptr;
+          return std::move(benchmark);
+        });
+    registry.add(
+        prefix + ".preload-null-build",
+        "null build of a 100x100 matrix by a fresh engine with a preloaded "
+        "database", 5,
+        [=](BenchmarkContext& context,
+            std::string* error_out) -> std::unique_ptr<Benchmark> {
+          auto dbPath = getDBPath(context, prefix + ".preload-null-build",
+                                  error_out);
+          if (dbPath.empty())
+            return nullptr;
+          auto benchmark = llvm::make_unique<DBNullBuildBenchmark>(
+              format, dbPath, 100, 100, /*preload=*/true);
+          if (!benchmark->setUp(error_out))
+            return nullptr;
+          return std::move(benchmark);
+        });
+  }
+}
@@ -0,0 +1,290 @@
+//===-- NinjaBenchmarks.cpp -----------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+
+#include "llbuild/Basic/FileInfo.h"
+#include "llbuild/Basic/FileSystem.h"
+#include "llbuild/Commands/Commands.h"
+#include "llbuild/Ninja/Manifest.h"
+#include "llbuild/Ninja/ManifestLoader.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+
+#include <unordered_set>
+
+using namespace llbuild;
+using namespace llbuild::benchmarks;
+
+namespace {
+
+/// The target used for the llvm-only benchmarks, which executes 266 commands.
+static const char* llvmOnlyTargetName = "N478";
+
+static std::string appendPath(StringRef base, StringRef component) {
+  SmallString<256> path(base);
+  llvm::sys::path::append(path, component);
+  return path.str();
+}
+
+static bool runNinja(const std::vector<std::string>& args,
+                     std::string* error_out) {
+  return runToolCommand(commands::executeNinjaCommand, args, error_out);
+}
+
+/// Create a benchmark which builds the llvm-only manifest in simulation mode.
+///
+/// \param nullBuild If true, the database is built once up front and each
+/// iteration measures a null build, otherwise each iteration measures the time
+/// to write the initial from scratch database.
+static std::unique_ptr<Benchmark>
+createLLVMOnlyBenchmark(BenchmarkContext& context, StringRef name,
+                        bool nullBuild, std::string* error_out) {
+  auto sandbox = context.createSandbox(name, error_out);
+  if (sandbox.empty())
+    return nullptr;
+  auto ninjaPath = appendPath(sandbox, "build.ninja");
+  if (!context.copyInput("llvm-only.ninja", ninjaPath, /*decompress=*/false,
+                         error_out))
+    return nullptr;
+
+  auto dbPath = appendPath(sandbox, "build.db");
+  std::vector<std::string> args = {
+    "build", "--quiet", "--jobs", "1", "--simulate",
+    "--db", dbPath, "-f", ninjaPath, llvmOnlyTargetName };
+
+  if (nullBuild) {
+    // Build once to create a fresh initial database.
+    if (!runNinja(args, error_out))
+      return nullptr;
+    return llvm::make_unique<FunctionBenchmark>(
+        [=](std::string* error_out) { return runNinja(args, error_out); });
+  }
+
+  return llvm::make_unique<FunctionBenchmark>(
+      [=](std::string* error_out) { return runNinja(args, error_out); },
+      [=](std::string*) {
+        // For each iteration, remove the database file.
+        llvm::sys::fs::remove(dbPath);
+        return true;
+      });
+}
+
+/// Create a benchmark which builds the pseudo LLVM tree, which includes the
+/// time to do the actual stat'ing and dependency checking of files, and in
+/// particular includes all the overhead of the database.
+static std::unique_ptr<Benchmark>
+createPseudoLLVMBenchmark(BenchmarkContext& context, StringRef name,
+                          bool nullBuild, std::string* error_out) {
+  auto sandbox = context.createSandbox(name, error_out);
+  if (sandbox.empty())
+    return nullptr;
+  if (!context.extractInput("pseudo-llvm.tgz", sandbox, error_out))
+    return nullptr;
+
+  auto pseudoLLVMPath = appendPath(sandbox, "pseudo-llvm");
+  auto dbPath = appendPath(pseudoLLVMPath, "build.db");
+  std::vector<std::string> args = {
+    "build", "--quiet", "-C", pseudoLLVMPath, "all" };
+
+  // Build once to prime the tree.
+  if (!runNinja(args, error_out))
+    return nullptr;
+
+  if (nullBuild) {
+    return llvm::make_unique<FunctionBenchmark>(
+        [=](std::string* error_out) { return runNinja(args, error_out); });
+  }
+
+  return llvm::make_unique<FunctionBenchmark>(
+      [=](std::string* error_out) { return runNinja(args, error_out); },
+      [=](std::string*) {
+        // For each iteration, remove the database file.
+        llvm::sys::fs::remove(dbPath);
+        return true;
+      });
+}
+
+class BenchmarkLoaderActions : public ninja::ManifestLoaderActions {
+public:
+  std::string firstError;
+
+  virtual void initialize(ninja::ManifestLoader*) override {}
+
+  virtual void error(StringRef filename, StringRef message,
+                     const ninja::Token&) override {
+    if (firstError.empty())
+      firstError = (filename + ": " + message).str();
+  }
+
+  virtual std::unique_ptr<llvm::MemoryBuffer>
+  readFile(StringRef path, StringRef, const ninja::Token*) override {
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) {
+      firstError = "unable to read '" + path.str() + "'";
+      return nullptr;
+    }
+    return std::move(*buffer);
+  }
+};
+
+/// Create a file tree for the Chromium fake manifest, with an (empty) file for
+/// each node which isn't produced by a phony command.
+///
+/// \param paths_out On success, the canonical paths of all of the nodes.
+static bool createChromiumTree(BenchmarkContext& context, StringRef name,
+                               std::vector<std::string>& paths_out,
+                               std::string* error_out) {
+  auto sandbox = context.createSandbox(name, error_out);
+  if (sandbox.empty())
+    return false;
+  auto ninjaPath = appendPath(sandbox, "build.ninja");
+  if (!context.copyInput("chromium-fake-manifest.ninja.gz", ninjaPath,
+                         /*decompress=*/true, error_out))
+    return false;
+
+  BenchmarkLoaderActions actions;
+  ninja::ManifestLoader loader(sandbox, ninjaPath, actions);
+  auto manifest = loader.load();
+  if (!actions.firstError.empty()) {
+    *error_out = actions.firstError;
+    return false;
+  }
+
+  std::unordered_set<ninja::Node*> phonyOutputs;
+  for (auto* command: manifest->getCommands()) {
+    if (command->getRule() == manifest->getPhonyRule())
+      phonyOutputs.insert(command->getOutputs().begin(),
+                          command->getOutputs().end());
+  }
+
+  for (const auto& entry: manifest->getNodes()) {
+    auto* node = entry.getValue();
+    paths_out.push_back(node->getCanonicalPath());
+    if (phonyOutputs.count(node))
+      continue;
+
+    const auto& path = node->getCanonicalPath();
+    llvm::sys::fs::create_directories(llvm::sys::path::parent_path(path));
+    std::error_code ec;
+    llvm::raw_fd_ostream os(path, ec, llvm::sys::fs::F_None);
+    if (ec) {
+      *error_out = "unable to create '" + path + "': " + ec.message();
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Create a benchmark which retrieves the file information for every node in
+/// the Chromium fake manifest, as the first scan of a null build does.
+///
+/// \param batched If true, the information is prefetched in bulk into the
+/// per-build cache, otherwise each path is stat'ed in turn on a cache miss.
+static std::unique_ptr<Benchmark>
+createChromiumStatBenchmark(BenchmarkContext& context, StringRef name,
+                            bool batched, std::string* error_out) {
+  auto paths = std::make_shared<std::vector<std::string>>();
+  if (!createChromiumTree(context, name, *paths, error_out))
+    return nullptr;
+
+  return llvm::make_unique<FunctionBenchmark>(
+      [=](std::string* error_out) {
+        basic::StatCachingFileSystem fs(basic::createLocalFileSystem());
+        if (batched)
+          fs.prefetchFileInfo(*paths);
+        unsigned numMissing = 0;
+        for (const auto& path: *paths)
+          numMissing += fs.getFileInfo(path).isMissing();
+        if (numMissing == paths->size()) {
+          *error_out = "no files found";
+          return false;
+        }
+        return true;
+      });
+}
+
+}
+
+void benchmarks::registerNinjaBenchmarks(BenchmarkRegistry& registry) {
+  // Test the Ninja parsing/loading time for the Chromium fake manifest.
+  registry.add(
+      "ninja.chromium.load-manifest",
+      "load-manifest-only of the Chromium fake manifest", 5,
+      [](BenchmarkContext& context,
+         std::string* error_out) -> std::unique_ptr<Benchmark> {
+        auto sandbox = context.createSandbox("ChromiumFakeManifestLoading",
+                                             error_out);
+        if (sandbox.empty())
+          return nullptr;
+        auto ninjaPath = appendPath(sandbox, "build.ninja");
+        if (!context.copyInput("chromium-fake-manifest.ninja.gz", ninjaPath,
+                               /*decompress=*/true, error_out))
+          return nullptr;
+        return llvm::make_unique<FunctionBenchmark>(
+            [=](std::string* error_out) {
+              return runNinja({ "load-manifest-only", ninjaPath }, error_out);
+            });
+      });
+
+  registry.add(
+      "ninja.chromium.stat-serial",
+      "serially stat every node of the Chromium fake manifest", 5,
+      [](BenchmarkContext& context, std::string* error_out) {
+        return createChromiumStatBenchmark(
+            context, "ChromiumFakeStatSerial", false, error_out);
+      });
+
+  registry.add(
+      "ninja.chromium.stat-prefetch",
+      "prefetch file information for every node of the Chromium fake "
+      "manifest", 5,
+      [](BenchmarkContext& context, std::string* error_out) {
+        return createChromiumStatBenchmark(
+            context, "ChromiumFakeStatPrefetch", true, error_out);
+      });
+
+  registry.add(
+      "ninja.llvm-only.initial-build",
+      "simulated from scratch build of llvm-only.ninja (266 commands)", 5,
+      [](BenchmarkContext& context, std::string* error_out) {
+        return createLLVMOnlyBenchmark(
+            context, "LLVMOnlyNoExecuteInitialBuild", false, error_out);
+      });
+
+  registry.add(
+      "ninja.llvm-only.null-build",
+      "simulated null build of llvm-only.ninja (266 commands)", 10,
+      [](BenchmarkContext& context, std::string* error_out) {
+        return createLLVMOnlyBenchmark(
+            context, "LLVMOnlyNoExecuteNullBuild", true, error_out);
+      });
+
+  registry.add(
+      "ninja.pseudo-llvm.full-build",
+      "full build of the pseudo LLVM tree, with the database removed", 5,
+      [](BenchmarkContext& context, std::string* error_out) {
+        return createPseudoLLVMBenchmark(
+            context, "PseudoLLVMParallelFullBuild", false, error_out);
+      });
+
+  registry.add(
+      "ninja.pseudo-llvm.null-build", "null build of the pseudo LLVM tree", 10,
+      [](BenchmarkContext& context, std::string* error_out) {
+        return createPseudoLLVMBenchmark(
+            context, "PseudoLLVMParallelNullBuild", true, error_out);
+      });
+}
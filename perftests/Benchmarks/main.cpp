@@ -0,0 +1,171 @@
+//===-- main.cpp - llbuild Benchmark Suite --------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+
+#include "llbuild/Commands/Commands.h"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace llbuild;
+using namespace llbuild::benchmarks;
+
+static void usage(int exitCode = 1) {
+  int optionWidth = 20;
+  fprintf(stderr, "Usage: %s [options] [<filter> ...]\n",
+          commands::getProgramName());
+  fprintf(stderr, "\nRun the benchmarks whose names contain any <filter>.\n");
+  fprintf(stderr, "\nOptions:\n");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--help",
+          "show this help message and exit");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--list",
+          "list the available benchmarks and exit");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--iterations <N>",
+          "override the number of measured iterations");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--inputs <PATH>",
+          "the directory containing the benchmark inputs");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--sandbox <PATH>",
+          "the directory in which to create benchmark sandboxes");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "-o, --output <PATH>",
+          "write the results as JSON to PATH");
+  fprintf(stderr, "  %-*s %s\n", optionWidth, "--json",
+          "write the results as JSON to stdout");
+  ::exit(exitCode);
+}
+
+int main(int argc, const char** argv) {
+  commands::setProgramName("llbuild-bench");
+
+  std::vector<std::string> args(argv + 1, argv + argc);
+  std::vector<std::string> filters;
+  std::string inputsPath = LLBUILD_BENCH_INPUTS_PATH;
+  std::string sandboxPath = LLBUILD_BENCH_TEMPS_PATH;
+  std::string outputPath;
+  unsigned iterations = 0;
+  bool listOnly = false;
+  bool jsonToStdout = false;
+
+  while (!args.empty()) {
+    const std::string option = args[0];
+    args.erase(args.begin());
+
+    if (option == "--help") {
+      usage(0);
+    } else if (option == "--list") {
+      listOnly = true;
+    } else if (option == "--json") {
+      jsonToStdout = true;
+    } else if (option == "--iterations" || option == "--inputs" ||
+               option == "--sandbox" || option == "-o" ||
+               option == "--output") {
+      if (args.empty()) {
+        fprintf(stderr, "%s: error: missing argument to '%s'\n\n",
+                commands::getProgramName(), option.c_str());
+        usage();
+      }
+      std::string value = args[0];
+      args.erase(args.begin());
+
+      if (option == "--iterations") {
+        char* end;
+        iterations = ::strtol(value.c_str(), &end, 10);
+        if (*end != '\0' || iterations == 0) {
+          fprintf(stderr, "%s: error: invalid argument '%s' to '%s'\n\n",
+                  commands::getProgramName(), value.c_str(), option.c_str());
+          usage();
+        }
+      } else if (option == "--inputs") {
+        inputsPath = value;
+      } else if (option == "--sandbox") {
+        sandboxPath = value;
+      } else {
+        outputPath = value;
+      }
+    } else if (!option.empty() && option[0] == '-') {
+      fprintf(stderr, "%s: error: invalid option '%s'\n\n",
+              commands::getProgramName(), option.c_str());
+      usage();
+    } else {
+      filters.push_back(option);
+    }
+  }
+
+  BenchmarkRegistry registry;
+  registerBasicBenchmarks(registry);
+  registerCoreBenchmarks(registry);
+  registerNinjaBenchmarks(registry);
+  registerBuildSystemBenchmarks(registry);
+
+  std::vector<const BenchmarkInfo*> selected;
+  for (const auto& info: registry.getBenchmarks()) {
+    bool matches = filters.empty();
+    for (const auto& filter: filters) {
+      if (info.name.find(filter) != std::string::npos) {
+        matches = true;
+        break;
+      }
+    }
+    if (matches)
+      selected.push_back(&info);
+  }
+
+  if (listOnly) {
+    for (const auto* info: selected) {
+      printf("%-44s %s\n", info->name.c_str(), info->description.c_str());
+    }
+    return 0;
+  }
+
+  if (selected.empty()) {
+    fprintf(stderr, "%s: error: no benchmarks match the given filters\n",
+            commands::getProgramName());
+    return 1;
+  }
+
+  BenchmarkContext context(inputsPath, sandboxPath);
+  std::vector<BenchmarkResult> results;
+  bool hadFailure = false;
+  for (const auto* info: selected) {
+    fprintf(stderr, "running %s...\n", info->name.c_str());
+    results.push_back(runBenchmark(*info, context,
+                                   iterations ? iterations : info->iterations));
+    if (!results.back().error.empty()) {
+      fprintf(stderr, "%s: error: %s: %s\n", commands::getProgramName(),
+              info->name.c_str(), results.back().error.c_str());
+      hadFailure = true;
+    }
+  }
+
+  if (jsonToStdout) {
+    writeResultsAsJSON(results, llvm::outs());
+  } else {
+    writeResultsAsText(results, llvm::outs());
+  }
+
+  if (!outputPath.empty()) {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(outputPath, ec, llvm::sys::fs::F_Text);
+    if (ec) {
+      fprintf(stderr, "%s: error: unable to open '%s': %s\n",
+              commands::getProgramName(), outputPath.c_str(),
+              ec.message().c_str());
+      return 1;
+    }
+    writeResultsAsJSON(results, os);
+  }
+
+  return hadFailure ? 1 : 0;
+}
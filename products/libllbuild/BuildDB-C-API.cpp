@@ -120,13 +120,13 @@ public:
     return buildKey;
   }
   
-  virtual const KeyID getKeyID(const KeyType& key) override {
+  virtual const KeyID getKeyID(StringRef key) override {
     std::lock_guard<std::mutex> guard(keyTableMutex);
     
     // The RHS of the mapping is actually ignored, we use the StringMap's ptr
     // identity because it allows us to efficiently map back to the key string
     // in `getRuleInfoForKey`.
-    auto it = keyTable.insert(std::make_pair(key.str(), KeyID::novalue())).first;
+    auto it = keyTable.try_emplace(key, KeyID::novalue()).first;
     return KeyID(it->getKey().data());
   }
   
@@ -140,6 +140,10 @@ public:
   bool lookupRuleResult(const KeyType &key, Result *result_out, std::string *error_out) {
     return _db.get()->lookupRuleResult(this->getKeyID(key), key, result_out, error_out);
   }
+
+  bool lookupRuleStatistics(const KeyType &key, RuleStatistics *statistics_out, std::string *error_out) {
+    return _db.get()->lookupRuleStatistics(this->getKeyID(key), statistics_out, error_out);
+  }
   
   bool buildStarted(std::string *error_out) {
     return _db.get()->buildStarted(error_out);
@@ -294,6 +298,30 @@ bool llb_database_lookup_rule_result(llb_database_t *database, llb_build_key_t *
   return stored;
 }
 
+bool llb_database_lookup_rule_statistics(llb_database_t *database, llb_build_key_t *key, llb_database_rule_statistics_t *statistics_out, llb_data_t *error_out) {
+  
+  auto db = (CAPIBuildDB *)database;
+  
+  std::string error;
+  RuleStatistics statistics;
+  
+  auto stored = db->lookupRuleStatistics(((CAPIBuildKey *)key)->getInternalBuildKey().toData(), &statistics, &error);
+  
+  if (stored && statistics_out) {
+    statistics_out->run_count = statistics.runCount;
+    statistics_out->weighted_duration = statistics.weightedDuration;
+    statistics_out->peak_rss = statistics.peakRSS;
+    statistics_out->output_bytes = statistics.outputBytes;
+  }
+  
+  if (!error.empty() && error_out) {
+    error_out->length = error.size();
+    error_out->data = (const uint8_t*)strdup(error.c_str());
+  }
+  
+  return stored;
+}
+
 llb_database_key_id llb_database_fetch_result_get_count(llb_database_fetch_result_t *result) {
   auto resultKeys = (CAPIBuildDBFetchResult *)result;
   return resultKeys->size();
@@ -45,6 +45,8 @@ using namespace llbuild::basic;
 using namespace llbuild::buildsystem;
 
 static Optional<QualityOfService> getQoSFromLLBQoS(llb_quality_of_service_t level);
+static SchedulerAlgorithm
+getSchedulerAlgorithmFromLLB(llb_scheduler_algorithm_t algorithm);
 
 /* Build Engine API */
 
@@ -616,6 +618,8 @@ public:
     invocation.environment = cAPIInvocation.environment;
     invocation.useSerialBuild = cAPIInvocation.useSerialBuild;
     invocation.showVerboseStatus = cAPIInvocation.showVerboseStatus;
+    invocation.schedulerAlgorithm =
+      getSchedulerAlgorithmFromLLB(cAPIInvocation.schedulerAlgorithm);
     invocation.schedulerLanes = cAPIInvocation.schedulerLanes;
     invocation.qos = getQoSFromLLBQoS(cAPIInvocation.qos);
 
@@ -1489,6 +1493,23 @@ static Optional<QualityOfService> getQoSFromLLBQoS(llb_quality_of_service_t leve
   }
 }
 
+static SchedulerAlgorithm
+getSchedulerAlgorithmFromLLB(llb_scheduler_algorithm_t algorithm) {
+  switch (algorithm) {
+  case llb_scheduler_algorithm_command_name_priority:
+    return SchedulerAlgorithm::NamePriority;
+  case llb_scheduler_algorithm_fifo:
+    return SchedulerAlgorithm::FIFO;
+  case llb_scheduler_algorithm_work_stealing:
+    return SchedulerAlgorithm::WorkStealing;
+  case llb_scheduler_algorithm_critical_path:
+    return SchedulerAlgorithm::CriticalPath;
+  default:
+    assert(0 && "unknown scheduler algorithm");
+    return SchedulerAlgorithm::NamePriority;
+  }
+}
+
 void llb_set_quality_of_service(llb_quality_of_service_t level) {
   assert(level != llb_quality_of_service_unspecified);
   Optional<QualityOfService> qos = getQoSFromLLBQoS(level);
@@ -183,7 +183,16 @@ typedef enum LLBUILD_ENUM_ATTRIBUTES {
   llb_scheduler_algorithm_command_name_priority LLBUILD_SWIFT_NAME(commandNamePriority) = 0,
 
   /// First in, first out
-  llb_scheduler_algorithm_fifo = 1
+  llb_scheduler_algorithm_fifo = 1,
+
+  /// Per-lane first in, first out queues, with idle lanes stealing jobs from
+  /// busy ones
+  llb_scheduler_algorithm_work_stealing LLBUILD_SWIFT_NAME(workStealing) = 2,
+
+  /// Priority queue based scheduling, dispatching the commands with the longest
+  /// estimated critical path (from the durations recorded in the build
+  /// database) first
+  llb_scheduler_algorithm_critical_path LLBUILD_SWIFT_NAME(criticalPath) = 3
 } llb_scheduler_algorithm_t LLBUILD_SWIFT_NAME(SchedulerAlgorithm);
 
 /// Quality of service levels.
@@ -77,6 +77,25 @@ llb_database_lookup_rule_result(llb_database_t *database, llb_build_key_t *key,
 LLBUILD_EXPORT void
 llb_database_destroy_result(llb_database_result_t *result);
 
+/// The execution statistics recorded for a rule
+typedef struct llb_database_rule_statistics_t_ {
+  /// The number of times the rule's task has run
+  uint64_t run_count;
+
+  /// The exponentially weighted average duration of the task, in seconds
+  double weighted_duration;
+
+  /// The peak resident set size of the processes run by the most recent task, in bytes
+  uint64_t peak_rss;
+
+  /// The total size of the outputs written by the most recent task, in bytes
+  uint64_t output_bytes;
+} llb_database_rule_statistics_t LLBUILD_SWIFT_NAME(BuildDBRuleStatistics);
+
+/// Lookup the execution statistics of a rule in the database. Returns `false` if no statistics have been recorded for the rule, or if an error occurred (in which case error_out is set and needs to be freed).
+LLBUILD_EXPORT bool
+llb_database_lookup_rule_statistics(llb_database_t *database, llb_build_key_t *key, llb_database_rule_statistics_t *statistics_out, llb_data_t *error_out);
+
 /// Opaque pointer to a fetch result for getting all keys (with or without results) from the database
 typedef struct llb_database_result_keys_t_ llb_database_fetch_result_t;
 
@@ -314,6 +314,20 @@ public final class BuildDB {
         return mappedResult
     }
 
+    /// Get the execution statistics recorded for a given key
+    public func lookupRuleStatistics(buildKey: BuildKey) throws -> BuildDBRuleStatistics? {
+        let errorPtr = MutableStringPointer()
+        var statistics = BuildDBRuleStatistics()
+        
+        let stored = llb_database_lookup_rule_statistics(_database, buildKey.internalBuildKey, &statistics, &errorPtr.ptr)
+        
+        if let error = errorPtr.msg {
+            throw Error.operationDidFail(error: error)
+        }
+        
+        return stored ? statistics : nil
+    }
+
     public func currentBuildEpoch() throws -> UInt64 {
         let errorPtr = MutableStringPointer()
         let epoch = llb_database_get_epoch(_database, &errorPtr.ptr)
@@ -662,6 +662,10 @@ extension SchedulerAlgorithm {
             self = .commandNamePriority
         case "fifo":
             self = .fifo
+        case "workStealing":
+            self = .workStealing
+        case "criticalPath":
+            self = .criticalPath
         default:
             return nil
         }
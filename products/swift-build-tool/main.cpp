@@ -93,7 +93,9 @@ static int execute(ArrayRef<std::string> args) {
 
   // Create the frontend object.
   BasicBuildSystemFrontendDelegate delegate(sourceMgr, invocation);
-  BuildSystemFrontend frontend(delegate, invocation, basic::createLocalFileSystem());
+  BuildSystemFrontend frontend(
+      delegate, invocation,
+      basic::createLocalFileSystem(invocation.checksumAlgorithm));
   if (!frontend.build(targetToBuild)) {
     return 1;
   }
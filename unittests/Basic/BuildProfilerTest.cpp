@@ -0,0 +1,103 @@
+//===- unittests/Basic/BuildProfilerTest.cpp ------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "../BuildSystem/TempDir.h"
+
+#include "llbuild/Basic/BuildProfiler.h"
+#include "llbuild/Basic/Subprocess.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+
+#include "gtest/gtest.h"
+
+using namespace llbuild;
+using namespace llbuild::basic;
+
+namespace {
+
+TEST(BuildProfilerTest, basic) {
+  TmpDir tempDir{ __func__ };
+  SmallString<256> path{ tempDir.str() };
+  llvm::sys::path::append(path, "profile.json");
+
+  int scannedOnly, ran, skipped;
+  {
+    BuildProfiler profiler;
+
+    // Notifications are ignored until the profiler is opened.
+    EXPECT_FALSE(profiler.isOpen());
+    profiler.commandStarted(&ran, "ignored", 0);
+    profiler.commandFinished(&ran);
+
+    std::string error;
+    ASSERT_TRUE(profiler.open(path, &error)) << error;
+    EXPECT_TRUE(profiler.isOpen());
+
+    // A command which is up-to-date is not written.
+    profiler.commandScanning(&scannedOnly);
+    profiler.commandFinished(&scannedOnly);
+
+    // A command which runs two processes.
+    profiler.commandScanning(&ran);
+    profiler.commandPreparing(&ran);
+    profiler.commandQueued(&ran);
+    profiler.commandStarted(&ran, "compile \"a.c\"", 3);
+    profiler.commandProcessFinished(
+        &ran, ProcessResult(ProcessStatus::Succeeded, 0, 1, 10, 20, 4096));
+    profiler.commandProcessFinished(
+        &ran, ProcessResult(ProcessStatus::Succeeded, 0, 2, 30, 40, 1024));
+    profiler.commandFinished(&ran);
+
+    // A command which never started is not written.
+    profiler.commandPreparing(&skipped);
+    profiler.commandQueued(&skipped);
+    profiler.commandFinished(&skipped);
+
+    // Finishing a command again is ignored.
+    profiler.commandFinished(&ran);
+
+    ASSERT_TRUE(profiler.close(&error)) << error;
+    EXPECT_FALSE(profiler.isOpen());
+  }
+
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  ASSERT_TRUE(bool(buffer));
+  StringRef contents = (*buffer)->getBuffer();
+
+  EXPECT_TRUE(contents.startswith("{ \"traceEvents\": [\n"));
+  EXPECT_TRUE(contents.endswith("\n], \"displayTimeUnit\": \"ms\" }\n"));
+  EXPECT_NE(contents.find("\"tid\": 3, \"args\": { \"name\": \"lane 3\" }"),
+            StringRef::npos);
+  EXPECT_EQ(contents.count("\"ph\": \"X\""), 1U);
+  EXPECT_NE(contents.find("{ \"name\": \"compile \\\"a.c\\\"\", "
+                          "\"cat\": \"command\", \"ph\": \"X\", \"pid\": 0, "
+                          "\"tid\": 3, \"ts\": "), StringRef::npos);
+  EXPECT_NE(contents.find("\"args\": { \"scan_us\": "), StringRef::npos);
+  EXPECT_NE(contents.find(", \"input_wait_us\": "), StringRef::npos);
+  EXPECT_NE(contents.find(", \"queue_wait_us\": "), StringRef::npos);
+  EXPECT_NE(contents.find(", \"processes\": 2, \"utime_us\": 40, "
+                          "\"stime_us\": 60, \"maxrss_bytes\": 4096 } }"),
+            StringRef::npos);
+  EXPECT_EQ(contents.find("ignored"), StringRef::npos);
+}
+
+TEST(BuildProfilerTest, openError) {
+  BuildProfiler profiler;
+  std::string error;
+  EXPECT_FALSE(profiler.open("/does/not/exist/profile.json", &error));
+  EXPECT_NE(error.find("unable to open"), std::string::npos);
+  EXPECT_FALSE(profiler.isOpen());
+}
+
+}
@@ -0,0 +1,128 @@
+//===- unittests/Basic/ContentHashingTest.cpp -----------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "../BuildSystem/TempDir.h"
+
+#include "llbuild/Basic/ContentHashing.h"
+#include "llbuild/Basic/FileInfo.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace llbuild;
+using namespace llbuild::basic;
+
+namespace {
+
+std::string hexString(ArrayRef<uint8_t> bytes) {
+  std::string result;
+  llvm::raw_string_ostream os(result);
+  for (auto byte: bytes)
+    os << llvm::format_hex_no_prefix(byte, 2);
+  return os.str();
+}
+
+ArrayRef<uint8_t> bytesOf(StringRef str) {
+  return { reinterpret_cast<const uint8_t*>(str.data()), str.size() };
+}
+
+/// The input used by the BLAKE3 reference test vectors.
+std::vector<uint8_t> testInput(size_t length) {
+  std::vector<uint8_t> result(length);
+  for (size_t i = 0; i != length; ++i)
+    result[i] = uint8_t(i % 251);
+  return result;
+}
+
+TEST(ContentHashingTest, xxh64) {
+  EXPECT_EQ(hashXXH64({}), 0xef46db3751d8e999ull);
+  EXPECT_EQ(hashXXH64(bytesOf("abc")), 0x44bc2cf5ad770999ull);
+
+  // Small inputs are hashed directly.
+  EXPECT_EQ(hashXXH64Blocks(bytesOf("abc"), 4), hashXXH64(bytesOf("abc")));
+
+  // Large inputs don't depend on the number of threads.
+  auto data = testInput(3 * xxh64BlockSize + 17);
+  EXPECT_EQ(hashXXH64Blocks(data, 1), hashXXH64Blocks(data, 4));
+  EXPECT_NE(hashXXH64Blocks(data, 1), hashXXH64(data));
+}
+
+TEST(ContentHashingTest, blake3) {
+  EXPECT_EQ(hexString(hashBLAKE3({}, 1)),
+            "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262");
+  EXPECT_EQ(hexString(hashBLAKE3(bytesOf("abc"), 1)),
+            "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85");
+  EXPECT_EQ(hexString(hashBLAKE3(testInput(1024), 1)),
+            "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7");
+  EXPECT_EQ(hexString(hashBLAKE3(testInput(1025), 1)),
+            "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444");
+  EXPECT_EQ(hexString(hashBLAKE3(testInput(102400), 1)),
+            "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085");
+
+  // Large inputs don't depend on the number of threads.
+  for (size_t length: { 2 * 1024 * 1024 + 1, 5 * 1024 * 1024 + 77 }) {
+    auto data = testInput(length);
+    EXPECT_EQ(hashBLAKE3(data, 1), hashBLAKE3(data, 4));
+  }
+}
+
+TEST(ContentHashingTest, fileChecksums) {
+  TmpDir tempDir{ __func__ };
+  SmallString<256> path{ tempDir.str() };
+  llvm::sys::path::append(path, "file.txt");
+  {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(path.str(), ec, llvm::sys::fs::F_Text);
+    EXPECT_FALSE(ec);
+    os << "Hello, world!";
+  }
+
+  auto platform = FileChecksum::getChecksumForPath(
+      path.str(), FileChecksumAlgorithm::Platform);
+  auto xxh64 = FileChecksum::getChecksumForPath(
+      path.str(), FileChecksumAlgorithm::XXH64);
+  auto blake3 = FileChecksum::getChecksumForPath(
+      path.str(), FileChecksumAlgorithm::BLAKE3);
+
+  // Checksums from different algorithms never compare equal.
+  EXPECT_NE(platform, FileChecksum());
+  EXPECT_NE(platform, xxh64);
+  EXPECT_NE(platform, blake3);
+  EXPECT_NE(xxh64, blake3);
+  EXPECT_EQ(xxh64.bytes[FileChecksum::algorithmByte], 1);
+  EXPECT_EQ(blake3.bytes[FileChecksum::algorithmByte], 2);
+  auto expected = hashBLAKE3(bytesOf("Hello, world!"), 1);
+  EXPECT_TRUE(std::equal(expected.begin(),
+                         expected.begin() + FileChecksum::algorithmByte,
+                         blake3.bytes));
+
+  // Missing files have an empty checksum, regardless of the algorithm.
+  EXPECT_EQ(FileChecksum::getChecksumForPath(
+                "/does/not/exist", FileChecksumAlgorithm::BLAKE3),
+            FileChecksum());
+
+  FileChecksumAlgorithm algorithm;
+  EXPECT_TRUE(parseFileChecksumAlgorithm("blake3", &algorithm));
+  EXPECT_EQ(algorithm, FileChecksumAlgorithm::BLAKE3);
+  EXPECT_FALSE(parseFileChecksumAlgorithm("sha1", &algorithm));
+}
+
+}
@@ -24,6 +24,9 @@
 
 #include "gtest/gtest.h"
 
+#include <atomic>
+#include <chrono>
+
 using namespace llbuild;
 using namespace llbuild::basic;
 
@@ -154,6 +157,49 @@ TEST(FileSystemTest, testRecursiveRemovalDoesNotFollowSymlinks) {
   EXPECT_EQ(0, sys::stat(otherFile.c_str(), &statbuf));
 }
 
+TEST(FileSystemTest, getFileInfos) {
+  TmpDir tempDir(__func__);
+
+  // Use enough paths that the information is retrieved in batches, rather
+  // than one path at a time.
+  std::vector<std::string> paths;
+  for (unsigned i = 0; i != 300; ++i) {
+    SmallString<256> path{ tempDir.str() };
+    llvm::sys::path::append(path, "file-" + std::to_string(i));
+    paths.push_back(path.str());
+
+    // Leave every third file missing, and link every fifth to its predecessor.
+    if (i % 3 == 0)
+      continue;
+    if (i % 5 == 0) {
+      EXPECT_EQ(sys::symlink(paths[i - 1].c_str(), path.c_str()), 0);
+      continue;
+    }
+    std::error_code ec;
+    llvm::raw_fd_ostream os(path.str(), ec, llvm::sys::fs::F_Text);
+    EXPECT_FALSE(ec);
+    os << std::string(i, 'x');
+  }
+  paths.push_back(tempDir.str());
+
+  for (bool asLink: { false, true }) {
+    std::vector<FileInfo> infos(paths.size());
+    FileInfo::getInfoForPaths(paths, infos, asLink);
+    for (unsigned i = 0; i != paths.size(); ++i) {
+      auto expected = FileInfo::getInfoForPath(paths[i], asLink);
+      EXPECT_TRUE(infos[i] == expected) << paths[i];
+      EXPECT_EQ(infos[i].mode, expected.mode) << paths[i];
+    }
+  }
+
+  // The file system interface should produce the same results.
+  auto fs = createLocalFileSystem();
+  std::vector<FileInfo> infos(paths.size());
+  fs->getFileInfos(paths, infos);
+  for (unsigned i = 0; i != paths.size(); ++i)
+    EXPECT_TRUE(infos[i] == fs->getFileInfo(paths[i])) << paths[i];
+}
+
 TEST(DeviceAgnosticFileSystemTest, basic) {
   // Check basic sanity of the local filesystem object.
   auto fs = DeviceAgnosticFileSystem::from(createLocalFileSystem());
@@ -222,4 +268,300 @@ TEST(ChecksumOnlyFileSystem, basic) {
   EXPECT_FALSE(ec);
 }
 
+
+/// A file system which counts the file information requests it serves.
+class CountingFileSystem : public FileSystem {
+  std::unique_ptr<FileSystem> impl = createLocalFileSystem();
+
+public:
+  std::atomic<unsigned> numInfoRequests{0};
+  std::atomic<unsigned> numChecksumRequests{0};
+
+  virtual bool createDirectory(const std::string& path) override {
+    return impl->createDirectory(path);
+  }
+
+  virtual std::unique_ptr<llvm::MemoryBuffer>
+  getFileContents(const std::string& path) override {
+    return impl->getFileContents(path);
+  }
+
+  virtual bool remove(const std::string& path) override {
+    return impl->remove(path);
+  }
+
+  virtual FileChecksum getFileChecksum(const std::string& path) override {
+    ++numChecksumRequests;
+    return impl->getFileChecksum(path);
+  }
+
+  virtual FileInfo getFileInfo(const std::string& path) override {
+    ++numInfoRequests;
+    return impl->getFileInfo(path);
+  }
+
+  virtual FileInfo getLinkInfo(const std::string& path) override {
+    ++numInfoRequests;
+    return impl->getLinkInfo(path);
+  }
+
+  virtual bool createSymlink(const std::string& src,
+                             const std::string& target) override {
+    return impl->createSymlink(src, target);
+  }
+};
+
+TEST(StatCachingFileSystemTest, basic) {
+  TmpDir tempDir{"StatCachingFileSystemTest"};
+  auto countingFS = new CountingFileSystem();
+  StatCachingFileSystem fs{std::unique_ptr<FileSystem>(countingFS)};
+
+  std::string dir = tempDir.str();
+  std::string file = dir + "/file.txt";
+  auto writeFile = [&](StringRef contents) {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(file, ec, llvm::sys::fs::F_Text);
+    EXPECT_FALSE(ec);
+    os << contents;
+  };
+
+  // Repeated requests are served from the cache.
+  EXPECT_TRUE(fs.getFileInfo(file).isMissing());
+  EXPECT_TRUE(fs.getFileInfo(file).isMissing());
+  EXPECT_EQ(countingFS->numInfoRequests, 1u);
+  auto dirInfo = fs.getFileInfo(dir);
+  EXPECT_TRUE(dirInfo.isDirectory());
+  EXPECT_EQ(countingFS->numInfoRequests, 2u);
+
+  // Modifications made by other means are not observed until the path is
+  // invalidated, which also invalidates its parent directory.
+  writeFile("Hello");
+  EXPECT_TRUE(fs.getFileInfo(file).isMissing());
+  fs.invalidateFileInfo(file);
+  EXPECT_EQ(fs.getFileInfo(file).size, 5u);
+  fs.getFileInfo(dir);
+  EXPECT_EQ(countingFS->numInfoRequests, 4u);
+
+  // Link information is cached separately.
+  EXPECT_EQ(fs.getLinkInfo(file).size, 5u);
+  EXPECT_EQ(fs.getLinkInfo(file).size, 5u);
+  EXPECT_EQ(countingFS->numInfoRequests, 5u);
+
+  // Clearing the cache discards everything.
+  writeFile("Hello, world!");
+  fs.clear();
+  EXPECT_EQ(fs.getFileInfo(file).size, 13u);
+  EXPECT_EQ(fs.getLinkInfo(file).size, 13u);
+  EXPECT_EQ(countingFS->numInfoRequests, 7u);
+
+  // Modifications made through the file system invalidate their entries,
+  // including the entries within a removed directory.
+  std::string subdir = dir + "/subdir";
+  EXPECT_TRUE(fs.getFileInfo(subdir).isMissing());
+  EXPECT_TRUE(fs.createDirectory(subdir));
+  EXPECT_TRUE(fs.getFileInfo(subdir).isDirectory());
+  std::string link = subdir + "/link";
+  EXPECT_TRUE(fs.getLinkInfo(link).isMissing());
+  EXPECT_TRUE(fs.createSymlink(file, link));
+  EXPECT_FALSE(fs.getLinkInfo(link).isMissing());
+  EXPECT_TRUE(fs.remove(subdir));
+  EXPECT_TRUE(fs.getLinkInfo(link).isMissing());
+  EXPECT_TRUE(fs.getFileInfo(subdir).isMissing());
+}
+
+#if defined(__linux__)
+TEST(StatCachingFileSystemTest, journal) {
+  TmpDir tempDir{"StatCachingFileSystemTest"};
+  auto countingFS = new CountingFileSystem();
+  StatCachingFileSystem fs{std::unique_ptr<FileSystem>(countingFS)};
+  std::string error;
+  auto journal = createFileChangeJournal(&error);
+  ASSERT_TRUE(journal) << error;
+  fs.attachJournal(std::move(journal));
+
+  std::string dir = tempDir.str();
+  std::string file = dir + "/file.txt";
+  std::string other = dir + "/other.txt";
+  auto writeFile = [&](StringRef path, StringRef contents) {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(path, ec, llvm::sys::fs::F_Text);
+    EXPECT_FALSE(ec);
+    os << contents;
+  };
+  writeFile(other, "Other");
+
+  // Revalidating keeps the information for unchanged paths.
+  EXPECT_TRUE(fs.getFileInfo(file).isMissing());
+  EXPECT_EQ(fs.getFileInfo(other).size, 5u);
+  EXPECT_EQ(countingFS->numInfoRequests, 2u);
+  fs.revalidate();
+  EXPECT_TRUE(fs.getFileInfo(file).isMissing());
+  EXPECT_EQ(fs.getFileInfo(other).size, 5u);
+  EXPECT_EQ(countingFS->numInfoRequests, 2u);
+
+  // Only the changed paths are read again.
+  writeFile(file, "Hello");
+  fs.revalidate();
+  EXPECT_EQ(fs.getFileInfo(file).size, 5u);
+  EXPECT_EQ(fs.getFileInfo(other).size, 5u);
+  EXPECT_EQ(countingFS->numInfoRequests, 3u);
+
+  // Paths whose directory does not exist are not cached.
+  std::string subdir = dir + "/subdir";
+  std::string nested = subdir + "/nested.txt";
+  EXPECT_TRUE(fs.getFileInfo(nested).isMissing());
+  EXPECT_TRUE(fs.getFileInfo(nested).isMissing());
+  EXPECT_EQ(countingFS->numInfoRequests, 5u);
+
+  // Replacing a watched directory discards everything below it.
+  ASSERT_FALSE(llvm::sys::fs::create_directory(subdir));
+  writeFile(nested, "Nested");
+  fs.revalidate();
+  EXPECT_EQ(fs.getFileInfo(nested).size, 6u);
+  EXPECT_EQ(countingFS->numInfoRequests, 6u);
+  ASSERT_FALSE(llvm::sys::fs::rename(subdir, dir + "/moved"));
+  ASSERT_FALSE(llvm::sys::fs::create_directory(subdir));
+  fs.revalidate();
+  EXPECT_TRUE(fs.getFileInfo(nested).isMissing());
+
+  // Changing the entries of a watched directory invalidates the directory.
+  EXPECT_TRUE(fs.getFileInfo(subdir).isDirectory());
+  fs.revalidate();
+  unsigned numRequests = countingFS->numInfoRequests;
+  EXPECT_TRUE(fs.getFileInfo(subdir).isDirectory());
+  EXPECT_EQ(countingFS->numInfoRequests, numRequests);
+  writeFile(subdir + "/new.txt", "New");
+  fs.revalidate();
+  EXPECT_TRUE(fs.getFileInfo(subdir).isDirectory());
+  EXPECT_EQ(countingFS->numInfoRequests, numRequests + 1);
+
+  // Paths which are, or are reached through, symbolic links are not cached,
+  // since changes to their targets are not noticed.
+  std::string targetDir = dir + "/target";
+  std::string target = targetDir + "/target.txt";
+  std::string link = dir + "/link.txt";
+  std::string dirLink = dir + "/dirlink";
+  ASSERT_FALSE(llvm::sys::fs::create_directory(targetDir));
+  writeFile(target, "Target");
+  ASSERT_FALSE(llvm::sys::fs::create_link(target, link));
+  ASSERT_FALSE(llvm::sys::fs::create_link(targetDir, dirLink));
+  fs.revalidate();
+  EXPECT_EQ(fs.getFileInfo(link).size, 6u);
+  EXPECT_EQ(fs.getFileInfo(dirLink + "/target.txt").size, 6u);
+  writeFile(target, "Changed target");
+  fs.revalidate();
+  EXPECT_EQ(fs.getFileInfo(link).size, 14u);
+  EXPECT_EQ(fs.getFileInfo(dirLink + "/target.txt").size, 14u);
+}
+#endif
+
+TEST(ChecksumOnlyFileSystem, checksumCache) {
+  TmpDir tempDir{"ChecksumOnlyFileSystemTest"};
+  std::string dir = tempDir.str();
+  std::string file = dir + "/file.txt";
+  std::string cachePath = dir + "/checksums";
+
+  // Write the file, with a modification time old enough for its checksum to be
+  // cached.
+  auto writeFile = [&](StringRef contents, int ageInSeconds) {
+    {
+      std::error_code ec;
+      llvm::raw_fd_ostream os(file, ec, llvm::sys::fs::F_Text);
+      EXPECT_FALSE(ec);
+      os << contents;
+    }
+    int fd;
+    EXPECT_FALSE(llvm::sys::fs::openFileForRead(file, fd));
+    EXPECT_FALSE(llvm::sys::fs::setLastModificationAndAccessTime(
+                     fd, std::chrono::system_clock::now() -
+                     std::chrono::seconds(ageInSeconds)));
+    sys::close(fd);
+  };
+  writeFile("Hello", 3600);
+
+  FileChecksum checksum;
+  {
+    FileChecksumCache cache(cachePath, FileChecksum::defaultAlgorithm);
+    auto countingFS = new CountingFileSystem();
+    ChecksumOnlyFileSystem fs{std::unique_ptr<FileSystem>(countingFS)};
+    fs.attachChecksumCache(&cache);
+
+    // Repeated requests only read the contents once.
+    checksum = fs.getFileInfo(file).checksum;
+    EXPECT_EQ(fs.getFileInfo(file).checksum, checksum);
+    EXPECT_EQ(countingFS->numChecksumRequests, 1u);
+
+    std::string error;
+    EXPECT_TRUE(cache.save(&error)) << error;
+  }
+
+  {
+    FileChecksumCache cache(cachePath, FileChecksum::defaultAlgorithm);
+    auto countingFS = new CountingFileSystem();
+    ChecksumOnlyFileSystem fs{std::unique_ptr<FileSystem>(countingFS)};
+    fs.attachChecksumCache(&cache);
+
+    // The saved checksum is reused.
+    EXPECT_EQ(fs.getFileInfo(file).checksum, checksum);
+    EXPECT_EQ(countingFS->numChecksumRequests, 0u);
+
+    // A modified file is read again.
+    writeFile("Hello, world!", 1800);
+    EXPECT_NE(fs.getFileInfo(file).checksum, checksum);
+    EXPECT_EQ(countingFS->numChecksumRequests, 1u);
+
+    // A recently modified file is not cached.
+    writeFile("Hello", 0);
+    EXPECT_EQ(fs.getFileInfo(file).checksum, checksum);
+    EXPECT_EQ(fs.getFileInfo(file).checksum, checksum);
+    EXPECT_EQ(countingFS->numChecksumRequests, 3u);
+  }
+
+  // A cache written for another algorithm is discarded.
+  {
+    writeFile("Hello", 3600);
+    FileChecksumCache cache(cachePath, FileChecksum::defaultAlgorithm);
+    auto info = FileInfo::getInfoForPath(file);
+    cache.insert(info, checksum);
+    std::string error;
+    EXPECT_TRUE(cache.save(&error)) << error;
+
+    FileChecksum cached;
+    EXPECT_TRUE(FileChecksumCache(cachePath, FileChecksum::defaultAlgorithm)
+                .lookup(info, &cached));
+    EXPECT_EQ(cached, checksum);
+    EXPECT_FALSE(FileChecksumCache(cachePath, FileChecksumAlgorithm::BLAKE3)
+                 .lookup(info, &cached));
+  }
+
+  // Only the entries used since the cache was loaded are saved.
+  {
+    std::string other = dir + "/other.txt";
+    {
+      std::error_code ec;
+      llvm::raw_fd_ostream os(other, ec, llvm::sys::fs::F_Text);
+      EXPECT_FALSE(ec);
+    }
+    auto info = FileInfo::getInfoForPath(file);
+    auto otherInfo = FileInfo::getInfoForPath(other);
+    otherInfo.modTime.seconds -= 3600;
+    std::string error;
+    FileChecksum cached;
+    {
+      FileChecksumCache cache(cachePath, FileChecksum::defaultAlgorithm);
+      EXPECT_TRUE(cache.lookup(info, &cached));
+      cache.insert(otherInfo, checksum);
+      EXPECT_TRUE(cache.save(&error)) << error;
+    }
+    {
+      FileChecksumCache cache(cachePath, FileChecksum::defaultAlgorithm);
+      EXPECT_TRUE(cache.lookup(info, &cached));
+      EXPECT_TRUE(cache.save(&error)) << error;
+    }
+    FileChecksumCache cache(cachePath, FileChecksum::defaultAlgorithm);
+    EXPECT_TRUE(cache.lookup(info, &cached));
+    EXPECT_FALSE(cache.lookup(otherInfo, &cached));
+  }
+}
+
 }
@@ -26,6 +26,8 @@
 #include <ctime>
 #include <future>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 using namespace llbuild;
 using namespace llbuild::basic;
@@ -172,10 +174,14 @@ namespace {
       }
     }
 
+    // Destroy the queue outside of the lock, since the remaining job takes it
+    // and the queue waits for its lanes to finish.
+    std::unique_ptr<ExecutionQueue> cancelledQueue;
     {
       std::lock_guard<std::mutex> lock(queueMutex);
-      queue.reset();
+      cancelledQueue = std::move(queue);
     }
+    cancelledQueue.reset();
 
     // Busy wait until our executions are done, but also have a timeout in case they never finish
     time_t start = ::time(NULL);
@@ -188,4 +194,354 @@ namespace {
     EXPECT_EQ(executions, 2);
   }
 
+  TEST(LaneBasedExecutionQueueTest, releaseLane) {
+    DummyDelegate delegate;
+    TmpDir tempDir{"LaneBasedExecutionQueueTest"};
+    std::string semaphoreFile = tempDir.str() + "/semaphore";
+    auto queue = std::unique_ptr<ExecutionQueue>(
+        createLaneBasedExecutionQueue(delegate, 1,
+                                      SchedulerAlgorithm::FIFO,
+                                      getDefaultQualityOfService(),
+                                      /*environment=*/nullptr));
+
+    // Run a process which releases the only lane, and then waits for a
+    // process run by a second job.
+    std::string waitCommand =
+      "printf 'llbuild.1\\n%s\\n' $LLBUILD_TASK_ID >&$LLBUILD_CONTROL_FD; "
+      "while [ ! -f " + semaphoreFile + " ]; do sleep 0.01; done";
+    std::promise<ProcessStatus> released;
+    auto releasedResult = released.get_future();
+    auto waitFn = [&](QueueJobContext* context) {
+      std::vector<StringRef> commandLine(
+          { DefaultShellPath, "-c", waitCommand });
+      queue->executeProcess(context, commandLine, {}, {true},
+                            {[&released](ProcessResult result) mutable {
+                              released.set_value(result.status);
+                            }});
+    };
+
+    std::string touchCommand = "touch " + semaphoreFile;
+    std::promise<ProcessStatus> touched;
+    auto touchedResult = touched.get_future();
+    auto touchFn = [&](QueueJobContext* context) {
+      std::vector<StringRef> commandLine(
+          { DefaultShellPath, "-c", touchCommand });
+      queue->executeProcess(context, commandLine, {}, {true},
+                            {[&touched](ProcessResult result) mutable {
+                              touched.set_value(result.status);
+                            }});
+    };
+
+    DummyCommand dummyCommand;
+    queue->addJob(QueueJob(&dummyCommand, waitFn));
+    queue->addJob(QueueJob(&dummyCommand, touchFn));
+
+    for (auto* result: { &touchedResult, &releasedResult }) {
+      if (result->wait_for(std::chrono::seconds(10)) !=
+          std::future_status::ready) {
+        // We can't fail gracefully because the `LaneBasedExecutionQueue` will
+        // always wait for spawned processes to exit
+        abort();
+      }
+      EXPECT_EQ(ProcessStatus::Succeeded, result->get());
+    }
+    queue.reset();
+  }
+
+  TEST(LaneBasedExecutionQueueTest, inheritedEnvironmentPrecedence) {
+    DummyDelegate delegate;
+    const char* environment[] = { "LLBUILD_TASK_ID=inherited", nullptr };
+    auto queue = std::unique_ptr<ExecutionQueue>(
+        createLaneBasedExecutionQueue(delegate, 1,
+                                      SchedulerAlgorithm::FIFO,
+                                      getDefaultQualityOfService(),
+                                      environment));
+
+    // An inherited variable takes precedence over the default the queue
+    // assigns, but not over the job's own environment.
+    std::string command =
+      "[ \"$LLBUILD_TASK_ID\" = inherited ] && [ \"$VALUE\" = job ]";
+    std::promise<ProcessStatus> finished;
+    auto finishedResult = finished.get_future();
+    auto fn = [&](QueueJobContext* context) {
+      std::vector<StringRef> commandLine({ DefaultShellPath, "-c", command });
+      std::vector<std::pair<StringRef, StringRef>> jobEnvironment(
+          { { "VALUE", "job" } });
+      queue->executeProcess(context, commandLine, jobEnvironment, {true},
+                            {[&finished](ProcessResult result) mutable {
+                              finished.set_value(result.status);
+                            }});
+    };
+
+    DummyCommand dummyCommand;
+    queue->addJob(QueueJob(&dummyCommand, fn));
+    ASSERT_EQ(finishedResult.wait_for(std::chrono::seconds(10)),
+              std::future_status::ready);
+    EXPECT_EQ(ProcessStatus::Succeeded, finishedResult.get());
+    queue.reset();
+  }
+
+  TEST(LaneBasedExecutionQueueTest, outputAfterReleasingLane) {
+    // Check that output written after a process releases its lane is still
+    // delivered to the delegate.
+    class OutputDelegate : public DummyDelegate {
+    public:
+      std::mutex outputMutex;
+      std::string output;
+
+      virtual void processHadOutput(ProcessContext*, ProcessHandle,
+                                    StringRef data) override {
+        std::lock_guard<std::mutex> guard(outputMutex);
+        output += data;
+      }
+    };
+
+    OutputDelegate delegate;
+    auto queue = std::unique_ptr<ExecutionQueue>(
+        createLaneBasedExecutionQueue(delegate, 1,
+                                      SchedulerAlgorithm::FIFO,
+                                      getDefaultQualityOfService(),
+                                      /*environment=*/nullptr));
+
+    std::string command =
+      "echo before; "
+      "printf 'llbuild.1\\n%s\\n' $LLBUILD_TASK_ID >&$LLBUILD_CONTROL_FD; "
+      "sleep 0.1; echo after";
+    std::promise<ProcessStatus> finished;
+    auto finishedResult = finished.get_future();
+    auto fn = [&](QueueJobContext* context) {
+      std::vector<StringRef> commandLine({ DefaultShellPath, "-c", command });
+      queue->executeProcess(context, commandLine, {}, {true},
+                            {[&finished](ProcessResult result) mutable {
+                              finished.set_value(result.status);
+                            }});
+    };
+
+    DummyCommand dummyCommand;
+    queue->addJob(QueueJob(&dummyCommand, fn));
+    if (finishedResult.wait_for(std::chrono::seconds(10)) !=
+        std::future_status::ready) {
+      abort();
+    }
+    EXPECT_EQ(ProcessStatus::Succeeded, finishedResult.get());
+    queue.reset();
+
+    std::lock_guard<std::mutex> guard(delegate.outputMutex);
+    EXPECT_EQ("before\nafter\n", delegate.output);
+  }
+
+  TEST(LaneBasedExecutionQueueTest, workStealing) {
+    DummyDelegate delegate;
+    auto queue = std::unique_ptr<ExecutionQueue>(
+        createLaneBasedExecutionQueue(delegate, 4,
+                                      SchedulerAlgorithm::WorkStealing,
+                                      getDefaultQualityOfService(),
+                                      /*environment=*/nullptr));
+
+    // Add jobs from outside the queue, each of which adds jobs from its lane.
+    const int numJobs = 256;
+    const int numNestedJobs = 4;
+    std::atomic<int> executions { 0 };
+    std::atomic<int> priorityExecutions { 0 };
+    DummyCommand dummyCommand;
+    auto nestedFn = [&executions](QueueJobContext*) {
+      executions++;
+    };
+    ExecutionQueue* queuePtr = queue.get();
+    auto fn = [&](QueueJobContext*) {
+      executions++;
+      for (int i = 0; i != numNestedJobs; ++i) {
+        queuePtr->addJob(QueueJob(&dummyCommand, nestedFn));
+      }
+    };
+    for (int i = 0; i != numJobs; ++i) {
+      queue->addJob(QueueJob(&dummyCommand, fn));
+      if (i % 64 == 0) {
+        queue->addJob(QueueJob(&dummyCommand, [&](QueueJobContext*) {
+              priorityExecutions++;
+            }), QueueJobPriority::High);
+      }
+    }
+
+    // Destroying the queue waits for all of the jobs to run.
+    queue.reset();
+
+    EXPECT_EQ(numJobs * (1 + numNestedJobs), executions);
+    EXPECT_EQ(numJobs / 64, priorityExecutions);
+  }
+
+  TEST(LaneBasedExecutionQueueTest, criticalPath) {
+    DummyDelegate delegate;
+    auto queue = std::unique_ptr<ExecutionQueue>(
+        createLaneBasedExecutionQueue(delegate, 1,
+                                      SchedulerAlgorithm::CriticalPath,
+                                      getDefaultQualityOfService(),
+                                      /*environment=*/nullptr));
+    EXPECT_TRUE(queue->usesCriticalPathEstimates());
+
+    // Block the only lane while the jobs are added.
+    std::promise<void> blocked, released;
+    DummyCommand dummyCommand;
+    queue->addJob(QueueJob(&dummyCommand, [&](QueueJobContext*) {
+          blocked.set_value();
+          released.get_future().wait();
+        }));
+    blocked.get_future().wait();
+
+    std::vector<int> order;
+    for (int estimate: { 1, 5, 0, 3 }) {
+      QueueJob job(&dummyCommand, [&order, estimate](QueueJobContext*) {
+          order.push_back(estimate);
+        });
+      job.setCriticalPathEstimate(estimate);
+      queue->addJob(job);
+    }
+    released.set_value();
+
+    // Destroying the queue waits for all of the jobs to run.
+    queue.reset();
+
+    EXPECT_EQ(std::vector<int>({ 5, 3, 1, 0 }), order);
+  }
+
+  TEST(LaneBasedExecutionQueueTest, loadLimits) {
+    DummyDelegate delegate;
+
+    // Use limits which are almost always exceeded, processes should still be
+    // started one at a time.
+    ExecutionQueueLoadLimits loadLimits;
+    loadLimits.maxLoadAverage = 0.0001;
+    loadLimits.maxCPUPressure = 0.0001;
+    auto queue = std::unique_ptr<ExecutionQueue>(
+        createLaneBasedExecutionQueue(delegate, 4,
+                                      SchedulerAlgorithm::NamePriority,
+                                      getDefaultQualityOfService(),
+                                      /*environment=*/nullptr, loadLimits));
+
+    const int numJobs = 8;
+    std::atomic<int> numSucceeded { 0 };
+    DummyCommand dummyCommand;
+    auto fn = [&](QueueJobContext* context) {
+      std::vector<StringRef> commandLine({ DefaultShellPath, "-c", "true" });
+      std::promise<ProcessStatus> p;
+      auto result = p.get_future();
+      queue->executeProcess(context, commandLine, {}, {true},
+                            {[&p](ProcessResult result) mutable {
+                              p.set_value(result.status);
+                            }});
+      if (result.get() == ProcessStatus::Succeeded)
+        numSucceeded++;
+    };
+    for (int i = 0; i != numJobs; ++i) {
+      queue->addJob(QueueJob(&dummyCommand, fn));
+    }
+
+    // Wait for the jobs to complete, before destroying the queue.
+    time_t start = ::time(NULL);
+    while (numSucceeded < numJobs && ::time(NULL) < start + 30) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    queue.reset();
+
+    EXPECT_EQ(numJobs, numSucceeded);
+  }
+
+  TEST(LaneBasedExecutionQueueTest, memoryBudget) {
+    DummyDelegate delegate;
+
+    // Use a budget which only fits one of the jobs at a time, so their
+    // processes should run one after another, despite the free lanes.
+    ExecutionQueueLoadLimits loadLimits;
+    loadLimits.memoryBudget = 100;
+    auto queue = std::unique_ptr<ExecutionQueue>(
+        createLaneBasedExecutionQueue(delegate, 4,
+                                      SchedulerAlgorithm::NamePriority,
+                                      getDefaultQualityOfService(),
+                                      /*environment=*/nullptr, loadLimits));
+    EXPECT_TRUE(queue->usesMemoryEstimates());
+
+    const int numJobs = 4;
+    std::atomic<int> numSucceeded { 0 };
+    DummyCommand dummyCommand;
+    auto fn = [&](QueueJobContext* context) {
+      std::vector<StringRef> commandLine({ DefaultShellPath, "-c",
+                                           "sleep 0.2" });
+      std::promise<ProcessStatus> p;
+      auto result = p.get_future();
+      queue->executeProcess(context, commandLine, {}, {true},
+                            {[&p](ProcessResult result) mutable {
+                              p.set_value(result.status);
+                            }});
+      if (result.get() == ProcessStatus::Succeeded)
+        numSucceeded++;
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i != numJobs; ++i) {
+      QueueJob job(&dummyCommand, fn);
+      job.setMemoryEstimate(60);
+      queue->addJob(job);
+    }
+
+    // Wait for the jobs to complete, before destroying the queue.
+    time_t timeout = ::time(NULL) + 30;
+    while (numSucceeded < numJobs && ::time(NULL) < timeout) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    queue.reset();
+
+    EXPECT_EQ(numJobs, numSucceeded);
+    EXPECT_GE(elapsed, std::chrono::milliseconds(numJobs * 200));
+  }
+
+  TEST(LaneBasedExecutionQueueTest, resourcePools) {
+    for (auto alg: { SchedulerAlgorithm::NamePriority,
+                     SchedulerAlgorithm::WorkStealing }) {
+      DummyDelegate delegate;
+      auto queue = std::unique_ptr<ExecutionQueue>(
+          createLaneBasedExecutionQueue(delegate, 4, alg,
+                                        getDefaultQualityOfService(),
+                                        /*environment=*/nullptr));
+
+      // Run jobs in a pool of depth 2, one of which is heavier than the pool,
+      // alongside jobs outside of the pool which should not be held up.
+      ResourcePool pool("link", 2);
+      std::atomic<int> weightInUse{ 0 }, maxWeightInUse{ 0 };
+      std::atomic<int> numPoolJobs{ 0 }, numOtherJobs{ 0 };
+      DummyCommand dummyCommand;
+      auto poolJob = [&](int weight) {
+        return [&, weight](QueueJobContext*) {
+          int current = weightInUse += weight;
+          int previous = maxWeightInUse;
+          while (current > previous &&
+                 !maxWeightInUse.compare_exchange_weak(previous, current)) {}
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          weightInUse -= weight;
+          ++numPoolJobs;
+        };
+      };
+      for (int i = 0; i != 6; ++i) {
+        QueueJob job(&dummyCommand, poolJob(1));
+        job.setResourcePool(&pool);
+        queue->addJob(job);
+      }
+      QueueJob heavyJob(&dummyCommand, poolJob(3));
+      heavyJob.setResourcePool(&pool, 3);
+      queue->addJob(heavyJob);
+      for (int i = 0; i != 4; ++i) {
+        queue->addJob(QueueJob(&dummyCommand, [&](QueueJobContext*) {
+              ++numOtherJobs;
+            }));
+      }
+
+      // Destroying the queue waits for all of the jobs to run.
+      queue.reset();
+
+      EXPECT_EQ(7, numPoolJobs);
+      EXPECT_EQ(4, numOtherJobs);
+      EXPECT_LE(maxWeightInUse, 3);
+      EXPECT_GE(maxWeightInUse, 2);
+    }
+  }
+
 }
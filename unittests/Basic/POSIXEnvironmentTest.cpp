@@ -31,4 +31,38 @@ TEST(POSIXEnvironmentTest, basic) {
   EXPECT_EQ(result[2], nullptr);
 #endif
   }
+
+TEST(POSIXEnvironmentTest, base) {
+  const char* baseEnvp[] = {
+    "a=aBase", "b=bBase", "c=cBase", "b=NOT HERE", nullptr };
+  auto base = std::make_shared<const POSIXEnvironmentBlock>(baseEnvp);
+  EXPECT_EQ(base->getEntries().size(), 3u);
+  EXPECT_EQ(base->getIndex("c"), 2);
+  EXPECT_EQ(base->getIndex("d"), -1);
+
+  // Base assignments are shadowed by earlier assignments, but take precedence
+  // over later ones (such as defaults added when a process is spawned).
+  POSIXEnvironment env;
+  env.setIfMissing("b", "bValue");
+  env.setBase(base);
+  env.setIfMissing("c", "cValue");
+  env.setIfMissing("d", "dValue");
+
+#if !defined(_WIN32)
+  auto result = env.getEnvp();
+  EXPECT_EQ(StringRef(result[0]), "b=bValue");
+  EXPECT_EQ(StringRef(result[1]), "a=aBase");
+  EXPECT_EQ(StringRef(result[2]), "c=cBase");
+  EXPECT_EQ(StringRef(result[3]), "d=dValue");
+  EXPECT_EQ(result[4], nullptr);
+
+  POSIXEnvironment other;
+  other.setBase(base);
+  auto otherResult = other.getEnvp();
+  EXPECT_EQ(StringRef(otherResult[0]), "a=aBase");
+  EXPECT_EQ(StringRef(otherResult[1]), "b=bBase");
+  EXPECT_EQ(StringRef(otherResult[2]), "c=cBase");
+  EXPECT_EQ(otherResult[3], nullptr);
+#endif
+}
 }
@@ -0,0 +1,84 @@
+//===- unittests/Basic/WorkStealingPoolTest.cpp ---------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "llbuild/Basic/WorkStealingPool.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+using namespace llbuild;
+using namespace llbuild::basic;
+
+namespace {
+
+TEST(WorkStealingPoolTest, basic) {
+  std::atomic<int> count{ 0 };
+  {
+    WorkStealingPool pool(4);
+    EXPECT_EQ(pool.getNumThreads(), 4u);
+    for (int i = 0; i != 1000; ++i)
+      pool.async([&] { ++count; });
+    pool.waitForAll();
+    EXPECT_EQ(count, 1000);
+
+    // The pool can be reused after waiting.
+    pool.async([&] { ++count; });
+  }
+  EXPECT_EQ(count, 1001);
+}
+
+TEST(WorkStealingPoolTest, nestedOperations) {
+  // Check that operations added by operations (which go on the adding thread's
+  // own deque) are completed before waitForAll() returns.
+  WorkStealingPool pool(2);
+  std::atomic<int> count{ 0 };
+  std::function<void(int)> spawnTree = [&](int depth) {
+    ++count;
+    if (depth == 0)
+      return;
+    for (int i = 0; i != 2; ++i)
+      pool.async([&spawnTree, depth] { spawnTree(depth - 1); });
+  };
+  pool.async([&] { spawnTree(10); });
+  pool.waitForAll();
+  EXPECT_EQ(count, (1 << 11) - 1);
+}
+
+TEST(WorkStealingPoolTest, runOne) {
+  // Check that a waiting thread can run pending operations itself.
+  WorkStealingPool pool(1);
+  std::atomic<bool> started{ false };
+  std::atomic<bool> release{ false };
+  std::atomic<int> count{ 0 };
+
+  // Occupy the only pool thread.
+  pool.async([&] {
+      started = true;
+      while (!release)
+        std::this_thread::yield();
+    });
+  while (!started)
+    std::this_thread::yield();
+  for (int i = 0; i != 10; ++i)
+    pool.async([&] { ++count; });
+
+  while (count != 10)
+    pool.runOne();
+  release = true;
+  pool.waitForAll();
+  EXPECT_FALSE(pool.runOne());
+}
+
+}
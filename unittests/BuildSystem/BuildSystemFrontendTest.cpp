@@ -734,6 +734,56 @@ client:
   ASSERT_TRUE(delegate.checkTrace("error: missing input '/missing' and no rule to build it\n"));
 }
 
+// The frontend keeps its build system resident across builds, but must start
+// over if the build file changes underneath it.
+TEST_F(BuildSystemFrontendTest, residentBuildSystemReload) {
+  auto writeBuildFileWithArgs = [&](StringRef args) {
+    writeBuildFile((Twine(R"END(
+client:
+    name: client
+
+targets:
+    "": ["1"]
+
+commands:
+    1:
+        tool: shell
+        outputs: ["1"]
+        args: )END") + args + "\n").str());
+  };
+  writeBuildFileWithArgs("touch 1");
+
+  TestBuildSystemFrontendDelegate delegate(sourceMgr);
+  BuildSystemFrontend frontend(delegate, invocation, createLocalFileSystem());
+  ASSERT_TRUE(frontend.build(""));
+  ASSERT_TRUE(delegate.checkTrace(R"END(
+commandPreparing: 1
+shouldCommandStart: 1
+commandStarted: 1
+commandProcessStarted: 1
+commandProcessFinished: 1: 0
+commandFinished: 1: 0
+)END"));
+
+  // A null build reuses the resident state.
+  delegate.clearTrace();
+  ASSERT_TRUE(frontend.build(""));
+  ASSERT_TRUE(delegate.checkTrace(""));
+
+  // Changing the command must be picked up by the next build.
+  writeBuildFileWithArgs("touch 1 2");
+  delegate.clearTrace();
+  ASSERT_TRUE(frontend.build(""));
+  ASSERT_TRUE(delegate.checkTrace(R"END(
+commandPreparing: 1
+shouldCommandStart: 1
+commandStarted: 1
+commandProcessStarted: 1
+commandProcessFinished: 1: 0
+commandFinished: 1: 0
+)END"));
+  ASSERT_FALSE(fs->getFileInfo(tempDir.str() + "/2").isMissing());
+}
 
 TEST(BuildSystemInvocationTest, formatCycle) {
   BuildSystemInvocation invocation;
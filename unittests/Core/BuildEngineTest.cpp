@@ -21,8 +21,13 @@
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <future>
 #include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -213,6 +218,62 @@ TEST(BuildEngineTest, basic) {
 }
 
 
+TEST(BuildEngineTest, callbacksFromFinishedTasksAreIgnored) {
+  // Check that a task interface which outlives its task doesn't affect the
+  // task which is later created in its place.
+  std::vector<TaskInterface> savedInterfaces;
+
+  class SavingTask : public Task {
+    std::vector<TaskInterface>& savedInterfaces;
+    int value;
+
+  public:
+    SavingTask(std::vector<TaskInterface>& savedInterfaces, int value)
+        : savedInterfaces(savedInterfaces), value(value) {}
+
+    virtual void start(TaskInterface ti) override {
+      // Call back through any interface of an earlier task.
+      for (auto& saved: savedInterfaces)
+        saved.complete(intToValue(-1));
+      savedInterfaces.push_back(ti);
+    }
+    virtual void provideValue(TaskInterface, uintptr_t, const KeyType&,
+                              const ValueType&) override {}
+    virtual void inputsAvailable(TaskInterface ti) override {
+      ti.complete(intToValue(value));
+    }
+  };
+
+  class SavingRule : public Rule {
+    std::vector<TaskInterface>& savedInterfaces;
+    int value;
+
+  public:
+    SavingRule(const KeyType& key, std::vector<TaskInterface>& savedInterfaces,
+               int value)
+        : Rule(key), savedInterfaces(savedInterfaces), value(value) {}
+
+    Task* createTask(BuildEngine&) override {
+      return new SavingTask(savedInterfaces, value);
+    }
+    bool isResultValid(BuildEngine&, const ValueType&) override {
+      return true;
+    }
+  };
+
+  SimpleBuildEngineDelegate delegate;
+  core::BuildEngine engine(delegate);
+  engine.addRule(std::unique_ptr<core::Rule>(
+                     new SavingRule("first", savedInterfaces, 1)));
+  engine.addRule(std::unique_ptr<core::Rule>(
+                     new SavingRule("second", savedInterfaces, 2)));
+
+  EXPECT_EQ(1, intFromValue(engine.build("first")));
+  EXPECT_EQ(2, intFromValue(engine.build("second")));
+  EXPECT_TRUE(delegate.errors.empty());
+}
+
+
 TEST(BuildEngineTest, duplicateRule) {
   SimpleBuildEngineDelegate delegate;
   delegate.expectedError = true;
@@ -720,6 +781,100 @@ TEST(BuildEngineTest, unchangedOutputs) {
   EXPECT_EQ("value", builtKeys[0]);
 }
 
+TEST(BuildEngineTest, unchangedResultsAreNotRewritten) {
+  // Check that a rule which reruns but produces an unchanged result is not
+  // rewritten to the database.
+  SimpleBuildEngineDelegate delegate;
+  core::BuildEngine engine(delegate);
+
+  class CustomDB : public BuildDB {
+  public:
+    std::unordered_map<KeyType, Result> ruleResults;
+    std::vector<std::string> writtenKeys;
+
+    virtual void attachDelegate(BuildDBDelegate* delegate) override { ; }
+
+    virtual uint64_t getCurrentEpoch(bool* success_out, std::string* error_out) override {
+      *success_out = true;
+      return 0;
+    }
+    virtual bool setCurrentIteration(uint64_t value, std::string* error_out) override { return true; }
+    virtual bool lookupRuleResult(KeyID keyID,
+                                  const KeyType& key,
+                                  Result* result_out,
+                                  std::string* error_out) override {
+      return false;
+    }
+    virtual bool setRuleResult(KeyID key,
+                               const Rule& rule,
+                               const Result& result,
+                               std::string* error_out) override {
+      ruleResults[rule.key] = result;
+      writtenKeys.push_back(rule.key.str());
+      return true;
+    }
+    virtual bool buildStarted(std::string* error_out) override { return true; }
+    virtual void buildComplete() override {}
+    virtual bool getKeys(std::vector<KeyType>& keys_out, std::string* error_out) override { return false; }
+    virtual bool getKeysWithResult(std::vector<KeyType> &keys_out, std::vector<Result> &results_out, std::string* error_out) override { return false; };
+  };
+  CustomDB *db = new CustomDB();
+  std::string error;
+  engine.attachDB(std::unique_ptr<CustomDB>(db), &error);
+
+  int value = 2;
+  int input = 1;
+  engine.addRule(std::unique_ptr<core::Rule>(new SimpleRule(
+      "value", {}, [&] (const std::vector<int>& inputs) {
+        return value; },
+      [&](const ValueType&) {
+        // Always rebuild
+        return false;
+      })));
+  engine.addRule(std::unique_ptr<core::Rule>(new SimpleRule(
+      "input", {}, [&] (const std::vector<int>& inputs) {
+        return input; },
+      [&](const ValueType& result) {
+        return input == intFromValue(result);
+      })));
+  engine.addRule(std::unique_ptr<core::Rule>(new SimpleRule(
+      "result", {"value", "input"},
+      [&] (const std::vector<int>& inputs) {
+        return inputs[0] * inputs[1];
+      },
+      [&](const ValueType&) {
+        // Always rebuild
+        return false;
+      })));
+
+  // Build the result, which writes every rule.
+  EXPECT_EQ(2, intFromValue(engine.build("result")));
+  EXPECT_EQ(3U, db->writtenKeys.size());
+  EXPECT_EQ(1U, db->ruleResults["value"].builtAt);
+
+  // Rebuild, which reruns "value" and "result" but leaves both unchanged.
+  db->writtenKeys.clear();
+  EXPECT_EQ(2, intFromValue(engine.build("result")));
+  EXPECT_EQ(0U, db->writtenKeys.size());
+  EXPECT_EQ(1U, db->ruleResults["value"].builtAt);
+
+  // Change an input, so "result" must be rewritten even though "value" is not.
+  input = 3;
+  db->writtenKeys.clear();
+  EXPECT_EQ(6, intFromValue(engine.build("result")));
+  ASSERT_EQ(2U, db->writtenKeys.size());
+  EXPECT_EQ("input", db->writtenKeys[0]);
+  EXPECT_EQ("result", db->writtenKeys[1]);
+  EXPECT_EQ(3U, db->ruleResults["result"].builtAt);
+  EXPECT_EQ(3U, db->ruleResults["result"].computedAt);
+
+  // Rebuild with the value unchanged; "result" has no inputs computed after
+  // its stored result, so it is not rewritten.
+  db->writtenKeys.clear();
+  EXPECT_EQ(6, intFromValue(engine.build("result")));
+  EXPECT_EQ(0U, db->writtenKeys.size());
+}
+
 TEST(BuildEngineTest, StatusCallbacks) {
   unsigned numScanned = 0;
   unsigned numComplete = 0;
@@ -1013,4 +1168,432 @@ TEST(BuildEngineTest, concurrentProtection) {
   EXPECT_EQ(0U, delegate.errors.size());
 }
 
+
+TEST(BuildEngineTest, parallelScanning) {
+  // Check that incremental builds with parallel scanning rebuild exactly the
+  // invalidated rules.
+  //
+  // Dependencies:
+  //   result: (input-0, ..., input-N)
+  const int numInputs = 64;
+  std::vector<std::string> builtKeys;
+  std::vector<int> inputValues(numInputs, 1);
+  std::atomic<int> numValidityChecks{ 0 };
+  SimpleBuildEngineDelegate delegate;
+  core::BuildEngine engine(delegate);
+  engine.enableParallelScanning(4);
+
+  std::vector<KeyType> inputKeys;
+  for (int i = 0; i != numInputs; ++i) {
+    std::string key = "input-" + std::to_string(i);
+    inputKeys.push_back(key);
+    engine.addRule(std::unique_ptr<core::Rule>(new SimpleRule(
+      key, {}, [&, i, key] (const std::vector<int>&) {
+          builtKeys.push_back(key);
+          return inputValues[i]; },
+      [&, i] (const ValueType& value) {
+        ++numValidityChecks;
+        return inputValues[i] == intFromValue(value);
+      })));
+  }
+  engine.addRule(std::unique_ptr<core::Rule>(new SimpleRule(
+    "result", inputKeys, [&] (const std::vector<int>& inputs) {
+      builtKeys.push_back("result");
+      int sum = 0;
+      for (int value: inputs)
+        sum += value;
+      return sum; })));
+
+  // Build the initial result.
+  EXPECT_EQ(numInputs, intFromValue(engine.build("result")));
+  EXPECT_EQ(size_t(numInputs + 1), builtKeys.size());
+
+  // Check that a null build checks each input exactly once.
+  builtKeys.clear();
+  numValidityChecks = 0;
+  EXPECT_EQ(numInputs, intFromValue(engine.build("result")));
+  EXPECT_EQ(0U, builtKeys.size());
+  EXPECT_EQ(numInputs, numValidityChecks);
+
+  // Change some of the inputs, and rebuild.
+  builtKeys.clear();
+  inputValues[3] = 2;
+  inputValues[40] = 3;
+  EXPECT_EQ(numInputs + 3, intFromValue(engine.build("result")));
+  std::sort(builtKeys.begin(), builtKeys.end());
+  ASSERT_EQ(3U, builtKeys.size());
+  EXPECT_EQ("input-3", builtKeys[0]);
+  EXPECT_EQ("input-40", builtKeys[1]);
+  EXPECT_EQ("result", builtKeys[2]);
+}
+
+TEST(BuildEngineTest, parallelScanningAfterEarlierInputRebuilds) {
+  // Check that a validity check made in parallel is not trusted if an earlier
+  // input is rebuilt before its rule is scanned, since that work may have
+  // changed what the check observed.
+  //
+  // Dependencies:
+  //   result: (writer, checked)
+  //
+  // Building "writer" updates the state which "checked" is computed from.
+  int writerValue = 1;
+  int sharedState = 0;
+  std::vector<std::string> builtKeys;
+  SimpleBuildEngineDelegate delegate;
+  core::BuildEngine engine(delegate);
+  engine.enableParallelScanning(4);
+  engine.addRule(std::unique_ptr<core::Rule>(new SimpleRule(
+    "writer", {}, [&] (const std::vector<int>&) {
+        builtKeys.push_back("writer");
+        sharedState = writerValue;
+        return writerValue; },
+    [&] (const ValueType& value) {
+      return writerValue == intFromValue(value);
+    })));
+  engine.addRule(std::unique_ptr<core::Rule>(new SimpleRule(
+    "checked", {}, [&] (const std::vector<int>&) {
+        builtKeys.push_back("checked");
+        return sharedState; },
+    [&] (const ValueType& value) {
+      return sharedState == intFromValue(value);
+    })));
+  engine.addRule(std::unique_ptr<core::Rule>(new SimpleRule(
+    "result", {"writer", "checked"}, [&] (const std::vector<int>& inputs) {
+      builtKeys.push_back("result");
+      return inputs[0] * 10 + inputs[1]; })));
+
+  EXPECT_EQ(11, intFromValue(engine.build("result")));
+  EXPECT_EQ(3U, builtKeys.size());
+
+  // Change the writer; "checked" must be rebuilt with the new state.
+  builtKeys.clear();
+  writerValue = 2;
+  EXPECT_EQ(22, intFromValue(engine.build("result")));
+  ASSERT_EQ(3U, builtKeys.size());
+  EXPECT_EQ("writer", builtKeys[0]);
+  EXPECT_EQ("checked", builtKeys[1]);
+  EXPECT_EQ("result", builtKeys[2]);
+}
+
+TEST(BuildEngineTest, criticalPathEstimates) {
+  // Check the jobs spawned by tasks are given the critical path estimates of
+  // their rules, from the durations of the prior build.
+  //
+  // Dependencies:
+  //   result: (chain-2, quick)
+  //   chain-2: (chain-1)
+
+  /// An execution queue which records the estimate of each job added to it.
+  class RecordingExecutionQueue : public basic::ExecutionQueue {
+    std::unique_ptr<basic::ExecutionQueue> queue;
+    std::mutex& estimatesMutex;
+    std::unordered_map<std::string, double>& estimates;
+
+  public:
+    RecordingExecutionQueue(basic::ExecutionQueueDelegate& delegate,
+                            std::mutex& estimatesMutex,
+                            std::unordered_map<std::string, double>& estimates)
+        : ExecutionQueue(delegate),
+          queue(basic::createLaneBasedExecutionQueue(
+                    delegate, 4, basic::SchedulerAlgorithm::NamePriority,
+                    basic::getDefaultQualityOfService(), nullptr)),
+          estimatesMutex(estimatesMutex), estimates(estimates) {}
+
+    void addJob(basic::QueueJob job,
+                basic::QueueJobPriority priority) override {
+      {
+        std::lock_guard<std::mutex> guard(estimatesMutex);
+        estimates[job.getDescriptor()->getOrdinalName()] =
+          job.getCriticalPathEstimate();
+      }
+      queue->addJob(job, priority);
+    }
+    void cancelAllJobs() override { queue->cancelAllJobs(); }
+    void executeProcess(
+        basic::QueueJobContext* context, ArrayRef<StringRef> commandLine,
+        ArrayRef<std::pair<StringRef, StringRef>> environment,
+        basic::ProcessAttributes attributes,
+        llvm::Optional<basic::ProcessCompletionFn> completionFn,
+        basic::ProcessDelegate* delegate) override {
+      queue->executeProcess(context, commandLine, environment, attributes,
+                            completionFn, delegate);
+    }
+    bool usesCriticalPathEstimates() const override { return true; }
+  };
+
+  class RecordingDelegate : public SimpleBuildEngineDelegate {
+  public:
+    std::mutex estimatesMutex;
+    std::unordered_map<std::string, double> estimates;
+
+  private:
+    std::unique_ptr<basic::ExecutionQueue> createExecutionQueue() override {
+      return llvm::make_unique<RecordingExecutionQueue>(*this, estimatesMutex,
+                                                        estimates);
+    }
+  };
+
+  /// A rule whose task requests its inputs, then spawns a job which takes the
+  /// given time.
+  class SpawningRule : public Rule, public basic::JobDescriptor {
+    std::vector<KeyType> inputs;
+    std::chrono::milliseconds duration;
+
+    class SpawningTask : public Task {
+      SpawningRule& rule;
+
+    public:
+      SpawningTask(SpawningRule& rule) : rule(rule) {}
+
+      void start(TaskInterface ti) override {
+        for (const auto& input: rule.inputs)
+          ti.request(input, 0);
+      }
+      void provideValue(TaskInterface, uintptr_t, const KeyType&,
+                        const ValueType&) override {}
+      void inputsAvailable(TaskInterface ti) override {
+        auto duration = rule.duration;
+        ti.spawn(basic::QueueJob(&rule, [ti, duration](
+                                     basic::QueueJobContext*) mutable {
+              std::this_thread::sleep_for(duration);
+              ti.complete(intToValue(1));
+            }));
+      }
+    };
+
+  public:
+    SpawningRule(const KeyType& key, const std::vector<KeyType>& inputs,
+                 std::chrono::milliseconds duration)
+        : Rule(key), inputs(inputs), duration(duration) {}
+
+    Task* createTask(BuildEngine&) override { return new SpawningTask(*this); }
+    bool isResultValid(BuildEngine&, const ValueType&) override {
+      return false;
+    }
+
+    StringRef getOrdinalName() const override { return key.str(); }
+    void getShortDescription(SmallVectorImpl<char>&) const override {}
+    void getVerboseDescription(SmallVectorImpl<char>&) const override {}
+  };
+
+  llvm::SmallString<256> dbPath;
+  auto ec = llvm::sys::fs::createTemporaryFile("build", "db", dbPath);
+  ASSERT_FALSE(bool(ec));
+
+  RecordingDelegate delegate;
+  auto build = [&]() {
+    core::BuildEngine engine(delegate);
+    std::string error;
+    auto db = createSQLiteBuildDB(dbPath, 1,
+                                  /* recreateUnmatchedVersion = */ true,
+                                  &error);
+    ASSERT_TRUE(bool(db)) << error;
+    ASSERT_TRUE(engine.attachDB(std::move(db), &error)) << error;
+
+    const std::chrono::milliseconds slow(20), fast(0);
+    engine.addRule(llvm::make_unique<SpawningRule>(
+                       "chain-1", std::vector<KeyType>{}, slow));
+    engine.addRule(llvm::make_unique<SpawningRule>(
+                       "chain-2", std::vector<KeyType>{ "chain-1" }, slow));
+    engine.addRule(llvm::make_unique<SpawningRule>(
+                       "quick", std::vector<KeyType>{}, fast));
+    engine.addRule(llvm::make_unique<SpawningRule>(
+                       "result", std::vector<KeyType>{ "chain-2", "quick" },
+                       fast));
+    EXPECT_EQ(1, intFromValue(engine.build("result")));
+  };
+
+  // Without prior results, there are no estimates.
+  build();
+  ASSERT_EQ(4U, delegate.estimates.size());
+  for (const auto& it: delegate.estimates)
+    EXPECT_EQ(0.0, it.second) << it.first;
+
+  // Rebuild, and check the estimates follow the longest chain of dependents.
+  delegate.estimates.clear();
+  build();
+  ASSERT_EQ(4U, delegate.estimates.size());
+  auto& estimates = delegate.estimates;
+  EXPECT_GE(estimates["chain-1"], 0.04);
+  EXPECT_GE(estimates["chain-2"], 0.02);
+  EXPECT_GT(estimates["chain-1"], estimates["chain-2"]);
+  EXPECT_GT(estimates["chain-2"], estimates["quick"]);
+  EXPECT_GE(estimates["quick"], estimates["result"]);
+
+  llvm::sys::fs::remove(dbPath);
+}
+
+TEST(BuildEngineTest, ruleStatistics) {
+  // Check the statistics of the tasks which spawn jobs are recorded in the
+  // database, accumulated across builds, and used to estimate the memory use
+  // of their jobs.
+  //
+  // Dependencies:
+  //   spawned: (input)
+
+  /// An execution queue which records the memory estimate of each job added to
+  /// it.
+  class RecordingExecutionQueue : public basic::ExecutionQueue {
+    std::unique_ptr<basic::ExecutionQueue> queue;
+    std::vector<uint64_t>& estimates;
+
+  public:
+    RecordingExecutionQueue(basic::ExecutionQueueDelegate& delegate,
+                            std::vector<uint64_t>& estimates)
+        : ExecutionQueue(delegate),
+          queue(basic::createLaneBasedExecutionQueue(
+                    delegate, 2, basic::SchedulerAlgorithm::NamePriority,
+                    basic::getDefaultQualityOfService(), nullptr)),
+          estimates(estimates) {}
+
+    void addJob(basic::QueueJob job,
+                basic::QueueJobPriority priority) override {
+      estimates.push_back(job.getMemoryEstimate());
+      queue->addJob(job, priority);
+    }
+    void cancelAllJobs() override { queue->cancelAllJobs(); }
+    void executeProcess(
+        basic::QueueJobContext* context, ArrayRef<StringRef> commandLine,
+        ArrayRef<std::pair<StringRef, StringRef>> environment,
+        basic::ProcessAttributes attributes,
+        llvm::Optional<basic::ProcessCompletionFn> completionFn,
+        basic::ProcessDelegate* delegate) override {
+      queue->executeProcess(context, commandLine, environment, attributes,
+                            completionFn, delegate);
+    }
+    bool usesMemoryEstimates() const override { return true; }
+  };
+
+  class RecordingDelegate : public SimpleBuildEngineDelegate {
+  public:
+    std::vector<uint64_t> estimates;
+
+  private:
+    std::unique_ptr<basic::ExecutionQueue> createExecutionQueue() override {
+      return llvm::make_unique<RecordingExecutionQueue>(*this, estimates);
+    }
+  };
+
+  class CustomDB : public BuildDB {
+  public:
+    std::unordered_map<uint64_t, std::string> keyNames;
+    std::unordered_map<std::string, RuleStatistics> statistics;
+
+    virtual void attachDelegate(BuildDBDelegate* delegate) override { ; }
+
+    virtual uint64_t getCurrentEpoch(bool* success_out, std::string* error_out) override {
+      *success_out = true;
+      return 0;
+    }
+    virtual bool setCurrentIteration(uint64_t value, std::string* error_out) override { return true; }
+    virtual bool lookupRuleResult(KeyID keyID,
+                                  const KeyType& key,
+                                  Result* result_out,
+                                  std::string* error_out) override {
+      return false;
+    }
+    virtual bool setRuleResult(KeyID key,
+                               const Rule& rule,
+                               const Result& result,
+                               std::string* error_out) override {
+      keyNames[key.value()] = rule.key.str();
+      return true;
+    }
+    virtual bool lookupRuleStatistics(KeyID key,
+                                      RuleStatistics* statistics_out,
+                                      std::string* error_out) override {
+      auto it = statistics.find(keyNames[key.value()]);
+      if (it == statistics.end())
+        return false;
+      *statistics_out = it->second;
+      return true;
+    }
+    virtual bool setRuleStatistics(KeyID key,
+                                   const RuleStatistics& value,
+                                   std::string* error_out) override {
+      statistics[keyNames[key.value()]] = value;
+      return true;
+    }
+    virtual bool buildStarted(std::string* error_out) override { return true; }
+    virtual void buildComplete() override {}
+    virtual bool getKeys(std::vector<KeyType>& keys_out, std::string* error_out) override { return false; }
+    virtual bool getKeysWithResult(std::vector<KeyType> &keys_out, std::vector<Result> &results_out, std::string* error_out) override { return false; };
+  };
+
+  /// A rule whose task spawns a job which reports its resource usage.
+  class SpawningRule : public Rule, public basic::JobDescriptor {
+    class SpawningTask : public Task {
+      SpawningRule& rule;
+
+    public:
+      SpawningTask(SpawningRule& rule) : rule(rule) {}
+
+      void start(TaskInterface ti) override { ti.request("input", 0); }
+      void provideValue(TaskInterface, uintptr_t, const KeyType&,
+                        const ValueType&) override {}
+      void inputsAvailable(TaskInterface ti) override {
+        uint64_t peakRSS = rule.peakRSS;
+        ti.spawn(basic::QueueJob(&rule, [ti, peakRSS](
+                                     basic::QueueJobContext*) mutable {
+              ti.reportStatistics(peakRSS, 10);
+              ti.reportStatistics(peakRSS / 2, 20);
+              ti.complete(intToValue(1));
+            }));
+      }
+    };
+
+  public:
+    uint64_t peakRSS = 0;
+
+    SpawningRule(const KeyType& key) : Rule(key) {}
+
+    Task* createTask(BuildEngine&) override { return new SpawningTask(*this); }
+    bool isResultValid(BuildEngine&, const ValueType&) override {
+      return false;
+    }
+
+    StringRef getOrdinalName() const override { return key.str(); }
+    void getShortDescription(SmallVectorImpl<char>&) const override {}
+    void getVerboseDescription(SmallVectorImpl<char>&) const override {}
+  };
+
+  RecordingDelegate delegate;
+  core::BuildEngine engine(delegate);
+  CustomDB *db = new CustomDB();
+  std::string error;
+  ASSERT_TRUE(engine.attachDB(std::unique_ptr<CustomDB>(db), &error)) << error;
+
+  auto spawnedRule = llvm::make_unique<SpawningRule>("spawned");
+  auto& spawned = *spawnedRule;
+  engine.addRule(std::move(spawnedRule));
+  engine.addRule(llvm::make_unique<SimpleRule>(
+                     "input", std::vector<KeyType>{},
+                     [&] (const std::vector<int>&) { return 2; },
+                     [] (const ValueType&) { return false; }));
+
+  spawned.peakRSS = 4096;
+  EXPECT_EQ(1, intFromValue(engine.build("spawned")));
+
+  // Only the task which spawned a job has statistics.
+  ASSERT_EQ(1U, db->statistics.size());
+  const RuleStatistics& statistics = db->statistics["spawned"];
+  EXPECT_EQ(1U, statistics.runCount);
+  EXPECT_GE(statistics.weightedDuration, 0.0);
+  EXPECT_EQ(4096U, statistics.peakRSS);
+  EXPECT_EQ(30U, statistics.outputBytes);
+
+  // Without statistics, the job had no memory estimate.
+  EXPECT_EQ(std::vector<uint64_t>({ 0 }), delegate.estimates);
+
+  // The run count accumulates, the resource usage is of the last run, and the
+  // job is estimated to use the peak RSS of the prior run.
+  spawned.peakRSS = 1024;
+  EXPECT_EQ(1, intFromValue(engine.build("spawned")));
+  ASSERT_EQ(1U, db->statistics.size());
+  EXPECT_EQ(2U, db->statistics["spawned"].runCount);
+  EXPECT_EQ(1024U, db->statistics["spawned"].peakRSS);
+  EXPECT_EQ(30U, db->statistics["spawned"].outputBytes);
+  EXPECT_EQ(std::vector<uint64_t>({ 0, 4096 }), delegate.estimates);
+}
+
 }
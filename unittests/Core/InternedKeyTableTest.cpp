@@ -0,0 +1,83 @@
+//===- unittests/Core/InternedKeyTableTest.cpp ----------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "llbuild/Core/InternedKeyTable.h"
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace llbuild;
+using namespace llbuild::core;
+
+namespace {
+
+typedef InternedKeyTable<int> TestTable;
+
+TEST(InternedKeyTableTest, Basics) {
+  TestTable table;
+
+  std::string keyStorage = "a";
+  KeyID a = table.getKeyID(keyStorage);
+  KeyID b = table.getKeyID("b");
+  EXPECT_NE(a, b);
+  EXPECT_EQ(table.getKeyID("a"), a);
+  EXPECT_EQ(table.size(), 2u);
+
+  // The key is copied into the table.
+  keyStorage = "c";
+  EXPECT_EQ(TestTable::getKey(a), "a");
+  EXPECT_EQ(TestTable::getKey(b), "b");
+
+  // The empty key is a valid key.
+  KeyID empty = table.getKeyID("");
+  EXPECT_EQ(TestTable::getKey(empty), "");
+  EXPECT_NE(empty, a);
+
+  EXPECT_EQ(TestTable::getValue(a), 0);
+  TestTable::getValue(a) = 42;
+  EXPECT_EQ(TestTable::getValue(table.getKeyID("a")), 42);
+  EXPECT_EQ(TestTable::getValue(b), 0);
+}
+
+TEST(InternedKeyTableTest, ConcurrentInterning) {
+  TestTable table;
+  const unsigned numThreads = 4;
+  const unsigned numKeys = 2048;
+
+  // Every thread interns the same keys, in a different order (any odd stride
+  // visits every index, since the number of keys is a power of two).
+  std::vector<std::vector<KeyID>> ids(numThreads,
+                                      std::vector<KeyID>(numKeys));
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t != numThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (unsigned i = 0; i != numKeys; ++i) {
+        unsigned index = (i * (2 * t + 1)) % numKeys;
+        ids[t][index] = table.getKeyID("key-" + std::to_string(index));
+      }
+    });
+  }
+  for (auto& thread: threads)
+    thread.join();
+
+  EXPECT_EQ(table.size(), size_t(numKeys));
+  for (unsigned i = 0; i != numKeys; ++i) {
+    EXPECT_EQ(TestTable::getKey(ids[0][i]), "key-" + std::to_string(i));
+    for (unsigned t = 1; t != numThreads; ++t)
+      EXPECT_EQ(ids[t][i], ids[0][i]);
+  }
+}
+
+}
@@ -0,0 +1,408 @@
+//===- unittests/Core/LogBuildDBTest.cpp ----------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "llbuild/Core/BuildDB.h"
+#include "llbuild/Core/BuildEngine.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
+
+#include "gtest/gtest.h"
+
+#include <deque>
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace llbuild;
+using namespace llbuild::core;
+
+namespace {
+
+/// A delegate which assigns stable key IDs to any requested key.
+class SimpleDBDelegate : public BuildDBDelegate {
+  std::deque<KeyType> keys;
+  llvm::StringMap<KeyID> keyIDs;
+
+public:
+  std::vector<std::string> errors;
+
+  virtual const KeyID getKeyID(StringRef key) override {
+    auto it = keyIDs.find(key);
+    if (it != keyIDs.end())
+      return it->second;
+    keys.push_back(key);
+    KeyID id(&keys.back());
+    keyIDs[key] = id;
+    return id;
+  }
+
+  virtual KeyType getKeyForID(const KeyID key) override {
+    return *reinterpret_cast<const KeyType*>(uintptr_t(key.value()));
+  }
+
+  virtual void error(const Twine& message) override {
+    errors.push_back(message.str());
+  }
+};
+
+class SimpleRule : public Rule {
+public:
+  SimpleRule(const KeyType& key) : Rule(key) {}
+  Task* createTask(BuildEngine&) override { return nullptr; }
+  bool isResultValid(BuildEngine&, const ValueType&) override { return true; }
+};
+
+class LogBuildDBTest : public ::testing::Test {
+protected:
+  llvm::SmallString<256> dbPath;
+  SimpleDBDelegate delegate;
+
+  virtual void SetUp() override {
+    auto ec = llvm::sys::fs::createTemporaryFile("build", "db", dbPath);
+    ASSERT_FALSE(bool(ec));
+  }
+
+  virtual void TearDown() override {
+    llvm::sys::fs::remove(dbPath.str());
+  }
+
+  std::unique_ptr<BuildDB> open(uint32_t clientVersion = 1,
+                                bool recreateUnmatchedVersion = true) {
+    std::string error;
+    auto db = createLogBuildDB(dbPath, clientVersion, recreateUnmatchedVersion,
+                               &error);
+    EXPECT_TRUE(db != nullptr);
+    EXPECT_EQ(error, "");
+    db->attachDelegate(&delegate);
+    return db;
+  }
+
+  Result makeResult(uint8_t value, Epoch builtAt) {
+    Result result;
+    result.value = { value, uint8_t(value + 1), uint8_t(value + 2) };
+    result.signature = basic::CommandSignature(0x1234 + value);
+    result.builtAt = builtAt;
+    result.computedAt = builtAt + 1;
+    result.start = 1.5;
+    result.end = 2.25;
+    return result;
+  }
+};
+
+}
+
+TEST_F(LogBuildDBTest, RoundTrip) {
+  std::string error;
+  SimpleRule ruleA("a"), ruleB("b"), ruleC("c");
+  KeyID a = delegate.getKeyID("a");
+  KeyID b = delegate.getKeyID("b");
+  KeyID c = delegate.getKeyID("c");
+
+  {
+    auto db = open();
+    ASSERT_TRUE(db->buildStarted(&error));
+    EXPECT_TRUE(db->setCurrentIteration(7, &error));
+
+    Result resultA = makeResult(10, 3);
+    resultA.dependencies.push_back(b, /*orderOnly=*/false, /*singleUse=*/true);
+    resultA.dependencies.push_back(c, /*orderOnly=*/true, /*singleUse=*/false);
+    EXPECT_TRUE(db->setRuleResult(a, ruleA, resultA, &error));
+    EXPECT_TRUE(db->setRuleResult(b, ruleB, makeResult(20, 4), &error));
+
+    // Results written during the build are visible before they are flushed.
+    Result result;
+    EXPECT_TRUE(db->lookupRuleResult(b, ruleB, &result, &error));
+    EXPECT_EQ(result.value, std::vector<uint8_t>({ 20, 21, 22 }));
+
+    // A later result supersedes the earlier one.
+    EXPECT_TRUE(db->setRuleResult(b, ruleB, makeResult(30, 5), &error));
+    db->buildComplete();
+  }
+
+  // Reopen and check the results persisted.
+  auto db = open();
+  bool success;
+  EXPECT_EQ(db->getCurrentEpoch(&success, &error), 7u);
+  EXPECT_TRUE(success);
+
+  Result result;
+  ASSERT_TRUE(db->lookupRuleResult(a, ruleA, &result, &error));
+  EXPECT_EQ(error, "");
+  EXPECT_EQ(result.value, std::vector<uint8_t>({ 10, 11, 12 }));
+  EXPECT_EQ(result.signature.value, uint64_t(0x1234 + 10));
+  EXPECT_EQ(result.builtAt, 3u);
+  EXPECT_EQ(result.computedAt, 4u);
+  EXPECT_EQ(result.start, 1.5);
+  EXPECT_EQ(result.end, 2.25);
+  ASSERT_EQ(result.dependencies.size(), 2u);
+  EXPECT_EQ(result.dependencies[0].keyID, b);
+  EXPECT_FALSE(result.dependencies[0].orderOnly);
+  EXPECT_TRUE(result.dependencies[0].singleUse);
+  EXPECT_EQ(result.dependencies[1].keyID, c);
+  EXPECT_TRUE(result.dependencies[1].orderOnly);
+  EXPECT_FALSE(result.dependencies[1].singleUse);
+
+  Result resultB;
+  ASSERT_TRUE(db->lookupRuleResult(b, ruleB, &resultB, &error));
+  EXPECT_EQ(resultB.value, std::vector<uint8_t>({ 30, 31, 32 }));
+  EXPECT_EQ(resultB.builtAt, 5u);
+
+  // The dependency 'c' was recorded as a key, but has no result.
+  Result resultC;
+  EXPECT_FALSE(db->lookupRuleResult(c, ruleC, &resultC, &error));
+  EXPECT_EQ(error, "");
+
+  std::vector<KeyType> keys;
+  EXPECT_TRUE(db->getKeys(keys, &error));
+  EXPECT_EQ(keys.size(), 3u);
+
+  std::vector<KeyType> keysWithResult;
+  std::vector<Result> results;
+  EXPECT_TRUE(db->getKeysWithResult(keysWithResult, results, &error));
+  ASSERT_EQ(keysWithResult.size(), 2u);
+  EXPECT_EQ(keysWithResult[0].str(), "a");
+  EXPECT_EQ(keysWithResult[1].str(), "b");
+  EXPECT_EQ(results[1].value, std::vector<uint8_t>({ 30, 31, 32 }));
+}
+
+TEST_F(LogBuildDBTest, LockedWhileBuilding) {
+  std::string error;
+  auto db = open();
+  auto secondDB = open();
+
+  EXPECT_TRUE(db->buildStarted(&error));
+  EXPECT_EQ(error, "");
+
+  bool success = true;
+  secondDB->getCurrentEpoch(&success, &error);
+  EXPECT_FALSE(success);
+  EXPECT_TRUE(error.find("database is locked") != std::string::npos);
+
+  // The lock is released when the build completes.
+  db->buildComplete();
+  error.clear();
+  secondDB->getCurrentEpoch(&success, &error);
+  EXPECT_TRUE(success);
+  EXPECT_EQ(error, "");
+}
+
+TEST_F(LogBuildDBTest, VersionMismatch) {
+  std::string error;
+  SimpleRule rule("a");
+  KeyID a = delegate.getKeyID("a");
+  {
+    auto db = open(1);
+    EXPECT_TRUE(db->setRuleResult(a, rule, makeResult(1, 1), &error));
+    db->buildComplete();
+  }
+
+  {
+    auto db = open(2, /*recreateUnmatchedVersion=*/false);
+    bool success = true;
+    db->getCurrentEpoch(&success, &error);
+    EXPECT_FALSE(success);
+    EXPECT_TRUE(error.find("Version mismatch") != std::string::npos);
+  }
+
+  // Recreating the database drops the old results.
+  error.clear();
+  auto db = open(2);
+  Result result;
+  EXPECT_FALSE(db->lookupRuleResult(a, rule, &result, &error));
+  EXPECT_EQ(error, "");
+}
+
+TEST_F(LogBuildDBTest, RecreatedByAnotherClient) {
+  std::string error;
+  SimpleRule ruleA("a"), ruleB("b");
+  KeyID a = delegate.getKeyID("a");
+  KeyID b = delegate.getKeyID("b");
+
+  auto db = open();
+  ASSERT_TRUE(db->buildStarted(&error));
+  EXPECT_TRUE(db->setRuleResult(a, ruleA, makeResult(1, 1), &error));
+  EXPECT_TRUE(db->setRuleResult(b, ruleB, makeResult(2, 1), &error));
+  db->buildComplete();
+
+  // Another client recreates the log, assigning the keys in a different order.
+  ASSERT_FALSE(bool(llvm::sys::fs::remove(dbPath.str())));
+  {
+    auto otherDB = open();
+    ASSERT_TRUE(otherDB->buildStarted(&error));
+    EXPECT_TRUE(otherDB->setRuleResult(b, ruleB, makeResult(3, 2), &error));
+    EXPECT_TRUE(otherDB->setRuleResult(a, ruleA, makeResult(4, 2), &error));
+    otherDB->buildComplete();
+  }
+
+  // The first client doesn't reuse its stale key ID mappings.
+  ASSERT_TRUE(db->buildStarted(&error));
+  Result resultA, resultB;
+  ASSERT_TRUE(db->lookupRuleResult(a, ruleA, &resultA, &error));
+  EXPECT_EQ(resultA.value, std::vector<uint8_t>({ 4, 5, 6 }));
+  ASSERT_TRUE(db->lookupRuleResult(b, ruleB, &resultB, &error));
+  EXPECT_EQ(resultB.value, std::vector<uint8_t>({ 3, 4, 5 }));
+  db->buildComplete();
+}
+
+TEST_F(LogBuildDBTest, TruncatedRecord) {
+  std::string error;
+  SimpleRule ruleA("a"), ruleB("b");
+  KeyID a = delegate.getKeyID("a");
+  KeyID b = delegate.getKeyID("b");
+  {
+    auto db = open();
+    EXPECT_TRUE(db->setRuleResult(a, ruleA, makeResult(1, 1), &error));
+    EXPECT_TRUE(db->setRuleResult(b, ruleB, makeResult(2, 1), &error));
+    db->buildComplete();
+  }
+
+  // Simulate a crash in the middle of writing the last record.
+  uint64_t size;
+  ASSERT_FALSE(bool(llvm::sys::fs::file_size(dbPath, size)));
+  ASSERT_EQ(::truncate(dbPath.c_str(), size - 4), 0);
+
+  auto db = open();
+  Result resultA, resultB;
+  EXPECT_TRUE(db->lookupRuleResult(a, ruleA, &resultA, &error));
+  EXPECT_EQ(resultA.value, std::vector<uint8_t>({ 1, 2, 3 }));
+  EXPECT_FALSE(db->lookupRuleResult(b, ruleB, &resultB, &error));
+  EXPECT_EQ(error, "");
+
+  // The log remains usable after the torn record.
+  EXPECT_TRUE(db->setRuleResult(b, ruleB, makeResult(3, 2), &error));
+  db->buildComplete();
+  auto reopenedDB = open();
+  Result reopenedB;
+  EXPECT_TRUE(reopenedDB->lookupRuleResult(b, ruleB, &reopenedB, &error));
+  EXPECT_EQ(reopenedB.value, std::vector<uint8_t>({ 3, 4, 5 }));
+}
+
+TEST_F(LogBuildDBTest, Compaction) {
+  std::string error;
+  SimpleRule rule("a");
+  KeyID a = delegate.getKeyID("a");
+  KeyID b = delegate.getKeyID("b");
+
+  // Repeatedly overwrite a large result, so the log is dominated by dead
+  // records.
+  {
+    auto db = open();
+    Result result = makeResult(1, 1);
+    result.value.resize(64 * 1024, 0xAB);
+    result.dependencies.push_back(b, false, false);
+    for (int i = 0; i != 64; ++i) {
+      result.builtAt = i;
+      EXPECT_TRUE(db->setRuleResult(a, rule, result, &error));
+    }
+    db->buildComplete();
+  }
+
+  uint64_t sizeBefore, sizeAfter;
+  ASSERT_FALSE(bool(llvm::sys::fs::file_size(dbPath, sizeBefore)));
+  EXPECT_GT(sizeBefore, uint64_t(4 * 1024 * 1024));
+
+  auto db = open();
+  Result result;
+  ASSERT_TRUE(db->lookupRuleResult(a, rule, &result, &error));
+  EXPECT_EQ(result.builtAt, 63u);
+  EXPECT_EQ(result.value.size(), size_t(64 * 1024));
+  ASSERT_EQ(result.dependencies.size(), 1u);
+  EXPECT_EQ(result.dependencies[0].keyID, b);
+  db->buildComplete();
+
+  ASSERT_FALSE(bool(llvm::sys::fs::file_size(dbPath, sizeAfter)));
+  EXPECT_LT(sizeAfter, uint64_t(128 * 1024));
+}
+
+TEST_F(LogBuildDBTest, RuleStatistics) {
+  std::string error;
+  SimpleRule ruleA("a");
+  KeyID a = delegate.getKeyID("a");
+  KeyID b = delegate.getKeyID("b");
+
+  RuleStatistics statistics;
+  statistics.addRun(4.0, 1024, 100);
+  EXPECT_EQ(statistics.runCount, 1u);
+  EXPECT_EQ(statistics.weightedDuration, 4.0);
+  statistics.addRun(8.0, 2048, 200);
+  EXPECT_EQ(statistics.runCount, 2u);
+  EXPECT_EQ(statistics.weightedDuration, 5.0);
+  EXPECT_EQ(statistics.peakRSS, 2048u);
+  EXPECT_EQ(statistics.outputBytes, 200u);
+
+  {
+    auto db = open();
+    EXPECT_TRUE(db->setRuleResult(a, ruleA, makeResult(1, 1), &error));
+    EXPECT_TRUE(db->setRuleStatistics(a, RuleStatistics(), &error));
+    EXPECT_TRUE(db->setRuleStatistics(a, statistics, &error));
+
+    // Keys without a result may still have statistics.
+    RuleStatistics statisticsB;
+    statisticsB.addRun(1.0, 1, 2);
+    EXPECT_TRUE(db->setRuleStatistics(b, statisticsB, &error));
+    db->buildComplete();
+  }
+
+  // Reopen and check the latest statistics persisted, and the results are
+  // unaffected.
+  auto db = open();
+  RuleStatistics result;
+  ASSERT_TRUE(db->lookupRuleStatistics(a, &result, &error));
+  EXPECT_EQ(error, "");
+  EXPECT_EQ(result.runCount, 2u);
+  EXPECT_EQ(result.weightedDuration, 5.0);
+  EXPECT_EQ(result.peakRSS, 2048u);
+  EXPECT_EQ(result.outputBytes, 200u);
+  ASSERT_TRUE(db->lookupRuleStatistics(b, &result, &error));
+  EXPECT_EQ(result.runCount, 1u);
+
+  Result resultA;
+  EXPECT_TRUE(db->lookupRuleResult(a, ruleA, &resultA, &error));
+  EXPECT_EQ(resultA.value, std::vector<uint8_t>({ 1, 2, 3 }));
+
+  KeyID c = delegate.getKeyID("c");
+  EXPECT_FALSE(db->lookupRuleStatistics(c, &result, &error));
+  EXPECT_EQ(error, "");
+}
+
+TEST_F(LogBuildDBTest, WriteErrorAtBuildComplete) {
+  std::string error;
+  SimpleRule ruleA("a");
+  KeyID a = delegate.getKeyID("a");
+
+  auto db = open();
+  ASSERT_TRUE(db->buildStarted(&error));
+  EXPECT_TRUE(db->setCurrentIteration(1, &error));
+  EXPECT_TRUE(db->setRuleResult(a, ruleA, makeResult(10, 1), &error));
+  EXPECT_TRUE(delegate.errors.empty());
+
+  // Prevent the log from growing, so the buffered records can't be written.
+  struct rlimit previousLimit;
+  ASSERT_EQ(::getrlimit(RLIMIT_FSIZE, &previousLimit), 0);
+  struct rlimit limit = previousLimit;
+  limit.rlim_cur = 16;
+  auto previousHandler = ::signal(SIGXFSZ, SIG_IGN);
+  ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &limit), 0);
+
+  // The failure is reported to the delegate.
+  db->buildComplete();
+
+  ::setrlimit(RLIMIT_FSIZE, &previousLimit);
+  ::signal(SIGXFSZ, previousHandler);
+
+  ASSERT_EQ(delegate.errors.size(), 1u);
+  EXPECT_TRUE(delegate.errors[0].find("unable to write build results") !=
+              std::string::npos);
+}
@@ -0,0 +1,209 @@
+//===- unittests/Core/PreloadingBuildDBTest.cpp ---------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "llbuild/Core/BuildDB.h"
+#include "llbuild/Core/BuildEngine.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
+
+#include "gtest/gtest.h"
+
+#include <deque>
+
+using namespace llbuild;
+using namespace llbuild::core;
+
+namespace {
+
+/// A delegate which assigns stable key IDs to any requested key.
+class SimpleDBDelegate : public BuildDBDelegate {
+  std::deque<KeyType> keys;
+  llvm::StringMap<KeyID> keyIDs;
+
+public:
+  virtual const KeyID getKeyID(StringRef key) override {
+    auto it = keyIDs.find(key);
+    if (it != keyIDs.end())
+      return it->second;
+    keys.push_back(key);
+    KeyID id(&keys.back());
+    keyIDs[key] = id;
+    return id;
+  }
+
+  virtual KeyType getKeyForID(const KeyID key) override {
+    return *reinterpret_cast<const KeyType*>(uintptr_t(key.value()));
+  }
+};
+
+/// An in-memory database which counts the reads made on it.
+class CountingBuildDB : public BuildDB {
+public:
+  std::vector<std::pair<KeyType, Result>> results;
+  unsigned numLookups = 0;
+  unsigned numBulkReads = 0;
+
+  virtual void attachDelegate(BuildDBDelegate*) override {}
+
+  virtual Epoch getCurrentEpoch(bool* success_out, std::string*) override {
+    *success_out = true;
+    return 0;
+  }
+
+  virtual bool setCurrentIteration(uint64_t, std::string*) override {
+    return true;
+  }
+
+  virtual bool lookupRuleResult(KeyID, const KeyType& key,
+                                Result* result_out, std::string*) override {
+    ++numLookups;
+    for (const auto& entry: results) {
+      if (entry.first == key) {
+        *result_out = entry.second;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  virtual bool setRuleResult(KeyID, const Rule& rule, const Result& result,
+                             std::string*) override {
+    results.push_back({ rule.key, result });
+    return true;
+  }
+
+  virtual bool buildStarted(std::string*) override { return true; }
+
+  virtual void buildComplete() override {}
+
+  virtual bool getKeys(std::vector<KeyType>&, std::string*) override {
+    return true;
+  }
+
+  virtual bool getKeysWithResult(std::vector<KeyType>& keys_out,
+                                 std::vector<Result>& results_out,
+                                 std::string*) override {
+    ++numBulkReads;
+    for (const auto& entry: results) {
+      keys_out.push_back(entry.first);
+      results_out.push_back(entry.second);
+    }
+    return true;
+  }
+};
+
+class SimpleRule : public Rule {
+public:
+  SimpleRule(const KeyType& key) : Rule(key) {}
+  Task* createTask(BuildEngine&) override { return nullptr; }
+  bool isResultValid(BuildEngine&, const ValueType&) override { return true; }
+};
+
+TEST(PreloadingBuildDBTest, LookupsAreServedFromMemory) {
+  SimpleDBDelegate delegate;
+  auto countingDB = new CountingBuildDB();
+  auto db = createPreloadingBuildDB(std::unique_ptr<BuildDB>(countingDB));
+  db->attachDelegate(&delegate);
+  std::string error;
+
+  SimpleRule ruleA("a"), ruleB("b"), ruleC("c");
+  Result resultA;
+  resultA.value = { 1 };
+  resultA.builtAt = 1;
+  resultA.dependencies.push_back(delegate.getKeyID("b"), false, false);
+  Result resultB;
+  resultB.value = { 2 };
+  resultB.builtAt = 1;
+  countingDB->results.push_back({ "a", resultA });
+  countingDB->results.push_back({ "b", resultB });
+
+  Result result;
+  ASSERT_TRUE(db->lookupRuleResult(delegate.getKeyID("a"), ruleA, &result,
+                                   &error));
+  EXPECT_EQ(result.value, std::vector<uint8_t>({ 1 }));
+  ASSERT_EQ(result.dependencies.size(), 1u);
+  EXPECT_EQ(result.dependencies[0].keyID, delegate.getKeyID("b"));
+
+  Result missing;
+  EXPECT_FALSE(db->lookupRuleResult(delegate.getKeyID("c"), ruleC, &missing,
+                                    &error));
+  EXPECT_EQ(error, "");
+
+  // A replaced result is not served from the preloaded table.
+  Result newResultB;
+  newResultB.value = { 3 };
+  newResultB.builtAt = 2;
+  EXPECT_TRUE(db->setRuleResult(delegate.getKeyID("b"), ruleB, newResultB,
+                                &error));
+  Result lookedUpB;
+  EXPECT_FALSE(db->lookupRuleResult(delegate.getKeyID("b"), ruleB, &lookedUpB,
+                                    &error));
+
+  EXPECT_EQ(countingDB->numBulkReads, 1u);
+  EXPECT_EQ(countingDB->numLookups, 0u);
+}
+
+TEST(PreloadingBuildDBTest, SQLiteRoundTrip) {
+  llvm::SmallString<256> dbPath;
+  auto ec = llvm::sys::fs::createTemporaryFile("build", "db", dbPath);
+  ASSERT_FALSE(bool(ec));
+  std::string error;
+
+  SimpleRule ruleA("a"), ruleB("b");
+  {
+    SimpleDBDelegate delegate;
+    auto db = createSQLiteBuildDB(dbPath, 1, true, &error);
+    db->attachDelegate(&delegate);
+    ASSERT_TRUE(db->buildStarted(&error));
+    Result resultA;
+    resultA.value = { 1, 2 };
+    resultA.builtAt = 3;
+    resultA.computedAt = 2;
+    resultA.dependencies.push_back(delegate.getKeyID("b"), true, false);
+    resultA.dependencies.push_back(delegate.getKeyID("c"), false, true);
+    EXPECT_TRUE(db->setRuleResult(delegate.getKeyID("a"), ruleA, resultA,
+                                  &error));
+    db->buildComplete();
+  }
+
+  // Read the results back with a fresh delegate, so every key is mapped by the
+  // bulk read.
+  SimpleDBDelegate delegate;
+  auto db = createPreloadingBuildDB(
+      createSQLiteBuildDB(dbPath, 1, true, &error));
+  db->attachDelegate(&delegate);
+
+  Result result;
+  ASSERT_TRUE(db->lookupRuleResult(delegate.getKeyID("a"), ruleA, &result,
+                                   &error));
+  EXPECT_EQ(error, "");
+  EXPECT_EQ(result.value, std::vector<uint8_t>({ 1, 2 }));
+  EXPECT_EQ(result.builtAt, 3u);
+  EXPECT_EQ(result.computedAt, 2u);
+  ASSERT_EQ(result.dependencies.size(), 2u);
+  EXPECT_EQ(result.dependencies[0].keyID, delegate.getKeyID("b"));
+  EXPECT_TRUE(result.dependencies[0].orderOnly);
+  EXPECT_EQ(result.dependencies[1].keyID, delegate.getKeyID("c"));
+  EXPECT_TRUE(result.dependencies[1].singleUse);
+
+  Result resultB;
+  EXPECT_FALSE(db->lookupRuleResult(delegate.getKeyID("b"), ruleB, &resultB,
+                                    &error));
+  EXPECT_EQ(error, "");
+
+  db = nullptr;
+  llvm::sys::fs::remove(dbPath.str());
+}
+
+}
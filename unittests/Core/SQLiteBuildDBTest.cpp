@@ -13,15 +13,44 @@
 #include "llbuild/Core/BuildDB.h"
 
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/FileSystem.h"
 
 #include "gtest/gtest.h"
 
+#include <deque>
+
 #include <sqlite3.h>
 
 using namespace llbuild;
 using namespace llbuild::core;
 
+namespace {
+
+class SimpleDBDelegate : public BuildDBDelegate {
+  std::deque<KeyType> keys;
+  llvm::StringMap<KeyID> keyIDs;
+
+public:
+  virtual const KeyID getKeyID(StringRef key) override {
+    auto it = keyIDs.find(key);
+    if (it != keyIDs.end())
+      return it->second;
+    keys.push_back(key);
+    KeyID id(&keys.back());
+    keyIDs[key] = id;
+    return id;
+  }
+
+  virtual KeyType getKeyForID(const KeyID key) override {
+    return *reinterpret_cast<const KeyType*>(uintptr_t(key.value()));
+  }
+
+  virtual void error(const Twine& message) override {}
+};
+
+}
+
 TEST(SQLiteBuildDBTest, ErrorHandling) {
     // Create a temporary file.
     llvm::SmallString<256> dbPath;
@@ -123,3 +152,56 @@ TEST(SQLiteBuildDBTest, CloseDBConnectionAfterCloseCall) {
   
   buildDB->buildComplete();
 }
+
+TEST(SQLiteBuildDBTest, AddsStatisticsTableToExistingDatabase) {
+  // Check that a database written before rule statistics were stored is
+  // upgraded in place, rather than recreated.
+  llvm::SmallString<256> dbPath;
+  auto ec = llvm::sys::fs::createTemporaryFile("build", "db", dbPath);
+  EXPECT_EQ(bool(ec), false);
+
+  std::string error;
+  {
+    std::unique_ptr<BuildDB> buildDB = createSQLiteBuildDB(
+        dbPath, 1, /* recreateUnmatchedVersion = */ true, &error);
+    ASSERT_TRUE(buildDB != nullptr);
+    ASSERT_TRUE(buildDB->buildStarted(&error));
+    EXPECT_TRUE(buildDB->setCurrentIteration(7, &error));
+    buildDB->buildComplete();
+  }
+
+  // Remove the statistics table, as an older client would have written it.
+  sqlite3 *db = nullptr;
+  ASSERT_EQ(SQLITE_OK, sqlite3_open(dbPath.c_str(), &db));
+  EXPECT_EQ(SQLITE_OK, sqlite3_exec(db, "DROP TABLE rule_statistics;",
+                                    nullptr, nullptr, nullptr));
+  sqlite3_close(db);
+
+  SimpleDBDelegate delegate;
+  std::unique_ptr<BuildDB> buildDB = createSQLiteBuildDB(
+      dbPath, 1, /* recreateUnmatchedVersion = */ true, &error);
+  ASSERT_TRUE(buildDB != nullptr);
+  buildDB->attachDelegate(&delegate);
+  bool success = false;
+  EXPECT_EQ(7U, buildDB->getCurrentEpoch(&success, &error));
+  EXPECT_TRUE(success);
+  EXPECT_EQ("", error);
+
+  KeyID key = delegate.getKeyID("key");
+  RuleStatistics statistics;
+  statistics.addRun(1.0, 2, 3);
+  ASSERT_TRUE(buildDB->buildStarted(&error));
+  EXPECT_TRUE(buildDB->setRuleStatistics(key, statistics, &error));
+  buildDB->buildComplete();
+
+  RuleStatistics result;
+  EXPECT_TRUE(buildDB->lookupRuleStatistics(key, &result, &error));
+  EXPECT_EQ("", error);
+  EXPECT_EQ(1U, result.runCount);
+  EXPECT_EQ(2U, result.peakRSS);
+  EXPECT_EQ(3U, result.outputBytes);
+  buildDB = nullptr;
+
+  ec = llvm::sys::fs::remove(dbPath.str());
+  EXPECT_EQ(bool(ec), false);
+}
@@ -0,0 +1,236 @@
+//===- unittests/Core/WriteBehindBuildDBTest.cpp --------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2026 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "llbuild/Core/BuildDB.h"
+#include "llbuild/Core/BuildEngine.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include "gtest/gtest.h"
+
+#include <mutex>
+
+using namespace llbuild;
+using namespace llbuild::core;
+
+namespace {
+
+/// An in-memory database which records the operations made on it.
+class RecordingBuildDB : public BuildDB {
+public:
+  struct State {
+    std::mutex mutex;
+    std::vector<std::string> log;
+    llvm::DenseMap<KeyID, Result> results;
+    bool failWrites = false;
+  };
+
+private:
+  State& state;
+
+  void record(const std::string& entry) {
+    std::lock_guard<std::mutex> guard(state.mutex);
+    state.log.push_back(entry);
+  }
+
+public:
+  RecordingBuildDB(State& state) : state(state) {}
+
+  virtual void attachDelegate(BuildDBDelegate*) override {}
+
+  virtual Epoch getCurrentEpoch(bool* success_out, std::string*) override {
+    *success_out = true;
+    return 0;
+  }
+
+  virtual bool setCurrentIteration(uint64_t value, std::string*) override {
+    record("iteration " + std::to_string(value));
+    return true;
+  }
+
+  virtual bool lookupRuleResult(KeyID keyID, const KeyType&,
+                                Result* result_out, std::string*) override {
+    std::lock_guard<std::mutex> guard(state.mutex);
+    auto it = state.results.find(keyID);
+    if (it == state.results.end())
+      return false;
+    *result_out = it->second;
+    return true;
+  }
+
+  virtual bool setRuleResult(KeyID keyID, const Rule& rule,
+                             const Result& result,
+                             std::string* error_out) override {
+    std::lock_guard<std::mutex> guard(state.mutex);
+    if (state.failWrites) {
+      *error_out = "write failed";
+      return false;
+    }
+    state.log.push_back("set " + rule.key.str());
+    state.results[keyID] = result;
+    return true;
+  }
+
+  virtual bool buildStarted(std::string*) override {
+    record("started");
+    return true;
+  }
+
+  virtual void buildComplete() override {
+    record("complete");
+  }
+
+  virtual bool getKeys(std::vector<KeyType>&, std::string*) override {
+    return true;
+  }
+
+  virtual bool getKeysWithResult(std::vector<KeyType>&, std::vector<Result>&,
+                                 std::string*) override {
+    return true;
+  }
+};
+
+/// A delegate which records reported errors.
+class ErrorRecordingDelegate : public BuildDBDelegate {
+public:
+  std::vector<std::string> errors;
+
+  virtual const KeyID getKeyID(StringRef key) override {
+    return KeyID::novalue();
+  }
+
+  virtual KeyType getKeyForID(const KeyID) override { return {}; }
+
+  virtual void error(const Twine& message) override {
+    errors.push_back(message.str());
+  }
+};
+
+class SimpleRule : public Rule {
+public:
+  SimpleRule(const KeyType& key) : Rule(key) {}
+  Task* createTask(BuildEngine&) override { return nullptr; }
+  bool isResultValid(BuildEngine&, const ValueType&) override { return true; }
+};
+
+TEST(WriteBehindBuildDBTest, WritesAreOrderedAndFlushed) {
+  RecordingBuildDB::State state;
+  auto db = createWriteBehindBuildDB(
+      llvm::make_unique<RecordingBuildDB>(state), /*batchSize=*/4);
+  std::string error;
+
+  std::vector<std::unique_ptr<SimpleRule>> rules;
+  for (int i = 0; i != 10; ++i)
+    rules.push_back(llvm::make_unique<SimpleRule>("k" + std::to_string(i)));
+
+  ASSERT_TRUE(db->buildStarted(&error));
+  for (int i = 0; i != 10; ++i) {
+    Result result;
+    result.builtAt = i + 1;
+    EXPECT_TRUE(db->setRuleResult(KeyID(rules[i].get()), *rules[i], result,
+                                  &error));
+  }
+  EXPECT_TRUE(db->setCurrentIteration(3, &error));
+  db->buildComplete();
+
+  std::lock_guard<std::mutex> guard(state.mutex);
+  ASSERT_EQ(state.log.size(), 13u);
+  EXPECT_EQ(state.log[0], "started");
+  for (int i = 0; i != 10; ++i)
+    EXPECT_EQ(state.log[i + 1], "set k" + std::to_string(i));
+  EXPECT_EQ(state.log[11], "iteration 3");
+  EXPECT_EQ(state.log[12], "complete");
+}
+
+TEST(WriteBehindBuildDBTest, LookupSeesPendingWrite) {
+  RecordingBuildDB::State state;
+  auto db = createWriteBehindBuildDB(
+      llvm::make_unique<RecordingBuildDB>(state), /*batchSize=*/1000);
+  std::string error;
+  SimpleRule rule("a");
+
+  ASSERT_TRUE(db->buildStarted(&error));
+  Result result;
+  result.builtAt = 7;
+  EXPECT_TRUE(db->setRuleResult(KeyID(&rule), rule, result, &error));
+
+  // The batch is not full, so the lookup must wait for the write.
+  Result lookedUp;
+  EXPECT_TRUE(db->lookupRuleResult(KeyID(&rule), rule, &lookedUp, &error));
+  EXPECT_EQ(lookedUp.builtAt, 7u);
+  db->buildComplete();
+}
+
+TEST(WriteBehindBuildDBTest, WriteErrorsAreReported) {
+  RecordingBuildDB::State state;
+  state.failWrites = true;
+  auto db = createWriteBehindBuildDB(
+      llvm::make_unique<RecordingBuildDB>(state), /*batchSize=*/1);
+  std::string error;
+  SimpleRule rule("a");
+
+  ASSERT_TRUE(db->buildStarted(&error));
+  EXPECT_TRUE(db->setRuleResult(KeyID(&rule), rule, Result{}, &error));
+
+  // The failure is reported at the next barrier.
+  EXPECT_FALSE(db->setCurrentIteration(1, &error));
+  EXPECT_EQ(error, "write failed");
+
+  // And by any subsequent write in the same build.
+  error.clear();
+  EXPECT_FALSE(db->setRuleResult(KeyID(&rule), rule, Result{}, &error));
+  EXPECT_EQ(error, "write failed");
+  db->buildComplete();
+}
+
+TEST(WriteBehindBuildDBTest, LastWriteErrorIsReportedAtBuildComplete) {
+  RecordingBuildDB::State state;
+  state.failWrites = true;
+  auto db = createWriteBehindBuildDB(
+      llvm::make_unique<RecordingBuildDB>(state), /*batchSize=*/1);
+  ErrorRecordingDelegate delegate;
+  db->attachDelegate(&delegate);
+  std::string error;
+  SimpleRule rule("a");
+
+  // A failure in the last writes of a build is reported to the delegate.
+  ASSERT_TRUE(db->buildStarted(&error));
+  EXPECT_TRUE(db->setRuleResult(KeyID(&rule), rule, Result{}, &error));
+  db->buildComplete();
+  ASSERT_EQ(delegate.errors.size(), 1u);
+  EXPECT_EQ(delegate.errors[0], "write failed");
+
+  // Once reported, the failure doesn't affect the next build.
+  state.failWrites = false;
+  EXPECT_TRUE(db->buildStarted(&error));
+  EXPECT_TRUE(db->setRuleResult(KeyID(&rule), rule, Result{}, &error));
+  db->buildComplete();
+  EXPECT_EQ(delegate.errors.size(), 1u);
+}
+
+TEST(WriteBehindBuildDBTest, UnreportedWriteErrorFailsNextBuild) {
+  RecordingBuildDB::State state;
+  state.failWrites = true;
+  auto db = createWriteBehindBuildDB(
+      llvm::make_unique<RecordingBuildDB>(state), /*batchSize=*/1);
+  std::string error;
+  SimpleRule rule("a");
+
+  // A failure from a build which never completed is returned when the next
+  // build starts.
+  ASSERT_TRUE(db->buildStarted(&error));
+  EXPECT_TRUE(db->setRuleResult(KeyID(&rule), rule, Result{}, &error));
+  EXPECT_FALSE(db->buildStarted(&error));
+  EXPECT_EQ(error, "write failed");
+}
+
+}